@@ -21,12 +21,16 @@
     for (unsigned int i = 0, max = [parameters count]; i < max; i++)
     {
         id parameter = [parameters objectAtIndex:i];
+        NSAppleEventDescriptor *descriptor = nil;
         if ([parameter isKindOfClass:[NSAppleEventDescriptor class]])
-            [directObject insertDescriptor:parameter atIndex:i];
+            descriptor = parameter;
         else if ([parameter isKindOfClass:[NSString class]])
-            [directObject insertDescriptor:[NSAppleEventDescriptor descriptorWithString:parameter] atIndex:i];
+            descriptor = [NSAppleEventDescriptor descriptorWithString:parameter];
         else if ([parameter respondsToSelector:@selector(intValue)])
-            [directObject insertDescriptor:[NSAppleEventDescriptor descriptorWithInt32:[parameter intValue]] atIndex:i];
+            descriptor = [NSAppleEventDescriptor descriptorWithInt32:[parameter intValue]];
+        if (descriptor)
+            // list indices start at 1: inserting at 1 each time would replace the first item
+            [directObject insertDescriptor:descriptor atIndex:[directObject numberOfItems] + 1];
     }
     [event setDescriptor:directObject forKeyword:keyDirectObject];
     return [self executeAppleEvent:event error:errorInfo];
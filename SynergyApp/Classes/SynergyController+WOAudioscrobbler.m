@@ -9,7 +9,7 @@
 // other headers
 #import "WOAudioscrobblerController.h"
 #import "WOAudioscrobbler.h"
-#import "WOProcessManager.h"
+#import "WOPlayerSnapshot.h"
 #import "NSTimer+WOPausable.h"
 #import "WOPreferences.h"
 #import "WODebug.h"
@@ -29,6 +29,10 @@ BOOL lastFmEnabled;
 // could make these instance variables, but for now leave them as file-scoped globals
 NSTimer *audioscrobblerTimer;
 
+// user info of the submission timer that fired, while waiting for the snapshot
+// that confirms the position
+NSDictionary *audioscrobblerPendingCheck;
+
 // which track are we monitoring?
 NSMutableDictionary *audioscrobblerCurrentTrack;
 
@@ -49,28 +53,29 @@ NSMutableDictionary *audioscrobblerCurrentTrack;
     NSParameterAssert(aTimer != nil);
     NSDictionary *info = (NSDictionary *)[aTimer userInfo];
     NSParameterAssert(info != nil);
-    NSNumber *length = [info objectForKey:WO_AUDIOSCROBBLER_LENGTH];
-    NSParameterAssert(length != nil);
+    NSParameterAssert([info objectForKey:WO_AUDIOSCROBBLER_LENGTH] != nil);
+    audioscrobblerTimer = nil;
 
-    // query iTunes and ask it if we are where we think we should be (at the "trigger" point)
-    unsigned trigger = MIN((unsigned)240, ([length unsignedIntValue] / 2));
+    // query iTunes and ask it if we are where we think we should be (at the "trigger" point); if the main timer is
+    // also waiting for a snapshot, the same one answers both
+    audioscrobblerPendingCheck = info;
+    [playerQueue requestSnapshotForTarget:self selector:@selector(audioscrobblerCheckPosition:)];
+}
 
-    static NSAppleScript *script = nil;
-    if (!script)
-        // effectively leak this script, keeping it around for the lifetime of the program to avoid recompiling it every single time
-        script = [[NSAppleScript alloc] initWithSource:@"tell application \"iTunes\" to get player position"];
-    if (!script)
-        NSLog(@"Error compiling AppleScript (audioscrobblerTimerFired:)");
-
-    // was a bug: this method reliably caused iTunes to respawn if it was quit
-    // there is still about a 2 second window of possible error in which iTunes can quit and the system will claim it is still running
-    // the proper solution is to use Apple Events (which don't cause a respawn) but that will be for Synergy Advance
-    NSAppleEventDescriptor *result = nil;
-    if ([WOProcessManager processRunningWithSignature:'hook'])
-        result = [script executeAndReturnError:NULL];
-    if (result)
+// was a bug: a script asking for the player position reliably caused iTunes to respawn if it was quit; the snapshot
+// checks that iTunes answers an Apple Event first
+- (void)audioscrobblerCheckPosition:(WOPlayerSnapshot *)snapshot
+{
+    NSDictionary *info = audioscrobblerPendingCheck;
+    audioscrobblerPendingCheck = nil;
+    if (!info)
+        // cancelled while waiting for the snapshot
+        return;
+    NSNumber *length = [info objectForKey:WO_AUDIOSCROBBLER_LENGTH];
+    unsigned trigger = MIN((unsigned)240, ([length unsignedIntValue] / 2));
+    if ([snapshot hasTrack])
     {
-        SInt32 position = [result int32Value];
+        SInt32 position = [snapshot position];
         if ((position > WO_AUDIOSCROBBLER_SKIP_CHECK_RESOLUTION) &&
             (abs(position - trigger) < WO_AUDIOSCROBBLER_SKIP_CHECK_RESOLUTION))
         {
@@ -84,8 +89,7 @@ NSMutableDictionary *audioscrobblerCurrentTrack;
             WOAudioscrobblerLog(@"Position does not match (user must have skipped); will not submit to Audioscrobbler");
     }
     else
-        NSLog(@"Error executing AppleScript (audioscrobblerTimerFired:)");
-    audioscrobblerTimer = nil;
+        NSLog(@"Error getting player position (audioscrobblerCheckPosition:)");
 }
 
 // if the submission timer is running, invalidates it
@@ -94,6 +98,7 @@ NSMutableDictionary *audioscrobblerCurrentTrack;
     WOAudioscrobblerLog(@"Cancelling previously existing submission timer, if any");
     [audioscrobblerTimer cancel];
     audioscrobblerTimer = nil;
+    audioscrobblerPendingCheck = nil;
 }
 
 // called at launch and whenever the preferences get updated
@@ -107,6 +112,13 @@ NSMutableDictionary *audioscrobblerCurrentTrack;
         audioscrobblerController    = [[WOAudioscrobblerController alloc] init];        // leak this, effectively a singleton
         audioscrobbler              = [[WOAudioscrobbler alloc] init];                  // again, effectively a singleton
         firstTime = YES;
+
+        NSArray *mirrors = NSMakeCollectable(CFPreferencesCopyAppValue
+            ((CFStringRef)WO_AUDIOSCROBBLER_MIRRORS, kCFPreferencesCurrentApplication));
+        if ([mirrors isKindOfClass:[NSArray class]])
+            for (NSString *mirror in mirrors)
+                if ([mirror isKindOfClass:[NSString class]])
+                    [audioscrobbler addMirrorWithHandshakeURLBase:mirror];
     }
 
 #ifdef USE_BUGGY_VERSION
@@ -138,6 +150,7 @@ NSMutableDictionary *audioscrobblerCurrentTrack;
     if (firstTime)
     {
         WOAudioscrobblerLog(@"First time we've read the preferences; will start a new session");
+        [audioscrobbler importLibraryPlays:[self audioscrobblerEnabled]];
         [audioscrobbler startSession];
     }
     else
@@ -8,10 +8,13 @@
 
 #import "Growl/Growl.h"
 
+#import "WOPlayerBackend.h"
+
 // used to register Synergy Help with system
 @class WOSynergyView, WOPreferences,
 WODistributedNotification, WOSynergyFloaterController,
-WOFeedbackController, WOAudioscrobblerController, WOAudioscrobbler;
+WOFeedbackController, WOAudioscrobblerController, WOAudioscrobbler,
+WOArtworkPipeline, WOPlayerSnapshot, WOPlayerPollScheduler, WOPlayerQueue;
 
 // presets for internal iTunes state variable
 #define ITUNES_PAUSED 0
@@ -21,26 +24,9 @@ WOFeedbackController, WOAudioscrobblerController, WOAudioscrobbler;
 #define ITUNES_ERROR 4
 #define ITUNES_UNKNOWN 5
 
-typedef enum WORepeatMode {
-
-    WORepeatOff = 0,
-    WORepeatOne = 1,
-    WORepeatAll = 2,
-    WORepeatUnknown = 3
-
-} WORepeatMode;
-
-typedef enum WOShuffleState {
-
-    WOShuffleOff = 0,
-    WOShuffleOn = 1,
-    WOShuffleUnknown = 2
-
-} WOShuffleState;
-
 // This "singleton-like" class does all the real work: we instantiate it once at
 // launch from the main nib
-@interface SynergyController : NSObject <GrowlApplicationBridgeDelegate>
+@interface SynergyController : NSObject <GrowlApplicationBridgeDelegate, WOPlayerBackendDelegate>
 {
     BOOL waitingForITunesToLaunch;
     // custom view for display of control buttons in menu bar
@@ -53,6 +39,10 @@ typedef enum WOShuffleState {
 
     // last known state of iTunes
     int iTunesState;
+
+    // state of iTunes when the play/pause hot key was pressed, for choosing
+    // the feedback icon once the answer comes back
+    int stateBeforePlayPause;
     int playerPosition;
 
     // last known shuffle state of iTunes
@@ -109,11 +99,20 @@ typedef enum WOShuffleState {
     IBOutlet NSMenuItem *activateITunesMenuItem;
     IBOutlet NSMenuItem *launchQuitITunesMenuItem;
 
-    //a timer which will let us check iTunes every 10 seconds
+    //a timer which will let us check iTunes every so often (see pollScheduler)
     NSTimer *mainTimer;
 
-    //the script to get information from iTunes
-    NSAppleScript *getSongInfoScript;
+    //! decides when mainTimer should next fire
+    WOPlayerPollScheduler *pollScheduler;
+
+    //! the music player (iTunes)
+    id <WOPlayerBackend> player;
+
+    //! everything that sends Apple Events to the player goes through here, off the main thread
+    WOPlayerQueue *playerQueue;
+
+    //! what the timer last got from the player, to work out which parts of the UI need updating; nil forces a full update
+    WOPlayerSnapshot *lastSnapshot;
 
     WOPreferences *synergyPreferences;
 
@@ -146,13 +145,16 @@ typedef enum WOShuffleState {
     float communicationInterval; // use a float here because that's what NSTimer wants
 
     // temporary storage if user tries to play a song and iTunes not running
-    NSAppleEventDescriptor  *songToPlayOnceLaunched;
-
-    // true for iTunes 4.7 and up
-    BOOL iTunesSendsNotifications;
+    id songToPlayOnceLaunched;
 
     NSString *lastKnownTrackIdentifier;
 
+    //! userInfo of the most recent com.apple.iTunes.playerInfo notification
+    NSDictionary *lastPlayerInfo;
+
+    //! finds artwork for the floater (created on first use)
+    WOArtworkPipeline *artworkPipeline;
+
     NSArray *trackChangeLaunchItems;
 
     //! Set to YES when user double-clicks a button set in the Finder
@@ -316,9 +318,9 @@ typedef enum WOShuffleState {
 - (void)increaseRatingHotKeyPressed;
 
 // slave method that does all the heavy lifting for setting song ratings
-- (BOOL)setRating:(int)newRating;
+- (void)setRating:(int)newRating;
 
-- (void)tellITunesToPlaySong:(NSAppleEventDescriptor *)descriptor;
+- (void)tellITunesToPlaySong:(id)identifier;
 
 - (void)tellITunesToggleMute;
 - (void)tellITunesToggleShuffle;
@@ -328,16 +330,12 @@ typedef enum WOShuffleState {
 - (void)tellITunesActivate;
 - (void)hideITunes;
 
-// make sure iTunes is running and ready to process Apple Events before firing
-// off our status script
-- (BOOL)iTunesReadyToReceiveAppleScript;
-
 - (NSString *)chooseRandomButtonSet;
 
 // called when download is completed in separate thread
 - (void)coverDownloadDone:(NSNotification *)notification;
 
-// true for iTunes 4.7 and up
+// true for iTunes 4.7 and up (see WOPlayerBackend's sendsNotifications)
 - (BOOL)iTunesSendsNotifications;
 
 // track change launch items support
@@ -350,18 +348,17 @@ typedef enum WOShuffleState {
 
 // accessors
 
+- (id <WOPlayerBackend>)player;
+
 - (BOOL)hitAmazon;
 
 // temporary storage for song id (used while waiting for iTunes to launch)
-- (void)setSongToPlayOnceLaunched:(NSAppleEventDescriptor *)songId;
-- (NSAppleEventDescriptor *)songToPlayOnceLaunched;
+- (void)setSongToPlayOnceLaunched:(id)songId;
+- (id)songToPlayOnceLaunched;
 
 - (NSArray *)trackChangeLaunchItems;
 - (void)setTrackChangeLaunchItems:(NSArray *)aTrackChangeLaunchItems;
 
-// refactoring for sending simple Apple Events to iTunes
-- (void)sendAppleEventClass:(AEEventClass)eventClass ID:(AEEventID)eventID;
-
 #pragma mark GrowlApplicationBridgeDelegate protocol
 
 - (NSDictionary *)registrationDictionaryForGrowl;
@@ -8,7 +8,6 @@
 #import <unistd.h>
 
 // other headers
-#import "iTunes.h"
 #import "WOSynergyGlobal.h"
 #import "SynergyController.h"
 #import "HotkeyCapableApplication.h"
@@ -19,8 +18,15 @@
 #import "WOCarbonWrappers.h"
 #import "WOSynergyFloaterController.h"
 #import "WOFeedbackController.h"
-#import "WOProcessManager.h"
+#import "WOITunesPlayer.h"
+#import "WOPlayerPollScheduler.h"
+#import "WOPlayerQueue.h"
+#import "WOPlayerSnapshot.h"
+#import "WOArtworkPipeline.h"
+#import "WOArtworkRequest.h"
 #import "WOCoverDownloader.h"
+#import "WOCoverImageCache.h"
+#import "WOCoverStore.h"
 #import "WOExceptions.h"
 #import "WOSongInfo.h"
 #import "WOAudioscrobblerController.h"
@@ -45,6 +51,7 @@
 
 // macros for keys in a "songDictionary" (identifying info for a song)
 #define WO_SONG_DICTIONARY_ID       @"_woSongDictionaryId"
+#define WO_SONG_DICTIONARY_KEY      @"_woSongDictionaryKey"
 #define WO_SONG_DICTIONARY_TITLE    @"_woSongDictionaryTitle"
 #define WO_SONG_DICTIONARY_ARTIST   @"_woSongDictionaryArtist"
 
@@ -73,9 +80,29 @@ UInt32      widthCode;
 
 #pragma mark Private methods
 
-@interface SynergyController ()
+@interface SynergyController () <WOArtworkPipelineDelegate>
 
 - (NSString *)audioscrobblerMenuTitleForState:(BOOL)enabled;
+- (NSString *)pathOfNotifiedTrack:(NSString *)title album:(NSString *)album;
+- (WOArtworkPipeline *)artworkPipeline;
+- (void)updateWithSnapshot:(WOPlayerSnapshot *)snapshot;
+
+//! \name Answers from playerQueue
+//! \startgroup
+
+- (void)didPlayTrack:(NSNumber *)success;
+- (void)volumeDidChange:(NSNumber *)segments;
+- (void)ratingDidChange:(NSNumber *)rating;
+- (void)shuffleDidToggle:(NSNumber *)newState;
+- (void)repeatModeDidCycle:(NSNumber *)newMode;
+- (void)playlistNamesDidArrive:(NSArray *)names;
+- (void)playPauseDidFinish:(WOPlayerSnapshot *)snapshot;
+
+//! \endgroup
+
+//! makes the next timer: update everything, not just what changed in the player; for after changes to the preferences
+//! or the UI made behind the timer's back
+- (void)setNeedsFullUpdate;
 
 @end
 
@@ -105,11 +132,9 @@ UInt32      widthCode;
         self = [super init];
         _sharedSynergyController = self;
 
-        NSURL *url = [NSURL fileURLWithPath:
-            [[[NSBundle mainBundle] resourcePath]
-            stringByAppendingPathComponent:@"Scripts/getSongInfo.scpt"] ];
-
-        getSongInfoScript = [[NSAppleScript alloc] initWithContentsOfURL:url error:nil];
+        player = [[WOITunesPlayer alloc] init];
+        [player setDelegate:self];
+        playerQueue = [[WOPlayerQueue alloc] initWithPlayer:player];
 
         songList = [[NSMutableArray alloc] init];
 
@@ -281,17 +306,12 @@ UInt32      widthCode;
                        name:@"NSWorkspaceDidTerminateApplicationNotification"
                      object:nil];
 
-        // keep timer intact, but with a ridiculously long interval
-        communicationInterval = 60.0 * 60.0 * 24.0 * 30.0 ; // once per month
     }
 
-    // register for notifications regardless
-    [[NSDistributedNotificationCenter
-        defaultCenter] addObserver:self
-                          selector:@selector(handleNotification:)
-                              name:@"com.apple.iTunes.playerInfo"
-                            object:nil];
-
+    // the scheduler moves the fire date after every poll (see timer:), so the
+    // repeat interval only matters if that ever fails to happen
+    pollScheduler = [[WOPlayerPollScheduler alloc] initWithBaseInterval:communicationInterval];
+    [pollScheduler setPlayerSendsNotifications:[self iTunesSendsNotifications]];
     mainTimer = [NSTimer scheduledTimerWithTimeInterval:communicationInterval
                                                   target:self
                                                 selector:@selector(timer:)
@@ -679,22 +699,12 @@ UInt32      widthCode;
         if (communicationInterval > WO_MAX_POLLING_INTERVAL)
             communicationInterval = WO_MAX_POLLING_INTERVAL;
 
-        if ([self iTunesSendsNotifications])
-            // keep timer intact, but with a ridiculously long interval
-            communicationInterval = 60.0 * 60.0 * 24.0 * 30.0 ; // once/month
-
-        // change timer interval if necessary
-        if ([mainTimer timeInterval] != communicationInterval)
+        // takes effect from the next poll, which also ends any back-off
+        if ([pollScheduler baseInterval] != communicationInterval)
         {
-            // destroy the old timer
-            [mainTimer invalidate];
-
-            // and create a new one
-            mainTimer = [NSTimer scheduledTimerWithTimeInterval:communicationInterval
-                                                          target:self
-                                                        selector:@selector(timer:)
-                                                        userInfo:nil
-                                                         repeats:YES];
+            [pollScheduler setBaseInterval:communicationInterval];
+            if (![self iTunesSendsNotifications])
+                [mainTimer setFireDate:[NSDate dateWithTimeIntervalSinceNow:communicationInterval]];
         }
 
         [NSApp registerHotkeys];
@@ -846,6 +856,7 @@ UInt32      widthCode;
             [self addGlobalMenu];
     }
 
+    [self setNeedsFullUpdate];
     [mainTimer fire];
 }
 
@@ -1394,238 +1405,76 @@ UInt32      widthCode;
 
 - (void) timer:(NSTimer *)timer
 {
-    // this variable used as shorthand for floater "always on" status
-    BOOL floaterAlways = (BOOL)([[synergyPreferences objectOnDiskForKey:_woFloaterDurationPrefKey] floatValue] > 21.0);
-
     // let prefPane know that we're still running
     [synergyPrefPane notifyPrefPane:WODNAppIsRunning];
 
-    // this is what we are going to try and retrieve from iTunes
-    NSString                *playerState  = nil;
-    NSAppleEventDescriptor  *songId       = nil;
-    NSString                *songTitle    = nil;
-    NSString                *albumName    = nil;
-    NSString                *artistName   = nil;
-    NSString                *composerName = nil;
-    NSString                *songDuration = nil;
-    NSString                *year         = nil;
-
-    WORatingCode            songRating    = WO0StarRating;
-
-    NSMutableDictionary     *songDictionary = nil;
-
-    // check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
-    {
-        /*
-
-         1. that it takes a second or two before the process manager sees that
-         iTunes isn't running
-         2. that Apple events sent to a non-running app have no effect -- presumably
-         because the PSN isn't in use
-         2b. when it's not running, no error is produced, so i can't test for
-         error status in order to ascertain if it's working
-         3. that events sent to a just-launched app will be queued until the app
-         is eventually ready, and they get processed
-         4. that apple events will never cause a respawn
-         5. that apple script is the friggin culprit, because only the applescript
-         cause the respawn
-         6. that i should reimplement the getInfoScript as an AppleEvent request
-
-         */
-
-        if ([self iTunesReadyToReceiveAppleScript])
-        {
-            NSAppleEventDescriptor *descriptor = [getSongInfoScript executeAndReturnError:NULL];
-
-            if (descriptor && [descriptor numberOfItems] == 1)
-            {
-                // result will be "error", "not running" or "not playing"
-                playerState = [descriptor stringValue];
-            }
-            else if (descriptor && [descriptor numberOfItems] == 12)
-            {
-                // result should be "stopped", "playing" or "paused"
-
-                // experimentation shows that if no selection the time the script
-                // is first run, it will from then on return a human-readable string
-                //
-                // in the reverse case, it returns the non-human-readable version!
-
-                // hack for inconsistent AppleScript behaviour:
-
-                // GCC 3.3. warnings ("non-ASCII character in CFString literal")
-                NSString *playingString = // build string: "«constant ****kPSP»"
-                [NSString stringWithFormat:@"%Cconstant ****kPSP%C",
-                    WO_LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR,
-                    WO_RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR];
-
-                NSString *pausedString = // build string: "«constant ****kPSp»"
-                    [NSString stringWithFormat:@"%Cconstant ****kPSp%C",
-                        WO_LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR,
-                        WO_RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR];
-
-                NSString *stoppedString = // build string: "«constant ****kPSS»"
-                    [NSString stringWithFormat:@"%Cconstant ****kPSS%C",
-                        WO_LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR,
-                        WO_RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR];
-
-                if ([[[descriptor descriptorAtIndex:1] stringValue] isEqualToString:playingString])
-                    playerState = @"playing";
-
-                // for now, consider "stopped" to be equivalent to "paused"
-                else if (([[[descriptor descriptorAtIndex:1] stringValue] isEqualToString:pausedString]) ||
-                         ([[[descriptor descriptorAtIndex:1] stringValue] isEqualToString:stoppedString]) ||
-                         ([[[descriptor descriptorAtIndex:1] stringValue] isEqualToString:@"stopped"]))
-                    playerState = @"paused";
-
-                else
-                    // we got a literal string like "stopped", "playing" or "paused"
-                    playerState = [[descriptor descriptorAtIndex:1] stringValue];
-
-
-                // this is a descriptor containing a parameter of a form like:
-                //  file track id 9227 of user playlist id 9213 of source id 33
-                //  of application "iTunes"
-                songId = [descriptor descriptorAtIndex:2];
-                songTitle = [[descriptor descriptorAtIndex:3] stringValue];
-
-                // even songTitle may be nil on Snow Leopard it would seem
-                // see: https://wincent.com/issues/1381
-                if (!songTitle)
-                    songTitle = @"";
-
-                // check for nil values here (eg. Internet radio with missing tags)
-
-                albumName =
-                    [[descriptor descriptorAtIndex:4] stringValue];
-
-                if (!albumName)
-                    albumName = @"";
-
-                artistName =
-                    [[descriptor descriptorAtIndex:5] stringValue];
-
-                if (!artistName)
-                    artistName = @"";
-
-                composerName = [[descriptor descriptorAtIndex:6] stringValue];
-                if (!composerName) composerName = @"";
-
-                songDuration =
-                    [[descriptor descriptorAtIndex:7] stringValue];
-
-                if (!songDuration)
-                    songDuration = @"";
-
-                // year: equals "0" if not set
-                if([[[descriptor descriptorAtIndex:8] stringValue] isEqualToString:@"0"])
-                    year = @"";
-                else
-                {
-                    year = [[descriptor descriptorAtIndex:8] stringValue];
-
-                    if (year == nil)
-                        year = @"";
-                }
-
-                // song rating: convert it from a 0-100 integer into a 0-5 star
-                // rating
-                NSString *unconvertedSongRating =
-                    [NSString stringWithString:
-                        [[descriptor descriptorAtIndex:9] stringValue]];
-                int convertedRating = [unconvertedSongRating intValue];
-
-                // http://wincent.com/a/support/bugs/show_bug.cgi?id=366
-                if (convertedRating > 80)       songRating = WO5StarRating;
-                else if (convertedRating > 60)  songRating = WO4StarRating;
-                else if (convertedRating > 40)  songRating = WO3StarRating;
-                else if (convertedRating > 20)  songRating = WO2StarRating;
-                else if (convertedRating > 0)   songRating = WO1StarRating;
-                else                            songRating = WO0StarRating;
-
-                // repeat mode: should be "all", "one" or "off"
-                NSString *tempRepeatMode =
-                    [[descriptor descriptorAtIndex:10] stringValue];
-
-                if ([tempRepeatMode isEqualToString:@"all"])
-                    // just write it straight to our ivar
-                    repeatMode = WORepeatAll;
-                else if ([tempRepeatMode isEqualToString:@"one"])
-                    repeatMode = WORepeatOne;
-                else if ([tempRepeatMode isEqualToString:@"off"])
-                    repeatMode = WORepeatOff;
-                else
-                    // temporarily commenting out this error msg (it is spewing
-                    // out every time through the loop until I change the repeat
-                    // mode once, then it stops)
-                    repeatMode = WORepeatUnknown;
-
-                // shuffle state: should be "true" or "false"
-                NSString *tempShuffleState =
-                    [[descriptor descriptorAtIndex:11] stringValue];
-
-                if ([tempShuffleState isEqualToString:@"true"])
-                    shuffleState = WOShuffleOn;
-                else if ([tempShuffleState isEqualToString:@"false"])
-                    shuffleState = WOShuffleOff;
-                else
-                    shuffleState = WOShuffleUnknown;
-
-                // player position: integer 0, 1, 2 etc seconds
-                playerPosition = [[descriptor descriptorAtIndex:12] int32Value];
-            }
-            else
-            {
-                playerState = [NSString stringWithString:@"error"];
-
-                songId =
-                    [NSAppleEventDescriptor descriptorWithString:@"error"];
-
-                // set other variables to reasonable defaults
-                songTitle     = @"";
-                albumName     = @"";
-                artistName    = @"";
-                composerName  = @"";
-                songDuration  = @"";
-                year          = @"";
-                songRating    = WO0StarRating;
-                repeatMode    = WORepeatUnknown;
-                shuffleState  = WOShuffleUnknown;
-            }
-
-        }
-        else
-        {
-            // iTunes is NOT ready to receive the AppleScript!
+    // the answer comes back to updateWithSnapshot: on the main thread; if a
+    // request is already waiting (iTunes is busy) this one is folded into it
+    [playerQueue requestSnapshotForTarget:self selector:@selector(updateWithSnapshot:)];
+}
 
-            /*
+- (void)updateWithSnapshot:(WOPlayerSnapshot *)snapshot
+{
+    // this variable used as shorthand for floater "always on" status
+    BOOL floaterAlways = (BOOL)([[synergyPreferences objectOnDiskForKey:_woFloaterDurationPrefKey] floatValue] > 21.0);
 
-             This is not considered grounds to classify iTunes as "not running"
-             because there can be transitory failures in which iTunes will not
-             respond to the Apple Event within the timeout simply because the
-             user is dragging the window (or something similar).
+    // this is what we retrieved from iTunes
+    WOPlayerState           playerState   = [snapshot state];
+    id                      songId        = [snapshot trackIdentifier];
+    NSString                *songTitle    = [snapshot title];
+    NSString                *albumName    = [snapshot album];
+    NSString                *artistName   = [snapshot artist];
+    NSString                *composerName = [snapshot composer];
+    NSString                *songDuration = [snapshot duration];
+    NSString                *year         = [snapshot year];
 
-             So in these cases we do NOT classify things as "not running" or
-             because this could cause the Synergy
-             controls to be removed from the menu bar which might not be the
-             desired effect...
+    WORatingCode            songRating    = WO0StarRating;
 
-             */
-            playerState = [NSString stringWithString:@"unknown"];
-        }
+    NSMutableDictionary     *songDictionary = nil;
 
-    }
-    else
+    // only the parts of the UI built from fields that changed since the last
+    // tick get updated; a click, or a nil lastSnapshot (see
+    // setNeedsFullUpdate), means everything
+    WOPlayerChanges         changes       = WOPlayerChangedEverything;
+    if (!buttonClickOccurred && lastSnapshot)
+        changes = [snapshot changesSince:lastSnapshot];
+    lastSnapshot = snapshot;
+
+    // whatever brought this poll about (the timer, a click or a notification),
+    // the next one is counted from now
+    [mainTimer setFireDate:
+        [NSDate dateWithTimeIntervalSinceNow:[pollScheduler intervalAfterSnapshot:snapshot changes:changes]]];
+
+    if ([snapshot hasTrack])
+    {
+        // song rating: convert it from a 0-100 integer into a 0-5 star rating
+        // http://wincent.com/a/support/bugs/show_bug.cgi?id=366
+        int convertedRating = [snapshot rating];
+        if (convertedRating > 80)       songRating = WO5StarRating;
+        else if (convertedRating > 60)  songRating = WO4StarRating;
+        else if (convertedRating > 40)  songRating = WO3StarRating;
+        else if (convertedRating > 20)  songRating = WO2StarRating;
+        else if (convertedRating > 0)   songRating = WO1StarRating;
+        else                            songRating = WO0StarRating;
+
+        // just write these straight to our ivars
+        repeatMode      = [snapshot repeatMode];
+        shuffleState    = [snapshot shuffleState];
+        playerPosition  = [snapshot position];
+    }
+    else if (playerState == WOPlayerError)
     {
-        // well, it's not running, so let's try and avoid triggering an
-        // unwanted re-launch by pre-setting "result" as follows
-        playerState = [NSString stringWithString:@"not running"];
+        repeatMode      = WORepeatUnknown;
+        shuffleState    = WOShuffleUnknown;
     }
 
+    // the position is only read by the Audioscrobbler timer
+    if ((changes & ~WOPlayerChangedPosition) == WOPlayerChangedNothing)
+        return;
+
     // now we have all the info we need from iTunes, so time to start processing
 
-    if([playerState isEqualToString:@"not running"])
+    if (playerState == WOPlayerNotRunning)
     {
         NSString *errorMessage = [NSLocalizedString(@"Not running",
                                                     @"Not running tool-tip")
@@ -1668,7 +1517,7 @@ UInt32      widthCode;
         // iTunes; buttons are ghosted and unusable for up to 10 seconds while
         // waiting for next run of this timer method.
     }
-    else if([playerState isEqualToString:@"not playing"])
+    else if (playerState == WOPlayerNotPlaying)
     {
         NSString *errorMessage = [NSLocalizedString(
                                                     @"Not playing",
@@ -1770,7 +1619,7 @@ UInt32      widthCode;
         //[synergyMenuView enablePrevButton];
 
     }
-    else if([playerState isEqualToString:@"error"])
+    else if (playerState == WOPlayerError)
     {
         // we can get here when iTunes music store previews are playing, for example
         NSString *errorMessage = [NSLocalizedString(
@@ -1797,8 +1646,7 @@ UInt32      widthCode;
 
 
     }
-    else if (([playerState isEqualToString:@"playing"]) ||
-             ([playerState isEqualToString:@"paused"]))
+    else if ([snapshot hasTrack])
     {
 
         //         // this flag is used later on to determine if we are newly transitioning
@@ -1816,7 +1664,7 @@ UInt32      widthCode;
 
         // parts specific to playing and paused states:
 
-        if ([playerState isEqualToString:@"paused"])
+        if (playerState == WOPlayerPaused)
         {
             // update iTunes state variable
             if (iTunesState != ITUNES_PAUSED)
@@ -1891,359 +1739,285 @@ UInt32      widthCode;
 
         // parts shared between paused and playing states
 
-        // construct songDictionary from components -- store just enough to
-        // uniquely identify the song
-
-        songDictionary =
-        [NSMutableDictionary dictionaryWithCapacity:5];
-
-        // track identifier
-        [songDictionary setObject:songId
-                           forKey:WO_SONG_DICTIONARY_ID];
+        // song info, artwork and the "buy now" link only depend on the track
+        WOSongInfo *songInfo = nil;
+        if (changes & WOPlayerChangedTrackInfo)
+        {
+            // construct songDictionary from components -- store just enough to
+            // uniquely identify the song
 
-        // title
-        // was crashing here: https://wincent.com/issues/1381
-        // should never be nil because I've added a check above,
-        // but double-check it here to be defensive
-        [songDictionary setObject:(songTitle ? songTitle : NSLocalizedString(@"Untitled", @"Untitled"))
-                           forKey:WO_SONG_DICTIONARY_TITLE];
+            songDictionary =
+            [NSMutableDictionary dictionaryWithCapacity:5];
 
-        // artist
-        [songDictionary setObject:artistName
-                           forKey:WO_SONG_DICTIONARY_ARTIST];
+            // track identifier
+            [songDictionary setObject:songId
+                               forKey:WO_SONG_DICTIONARY_ID];
+            [songDictionary setObject:[snapshot trackKey]
+                               forKey:WO_SONG_DICTIONARY_KEY];
 
-        // for now, shoehorning support for album cover downloads into place
-        // by jamming in a WOSongInfo object
+            // title
+            // was crashing here: https://wincent.com/issues/1381
+            // the snapshot never has a nil title, but double-check it here to be
+            // defensive
+            [songDictionary setObject:(songTitle ? songTitle : NSLocalizedString(@"Untitled", @"Untitled"))
+                               forKey:WO_SONG_DICTIONARY_TITLE];
 
-        // first, create the object
-        WOSongInfo *songInfo =  [[WOSongInfo alloc] init];
+            // artist
+            [songDictionary setObject:artistName
+                               forKey:WO_SONG_DICTIONARY_ARTIST];
 
-        // populate it
-        [songInfo setSong:songTitle];
-        [songInfo setArtist:artistName];
-        [songInfo setAlbum:albumName];
+            // for now, shoehorning support for album cover downloads into place
+            // by jamming in a WOSongInfo object
 
-        // store it in songDictionary
-        [songDictionary setObject:songInfo forKey:WO_SONG_DICTIONARY_SONGINFO];
+            // first, create the object
+            songInfo = [[WOSongInfo alloc] init];
 
-        NSFileManager *manager = [NSFileManager defaultManager];
+            // populate it
+            [songInfo setSong:songTitle];
+            [songInfo setArtist:artistName];
+            [songInfo setAlbum:albumName];
 
-        // only attempt download if user preferences specify
-        if ([[synergyPreferences objectOnDiskForKey:_woFloaterGraphicType] intValue] == WOFloaterIconAlbumCover)
-        {
-            BOOL artSentToFloater = NO;
+            // store it in songDictionary
+            [songDictionary setObject:songInfo forKey:WO_SONG_DICTIONARY_SONGINFO];
 
-            // check disk first
-            NSString *filename = [songInfo filename];
-            NSString *tempCoverPath = [[WOCoverDownloader tempAlbumCoversPath] stringByAppendingPathComponent:filename];
-            NSString *coverPath = [[WOCoverDownloader albumCoversPath] stringByAppendingPathComponent:filename];
+            // the cover index has the "buy now" link, if there is one, without
+            // touching the disk
+            WOCoverStore *coverStore = [WOCoverDownloader coverStore];
+            WOCoverRecord coverRecord;
+            NSURL *storedBuyNowURL = nil;
+            [coverStore lookupKey:[songInfo coverKey] record:&coverRecord buyNowURL:&storedBuyNowURL];
 
-            if (filename)   // only do this if filename non-nil
+            // only look for artwork if user preferences specify
+            if ([[synergyPreferences objectOnDiskForKey:_woFloaterGraphicType] intValue] == WOFloaterIconAlbumCover)
             {
-                if ([manager fileExistsAtPath:tempCoverPath])
-                {
-                    // notify floater
-                    [floaterController setAlbumImagePath:tempCoverPath];
-                    artSentToFloater = YES;
-                }
-                else if ([manager fileExistsAtPath:coverPath])
-                {
+                // anything on the local disk normally turns up before this returns;
+                // otherwise the floater goes blank until the pipeline calls back
+                NSString            *trackPath  = [self pathOfNotifiedTrack:songTitle album:albumName];
+                WOArtworkRequest    *request    = [[WOArtworkRequest alloc] initWithSongInfo:songInfo trackPath:trackPath];
+                WOArtworkPipeline   *pipeline   = [self artworkPipeline];
+                if (!pipeline || ![pipeline findArtworkForRequest:request])
                     // notify floater
-                    [floaterController setAlbumImagePath:coverPath];
-                    artSentToFloater = YES;
-                }
+                    [floaterController setAlbumImagePath:nil];
             }
-
-            // check if iTunes supplied cover art
-            if (artSentToFloater == NO)
+            else
             {
-                // enclose this in an exception handling block because I've heard reports that this can crash
-                NS_DURING
-
-                    // old implementation actually stored the cover art in
-                    // the descriptor every time through the loop
-                    // new implemenation only tries grabbing it on demand:
-
-                    NSAppleEventDescriptor  *coverDescriptor = nil;
-                    NSAppleScript           *coverScript;
-                    static NSString         *coverScriptSource =
-                        @"tell application \"iTunes\"\n"
-                        @"  try\n"
-                        @"    if data of the artworks of the current track exists then\n"
-                        @"      return data of artwork 1 of current track as picture\n"
-                        @"    else\n"
-                        @"      return \"NO COVER\"\n"
-                        @"    end if\n"
-                        @"  on error\n"
-                        @"    return \"NO COVER\"\n"
-                        @"  end try\n"
-                        @"end tell\n";
-
-                    coverScript = [[NSAppleScript alloc] initWithSource:coverScriptSource];
-                    coverDescriptor = [coverScript executeAndReturnError:NULL];
-                    if (coverDescriptor && ![[coverDescriptor stringValue] isEqualToString:@"NO COVER"])
-                    {
-                        NSData *coverData = [coverDescriptor data];
-                        NSImage *coverImage = nil;
-                        if (coverData)
-                            coverImage = [[NSImage alloc] initWithData:coverData];
-                        if (!coverImage)
-                            [NSException raise:WO_ITUNES_ALBUM_COVER_TRANSFER_FAILURE
-                                        format:WO_ITUNES_ALBUM_COVER_TRANSFER_FAILURE_TEXT];
-
-                        // save a copy to disk
-                        NSData *coverDataAsTIFF = [coverImage TIFFRepresentationUsingCompression:NSTIFFCompressionLZW factor:1.0];
-                        NSBitmapImageRep    *rep = [NSBitmapImageRep imageRepWithData:coverDataAsTIFF];
-                        NSNumber            *quality = [NSNumber numberWithFloat:0.80];
-                        NSDictionary        *properties = [NSDictionary dictionaryWithObject:quality
-                                                                                      forKey:NSImageCompressionFactor];
-                        NSData *coverDataAsJPEG = [rep representationUsingType:NSJPEGFileType properties:properties];
-
-                        // actually write out to disk
-                        if (![coverDataAsJPEG writeToFile:tempCoverPath atomically:YES])
-                            [NSException raise:WO_ITUNES_ALBUM_COVER_TRANSFER_FAILURE
-                                        format:WO_ITUNES_ALBUM_COVER_TRANSFER_FAILURE_TEXT];
-
-                        // notify floater
-                        [floaterController setAlbumImagePath:tempCoverPath];
-                        artSentToFloater = YES;
-                    }
-                    NS_HANDLER
-                        ELOG(@"Warning: Exception caught while attempting to process cover art data from iTunes");
-                    NS_ENDHANDLER
-
+                // don't display album image (user doesn't want it)
+                [artworkPipeline cancel];
+                [floaterController setAlbumImagePath:nil];
             }
 
-            // alternate method: try downloading from amazon.com
-            if ((artSentToFloater == NO) && [WOCoverDownloader albumCoverExists:songInfo])
+            BOOL enableMenu = NO;
+
+            // do we have a "buy now" link?
+            if ([songInfo buyNowURL])
+                // unghost the menu
+                enableMenu = YES;
+            else if (storedBuyNowURL)
             {
-                // notify floater
-                [floaterController setAlbumImagePath:coverPath];
-                artSentToFloater = YES;
+                // we have the link from the cover index; stick it in the songInfo obj
+                [songInfo setBuyNowURL:storedBuyNowURL];
+
+                // unghost the menu
+                enableMenu = YES;
             }
 
-            if (artSentToFloater == NO)
-                // notify floater
-                [floaterController setAlbumImagePath:nil];
+            // somehow this wasn't getting set...
+            [buyFromAmazonMenuItem setEnabled:enableMenu];
         }
-        else
-            // don't display album image (user doesn't want it)
-            [floaterController setAlbumImagePath:nil];
-
-        BOOL enableMenu = NO;
 
-        // do we have a "buy now" link?
-        if ([songInfo buyNowURL])
-            // unghost the menu
-            enableMenu = YES;
-        else
+        if (changes & WOPlayerChangedFloaterText)
         {
-            // check to see if we have a "buy now" link stored on the disk for this song
-            NSString *buyNowFile =
-            [[[[WOCoverDownloader
-                    albumCoversPath] stringByAppendingPathComponent:[songInfo filename]] stringByDeletingPathExtension] stringByAppendingPathExtension:@"plist"];
+            NSString *extendedTitle;
+            NSString *extendedAlbum;
+
+            // if prefs say so, add duration after song title
+            if ([[synergyPreferences objectOnDiskForKey:_woIncludeDurationInFloaterPrefKey] boolValue])
+                extendedTitle = [[songTitle stringByAppendingString:@" - "] stringByAppendingString:songDuration];
+            else
+                extendedTitle = songTitle;
 
-            NSDictionary *buyNowInfo = [[NSDictionary alloc] initWithContentsOfFile:buyNowFile];
-            if (buyNowInfo)
+            // if prefs say so, add year after album
+            if ([[synergyPreferences objectOnDiskForKey:_woIncludeYearInFloaterPrefKey] boolValue])
             {
-                // we have the info from the disk
-                NSString *URLString = [buyNowInfo objectForKey:@"BuyNowLink"];
+                NSMutableString *bracketedYear;
 
-                // stick it in the songInfo obj
-                if (URLString)
+                if ([year isEqualToString:@""])
+                    bracketedYear = [NSMutableString stringWithString:@""];
+                else
                 {
-                    [songInfo setBuyNowURL:[NSURL URLWithString:URLString]];
-
-                    // unghost the menu
-                    enableMenu = YES;
+                    bracketedYear = [NSMutableString stringWithString:@" ("];
+                    [bracketedYear appendString:year];
+                    [bracketedYear appendString:@")"];
                 }
+                extendedAlbum = [albumName stringByAppendingString:bracketedYear];
             }
-        }
-
-        // somehow this wasn't getting set...
-        [buyFromAmazonMenuItem setEnabled:enableMenu];
+            else
+                extendedAlbum = albumName;
 
-        NSString *extendedTitle;
-        NSString *extendedAlbum;
+            // necessary to update floater strings here, just in case we
+            // have just started running and user presses "Show floater"
+            // hotkey
 
-        // if prefs say so, add duration after song title
-        if ([[synergyPreferences objectOnDiskForKey:_woIncludeDurationInFloaterPrefKey] boolValue])
-            extendedTitle = [[songTitle stringByAppendingString:@" - "] stringByAppendingString:songDuration];
-        else
-            extendedTitle = songTitle;
+            [self updateFloaterStrings:extendedTitle
+                                 album:extendedAlbum
+                                artist:artistName
+                              composer:composerName];
+        }
 
-        // if prefs say so, add year after album
-        if ([[synergyPreferences objectOnDiskForKey:_woIncludeYearInFloaterPrefKey] boolValue])
+        if (changes & WOPlayerChangedRating)
         {
-            NSMutableString *bracketedYear;
-
-            if ([year isEqualToString:@""])
-                bracketedYear = [NSMutableString stringWithString:@""];
+            // update star rating if the prefs say we should do so...
+            if (![[synergyPreferences objectOnDiskForKey:_woIncludeStarRatingInFloaterPrefKey] boolValue])
+                [floaterController setCurrentRating:WONoStarRatingDisplay];
             else
-            {
-                bracketedYear = [NSMutableString stringWithString:@" ("];
-                [bracketedYear appendString:year];
-                [bracketedYear appendString:@")"];
-            }
-            extendedAlbum = [albumName stringByAppendingString:bracketedYear];
+                [floaterController setCurrentRating:songRating];
         }
-        else
-            extendedAlbum = albumName;
-
-        // update star rating if the prefs say we should do so...
-        if (![[synergyPreferences objectOnDiskForKey:_woIncludeStarRatingInFloaterPrefKey] boolValue])
-            [floaterController setCurrentRating:WONoStarRatingDisplay];
-        else
-            [floaterController setCurrentRating:songRating];
-
-        // necessary to update floater strings here, just in case we
-        // have just started running and user presses "Show floater"
-        // hotkey
 
-        [self updateFloaterStrings:extendedTitle
-                             album:extendedAlbum
-                            artist:artistName
-                          composer:composerName];
-
-        // special case to handle bug 45 (floater not resizing when turned off)
-        // http://bugs.wincent.org/bugs/bug.php?op=show&bugid=45&pos=18
-        if (![[synergyPreferences objectOnDiskForKey:_woShowNotificationWindowPrefKey] boolValue])
-            // doesn't show it... only resizes it
-            [floaterController resizeInstantly];
+        if (changes & (WOPlayerChangedFloaterText | WOPlayerChangedRating))
+        {
+            // special case to handle bug 45 (floater not resizing when turned off)
+            // http://bugs.wincent.org/bugs/bug.php?op=show&bugid=45&pos=18
+            if (![[synergyPreferences objectOnDiskForKey:_woShowNotificationWindowPrefKey] boolValue])
+                // doesn't show it... only resizes it
+                [floaterController resizeInstantly];
 
-        // that method will handle missing values and also user preferences
-        // for display/non-display of specific parts
+            // that method will handle missing values and also user preferences
+            // for display/non-display of specific parts
 
-        // need to add a check here to stop us from running this every single frickin time through the loop
-        if (floaterAlways)
-        {
-            // we're supposed to show floater "always"... so we'd best make sure that it's showing
-            // make sure communications with floater aren't suspended
-            if (sendMessagesToFloater && floaterActive)
+            // need to add a check here to stop us from running this every single frickin time through the loop
+            if (floaterAlways)
             {
-                // now send it all off to the notification window
-                if (buttonClickOccurred)
-                    [floaterController clickDrivenUpdate];
-                else
+                // we're supposed to show floater "always"... so we'd best make sure that it's showing
+                // make sure communications with floater aren't suspended
+                if (sendMessagesToFloater && floaterActive)
                 {
-                    // if window is not yet fully faded in, fade it in...
-                    // here's the problem: when the window is at full alpha,
-                    // it never resizes...
-                    if ([floaterController windowAlphaValue] < 1.0)
-                        [floaterController timerDrivenUpdate];
+                    // now send it all off to the notification window
+                    if (buttonClickOccurred)
+                        [floaterController clickDrivenUpdate];
                     else
                     {
-                        // this cures the bug
-                        BOOL oldAnimateWhileResizingValue = [floaterController animateWhileResizing];
-                        [floaterController setAnimateWhileResizing:YES];
-                        [floaterController resizeInstantly];
-                        [floaterController setAnimateWhileResizing:oldAnimateWhileResizingValue];
+                        // if window is not yet fully faded in, fade it in...
+                        // here's the problem: when the window is at full alpha,
+                        // it never resizes...
+                        if ([floaterController windowAlphaValue] < 1.0)
+                            [floaterController timerDrivenUpdate];
+                        else
+                        {
+                            // this cures the bug
+                            BOOL oldAnimateWhileResizingValue = [floaterController animateWhileResizing];
+                            [floaterController setAnimateWhileResizing:YES];
+                            [floaterController resizeInstantly];
+                            [floaterController setAnimateWhileResizing:oldAnimateWhileResizingValue];
+                        }
                     }
                 }
             }
-        }
 
-        // this will update/resize the floater, but it won't put it onscreen
-        // if it is not already
-        [floaterController tellViewItNeedsToDisplay:self];
+            // this will update/resize the floater, but it won't put it onscreen
+            // if it is not already
+            [floaterController tellViewItNeedsToDisplay:self];
+        }
 
-        // use songDictionary to update songList array
-        if ([songList count] == 0)
-            // add first item to songlist
-            [songList addObject:songDictionary];
-        else
+        // use songDictionary to update songList array, and the tooltip
+        if (changes & WOPlayerChangedTrackInfo)
         {
-            /*
-             Check if title, artist or album have changed and update floater if necessary. This check is separate from the AppleEvent descriptor comparison that's used in the menu check immediately below, because otherwise we don't pick up track changes for Internet radio.
-             */
-            NSDictionary *previousTrack = [songList objectAtIndex:0];
-            WOSongInfo *previousTrackInfo = [previousTrack objectForKey:WO_SONG_DICTIONARY_SONGINFO];
-
-            if (![[songInfo song] isEqualToString:[previousTrackInfo song]] ||
-                ![[songInfo artist] isEqualToString:[previousTrackInfo artist]] ||
-                ![[songInfo album] isEqualToString:[previousTrackInfo album]])
+            if ([songList count] == 0)
+                // add first item to songlist
+                [songList addObject:songDictionary];
+            else
             {
-                // at least one of song, artist or album have changed
-
-                // if we're supposed to show the floater AND it's not set to show "always" then
-                if ([[synergyPreferences objectOnDiskForKey:_woShowNotificationWindowPrefKey] boolValue] && !floaterAlways)
-                    // (the "always" case is handled above)
+                /*
+                 Check if title, artist or album have changed and update floater if necessary. This check is separate from the AppleEvent descriptor comparison that's used in the menu check immediately below, because otherwise we don't pick up track changes for Internet radio.
+                 */
+                NSDictionary *previousTrack = [songList objectAtIndex:0];
+                WOSongInfo *previousTrackInfo = [previousTrack objectForKey:WO_SONG_DICTIONARY_SONGINFO];
+
+                if (![[songInfo song] isEqualToString:[previousTrackInfo song]] ||
+                    ![[songInfo artist] isEqualToString:[previousTrackInfo artist]] ||
+                    ![[songInfo album] isEqualToString:[previousTrackInfo album]])
                 {
-                    // make sure communications with floater aren't suspended
-                    if (sendMessagesToFloater && floaterActive)
+                    // at least one of song, artist or album have changed
+
+                    // if we're supposed to show the floater AND it's not set to show "always" then
+                    if ([[synergyPreferences objectOnDiskForKey:_woShowNotificationWindowPrefKey] boolValue] && !floaterAlways)
+                        // (the "always" case is handled above)
                     {
-                        if  (buttonClickOccurred)
-                            [floaterController clickDrivenUpdate];
-                        else
-                            [floaterController timerDrivenUpdate];
+                        // make sure communications with floater aren't suspended
+                        if (sendMessagesToFloater && floaterActive)
+                        {
+                            if  (buttonClickOccurred)
+                                [floaterController clickDrivenUpdate];
+                            else
+                                [floaterController timerDrivenUpdate];
+                        }
                     }
                 }
-            }
-
-            // add item to songlist, checking for duplicates
-            if (![[[[songDictionary objectForKey:WO_SONG_DICTIONARY_ID] data] description] isEqualToString:
-                  [[[previousTrack objectForKey:WO_SONG_DICTIONARY_ID] data] description]])
-            {
-                // Looks like it's not a dupe
-                BOOL duplicateFound = NO;
 
-                // cast to int safe because count always < 50
-                for (int i = 0; i < (int)[songList count]; i++)
+                // add item to songlist, checking for duplicates
+                if (![[songDictionary objectForKey:WO_SONG_DICTIONARY_KEY] isEqualToString:
+                      [previousTrack objectForKey:WO_SONG_DICTIONARY_KEY]])
                 {
-                    if ([[[[[songList objectAtIndex:i] objectForKey:WO_SONG_DICTIONARY_ID] data] description] isEqualToString:
-                         [[[songDictionary objectForKey:WO_SONG_DICTIONARY_ID] data] description]])
+                    // Looks like it's not a dupe
+                    BOOL duplicateFound = NO;
+
+                    // cast to int safe because count always < 50
+                    for (int i = 0; i < (int)[songList count]; i++)
                     {
-                        duplicateFound = YES;
-                        id moveSong = [songList objectAtIndex:i];
+                        if ([[[songList objectAtIndex:i] objectForKey:WO_SONG_DICTIONARY_KEY] isEqualToString:
+                             [songDictionary objectForKey:WO_SONG_DICTIONARY_KEY]])
+                        {
+                            duplicateFound = YES;
+                            id moveSong = [songList objectAtIndex:i];
 
-                        // pull it from list
-                        [songList removeObjectAtIndex:i];
+                            // pull it from list
+                            [songList removeObjectAtIndex:i];
 
-                        // re-insert same object at head of list
-                        [songList insertObject:moveSong atIndex:0];
+                            // re-insert same object at head of list
+                            [songList insertObject:moveSong atIndex:0];
 
-                        // optimisation: can safely assume that never more than
-                        // one duplicate here
-                        break;
+                            // optimisation: can safely assume that never more than
+                            // one duplicate here
+                            break;
+                        }
                     }
-                }
 
-                // if duplicate not found, add new entry
-                if (!duplicateFound)
-                    [songList insertObject:songDictionary atIndex:0];
+                    // if duplicate not found, add new entry
+                    if (!duplicateFound)
+                        [songList insertObject:songDictionary atIndex:0];
+                }
             }
-        }
 
-        NSMutableString *tooltipString = [NSMutableString string];
+            NSMutableString *tooltipString = [NSMutableString string];
 
-        if ([songTitle length] > 0)
-            [tooltipString setString:songTitle];
+            if ([songTitle length] > 0)
+                [tooltipString setString:songTitle];
 
-        if ([albumName length] > 0)
-        {
-            // append separator first if necessary
-            if ([tooltipString length] > 0)
-                [tooltipString appendString:@" - "];
+            if ([albumName length] > 0)
+            {
+                // append separator first if necessary
+                if ([tooltipString length] > 0)
+                    [tooltipString appendString:@" - "];
 
-            [tooltipString appendString:albumName];
-        }
+                [tooltipString appendString:albumName];
+            }
 
-        if ([artistName length] > 0)
-        {
-            // append separator first if necessary
-            if ([tooltipString length] > 0)
-                [tooltipString appendString:@" - "];
+            if ([artistName length] > 0)
+            {
+                // append separator first if necessary
+                if ([tooltipString length] > 0)
+                    [tooltipString appendString:@" - "];
 
-            [tooltipString appendString:artistName];
-        }
+                [tooltipString appendString:artistName];
+            }
 
-        // a test which should never really succeed
-        if ([tooltipString length] == 0)
-            // test if length of entire string is zero, so we have no song name,
-            // and nothing for tool tip
-            [tooltipString setString:NSLocalizedString(@"No track name available",@"No track name available")];
+            // a test which should never really succeed
+            if ([tooltipString length] == 0)
+                // test if length of entire string is zero, so we have no song name,
+                // and nothing for tool tip
+                [tooltipString setString:NSLocalizedString(@"No track name available",@"No track name available")];
 
-        [self updateTooltip:tooltipString];
+            [self updateTooltip:tooltipString];
+        }
     }
     else
     {
@@ -2252,15 +2026,22 @@ UInt32      widthCode;
             iTunesState = ITUNES_UNKNOWN;
         // do not update control hiding status here because app is in an unknown state
 
-        [self updateTooltip:playerState];
+        [self updateTooltip:NSLocalizedString(@"unknown", @"iTunes state unknown tool-tip")];
     }
 
-    [self updateMenu];
+    if (changes & (WOPlayerChangedTrackInfo | WOPlayerChangedState | WOPlayerChangedRepeatMode |
+                   WOPlayerChangedShuffle))
+        [self updateMenu];
 
     // reset buttondriven flag
     buttonClickOccurred = NO;
 }
 
+- (void)setNeedsFullUpdate
+{
+    lastSnapshot = nil;
+}
+
 - (void)updateFloaterStrings:(NSString *)songTitle
                        album:(NSString *)albumName
                       artist:(NSString *)artistName
@@ -2309,19 +2090,9 @@ UInt32      widthCode;
 
 - (void) tellITunesPlayPause;
 {
-    // tell iTunes to play using Apple Events
-
-    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
-
-    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN])
+    if (![player isRunning])
     {
-        // open iTunes using workspace; specifying .app here ensures that OS 9
-        // iTunes doesn't get opened -- fixes:
-        // http://bugs.wincent.org/bugs/bug.php?op=show&bugid=27
-        if ([[NSWorkspace
-            sharedWorkspace] launchApplication:@"iTunes.app"] == NO)
-            ELOG(@"Error attempting to launch iTunes");
-        else
+        if ([player launch])
         {
             // ask to be notified when iTunes finishes launching, and THEN tell
             // it to play
@@ -2336,8 +2107,7 @@ UInt32      widthCode;
         }
     }
     else
-        // Equivalent to: tell application "iTunes" to playpause
-        [self sendAppleEventClass:'hook' ID:'PlPs'];
+        [playerQueue sendCommand:@selector(playPause)];
 
     buttonClickOccurred = YES; // a control button clicked?
 
@@ -2389,35 +2159,10 @@ UInt32      widthCode;
     }
 }
 
-// use: [self sendAppleEventClass:'hook' ID:'Next'];
-- (void)sendAppleEventClass:(AEEventClass)eventClass ID:(AEEventID)eventID
-{
-    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
-    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] == NO)
-    {
-        AppleEvent  event, reply;
-        AEDesc      descriptor;
-        if (AECreateDesc(typeProcessSerialNumber, &iTunesPSN, sizeof(iTunesPSN), &descriptor) == noErr)
-        {
-            if (AECreateAppleEvent(eventClass, eventID, &descriptor, kAutoGenerateReturnID, kAnyTransactionID, &event) == noErr)
-            {
-                if (AESend(&event, &reply, kAENoReply, kAENormalPriority, kAEDefaultTimeout, nil, nil) == noErr)
-                    AEDisposeDesc(&reply);
-                else
-                    ELOG(@"Error (%d) sending Apple Event", noErr);
-
-                AEDisposeDesc(&event);
-            }
-            AEDisposeDesc(&descriptor);
-        }
-    }
-}
-
 // tell iTunes to go to "next"
 - (void)tellITunesNext
 {
-    // Equivalent to: tell application "iTunes" next track
-    [self sendAppleEventClass:'hook' ID:'Next'];
+    [playerQueue sendCommand:@selector(nextTrack)];
     buttonClickOccurred = YES; // a hot-key was pressed
 
     if (![self iTunesSendsNotifications])
@@ -2427,20 +2172,16 @@ UInt32      widthCode;
 // this code almost identical to the previous method; should re-factor
 - (void) tellITunesFastForward
 {
-    // Equivalent to: tell application "iTunes" fast forward
-    // (opposite Apple Event is 'Rwnd')
-    [self sendAppleEventClass:'hook' ID:'Fast'];
+    [playerQueue sendCommand:@selector(fastForward)];
 }
 
 - (void)tellITunesPrev;
 {
     // depending on user prefs, end either "back" or "prev"
     if ([[synergyPreferences objectOnDiskForKey:_woPrevActionSameAsITunesPrefKey] boolValue])
-        // Equivalent to: tell application "iTunes" back track
-        [self sendAppleEventClass:'hook' ID:'Back'];
+        [playerQueue sendCommand:@selector(backTrack)];
     else
-        // Equivalent to: tell application "iTunes" prev track
-        [self sendAppleEventClass:'hook' ID:'Prev'];
+        [playerQueue sendCommand:@selector(previousTrack)];
 
     buttonClickOccurred = YES; // a control button clicked?
     if (![self iTunesSendsNotifications])
@@ -2450,7 +2191,7 @@ UInt32      widthCode;
 // this code almost identical to the tellITunesNext method
 - (void)tellITunesRewind
 {
-    [self sendAppleEventClass:'hook' ID:'Rwnd'];
+    [playerQueue sendCommand:@selector(rewind)];
 }
 
 //- (IBAction) prevTrack:(id)sender
@@ -2467,6 +2208,7 @@ UInt32      widthCode;
         if ([item action] == @selector(playSong:))
             [synergyGlobalMenu removeItem:item];
     }
+    [self setNeedsFullUpdate];
     [mainTimer fire];
 }
 
@@ -2488,17 +2230,18 @@ UInt32      widthCode;
 
     songList = nil;
 
-    if (getSongInfoScript != nil)
-        getSongInfoScript = nil;
-
     if (mainTimer != nil)
     {
         [mainTimer invalidate];
         mainTimer = nil;
     }
 
+    LOG(@"Player statistics:\n%@", [playerQueue statisticsDescription]);
+
     [[NSNotificationCenter defaultCenter] removeObserver:self];
 
+    [WOCoverDownloader synchronizeCoverStore];
+
     // clean out "Temporary Album Covers"
     if (![[NSFileManager defaultManager] removeItemAtPath:[WOCoverDownloader tempAlbumCoversPath]
                                                     error:NULL])
@@ -2507,25 +2250,16 @@ UInt32      widthCode;
 
 -(IBAction)playSong:(id)sender
 {
-    NSAppleEventDescriptor *songId;
-
     // adjust this value by one because the first item is just the "Recent
     // tracks" label
     int index = ([[sender menu] indexOfItem:sender] - 1);
 
-    songId = [[songList objectAtIndex:index] objectForKey:WO_SONG_DICTIONARY_ID];
-
-    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
+    id songId = [[songList objectAtIndex:index] objectForKey:WO_SONG_DICTIONARY_ID];
 
     //we'll have to launch iTunes if it's not running
-    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN])
+    if (![player isRunning])
     {
-        // open iTunes using workspace; specifying .app here ensures that OS 9
-        // iTunes doesn't get opened -- attempted fix for:
-        // http://bugs.wincent.org/bugs/bug.php?op=show&bugid=27
-        if ([[NSWorkspace sharedWorkspace] launchApplication:@"iTunes.app"] == NO)
-            ELOG(@"Error attempting to launch iTunes");
-        else
+        if ([player launch])
         {
             // store song descriptor
             [self setSongToPlayOnceLaunched:songId];
@@ -2540,88 +2274,25 @@ UInt32      widthCode;
                                            selector:@selector(iTunesDidLaunchNowPlay:)
                                                name:@"NSWorkspaceDidLaunchApplicationNotification"
                                              object:nil];
-
         }
     }
     else
-    {
-
-        AppleEvent  event, reply;
-        AEDesc      theDescriptor;
-
-        // this method does no testing to see if iTunes is running -- that should
-        // be done before calling!
-
-        if (AECreateDesc(typeProcessSerialNumber, &iTunesPSN, sizeof(iTunesPSN),
-                         &theDescriptor) == noErr)
-        {
-            // Equivalent to: tell application "iTunes" to play
-            if (AECreateAppleEvent('hook', 'Play', &theDescriptor,
-                                   kAutoGenerateReturnID, kAnyTransactionID,
-                                   &event) == noErr)
-            {
-                const DescType keyword = keyDirectObject; // 'form'; was 'obj '
-                const AEDesc *thePointer = [songId aeDesc];
-
-                if ((AEPutParamDesc(&event, keyword, thePointer)) != noErr)
-                    ELOG(@"Error putting parameter in Apple Event");
-                else
-                {
-                    if (AESend(&event, &reply, kAENoReply, kAENormalPriority,
-                                kAEDefaultTimeout, nil, nil) == noErr)
-                        AEDisposeDesc(&reply);
-                    else
-                        ELOG(@"Error sending Apple Event");
-                }
-                AEDisposeDesc(&event);
-            }
-            AEDisposeDesc(&theDescriptor);
-        }
-
-        buttonClickOccurred = YES; // a menu item was chosen
-        if (![self iTunesSendsNotifications])
-            [mainTimer fire];
-    }
+        [self tellITunesToPlaySong:songId];
 }
 
-- (void)tellITunesToPlaySong:(NSAppleEventDescriptor *)descriptor
+- (void)tellITunesToPlaySong:(id)identifier
 {
-    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
+    [playerQueue sendCommand:@selector(playTrack:)
+                   arguments:[NSArray arrayWithObject:identifier]
+                      target:self
+                    selector:@selector(didPlayTrack:)];
+}
 
-    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] == NO)
+// the answer to tellITunesToPlaySong:
+- (void)didPlayTrack:(NSNumber *)success
+{
+    if ([success boolValue])
     {
-        // iTunes is running
-        AppleEvent  event, reply;
-        AEDesc      theDescriptor;
-
-        // this method does no testing to see if iTunes is running -- that should
-        // be done before calling!
-
-        if (AECreateDesc(typeProcessSerialNumber, &iTunesPSN, sizeof(iTunesPSN),
-                         &theDescriptor) == noErr)
-        {
-            // Equivalent to: tell application "iTunes" to play
-            if (AECreateAppleEvent('hook', 'Play', &theDescriptor,
-                                   kAutoGenerateReturnID,
-                                   kAnyTransactionID, &event) == noErr)
-            {
-                const DescType keyword = keyDirectObject; // 'form'; was 'obj '
-                const AEDesc *thePointer = [descriptor aeDesc];
-
-                if (AEPutParamDesc(&event, keyword, thePointer) != noErr)
-                    ELOG(@"Error putting parameter in Apple Event");
-
-                if (AESend(&event, &reply, kAENoReply, kAENormalPriority,
-                           kAEDefaultTimeout, nil, nil) == noErr)
-                    AEDisposeDesc(&reply);
-                else
-                    ELOG(@"Error sending Apple Event");
-
-                AEDisposeDesc(&event);
-            }
-            AEDisposeDesc(&theDescriptor);
-        }
-
         buttonClickOccurred = YES; // a menu item was chosen
         if (![self iTunesSendsNotifications])
             [mainTimer fire];
@@ -2658,178 +2329,63 @@ UInt32      widthCode;
 
 - (void)launchITunes
 {
-    // open iTunes using workspace
-    if ([[NSWorkspace sharedWorkspace] launchApplication:@"iTunes.app"] == NO)
-        ELOG(@"Error attempting to launch iTunes");
+    (void)[player launch];
 }
 
 - (IBAction)shuffleMenuItem:(id)sender
 {
     // (double) check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
-        NSAppleScript *script;
-        NSString *result;
+        // if shuffle (menu) was off turn it on, and vice versa
+        BOOL shuffle = ([shuffleMenuItem state] == NSOffState);
+        [playerQueue sendCommand:@selector(setShuffle:)
+                       arguments:[NSArray arrayWithObject:[NSNumber numberWithBool:shuffle]]
+                          target:nil
+                        selector:NULL];
 
-        if ([shuffleMenuItem state] == NSOffState)
-        {
-            // shuffle (menu) was off: turn it on
-
-            static NSString *scriptSource =
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    -- this will fail if iTunes has no current selection\n"
-            @"    set currentPlaylist to the container of the current track\n"
-            @"    set shuffle of currentPlaylist to true\n"
-            @"    return \"SUCCESS\"\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell";
-
-            script = [[NSAppleScript alloc] initWithSource:scriptSource];
-            result = [[NSString alloc] initWithString:[[script executeAndReturnError:NULL] stringValue]];
-
-            if (result && [result isEqualToString:@"SUCCESS"])
-            {
-                [shuffleMenuItem setState:NSOnState];
-            }
-            else if (result && [result isEqualToString:@"ERROR"])
-                ELOG(@"Error setting iTunes shuffle setting to ON");
-            else
-                ELOG(@"Unknown error while setting iTunes shuffle setting to ON");
-        }
-        else
-        {
-            // shuffle (menu) was on: turn it off
-
-            static NSString *scriptSource =
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    -- this will fail if iTunes has no current selection\n"
-            @"    set currentPlaylist to the container of the current track\n"
-            @"    set shuffle of currentPlaylist to false\n"
-            @"    return \"SUCCESS\"\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell";
-
-            script = [[NSAppleScript alloc] initWithSource:scriptSource];
-            result = [[NSString alloc] initWithString:[[script executeAndReturnError:NULL] stringValue]];
-            if (result && [result isEqualToString:@"SUCCESS"])
-                [shuffleMenuItem setState:NSOffState];
-            else if (result && [result isEqualToString:@"ERROR"])
-                ELOG(@"Error setting iTunes shuffle setting to OFF");
-            else
-                ELOG(@"Unknown error while setting iTunes shuffle setting to OFF");
-        }
+        // the snapshot is taken after the command, and the menu item is updated
+        // from it if shuffle did change
+        [mainTimer fire];
     }
 }
 
 - (IBAction)repeatOffMenuItem:(id)sender
 {
     // (double) check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
-        static NSString *scriptSource =
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    -- this will fail if iTunes has no current selection\n"
-            @"    set currentPlaylist to the container of the current track\n"
-            @"    set song repeat of currentPlaylist to off\n"
-            @"    return \"SUCCESS\"\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell";
-
-        NSAppleScript   *script = [[NSAppleScript alloc] initWithSource:scriptSource];
-        NSString        *result = [[NSString alloc] initWithString:[[script executeAndReturnError:NULL] stringValue]];
-
-        if (result && [result isEqualToString:@"SUCCESS"])
-        {
-            [repeatAllMenuItem setState:NSOffState];
-            [repeatOffMenuItem setState:NSOnState]; // only this one is "on"
-            [repeatOneMenuItem setState:NSOffState];
-        }
-        else if (result && [result isEqualToString:@"ERROR"])
-            ELOG(@"Error setting repeat mode to OFF");
-        else
-            ELOG(@"Unknown error while setting repeat mode to OFF");
+        [playerQueue sendCommand:@selector(setRepeatMode:)
+                       arguments:[NSArray arrayWithObject:[NSNumber numberWithInt:WORepeatOff]]
+                          target:nil
+                        selector:NULL];
+        [mainTimer fire]; // updates the menu items
     }
 }
 
 - (IBAction)repeatAllMenuItem:(id)sender
 {
     // (double) check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
-        NSAppleScript *script;
-        NSString *result;
-
-        static NSString *scriptSource =
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    -- this will fail if iTunes has no current selection\n"
-            @"    set currentPlaylist to the container of the current track\n"
-            @"    set song repeat of currentPlaylist to all\n"
-            @"    return \"SUCCESS\"\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell";
-
-        script = [[NSAppleScript alloc] initWithSource:scriptSource];
-        result = [[NSString alloc] initWithString:
-            [[script executeAndReturnError:NULL] stringValue]];
-
-        if (result && [result isEqualToString:@"SUCCESS"])
-        {
-            [repeatAllMenuItem setState:NSOnState];   // only this one is "on"
-            [repeatOffMenuItem setState:NSOffState];
-            [repeatOneMenuItem setState:NSOffState];
-        }
-        else if (result && [result isEqualToString:@"ERROR"])
-            ELOG(@"Error setting repeat mode to ALL");
-        else
-            ELOG(@"Unknown error while setting repeat mode to ALL");
+        [playerQueue sendCommand:@selector(setRepeatMode:)
+                       arguments:[NSArray arrayWithObject:[NSNumber numberWithInt:WORepeatAll]]
+                          target:nil
+                        selector:NULL];
+        [mainTimer fire]; // updates the menu items
     }
 }
 
 - (IBAction)repeatOneMenuItem:(id)sender
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])      // (double) check if iTunes is running
+    // (double) check if iTunes is running
+    if ([player isRunning])
     {
-        NSAppleScript *script;
-        NSString *result;
-
-        static NSString *scriptSource =
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    -- this will fail if iTunes has no current selection\n"
-            @"    set currentPlaylist to the container of the current track\n"
-            @"    set song repeat of currentPlaylist to one\n"
-            @"    return \"SUCCESS\"\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell";
-
-        script = [[NSAppleScript alloc] initWithSource:scriptSource];
-        result = [[NSString alloc] initWithString:
-            [[script executeAndReturnError:NULL] stringValue]];
-
-        if (result && [result isEqualToString:@"SUCCESS"])
-        {
-            [repeatAllMenuItem setState:NSOffState];
-            [repeatOffMenuItem setState:NSOffState];
-            [repeatOneMenuItem setState:NSOnState]; // only this one is "on"
-        }
-        else if (result && [result isEqualToString:@"ERROR"])
-            ELOG(@"Error setting repeat mode to ONE");
-        else
-            ELOG(@"Unknown error while setting repeat mode to ONE");
+        [playerQueue sendCommand:@selector(setRepeatMode:)
+                       arguments:[NSArray arrayWithObject:[NSNumber numberWithInt:WORepeatOne]]
+                          target:nil
+                        selector:NULL];
+        [mainTimer fire]; // updates the menu items
     }
 }
 
@@ -2860,8 +2416,7 @@ UInt32      widthCode;
         // if iTunes is running, quit it
         // (ie. STOPPED, PAUSED, PLAYING, ERROR)
 
-        // tell iTunes to quit using Apple Events
-        [self sendAppleEventClass:'aevt' ID:'quit'];
+        [playerQueue sendCommand:@selector(quit)];
         [launchQuitITunesMenuItem setTitle:
             NSLocalizedString(@"Launch iTunes",@"Launch iTunes menu command")];
 
@@ -2883,12 +2438,10 @@ UInt32      widthCode;
 
 - (IBAction)refreshPlaylistsSubmenu:(id)sender
 {
-    // only do this is iTunes is running
-    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
-
-    // but allow user to force an update if the update is triggered by selecting a menu item
+    // only do this is iTunes is running, but allow user to force an update if
+    // the update is triggered by selecting a menu item
     BOOL forceUpdate = sender ? [sender isKindOfClass:[NSMenuItem class]] : NO;
-    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] && !forceUpdate)
+    if (![player isRunning] && !forceUpdate)
     {
         // iTunes is not running
         //
@@ -2904,124 +2457,54 @@ UInt32      widthCode;
             [playlistsSubmenu removeItemAtIndex:0];
     }
     else    // iTunes is running: do a proper update
-    {
-        NSArray *names = nil;
-        @try
-        {
-            // do this the hard way -- [[iTunes sources] objectWithName:@"Library"] -- only works in English
-            iTunesApplication *iTunes = [SBApplication applicationWithBundleIdentifier:@"com.apple.iTunes"];
-            iTunesSource *library = nil;
-            for (iTunesSource *source in [iTunes sources])
-            {
-                if ([source kind] == iTunesESrcLibrary)
-                {
-                    library = source;
-                    break;
-                }
-            }
-            names = [[library playlists] arrayByApplyingSelector:@selector(name)];
-        }
-        @catch (id e)
-        {
-            // we don't want a mere Apple Event error like this one derailing the entire applicaton:
-            // *** Terminating app due to uncaught exception 'NSGenericException',
-            // reason: 'Apple event returned an error.  Event = 'core'\'cnte'{ '----':'null'(), 'kocl':'cSrc' }
-            // Error info = { ErrorNumber = -609; }
-            // incidentally, error 609 may be "connection is invalid" or a timeout ("Apple Event timed out")
-            // "there's a glitch in Apple's APIs that cause timeouts to sometimes raise error -609 instead of the usual -1712"
-            // see: http://discussions.apple.com/thread.jspa?messageID=6925244
-            // and: http://developer.apple.com/documentation/AppleScript/Conceptual/AppleScriptLangGuide/index.html
-            names = [NSArray array];
-        }
+        [playerQueue sendCommand:@selector(playlistNames)
+                       arguments:nil
+                          target:self
+                        selector:@selector(playlistNamesDidArrive:)];
+}
 
-        // clear out existing entries in playlist submenu
-        for (NSMenuItem *item in [playlistsSubmenu itemArray])
-        {
-            // only remove playlist entries (not separators, "Refresh" etc)
-            if ([item action] == @selector(selectPlaylist:))
-                [playlistsSubmenu removeItem:item];
-        }
+// the answer to refreshPlaylistsSubmenu: (nil if the names could not be read)
+- (void)playlistNamesDidArrive:(NSArray *)names
+{
+    if (!names)
+        names = [NSArray array];
 
-        // make sure we have a separator, but only if we need one
-        if ([playlistsSubmenu numberOfItems] == 1 && names.count > 0)
-            [playlistsSubmenu insertItem:[NSMenuItem separatorItem] atIndex:0];
+    // clear out existing entries in playlist submenu
+    for (NSMenuItem *item in [playlistsSubmenu itemArray])
+    {
+        // only remove playlist entries (not separators, "Refresh" etc)
+        if ([item action] == @selector(selectPlaylist:))
+            [playlistsSubmenu removeItem:item];
+    }
 
-        // add back in new entries, building menu in reverse order (inserting items at the top of the menu)
-        for (NSUInteger i = names.count; i > 0; i--)
-        {
-            NSMenuItem *item = [[NSMenuItem alloc] initWithTitle:[names objectAtIndex:i - 1]
-                                                          action:@selector(selectPlaylist:)
-                                                   keyEquivalent:@""];
-            [item setTarget:self];
-            [playlistsSubmenu insertItem:item atIndex:0];
-        }
+    // make sure we have a separator, but only if we need one
+    if ([playlistsSubmenu numberOfItems] == 1 && names.count > 0)
+        [playlistsSubmenu insertItem:[NSMenuItem separatorItem] atIndex:0];
+
+    // add back in new entries, building menu in reverse order (inserting items at the top of the menu)
+    for (NSUInteger i = names.count; i > 0; i--)
+    {
+        NSMenuItem *item = [[NSMenuItem alloc] initWithTitle:[names objectAtIndex:i - 1]
+                                                      action:@selector(selectPlaylist:)
+                                               keyEquivalent:@""];
+        [item setTarget:self];
+        [playlistsSubmenu insertItem:item atIndex:0];
     }
 }
 
 // switches to a given playlist and starts playing
 - (IBAction)selectPlaylist:(id)sender
 {
-    // note to self: do I have to strip out quote characters? escape them i mean
-    // do I run into strife with foreign characters eg:
-    // "Canciones españolas" returned as "Canciones espa\\361olas"
-
     // ensure sender is an NSMenuItem object
     if (![sender isKindOfClass:[NSMenuItem class]])
         return;
 
-    NSAppleScript           *script = nil;
-    NSAppleEventDescriptor  *result = nil;
-
-    NSMutableString *playlistName =
-        [NSMutableString stringWithString:[sender title]];
-
-    // unfortunately the escaping in the following wreaks havoc with
-    // Project Builder's auto-indenting:
-    [playlistName replaceOccurrencesOfString:@"\""    /* replace " */
-                                  withString:@"\\\""  /* with   \" */
-                                     options:NSBackwardsSearch
-                                       range:NSMakeRange(0, [playlistName length])];
-
-NSString *activate;
-
-// user prefs will dictate whether iTunes is brought to the front or not
-if ([[synergyPreferences objectOnDiskForKey:_woBringITunesToFrontPrefKey] boolValue])
-activate = @"activate";
-else
-activate = @"--activate";
-
-    NSString *source =
-        [NSString stringWithFormat:
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    stop\n"
-            @"    set thePlaylist to playlist \"%@\"\n"
-            @"    %@\n"
-            @"    set visible of browser window 1 to true\n"
-            @"    set view of browser window 1 to thePlaylist\n"
-            @"    play\n"
-            @"    return \"SUCCESS\"\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell",
-            playlistName,
-            activate];
-
-    script = [[NSAppleScript alloc] initWithSource:source];
-
-    result = [script executeAndReturnError:NULL];
-
-    if (!result)
-    {
-        // error
-    }
-    else
-    {
-        if ([[result stringValue] isEqualToString:@"ERROR"])
-            ELOG(@"Warning: AppleScript error while attempting to switch to "
-                 @"playlist \"%@\"", playlistName);
-    }
+    // user prefs will dictate whether iTunes is brought to the front or not
+    BOOL activate = [[synergyPreferences objectOnDiskForKey:_woBringITunesToFrontPrefKey] boolValue];
+    [playerQueue sendCommand:@selector(playPlaylistNamed:activate:)
+                   arguments:[NSArray arrayWithObjects:[sender title], [NSNumber numberWithBool:activate], nil]
+                      target:nil
+                    selector:NULL];
 }
 
 - (IBAction)showAlbumCoversFolder:(id)sender
@@ -3097,206 +2580,66 @@ activate = @"--activate";
     }
 
     // if floater display is set to "forever"... make sure it's on screen...
+    [self setNeedsFullUpdate];
     [mainTimer fire]; // the timer routine will check
 }
 
 - (void)tellITunesActivate
 {
-    // new way (Apple Events)
-    // based on "AEBuild*, AEPrint* and friends":
-    //  http://developer.apple.com/technotes/tn/tn2045.html#dssyntaxcprgdb
-    // and "Lazy AppleScript sending":
-    //  http://www.unsanity.org/archives/000107.php#000107
-
-    ProcessSerialNumber psn = [WOProcessManager PSNForSignature:'hook'];
-    AppleEvent event;
-    AEBuildError error;
-
-    // provided iTunes is running proceed to send Apple event
-    if (![WOProcessManager PSNEqualsNoProcess:psn])
-    {
-
-        // the business part of the event
-        NSString* sendString=@"&subj:'null'()";
-
-        OSStatus err = AEBuildAppleEvent('misc', 'actv',
-                                         typeProcessSerialNumber,
-                                         &psn, sizeof(ProcessSerialNumber),
-                                         kAutoGenerateReturnID,
-                                         kAnyTransactionID,
-                                         &event, &error,
-                                         [sendString UTF8String]);
-
-        if (err)
-        {
-            // print the error and where it occurs
-            ELOG(@"%lu:%lu error building \"%@\"", error.fError, error.fErrorPos,
-                 [sendString substringToIndex:error.fErrorPos]);
-        }
-        else
-        {
-            AppleEvent reply;
-
-            if (AESend(&event, &reply, kAENoReply, kAENormalPriority,
-                       kAEDefaultTimeout, NULL, NULL) == noErr)
-                AEDisposeDesc(&reply);
-
-            AEDisposeDesc(&event);
-        }
-    }
-    else
-    {
-        // iTunes is not running: do it the old way by firing off an AppleScript
-        // this will have the effect of launching iTunes
-
-        // old way (Apple Script)
-        static NSString *scriptSource = @"tell application \"iTunes\" to activate";
-        NSAppleScript *script = [[NSAppleScript alloc] initWithSource:scriptSource];
-        (void)[[NSString alloc] initWithString:[[script executeAndReturnError:NULL] stringValue]];
-    }
+    [playerQueue sendCommand:@selector(activate)];
 }
 
 // tell iTunes to up the volume by (approx) 6.25%
 - (void)tellITunesVolumeUp
 {
-    // From the iTunes Scripting Dictionary:
-    //
-    // In "application" class:
-    //     sound volume
-    //         integer  -- the sound output volume (0 = minimum, 100 = maximum)
-    //
-
-    static NSString *scriptSource =
-        @"tell application \"iTunes\"\n"
-        @"  set currentVol to the sound volume as real\n"
-        @"  set segmentNumber to ((currentVol / 6.25) div 1) as integer\n"
-        @"  if segmentNumber is less than 15 then\n"
-        @"    set segmentNumber to (segmentNumber + 1)\n"
-        @"    set the sound volume to ((segmentNumber * 6.25) + 2)\n"
-        @"  else\n"
-        @"    set the sound volume to 100\n"
-        @"  end if\n"
-        @"  if the sound volume is 100 then\n"
-        @"    return \"16\"\n"
-        @"  else\n"
-        @"    return segmentNumber as string\n"
-        @"  end if\n"
-        @"end tell";
-
-    NSAppleScript   *script = [[NSAppleScript alloc] initWithSource:scriptSource];
-    NSString        *result = [[script executeAndReturnError:NULL] stringValue];
-
-    // update internal measure of which segments are "lit"
-    if (result)
-        segmentCount = [result intValue];
+    [playerQueue sendCommand:@selector(volumeUp) arguments:nil target:self selector:@selector(volumeDidChange:)];
 }
 
 // tell iTunes to reduce the volume by 6.25%
 - (void)tellITunesVolumeDown
 {
-    // Deduct 6 from the sound volume, down to a minimum of 6
+    [playerQueue sendCommand:@selector(volumeDown) arguments:nil target:self selector:@selector(volumeDidChange:)];
+}
 
-    // tell application "iTunes"
-    //   set currentVol to the sound volume as real
-    //
-    //   -- Special (boundary) cases
-    //   -- 0 segments = 0 volume
-    //   -- 16 segments = 100 volume
-    //
-    //   -- Other cases
-    //   -- 15 segments
-    //   -- 0.0 - 6.25 = 1st segment
-    //   -- etc
-    //   -- 93.75 - 100.0 = 15th segment
-    //
-    //   -- find out which segment we lie in
-    //   set segmentNumber to ((currentVol / 6.25) div 1) as integer
-    //
-    //   -- reduce segment number
-    //   if segmentNumber is greater than 1 then
-    //     set segmentNumber to (segmentNumber - 1)
-    //
-    //     -- set sound volume according to new segment number
-    //     -- add two to compensate for rounding down errors
-    //     set the sound volume to ((segmentNumber * 6.25) + 2)
-    //   else
-    //     set the sound volume to 0
-    //   end if
-    //
-    //   -- notify of new segment number, noting boundary cases
-    //   if the sound volume is 0 then
-    //     return 0
-    //   else
-    //     return segmentNumber
-    //   end if
-    // end tell
-
-    NSAppleScript *script;
-    NSString      *result;
-
-    static NSString *scriptSource =
-        @"tell application \"iTunes\"\n"
-        @"  set currentVol to the sound volume as real\n"
-        @"  set segmentNumber to ((currentVol / 6.25) div 1) as integer\n"
-        @"  if segmentNumber is greater than 1 then\n"
-        @"    set segmentNumber to (segmentNumber - 1)\n"
-        @"    set the sound volume to ((segmentNumber * 6.25) + 2)\n"
-        @"  else\n"
-        @"    set the sound volume to 0\n"
-        @"  end if\n"
-        @"  if the sound volume is 0 then\n"
-        @"    return \"0\"\n"
-        @"  else\n"
-        @"    return segmentNumber as string\n"
-        @"  end if\n"
-        @"end tell";
-
-    script = [[NSAppleScript alloc] initWithSource:scriptSource];
-    result = [[NSString alloc] initWithString:
-        [[script executeAndReturnError:NULL] stringValue]];
-
-    // update internal measure of which segments are "lit"
-    if (result)
-        segmentCount = [result intValue];
+// the answer to a volume command: the number of lit segments, or -1 on error
+- (void)volumeDidChange:(NSNumber *)segments
+{
+    // update internal measure of which segments are "lit"; on error (-1, or
+    // nil if the command raised) don't update segment count!
+    if (segments && [segments intValue] >= 0)
+        segmentCount = [segments intValue];
+
+    [feedbackController setEnabledSegments:segmentCount];
+    if (extraFeedback)
+    {
+        [feedbackController showAtFullAlpha];
+        [feedbackController delayedFadeOut];
+    }
 }
 
 - (void)volumeUpHotKeyPressed
 {
     // check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:YES];
         [feedbackController setStarBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
 
         [self tellITunesVolumeUp];
-
-        [feedbackController setEnabledSegments:segmentCount];
-        if (extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
     }
 }
 
 - (void)volumeDownHotKeyPressed
 {
     // check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:YES];
         [feedbackController setStarBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
 
         [self tellITunesVolumeDown];
-
-        [feedbackController setEnabledSegments:segmentCount];
-        if (extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
     }
 }
 
@@ -3350,12 +2693,22 @@ activate = @"--activate";
     // it might help us to guess the iTunes state if we can't get
     // it in the timer loop (because iTunes is too busy to reply to our
     // Apple Event)!
-    int prevITunesState = iTunesState;
+    stateBeforePlayPause = iTunesState;
 
-    [self tellITunesPlayPause]; // main timer will fire at the end of this...
+    [self tellITunesPlayPause]; // queues the command, then a snapshot for the timer
 
     // in the case of the play/pause key, we have to wait until AFTER we hear
-    // back from iTunes (and therefore know its state) before choosing the icon
+    // back from iTunes (and therefore know its state) before choosing the icon:
+    // this snapshot is taken after the playPause command, and is delivered
+    // after the timer's request for the same snapshot has updated iTunesState
+    if ([[synergyPreferences objectOnDiskForKey:_woShowFeedbackWindowPrefKey] boolValue] ==
+        YES)
+        [playerQueue requestSnapshotForTarget:self selector:@selector(playPauseDidFinish:)];
+}
+
+- (void)playPauseDidFinish:(WOPlayerSnapshot *)snapshot
+{
+    int prevITunesState = stateBeforePlayPause;
 
     // only actually show the feedback window if user prefs say so
     if ([[synergyPreferences objectOnDiskForKey:_woShowFeedbackWindowPrefKey] boolValue] ==
@@ -3467,7 +2820,7 @@ activate = @"--activate";
 // this code almost identical to the tellITunesFastForward method
 - (void)tellITunesResume
 {
-    [self sendAppleEventClass:'hook' ID:'Resu'];
+    [playerQueue sendCommand:@selector(resume)];
 }
 
 - (void)nextHotKeyPressed
@@ -3478,9 +2831,7 @@ activate = @"--activate";
     {
         // additional layer of checking: show window only if iTunes is running
         // (if not running, hot key will have no effect anyway)
-        ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
-
-        if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] == NO)
+        if ([player isRunning])
         {
             [feedbackController setBarEnabled:NO];
             [feedbackController setStarBarEnabled:NO];
@@ -3504,9 +2855,7 @@ activate = @"--activate";
     {
         // additional layer of checking: show window only if iTunes is running
         // (if not running, hot key will have no effect anyway)
-        ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
-
-        if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] == NO)
+        if ([player isRunning])
         {
             [feedbackController setBarEnabled:NO];
             [feedbackController setStarBarEnabled:NO];
@@ -3525,234 +2874,66 @@ activate = @"--activate";
 - (void)decreaseRatingHotKeyPressed
 {
     // check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
-
-        NSAppleScript *script;
-        NSString *result;
-
-        static NSString *scriptSource =
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    set oldRating to rating of current track\n"
-            @"    if oldRating > 80 then\n"
-            @"      set rating of current track to 80\n"
-            @"      return \"80\"\n"
-            @"    else if oldRating > 60 then\n"
-            @"      set rating of current track to 60\n"
-            @"      return \"60\"\n"
-            @"    else if oldRating > 40 then\n"
-            @"      set rating of current track to 40\n"
-            @"      return \"40\"\n"
-            @"    else if oldRating > 20 then\n"
-            @"      set rating of current track to 20\n"
-            @"      return \"20\"\n"
-            @"    else\n"
-            @"      set rating of current track to 0\n"
-            @"      return \"0\"\n"
-            @"    end if\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell";
-
-        script = [[NSAppleScript alloc] initWithSource:scriptSource];
-        result = [[NSString alloc] initWithString:[[script executeAndReturnError:NULL] stringValue]];
-
-        if (result && [result isEqualToString:@"80"])
-        {
-            [feedbackController setEnabledStars:4];
-
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-
-            // fire the timer here... this will have the effect of updating the floater
-            // if it is already on screen and user preferences are set to "include
-            // rating"
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"60"])
-        {
-            [feedbackController setEnabledStars:3];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"40"])
-        {
-            [feedbackController setEnabledStars:2];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"20"])
-        {
-            [feedbackController setEnabledStars:1];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"0"])
-        {
-            [feedbackController setEnabledStars:0];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"ERROR"])
-            // this usually means that iTunes is running but there is no current selection
-            LOG(@"Error while decreasing song rating");
-        else
-            ELOG(@"Unknown error while decreasing song rating");
+        [playerQueue sendCommand:@selector(decreaseRating)
+                       arguments:nil
+                          target:self
+                        selector:@selector(ratingDidChange:)];
     }
 }
 
 - (void)increaseRatingHotKeyPressed
 {
     // check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
+        [playerQueue sendCommand:@selector(increaseRating)
+                       arguments:nil
+                          target:self
+                        selector:@selector(ratingDidChange:)];
+    }
+}
 
-        NSAppleScript *script;
-        NSString *result;
-
-        static NSString *scriptSource =
-            @"tell application \"iTunes\"\n"
-            @"  try\n"
-            @"    set oldRating to rating of current track\n"
-            @"    if oldRating < 20 then\n"
-            @"      set rating of current track to 20\n"
-            @"      return \"20\"\n"
-            @"    else if oldRating < 40 then\n"
-            @"      set rating of current track to 40\n"
-            @"      return \"40\"\n"
-            @"    else if oldRating < 60 then\n"
-            @"      set rating of current track to 60\n"
-            @"      return \"60\"\n"
-            @"    else if oldRating < 80 then\n"
-            @"      set rating of current track to 80\n"
-            @"      return \"80\"\n"
-            @"    else\n"
-            @"      set rating of current track to 100\n"
-            @"      return \"100\"\n"
-            @"    end if\n"
-            @"  on error\n"
-            @"    return \"ERROR\"\n"
-            @"  end try\n"
-            @"end tell";
-
-        script = [[NSAppleScript alloc] initWithSource:scriptSource];
-        result = [[NSString alloc] initWithString:
-            [[script executeAndReturnError:NULL] stringValue]];
-
-        if (result && [result isEqualToString:@"20"])
-        {
-            [feedbackController setEnabledStars:1];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            // fire the timer here... this will have the effect of updating the floater
-            // if it is already on screen and user preferences are set to "include
-            // rating"
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"40"])
-        {
-            [feedbackController setEnabledStars:2];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"60"])
-        {
-            [feedbackController setEnabledStars:3];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"80"])
-        {
-            [feedbackController setEnabledStars:4];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"100"])
-        {
-            [feedbackController setEnabledStars:5];
-            if (extraFeedback)
-            {
-                [feedbackController showAtFullAlpha];
-                [feedbackController delayedFadeOut];
-            }
-            if (![self iTunesSendsNotifications])
-                [mainTimer fire];
-        }
-        else if (result && [result isEqualToString:@"ERROR"])
-            // this usually means that iTunes is running but there is no current selection
-            LOG(@"Error while increasing song rating");
-        else
-            ELOG(@"Unknown error while increasing song rating");
+// the answer to a rating command: the new rating (0-100), or -1 if that failed
+// (usually because there is no current selection, in which case don't show
+// the feedback)
+- (void)ratingDidChange:(NSNumber *)rating
+{
+    if (!rating || [rating intValue] < 0)
+        return;
+
+    [feedbackController setEnabledStars:([rating intValue] / 20)];
+    if (extraFeedback)
+    {
+        [feedbackController showAtFullAlpha];
+        [feedbackController delayedFadeOut];
     }
+
+    // fire the timer here... this will have the effect of updating the floater
+    // if it is already on screen and user preferences are set to "include
+    // rating"
+    if (![self iTunesSendsNotifications])
+        [mainTimer fire];
 }
 
 - (void)rateAs0HotKeyPressed
 {
     // check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
         [feedbackController setEnabledStars:0];
 
-        // show feedback only if rating successfully set
-        if ([self setRating:0] && extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
+        [self setRating:0];
 
     }
 }
@@ -3760,179 +2941,62 @@ activate = @"--activate";
 - (void)rateAs1HotKeyPressed
 {
     // check if iTunes is running
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
         [feedbackController setEnabledStars:1];
 
-        // show feedback only if rating successfully set
-        if ([self setRating:20] && extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
+        [self setRating:20];
 
     }
 }
 
-- (BOOL)setRating:(int)newRating
+- (void)setRating:(int)newRating
 {
-    BOOL returnValue = NO;
-    // abort if we get an illegal parameter
-    if ((newRating < 0) || (newRating > 100))
-    {
-        ELOG(@"Out-of-range parameter submitted while setting song rating");
-        return returnValue;
-    }
-
-    NSAppleScript *script;
-    NSString *result;
-
-    NSString *scriptSource = [NSString stringWithFormat:
-        @"tell application \"iTunes\"\n"
-        @"  try\n"
-        @"    set rating of current track to %d\n"
-        @"    return \"SUCCESS\"\n"
-        @"  on error\n"
-        @"    return \"ERROR\"\n"
-        @"  end try\n"
-        @"end tell",
-        newRating];
-
-    script = [[NSAppleScript alloc] initWithSource:scriptSource];
-    result = [[NSString alloc] initWithString:
-        [[script executeAndReturnError:NULL] stringValue]];
-
-    if (result && [result isEqualToString:@"SUCCESS"])
-    {
-        // fire the timer here... this will have the effect of updating the floater
-        // if it is already on screen and user preferences are set to "include
-        // rating"
-        if (![self iTunesSendsNotifications])
-            [mainTimer fire];
-
-        returnValue = YES;
-    }
-    else if (result && [result isEqualToString:@"ERROR"])
-    {
-        // this usually means that iTunes is running but there is no current
-        // selection
-
-        // return NO (don't show floater)
-        returnValue = NO;
-
-    }
-    else
-    {
-        ELOG(@"Unknown error while setting song rating to %d", newRating);
-
-        returnValue = NO; // (don't show floater)
-    }
-    return returnValue;
+    [playerQueue sendCommand:@selector(setRating:)
+                   arguments:[NSArray arrayWithObject:[NSNumber numberWithInt:newRating]]
+                      target:self
+                    selector:@selector(ratingDidChange:)];
 }
 
 - (void)tellITunesToggleMute
 {
-    static NSString *scriptSource =
-        @"tell application \"iTunes\"\n"
-        @"  try\n"
-        @"    if mute is true then\n"
-        @"      set mute to false\n"
-        @"      set currentVol to the sound volume as real\n"
-        @"      set segmentNumber to ((currentVol / 6.25) div 1) as integer\n"
-        @"      if the sound volume is 100 then\n"
-        @"        return \"16\"\n"
-        @"      else\n"
-        @"        return segmentNumber as string\n"
-        @"      end if\n"
-        @"    else\n"
-        @"      set mute to true\n"
-        @"      return \"ON\"\n"
-        @"    end if\n"
-        @"  on error\n"
-        @"    return \"ERROR\"\n"
-        @"  end try\n"
-        @"end tell";
-
-    NSAppleScript *script = [[NSAppleScript alloc] initWithSource:scriptSource];
-    NSString *result = [[NSString alloc] initWithString:[[script executeAndReturnError:NULL] stringValue]];
-
     [feedbackController setBarEnabled:YES];
     [feedbackController setStarBarEnabled:NO];
     [feedbackController setIconType:WOFeedbackVolumeIcon];
 
-    if (result && [result isEqualToString:@"ON"])
-        segmentCount = 0;
-    else if (result && [result isEqualToString:@"ERROR"])
-        ELOG(@"Error while toggling iTunes mute setting");
-        // don't update segment count!
-    else
-        // result supposedly contains the segment count!
-        segmentCount = [result intValue];
-
-    [feedbackController setEnabledSegments:segmentCount];
-    if (extraFeedback)
-    {
-        [feedbackController showAtFullAlpha];
-        [feedbackController delayedFadeOut];
-    }
+    [playerQueue sendCommand:@selector(toggleMute) arguments:nil target:self selector:@selector(volumeDidChange:)];
 }
 
 - (void)tellITunesToggleShuffle
 {
-    BOOL error = NO;  // let's start off optimistic
-    NSAppleScript *script;
-    NSString *result;
-
-    static NSString *scriptSource =
-        @"tell application \"iTunes\"\n"
-        @"  try\n"
-        @"    -- this will fail if iTunes has no current selection\n"
-        @"    set currentPlaylist to the container of the current track\n"
-        @"    if shuffle of currentPlaylist is true then\n"
-        @"      set shuffle of currentPlaylist to false\n"
-        @"      return \"OFF\"\n"
-        @"    else\n"
-        @"      set shuffle of currentPlaylist to true\n"
-        @"      return \"ON\"\n"
-        @"    end if\n"
-        @"  on error\n"
-        @"    return \"ERROR\"\n"
-        @"  end try\n"
-        @"end tell";
-
-    script = [[NSAppleScript alloc] initWithSource:scriptSource];
-    result = [[NSString alloc] initWithString:
-        [[script executeAndReturnError:NULL] stringValue]];
+    [playerQueue sendCommand:@selector(toggleShuffle) arguments:nil target:self selector:@selector(shuffleDidToggle:)];
+}
+
+// the answer to tellITunesToggleShuffle
+- (void)shuffleDidToggle:(NSNumber *)newState
+{
+    WOShuffleState state = newState ? (WOShuffleState)[newState intValue] : WOShuffleUnknown;
 
     [feedbackController setBarEnabled:NO];
     [feedbackController setStarBarEnabled:NO];
 
-    if (result && [result isEqualToString:@"ON"])
+    if (state == WOShuffleOn)
     {
         [feedbackController setIconType:WOFeedbackShuffleOnIcon];
         [shuffleMenuItem setState:NSOnState];
     }
-    else if (result && [result isEqualToString:@"OFF"])
+    else if (state == WOShuffleOff)
     {
         [feedbackController setIconType:WOFeedbackShuffleOffIcon];
         [shuffleMenuItem setState:NSOffState];
-
-    }
-    else if (result && [result isEqualToString:@"ERROR"])
-    {
-        ELOG(@"Error while toggling iTunes shuffle setting");
-        error = YES;
     }
     else
-    {
-        ELOG(@"Unknown error while toggling iTunes shuffle setting");
-        error = YES;
-    }
+        return;
 
-    if (!error && extraFeedback)
+    if (extraFeedback)
     {
         [feedbackController showAtFullAlpha];
         [feedbackController delayedFadeOut];
@@ -3941,88 +3005,32 @@ activate = @"--activate";
 
 - (void)tellITunesSetRepeatMode
 {
-    BOOL error = NO;
-    NSAppleScript *script;
-    NSString *result;
-
-    static NSString *scriptSource =
-        @"tell application \"iTunes\"\n"
-        @"  try\n"
-        @"    -- this will fail if iTunes has no current selection\n"
-        @"    set currentPlaylist to the container of the current track\n"
-        @"    -- cycle through in this order: off, all, one\n"
-        @"    if song repeat of currentPlaylist is off then\n"
-        @"      set song repeat of currentPlaylist to all\n"
-        @"      return \"ALL\"\n"
-        @"    else\n"
-        @"      if song repeat of currentPlaylist is all then\n"
-        @"        set song repeat of currentPlaylist to one\n"
-        @"        return \"ONE\"\n"
-        @"      else\n"
-        @"        set song repeat of currentPlaylist to off\n"
-        @"        return \"OFF\"\n"
-        @"      end if\n"
-        @"    end if\n"
-        @"  on error\n"
-        @"    return \"ERROR\"\n"
-        @"  end try\n"
-        @"end tell";
-
-        script = [[NSAppleScript alloc] initWithSource:scriptSource];
-    result = [[NSString alloc] initWithString:
-        [[script executeAndReturnError:NULL] stringValue]];
+    [playerQueue sendCommand:@selector(cycleRepeatMode) arguments:nil target:self selector:@selector(repeatModeDidCycle:)];
+}
+
+// the answer to tellITunesSetRepeatMode
+- (void)repeatModeDidCycle:(NSNumber *)newMode
+{
+    WORepeatMode mode = newMode ? (WORepeatMode)[newMode intValue] : WORepeatUnknown;
 
     [feedbackController setBarEnabled:NO];
     [feedbackController setStarBarEnabled:NO];
 
-    if (result && [result isEqualToString:@"ALL"])
-    {
-        [feedbackController setIconType:WOFeedbackRepeatAllIcon];
+    // only one of these is "on" (or none, on error)
+    [repeatAllMenuItem setState:(mode == WORepeatAll ? NSOnState : NSOffState)];
+    [repeatOffMenuItem setState:(mode == WORepeatOff ? NSOnState : NSOffState)];
+    [repeatOneMenuItem setState:(mode == WORepeatOne ? NSOnState : NSOffState)];
 
-        [repeatAllMenuItem setState:NSOnState];  // only this one is "on"
-        [repeatOffMenuItem setState:NSOffState];
-        [repeatOneMenuItem setState:NSOffState];
-    }
-    else if (result && [result isEqualToString:@"ONE"])
-    {
+    if (mode == WORepeatAll)
+        [feedbackController setIconType:WOFeedbackRepeatAllIcon];
+    else if (mode == WORepeatOne)
         [feedbackController setIconType:WOFeedbackRepeatOneIcon];
-
-        [repeatAllMenuItem setState:NSOffState];
-        [repeatOffMenuItem setState:NSOffState];
-        [repeatOneMenuItem setState:NSOnState]; // only this one is "on"
-    }
-    else if (result && [result isEqualToString:@"OFF"])
-    {
+    else if (mode == WORepeatOff)
         [feedbackController setIconType:WOFeedbackRepeatOffIcon];
-
-        [repeatAllMenuItem setState:NSOffState];
-        [repeatOffMenuItem setState:NSOnState]; // only this one is "on"
-        [repeatOneMenuItem setState:NSOffState];
-    }
-    else if (result && [result isEqualToString:@"ERROR"])
-    {
-        ELOG(@"Error while cycling to next iTunes repeat mode");
-
-        error = YES;
-
-        // all off!
-        [repeatAllMenuItem setState:NSOffState];
-        [repeatOffMenuItem setState:NSOffState];
-        [repeatOneMenuItem setState:NSOffState];
-    }
     else
-    {
-        ELOG(@"Unknown error while cycling to next iTunes repeat mode");
-
-        error = YES;
-
-        // all off!
-        [repeatAllMenuItem setState:NSOffState];
-        [repeatOffMenuItem setState:NSOffState];
-        [repeatOneMenuItem setState:NSOffState];
-    }
+        return;
 
-    if (!error && extraFeedback)
+    if (extraFeedback)
     {
         [feedbackController showAtFullAlpha];
         [feedbackController delayedFadeOut];
@@ -4031,93 +3039,73 @@ activate = @"--activate";
 
 - (void)toggleMuteHotKeyPressed
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
         [self tellITunesToggleMute];
 }
 
 - (void)toggleShuffleHotKeyPressed
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
         [self tellITunesToggleShuffle];
 }
 
 - (void)setRepeatModeHotKeyPressed
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
         [self tellITunesSetRepeatMode];
 }
 
 - (void)rateAs2HotKeyPressed
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
         [feedbackController setEnabledStars:2];
 
-        // show feedback only if rating successfully set
-        if ([self setRating:40] && extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
+        [self setRating:40];
 
     }
 }
 
 - (void)rateAs3HotKeyPressed
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
         [feedbackController setEnabledStars:3];
 
-        // show feedback only if rating successfully set
-        if ([self setRating:60] && extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
+        [self setRating:60];
 
     }
 }
 
 - (void)rateAs4HotKeyPressed
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
         [feedbackController setEnabledStars:4];
 
-        // show feedback only if rating successfully set
-        if ([self setRating:80] && extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
+        [self setRating:80];
     }
 }
 
 - (void)rateAs5HotKeyPressed
 {
-    if ([WOProcessManager processRunningWithSignature:'hook'])
+    if ([player isRunning])
     {
         [feedbackController setBarEnabled:NO];
         [feedbackController setIconType:WOFeedbackVolumeIcon];
         [feedbackController setStarBarEnabled:YES];
         [feedbackController setEnabledStars:5];
 
-        // show feedback only if rating successfully set
-        if ([self setRating:100] && extraFeedback)
-        {
-            [feedbackController showAtFullAlpha];
-            [feedbackController delayedFadeOut];
-        }
+        [self setRating:100];
 
     }
 }
@@ -4131,120 +3119,18 @@ activate = @"--activate";
     // the risk of being mistaken because this is a hot-key-initiated action,
     // not a timer-driven one...
 
-    // find out frontmost process:
-    ProcessSerialNumber frontPID;
-    OSErr errCode;
-
-    errCode = GetFrontProcess(&frontPID);
-
-    if (errCode == noErr)
-    {
-        // we have the PID for the frontmost process
-
-        // get iTunes PID
-        ProcessSerialNumber iTunesPID;
-        iTunesPID = [WOProcessManager PSNForSignature:'hook'];
-
-        if(([WOProcessManager processRunningWithSignature:'hook']) &&
-           ([WOProcessManager process:iTunesPID
-                             isSameAs:frontPID]))
-        {
-            // iTunes is running and it is frontmost
-            [self hideITunes];
-        }
-        else
-        {
-            // iTunes is either not running, or not frontmost; in both cases, bring
-            // it to the front
-            [self tellITunesActivate];
-        }
-    }
+    if ([player isFrontmost])
+        // iTunes is running and it is frontmost
+        [self hideITunes];
     else
-        ELOG(@"Error getting frontmost process");
+        // iTunes is either not running, or not frontmost; in both cases, bring
+        // it to the front
+        [self tellITunesActivate];
 }
 
 - (void)hideITunes
 {
-    NSAppleScript   *script;
-    NSString        *result;
-
-    static NSString *scriptSource =
-        @"tell application \"System Events\"\n"
-        @"  try\n"
-        @"    set visible of process \"iTunes\" to false\n"
-        @"    return \"SUCCESS\"\n"
-        @"  on error\n"
-        @"    return \"ERROR\"\n"
-        @"  end try\n"
-        @"end tell";
-
-    script = [[NSAppleScript alloc] initWithSource:scriptSource];
-    result = [[NSString alloc] initWithString:
-        [[script executeAndReturnError:NULL] stringValue]];
-
-    if (result && [result isEqualToString:@"SUCCESS"])
-    {
-        //VLOG(@"Successfully issued \"hide iTunes\" directive");
-    }
-    else if (result && [result isEqualToString:@"ERROR"])
-        ELOG(@"Error while issuing \"hide iTunes\" directive");
-    else
-        ELOG(@"Unknown error while issuing \"hide iTunes\" directive");
-}
-
-// make sure iTunes is running and ready to process Apple Events before firing
-// off our status script
-- (BOOL)iTunesReadyToReceiveAppleScript
-/*"
- This is the fix for the iTunes "unwanted respawn" bug in which iTunes lingers
- on in the list of running processes for as long as 2 seconds after exiting, and
- an unwanted respawn results on sending it an AppleScript because all "tell"
- statements include an implicit "run".
-
- The workaround is to try to send an Apple Event which requires a reply, and
- test to see if a timeout is exceeded. If the timeout is exceeded then we assume
- that iTunes is not ready to receive the AppleScript, and in fact it is probably
- not running.
-
- We send the 'doex' Apple Event (equivalent to the "exists" AppleScript keyword)
- as this will have no undesired side-effects in the event that the event does
- make it through.
-
- We ignore the Apple documentation which requires us to implement an "idle
- handler" when using the kAEWaitReply mode; there do not appear to be any
- harmful side-effects.
-"*/
-{
-    BOOL readyToReceiveAppleScript = NO;
-
-    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:'hook'];
-
-    // make sure iTunes is running
-    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] == NO)
-    {
-        AppleEvent  event, reply;
-        AEDesc      AEdescriptor;
-
-        if (AECreateDesc(typeProcessSerialNumber, &iTunesPSN, sizeof(iTunesPSN),
-                         &AEdescriptor) == noErr)
-        {
-            if (AECreateAppleEvent('hook', 'doex', &AEdescriptor,
-                                   kAutoGenerateReturnID, kAnyTransactionID,
-                                   &event) == noErr)
-            {
-                if (AESend(&event, &reply, kAEWaitReply, kAEHighPriority,
-                           kAEDefaultTimeout, nil, nil) == noErr)
-                {
-                    AEDisposeDesc(&reply);  // this was a leak
-                    readyToReceiveAppleScript = YES;
-                }
-
-                AEDisposeDesc(&event);
-            }
-            AEDisposeDesc(&AEdescriptor);
-        }
-    }
-    return readyToReceiveAppleScript;
+    [playerQueue sendCommand:@selector(hide)];
 }
 
 - (NSString *)chooseRandomButtonSet
@@ -4366,11 +3252,16 @@ activate = @"--activate";
 
         if ((id)[songList objectAtIndex:0] == (id)completedSong)
         {
-            // append filename to Album Covers folder path
-            NSString *tempString = [[WOCoverDownloader albumCoversPath] stringByAppendingPathComponent:[completedSong filename]];
-
-            // notify floater
-            [floaterController setAlbumImagePath:tempString];
+            // downloaded covers always go in the Album Covers folder
+            WOCoverStore    *coverStore = [WOCoverDownloader coverStore];
+            WOCoverRecord   coverRecord;
+            if ([coverStore lookupKey:[completedSong coverKey] record:&coverRecord buyNowURL:NULL])
+                [floaterController setAlbumImagePath:[coverStore pathForRecord:&coverRecord]
+                                        variantPaths:[coverStore variantPathsForRecord:&coverRecord]];
+            else
+                [floaterController setAlbumImagePath:[coverStore pathForKey:[completedSong coverKey]
+                                                                   location:WOCoverLocationPermanent
+                                                                     format:WOCoverFormatJPEG]];
         }
     }
     else if ([[notification name] isEqualToString:WO_BUY_NOW_LINK_NOTIFICATION])
@@ -4412,220 +3303,201 @@ activate = @"--activate";
 
 - (BOOL)iTunesSendsNotifications
 {
-    static BOOL firstRun = YES;
-    if (!firstRun) return iTunesSendsNotifications;
-    firstRun = NO;
-
-    NSWorkspace *workspace  = [NSWorkspace sharedWorkspace];
-    NSString    *path       = [workspace fullPathForApplication:@"iTunes.app"];
-    if (path)
-    {
-        NSBundle     *bundle     = [NSBundle bundleWithPath:path];
-        NSDictionary *info       = [bundle infoDictionary];
-        NSString     *version    = [info objectForKey:@"CFBundleVersion"];
-        NSArray      *components = [version componentsSeparatedByString:@"."];
-        if (components && ([components count] >= 2))
-        {
-            int majorVersion, minorVersion;
-            NSScanner *scanner1 = [NSScanner scannerWithString:[components objectAtIndex:0]];
-            NSScanner *scanner2 = [NSScanner scannerWithString:[components objectAtIndex:1]];
-            if ([scanner1 scanInt:&majorVersion] && [scanner2 scanInt:&minorVersion])
-            {
-                if (((majorVersion == 4) && (minorVersion >= 7)) || (majorVersion > 4))
-                    iTunesSendsNotifications = YES;
-            }
-        }
-    }
-
-    return iTunesSendsNotifications;
+    return [player sendsNotifications];
 }
 
-- (void)handleNotification:(NSNotification *)aNotification
+- (void)playerBackend:(id)aBackend didChangeWithInfo:(NSDictionary *)userInfo
 {
-    if ([@"com.apple.iTunes.playerInfo" isEqual:[aNotification name]] ||
-        [@"com.apple.iTunes.player" isEqual:[aNotification object]])
-    {
-        [self launchTrackChangeItems:[self trackChangeLaunchItems]]; // new in 1.7
-
-        NSDictionary *userInfo = [aNotification userInfo];
-        if (!userInfo || ![userInfo isKindOfClass:[NSDictionary class]])
-            return;
+    [self launchTrackChangeItems:[self trackChangeLaunchItems]]; // new in 1.7
 
-        //NSString *grouping = [userInfo objectForKey:@"Grouping"];
-        NSString *name = [userInfo objectForKey:@"Name"];
-
-        // "Playing", "Stopped", "Paused"
-        NSString *playerState = [userInfo objectForKey:@"Player State"];
-
-        if (!playerState || ![playerState isKindOfClass:[NSString class]])
-            playerState = @"Unknown state";
-
-        // http://wincent.com/a/support/bugs/show_bug.cgi?id=142
-        if ([playerState isEqualToString:@"Stopped"] && !name)
-            return;
-
-        // hopefully fix this by moving this here (ie. don't update floater if iTunes has just exited; it will get updated in handleWorkspaceNotification)
-        // http://wincent.com/a/support/bugs/show_bug.cgi?id=188
-        [self timer:nil]; // update the floater etc
-
-        // int (milliseconds)
-        NSNumber *totalTime = [userInfo objectForKey:@"Total Time"];
-        NSString *album = [userInfo objectForKey:@"Album"];
-        NSString *artist = [userInfo objectForKey:@"Artist"];
-        // "file://localhost..." (local file)
-        // "http://pri.kts-af.net/redir/index..." (Internet radio)
-        NSString *location = [userInfo objectForKey:@"Location"];
-
-        // Audioscrobbler support; new in 3.1
-        WOAudioscrobblerLog(@"Received notification from iTunes");
-        if (!totalTime || ([totalTime unsignedIntValue] < (30 * 1000)))
-            [self audioscrobblerCurrentTrackIsTooShort];
-        else if (!location || ![location hasPrefix:@"file://"])
-            [self audioscrobblerCurrentTrackIsNotRegularFile];
-        else if ([playerState isEqualToString:@"Playing"])
-            [self audioscrobblerUpdateWithSong:name artist:artist album:album length:[totalTime unsignedIntValue]];
-        else
-            [self audioscrobblerNotPlaying:name artist:artist album:album length:[totalTime unsignedIntValue]];
+    if (!userInfo)
+        return;
 
-        // Growl support; also new in 1.7
-        // might be able to save some cycles here by calling isGrowlInstalled
-        // and isGrowlRunning before proceeding
-        NSNumber *year = [userInfo objectForKey:@"Year"];       // int
-        NSString *composer = [userInfo objectForKey:@"Composer"];
-        NSNumber *rating = [userInfo objectForKey:@"Rating"];   // int (0 - 100)
+    //NSString *grouping = [userInfo objectForKey:@"Grouping"];
+    NSString *name = [userInfo objectForKey:@"Name"];
 
-        // build description string
-        NSMutableString *workString = [NSMutableString string];
-        NSString *timeString = @"";
+    // "Playing", "Stopped", "Paused"
+    NSString *playerState = [userInfo objectForKey:@"Player State"];
 
-        NSNumber *pref = [synergyPreferences objectOnDiskForKey:_woIncludeAlbumInFloaterPrefKey];
-        if (pref && [pref boolValue] && album && [album isKindOfClass:[NSString class]])
-        {
-            [workString appendFormat:@"%@", album];
+    if (!playerState || ![playerState isKindOfClass:[NSString class]])
+        playerState = @"Unknown state";
 
-            pref = [synergyPreferences objectOnDiskForKey:_woIncludeYearInFloaterPrefKey];
-            if (pref && [pref boolValue] && year && [year isKindOfClass:[NSNumber class]])
-                [workString appendFormat:@" (%d)\n", [year intValue]];
-            else
-                [workString appendString:@"\n"];
-        }
-
-        BOOL showArtist = NO;
-        BOOL showComposer = NO;
+    // http://wincent.com/a/support/bugs/show_bug.cgi?id=142
+    if ([playerState isEqualToString:@"Stopped"] && !name)
+        return;
 
-        pref = [synergyPreferences objectOnDiskForKey:_woIncludeArtistInFloaterPrefKey];
-        if (pref && [pref boolValue])
-            showArtist = YES;
+    // remembered so that timer: can read artwork straight from the track's file
+    lastPlayerInfo = userInfo;
+
+    // hopefully fix this by moving this here (ie. don't update floater if iTunes has just exited; it will get updated in handleWorkspaceNotification)
+    // http://wincent.com/a/support/bugs/show_bug.cgi?id=188
+    [self timer:nil]; // update the floater etc
+
+    // int (milliseconds)
+    NSNumber *totalTime = [userInfo objectForKey:@"Total Time"];
+    NSString *album = [userInfo objectForKey:@"Album"];
+    NSString *artist = [userInfo objectForKey:@"Artist"];
+    // "file://localhost..." (local file)
+    // "http://pri.kts-af.net/redir/index..." (Internet radio)
+    NSString *location = [userInfo objectForKey:@"Location"];
+
+    // Audioscrobbler support; new in 3.1
+    WOAudioscrobblerLog(@"Received notification from iTunes");
+    if (!totalTime || ([totalTime unsignedIntValue] < (30 * 1000)))
+        [self audioscrobblerCurrentTrackIsTooShort];
+    else if (!location || ![location hasPrefix:@"file://"])
+        [self audioscrobblerCurrentTrackIsNotRegularFile];
+    else if ([playerState isEqualToString:@"Playing"])
+        [self audioscrobblerUpdateWithSong:name artist:artist album:album length:[totalTime unsignedIntValue]];
+    else
+        [self audioscrobblerNotPlaying:name artist:artist album:album length:[totalTime unsignedIntValue]];
 
-        pref = [synergyPreferences objectOnDiskForKey:_woIncludeComposerInFloaterPrefKey];
-        if (pref && [pref boolValue])
-            showComposer = YES;
+    // Growl support; also new in 1.7
+    // might be able to save some cycles here by calling isGrowlInstalled
+    // and isGrowlRunning before proceeding
+    NSNumber *year = [userInfo objectForKey:@"Year"];       // int
+    NSString *composer = [userInfo objectForKey:@"Composer"];
+    NSNumber *rating = [userInfo objectForKey:@"Rating"];   // int (0 - 100)
 
-        NSString *artistOrComposer = @"Unknown artist";
-        if (showArtist && showComposer)
-        {
-            if (artist && composer)
-                artistOrComposer =
-                [NSString stringWithFormat:@"%@ (%@)", artist, composer];
-            else if (artist)
-                artistOrComposer = artist;
-            else if (composer)
-                artistOrComposer = composer;
-            [workString appendFormat:@"%@\n", artistOrComposer];
-        }
-        else if (showArtist)
-        {
-            if (artist)
-                artistOrComposer = artist;
-            [workString appendFormat:@"%@\n", artistOrComposer];
-        }
-        else if (showComposer)
-        {
-            if (composer)
-                artistOrComposer = composer;
-            [workString appendFormat:@"%@\n", artistOrComposer];
-        }
+    // build description string
+    NSMutableString *workString = [NSMutableString string];
+    NSString *timeString = @"";
 
-        pref = [synergyPreferences objectOnDiskForKey:_woIncludeStarRatingInFloaterPrefKey];
-        if (pref && [pref boolValue] && rating && [rating isKindOfClass:[NSNumber class]])
-        {
-            unichar star = WO_ALT_RATING_STAR;
-            NSString *ratingString = @"";
-            int ratingNumber = [rating intValue];
-            if (ratingNumber > 80)
-                ratingString = [NSString stringWithFormat:@"%C%C%C%C%C",
-                                star, star,
-                                star, star,
-                                star];
-            else if (ratingNumber > 60)
-                ratingString = [NSString stringWithFormat:@"%C%C%C%C",
-                                star, star,
-                                star, star];
-            else if (ratingNumber > 40)
-                ratingString = [NSString stringWithFormat:@"%C%C%C",
-                                star, star,
-                                star];
-            else if (ratingNumber > 20)
-                ratingString = [NSString stringWithFormat:@"%C%C",
-                                star, star];
-            else if (ratingNumber > 0)
-                ratingString = [NSString stringWithFormat:@"%C", star];
-
-            [workString appendFormat:@"%@\n", ratingString];
-        }
-
-        pref = [synergyPreferences objectOnDiskForKey:_woIncludeDurationInFloaterPrefKey];
-        if (pref && [pref boolValue] && totalTime && [totalTime isKindOfClass:[NSNumber class]])
-        {
-            int seconds = [totalTime intValue] / 1000;
-            int days = seconds / 86400;
-            int hours = (seconds - (days * 86400)) / 3600;
-            int minutes = (seconds - (days * 86400) - (hours * 3600)) / 60;
-            seconds = seconds - (days * 86400) - (hours * 3600) - (minutes * 60);
-
-            if (days > 0)
-                timeString = [NSString stringWithFormat:
-                              @" (%02d:%02d:%02d:%02d)", days, hours, minutes, seconds];
-            else if (hours > 0)
-                timeString =
-                [NSString stringWithFormat:@" (%02d:%02d:%02d)", hours, minutes, seconds];
-            else
-                timeString =
-                [NSString stringWithFormat:@" (%02d:%02d)", minutes, seconds];
-        }
+    NSNumber *pref = [synergyPreferences objectOnDiskForKey:_woIncludeAlbumInFloaterPrefKey];
+    if (pref && [pref boolValue] && album && [album isKindOfClass:[NSString class]])
+    {
+        [workString appendFormat:@"%@", album];
 
-        // if iconData is nil, Growl will display Synergy icon instead
-        NSData *iconData = [[floaterController coverImage] TIFFRepresentation];
-        NSString *growlTitle = [NSString stringWithFormat:@"%@: %@%@", playerState, name, timeString];
-        NSString *growlDescription = [NSString stringWithString:workString];
-
-        // new for 2.0: coalesce Growl notications
-        NSDictionary *d = nil;
-        if (iconData)
-            d = [NSDictionary dictionaryWithObjectsAndKeys:
-                 @"Synergy",                         GROWL_APP_NAME,
-                 @"iTunes update",                   GROWL_NOTIFICATION_NAME,
-                 growlTitle,                         GROWL_NOTIFICATION_TITLE,
-                 growlDescription,                   GROWL_NOTIFICATION_DESCRIPTION,
-                 iconData,                           GROWL_NOTIFICATION_ICON,
-                 [NSNumber numberWithInt:0],         GROWL_NOTIFICATION_PRIORITY,
-                 [NSNumber numberWithBool:NO],       GROWL_NOTIFICATION_STICKY,
-                 @"Click",                           GROWL_NOTIFICATION_CLICK_CONTEXT,
-                 @"CoalescedSynergyNotification",    GROWL_NOTIFICATION_IDENTIFIER,
-                 nil];
+        pref = [synergyPreferences objectOnDiskForKey:_woIncludeYearInFloaterPrefKey];
+        if (pref && [pref boolValue] && year && [year isKindOfClass:[NSNumber class]])
+            [workString appendFormat:@" (%d)\n", [year intValue]];
         else
-            d = [NSDictionary dictionaryWithObjectsAndKeys:
-                 @"Synergy",                         GROWL_APP_NAME,
-                 @"iTunes update",                   GROWL_NOTIFICATION_NAME,
-                 growlTitle,                         GROWL_NOTIFICATION_TITLE,
-                 growlDescription,                   GROWL_NOTIFICATION_DESCRIPTION,
-                 [NSNumber numberWithInt:0],         GROWL_NOTIFICATION_PRIORITY,
-                 [NSNumber numberWithBool:NO],       GROWL_NOTIFICATION_STICKY,
-                 @"Click",                           GROWL_NOTIFICATION_CLICK_CONTEXT,
-                 @"CoalescedSynergyNotification",    GROWL_NOTIFICATION_IDENTIFIER,
-                 nil];
-        [GrowlApplicationBridge notifyWithDictionary:d];
-    }
+            [workString appendString:@"\n"];
+    }
+
+    BOOL showArtist = NO;
+    BOOL showComposer = NO;
+
+    pref = [synergyPreferences objectOnDiskForKey:_woIncludeArtistInFloaterPrefKey];
+    if (pref && [pref boolValue])
+        showArtist = YES;
+
+    pref = [synergyPreferences objectOnDiskForKey:_woIncludeComposerInFloaterPrefKey];
+    if (pref && [pref boolValue])
+        showComposer = YES;
+
+    NSString *artistOrComposer = @"Unknown artist";
+    if (showArtist && showComposer)
+    {
+        if (artist && composer)
+            artistOrComposer =
+            [NSString stringWithFormat:@"%@ (%@)", artist, composer];
+        else if (artist)
+            artistOrComposer = artist;
+        else if (composer)
+            artistOrComposer = composer;
+        [workString appendFormat:@"%@\n", artistOrComposer];
+    }
+    else if (showArtist)
+    {
+        if (artist)
+            artistOrComposer = artist;
+        [workString appendFormat:@"%@\n", artistOrComposer];
+    }
+    else if (showComposer)
+    {
+        if (composer)
+            artistOrComposer = composer;
+        [workString appendFormat:@"%@\n", artistOrComposer];
+    }
+
+    pref = [synergyPreferences objectOnDiskForKey:_woIncludeStarRatingInFloaterPrefKey];
+    if (pref && [pref boolValue] && rating && [rating isKindOfClass:[NSNumber class]])
+    {
+        unichar star = WO_ALT_RATING_STAR;
+        NSString *ratingString = @"";
+        int ratingNumber = [rating intValue];
+        if (ratingNumber > 80)
+            ratingString = [NSString stringWithFormat:@"%C%C%C%C%C",
+                            star, star,
+                            star, star,
+                            star];
+        else if (ratingNumber > 60)
+            ratingString = [NSString stringWithFormat:@"%C%C%C%C",
+                            star, star,
+                            star, star];
+        else if (ratingNumber > 40)
+            ratingString = [NSString stringWithFormat:@"%C%C%C",
+                            star, star,
+                            star];
+        else if (ratingNumber > 20)
+            ratingString = [NSString stringWithFormat:@"%C%C",
+                            star, star];
+        else if (ratingNumber > 0)
+            ratingString = [NSString stringWithFormat:@"%C", star];
+
+        [workString appendFormat:@"%@\n", ratingString];
+    }
+
+    pref = [synergyPreferences objectOnDiskForKey:_woIncludeDurationInFloaterPrefKey];
+    if (pref && [pref boolValue] && totalTime && [totalTime isKindOfClass:[NSNumber class]])
+    {
+        int seconds = [totalTime intValue] / 1000;
+        int days = seconds / 86400;
+        int hours = (seconds - (days * 86400)) / 3600;
+        int minutes = (seconds - (days * 86400) - (hours * 3600)) / 60;
+        seconds = seconds - (days * 86400) - (hours * 3600) - (minutes * 60);
+
+        if (days > 0)
+            timeString = [NSString stringWithFormat:
+                          @" (%02d:%02d:%02d:%02d)", days, hours, minutes, seconds];
+        else if (hours > 0)
+            timeString =
+            [NSString stringWithFormat:@" (%02d:%02d:%02d)", hours, minutes, seconds];
+        else
+            timeString =
+            [NSString stringWithFormat:@" (%02d:%02d)", minutes, seconds];
+    }
+
+    // if iconData is nil, Growl will display Synergy icon instead
+    // prefer the pre-scaled 128-pixel copy of the cover (already encoded; nothing to decode or rescale)
+    NSData          *iconData = nil;
+    WOCoverStore    *coverStore = [WOCoverDownloader coverStore];
+    WOCoverRecord   coverRecord;
+    NSString        *coverPath = [floaterController albumImagePath];
+    if (coverPath && [floaterController coverImage] && [coverStore lookupPath:coverPath record:&coverRecord])
+        iconData = [NSData dataWithContentsOfFile:[coverStore pathForRecord:&coverRecord fittingSize:128.0]];
+    if (!iconData)
+        iconData = [[floaterController coverImage] TIFFRepresentation];
+    NSString *growlTitle = [NSString stringWithFormat:@"%@: %@%@", playerState, name, timeString];
+    NSString *growlDescription = [NSString stringWithString:workString];
+
+    // new for 2.0: coalesce Growl notications
+    NSDictionary *d = nil;
+    if (iconData)
+        d = [NSDictionary dictionaryWithObjectsAndKeys:
+             @"Synergy",                         GROWL_APP_NAME,
+             @"iTunes update",                   GROWL_NOTIFICATION_NAME,
+             growlTitle,                         GROWL_NOTIFICATION_TITLE,
+             growlDescription,                   GROWL_NOTIFICATION_DESCRIPTION,
+             iconData,                           GROWL_NOTIFICATION_ICON,
+             [NSNumber numberWithInt:0],         GROWL_NOTIFICATION_PRIORITY,
+             [NSNumber numberWithBool:NO],       GROWL_NOTIFICATION_STICKY,
+             @"Click",                           GROWL_NOTIFICATION_CLICK_CONTEXT,
+             @"CoalescedSynergyNotification",    GROWL_NOTIFICATION_IDENTIFIER,
+             nil];
+    else
+        d = [NSDictionary dictionaryWithObjectsAndKeys:
+             @"Synergy",                         GROWL_APP_NAME,
+             @"iTunes update",                   GROWL_NOTIFICATION_NAME,
+             growlTitle,                         GROWL_NOTIFICATION_TITLE,
+             growlDescription,                   GROWL_NOTIFICATION_DESCRIPTION,
+             [NSNumber numberWithInt:0],         GROWL_NOTIFICATION_PRIORITY,
+             [NSNumber numberWithBool:NO],       GROWL_NOTIFICATION_STICKY,
+             @"Click",                           GROWL_NOTIFICATION_CLICK_CONTEXT,
+             @"CoalescedSynergyNotification",    GROWL_NOTIFICATION_IDENTIFIER,
+             nil];
+    [GrowlApplicationBridge notifyWithDictionary:d];
 }
 
 // watch for iTunes launch/quit events
@@ -4651,6 +3523,7 @@ activate = @"--activate";
             // taken straight out of timer method but rewritten with some "clue"
             [self updateTooltip:NSLocalizedString(@"Not running", @"Not running tool-tip")];
             iTunesState = ITUNES_NOT_RUNNING;   // update state variable
+            [self setNeedsFullUpdate];          // what's on screen no longer matches lastSnapshot
 
             if (!buttonClickOccurred)
             {
@@ -4719,6 +3592,48 @@ activate = @"--activate";
     return workingArray;
 }
 
+// returns the path of the local file iTunes last announced in a playerInfo
+// notification, provided that notification was for the given track; nil for
+// streams, for older versions of iTunes and when polling has run ahead of the
+// notifications
+- (NSString *)pathOfNotifiedTrack:(NSString *)title album:(NSString *)album
+{
+    NSString *location = [lastPlayerInfo objectForKey:@"Location"];
+    if (![location isKindOfClass:[NSString class]] || ![location hasPrefix:@"file://"])
+        return nil;
+    NSString *notifiedName = [lastPlayerInfo objectForKey:@"Name"];
+    NSString *notifiedAlbum = [lastPlayerInfo objectForKey:@"Album"];
+    if (!(notifiedName == title || [notifiedName isEqual:title]) ||
+        !(notifiedAlbum == album || [notifiedAlbum isEqual:album]))
+        return nil;
+    return [[NSURL URLWithString:location] path];
+}
+
+- (WOArtworkPipeline *)artworkPipeline
+{
+    if (!artworkPipeline)
+    {
+        WOCoverStore *coverStore = [WOCoverDownloader coverStore];
+        if (coverStore)
+        {
+            artworkPipeline = [[WOArtworkPipeline alloc] initWithStore:coverStore];
+            [artworkPipeline setDelegate:self];
+            [artworkPipeline addStandardProvidersWithPlayerQueue:playerQueue];
+        }
+    }
+    return artworkPipeline;
+}
+
+- (void)artworkPipeline:(WOArtworkPipeline *)aPipeline
+             foundCover:(const WOCoverRecord *)record
+             forRequest:(WOArtworkRequest *)aRequest
+{
+    // notify floater
+    WOCoverStore *coverStore = [WOCoverDownloader coverStore];
+    [floaterController setAlbumImagePath:[coverStore pathForRecord:record]
+                            variantPaths:[coverStore variantPathsForRecord:record]];
+}
+
 - (void)launchTrackChangeItems:(NSArray *)paths
 {
     NSWorkspace     *sharedWorkspace    = [NSWorkspace sharedWorkspace];
@@ -4752,45 +3667,19 @@ activate = @"--activate";
 // new for Synergy 2.9
 - (IBAction)transferCoverArtToITunes:(id)sender
 {
-    if (![WOProcessManager processRunningWithSignature:'hook'])
+    if (![player isRunning])
         return; // (double) check that iTunes is running
 
     // cannot just call coverImage because floater will return scaled art!
     NSString *artPath = [floaterController albumImagePath];
     if (!artPath)
         return;
-    NSImage *image = [[NSImage alloc] initWithContentsOfFile:artPath];
-    NSData *PICTData = [image PICTRepresentation];
-    if (!PICTData)
-        return;
-
-    // was bug: had to change descriptor type from 'JFIF' to 'PICT' (iTunes 9?)
-    // error was -2003: QuickTime cantFindHandler
-    // see: https://wincent.com/issues/1412
-    NSArray *parameters = [NSArray arrayWithObject:[NSAppleEventDescriptor descriptorWithDescriptorType:'PICT' data:PICTData]];
-
-    NSString *source =
-        @"on open args\n"
-        @"  try\n"
-        @"    set coverData to item 1 of args\n"
-        @"    tell application \"iTunes\"\n"
-        @"      with timeout of 15 seconds\n"
-        @"        set data of front artwork of current track to coverData\n"
-        @"      end timeout\n"
-        @"    end tell\n"
-        @"    return true\n"
-        @"  on error\n"
-        @"    return false\n"
-        @"  end try\n"
-        @"end open";
-
-    NSAppleScript           *script = [[NSAppleScript alloc] initWithSource:source];
-    NSDictionary            *error  = nil;
-    NSAppleEventDescriptor  *result = [script executeWithParameters:parameters error:&error];
-    if (!result || ![result booleanValue])
-        ELOG(@"Error transferring cover art");
-    else if (error)
-        ELOG(@"Error transferring cover art: %@", error);
+    NSImage *image = [[WOCoverImageCache sharedCache] imageWithContentsOfFile:artPath];
+    if (image)
+        [playerQueue sendCommand:@selector(setArtworkOfCurrentTrack:)
+                       arguments:[NSArray arrayWithObject:image]
+                          target:nil
+                        selector:NULL];
 }
 
 #pragma mark GrowlApplicationBridgeDelegate protocol
@@ -4823,16 +3712,21 @@ activate = @"--activate";
 #pragma mark Accessors
 #pragma mark -
 
-- (void)setSongToPlayOnceLaunched:(NSAppleEventDescriptor *)songId
+- (void)setSongToPlayOnceLaunched:(id)songId
 {
     songToPlayOnceLaunched = songId;
 }
 
-- (NSAppleEventDescriptor *)songToPlayOnceLaunched
+- (id)songToPlayOnceLaunched
 {
     return songToPlayOnceLaunched;
 }
 
+- (id <WOPlayerBackend>)player
+{
+    return player;
+}
+
 - (NSArray *)trackChangeLaunchItems
 {
     return trackChangeLaunchItems;
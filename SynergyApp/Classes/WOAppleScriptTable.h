@@ -0,0 +1,51 @@
+//
+//  WOAppleScriptTable.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+//! A fixed set of AppleScripts, looked up by name and compiled once for the life of the table.
+//!
+//! Scripts that need values from the caller are written as "on open args" handlers and given them as parameters (see
+//! NSAppleScript+WOAdditions) rather than being rebuilt from a format string for each value, so that after compileAll
+//! running any of them costs one Apple Event and no compilation. A script that fails to compile is tried again the next
+//! time it is run; compilationCount shows whether that is happening.
+//!
+//! \warn Not threadsafe
+@interface WOAppleScriptTable : NSObject {
+
+    //! WOAppleScriptTableEntry objects by name
+    NSMutableDictionary *entries;
+
+    unsigned            compilationCount;
+}
+
+//! Adds the script \p source under \p name, to be compiled by compileAll or on first use
+- (void)addScriptNamed:(NSString *)name source:(NSString *)source;
+
+//! Adds an already compiled script (loaded from a .scpt file, for example) under \p name
+- (void)addScriptNamed:(NSString *)name script:(NSAppleScript *)script;
+
+//! Compiles every script that is not already compiled
+- (void)compileAll;
+
+//! Runs the script called \p name and returns its result, or nil on failure
+- (NSAppleEventDescriptor *)runScriptNamed:(NSString *)name;
+
+//! Sends the "open" handler of the script called \p name the list \p parameters (strings, numbers and Apple Event
+//! descriptors) and returns its result, or nil on failure
+- (NSAppleEventDescriptor *)runScriptNamed:(NSString *)name parameters:(NSArray *)parameters;
+
+//! One line per script: how many times it has been compiled and run
+- (NSString *)statisticsDescription;
+
+#pragma mark -
+#pragma mark Properties
+
+//! Total number of compilations, successful or not
+@property(readonly) unsigned compilationCount;
+
+@end
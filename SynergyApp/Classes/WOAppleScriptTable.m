@@ -0,0 +1,138 @@
+// WOAppleScriptTable.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAppleScriptTable.h"
+
+// other headers
+#import "NSAppleScript+WOAdditions.h"
+#import "WODebug.h"
+
+//! One script in the table with its counters
+@interface WOAppleScriptTableEntry : NSObject {
+
+@public
+    NSAppleScript   *script;
+    unsigned        compilations;
+    unsigned        runs;
+}
+
+@end
+
+@implementation WOAppleScriptTableEntry
+
+@end
+
+@interface WOAppleScriptTable ()
+
+- (WOAppleScriptTableEntry *)compiledEntryNamed:(NSString *)name;
+- (BOOL)compileEntry:(WOAppleScriptTableEntry *)entry named:(NSString *)name;
+
+@end
+
+@implementation WOAppleScriptTable
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)init
+{
+    if ((self = [super init]))
+        entries = [[NSMutableDictionary alloc] init];
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)addScriptNamed:(NSString *)name source:(NSString *)source
+{
+    NSParameterAssert(source != nil);
+    [self addScriptNamed:name script:[[NSAppleScript alloc] initWithSource:source]];
+}
+
+- (void)addScriptNamed:(NSString *)name script:(NSAppleScript *)script
+{
+    NSParameterAssert(name != nil);
+    NSParameterAssert(script != nil);
+    NSAssert1([entries objectForKey:name] == nil, @"Script \"%@\" added twice", name);
+    WOAppleScriptTableEntry *entry = [[WOAppleScriptTableEntry alloc] init];
+    entry->script = script;
+    [entries setObject:entry forKey:name];
+}
+
+- (void)compileAll
+{
+    for (NSString *name in entries)
+    {
+        WOAppleScriptTableEntry *entry = [entries objectForKey:name];
+        if (![entry->script isCompiled])
+            (void)[self compileEntry:entry named:name];
+    }
+}
+
+- (NSAppleEventDescriptor *)runScriptNamed:(NSString *)name
+{
+    WOAppleScriptTableEntry *entry = [self compiledEntryNamed:name];
+    if (!entry)
+        return nil;
+    entry->runs++;
+    return [entry->script executeAndReturnError:NULL];
+}
+
+- (NSAppleEventDescriptor *)runScriptNamed:(NSString *)name parameters:(NSArray *)parameters
+{
+    WOAppleScriptTableEntry *entry = [self compiledEntryNamed:name];
+    if (!entry)
+        return nil;
+    entry->runs++;
+    return [entry->script executeWithParameters:parameters error:NULL];
+}
+
+- (NSString *)statisticsDescription
+{
+    NSMutableString *description = [NSMutableString stringWithFormat:@"%u compilations", compilationCount];
+    for (NSString *name in [[entries allKeys] sortedArrayUsingSelector:@selector(compare:)])
+    {
+        WOAppleScriptTableEntry *entry = [entries objectForKey:name];
+        [description appendFormat:@"\n%@: compiled %u, run %u", name, entry->compilations, entry->runs];
+    }
+    return description;
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// nil if there is no such script or it still does not compile
+- (WOAppleScriptTableEntry *)compiledEntryNamed:(NSString *)name
+{
+    WOAppleScriptTableEntry *entry = [entries objectForKey:name];
+    NSAssert1(entry != nil, @"No script named \"%@\"", name);
+    if (!entry)
+        return nil;
+
+    // NSAppleScript would compile it implicitly, but then it would not be counted
+    if (![entry->script isCompiled] && ![self compileEntry:entry named:name])
+        return nil;
+    return entry;
+}
+
+- (BOOL)compileEntry:(WOAppleScriptTableEntry *)entry named:(NSString *)name
+{
+    NSDictionary *error = nil;
+    compilationCount++;
+    entry->compilations++;
+    if ([entry->script compileAndReturnError:&error])
+        return YES;
+    ELOG(@"Error compiling \"%@\" script: %@", name, error);
+    return NO;
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize compilationCount;
+
+@end
@@ -0,0 +1,89 @@
+//
+//  WOArtworkPipeline.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+#import "WOArtworkProvider.h"
+
+@class WOArtworkPipeline, WOArtworkRace, WOPlayerQueue;
+
+@protocol WOArtworkPipelineDelegate
+
+//! Sent on the main thread when a provider turns up artwork for \p aRequest after findArtworkForRequest: has returned;
+//! \p record is already in the store
+- (void)artworkPipeline:(WOArtworkPipeline *)aPipeline
+             foundCover:(const WOCoverRecord *)record
+             forRequest:(WOArtworkRequest *)aRequest;
+
+@end
+
+//! Finds album artwork by asking a list of providers, cheapest first.
+//!
+//! Immediate providers (the store's index) are asked in turn. If none of them has anything, every concurrent provider
+//! (tags embedded in the audio file, a "cover.jpg" or the like next to it) is started on its own thread, and the first
+//! image that can be stored cancels the rest. The caller waits for the race for at most one frame, so anything on a
+//! local disk normally still arrives synchronously; after that the race goes on in the background until a deadline, and
+//! a late winner is reported to the delegate. If the race comes up empty, the player itself is asked over its
+//! WOPlayerQueue, so that the main thread never waits for iTunes, and if it has nothing either the remote providers start
+//! their searches, which report back by themselves (see WOCoverDownloader).
+//!
+//! Every image found is stored in the Album Covers folder before it is handed out, so that next time the index answers
+//! straight away.
+//!
+//! \warn Not threadsafe; should only be called from the main thread
+@interface WOArtworkPipeline : NSObject {
+
+    WOCoverStore                    *store;
+
+    id <WOArtworkPipelineDelegate>  delegate;
+
+    //! Providers (id <WOArtworkProvider>) in the order they were added, which is the order they are asked in within
+    //! their tier
+    NSMutableArray                  *providers;
+
+    //! Race for the most recent request, if it has not been settled yet
+    WOArtworkRace                   *currentRace;
+
+    //! Guards the state of every race; broadcast whenever one is settled
+    NSCondition                     *condition;
+
+    //! Asked for the current track's artwork once the race has failed; may be nil
+    WOPlayerQueue                   *playerQueue;
+
+    //! Request waiting for the player's artwork, if it has not been superseded
+    WOArtworkRequest                *playerRequest;
+
+    //! artworkOfCurrentTrack commands sent whose answers have not come back yet; only the last answer is for
+    //! playerRequest
+    NSUInteger                      playerAnswersOutstanding;
+}
+
+- (id)initWithStore:(WOCoverStore *)aStore;
+
+- (void)addProvider:(id <WOArtworkProvider>)aProvider;
+
+//! Adds the built-in providers: the store, embedded tags, image files next to the track and the cover search; the player
+//! behind \p aQueue, if not nil, is asked before the cover search
+- (void)addStandardProvidersWithPlayerQueue:(WOPlayerQueue *)aQueue;
+
+//! Cancels any earlier request and starts looking for artwork for \p aRequest. Returns YES if artwork was found (and the
+//! delegate told) before returning; otherwise the delegate may still be told later.
+- (BOOL)findArtworkForRequest:(WOArtworkRequest *)aRequest;
+
+//! Cancels the current request, if any; the delegate will not hear about it
+- (void)cancel;
+
+//! Stores \p data (an encoded image) for \p aRequest's track in the Album Covers folder, transcoding it to JPEG first
+//! if necessary (PICT from iTunes), and fills in \p record. Threadsafe.
+- (BOOL)storeImageData:(NSData *)data forRequest:(WOArtworkRequest *)aRequest record:(WOCoverRecord *)record;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(assign) id <WOArtworkPipelineDelegate> delegate;
+
+@end
@@ -0,0 +1,479 @@
+// WOArtworkPipeline.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOArtworkPipeline.h"
+
+// system headers
+#import <Cocoa/Cocoa.h>
+
+// other headers
+#import "WOArtworkRequest.h"
+#import "WOCoverDownloader.h"
+#import "WODebug.h"
+#import "WOEmbeddedArtwork.h"
+#import "WOPlayerQueue.h"
+#import "WOSongInfo.h"
+
+//! How long (seconds) the caller of findArtworkForRequest: waits for the race: one frame at 60Hz
+#define WO_ARTWORK_FRAME_BUDGET     (NSTimeInterval)(1.0 / 60.0)
+
+//! How long (seconds) the race may go on in the background before the later tiers are tried anyway
+#define WO_ARTWORK_RACE_DEADLINE    (NSTimeInterval)2.0
+
+typedef enum {
+
+    WOArtworkRacing,
+    WOArtworkRaceWon,
+    WOArtworkRaceLost,          // every racer finished empty-handed
+    WOArtworkRaceExpired        // the deadline passed, or the request was superseded
+
+} WOArtworkRaceState;
+
+// one run of the concurrent tier for one request
+@interface WOArtworkRace : NSObject {
+
+@public
+    WOArtworkRequest    *request;
+    WOArtworkRaceState  state;          // guarded by the pipeline's condition
+    NSUInteger          remaining;      // racers still running; guarded by the pipeline's condition
+    WOCoverRecord       record;         // the winner's, once state is WOArtworkRaceWon
+    BOOL                reported;       // main thread only
+}
+
+@end
+
+@implementation WOArtworkRace
+
+@end
+
+#pragma mark -
+#pragma mark Standard providers
+
+// covers already in the store
+@interface WOStoreArtworkProvider : NSObject <WOArtworkProvider> {
+
+    WOCoverStore    *store;
+}
+
+- (id)initWithStore:(WOCoverStore *)aStore;
+
+@end
+
+@implementation WOStoreArtworkProvider
+
+- (id)initWithStore:(WOCoverStore *)aStore
+{
+    if ((self = [super init]))
+        self->store = aStore;
+    return self;
+}
+
+- (WOArtworkTier)tier
+{
+    return WOArtworkTierImmediate;
+}
+
+- (BOOL)findArtworkForRequest:(WOArtworkRequest *)aRequest data:(NSData **)data record:(WOCoverRecord *)record
+{
+    return [store lookupKey:[aRequest coverKey] record:record buyNowURL:NULL];
+}
+
+@end
+
+// pictures embedded in the track's own tags
+@interface WOEmbeddedArtworkProvider : NSObject <WOArtworkProvider> {
+
+}
+
+@end
+
+@implementation WOEmbeddedArtworkProvider
+
+- (WOArtworkTier)tier
+{
+    return WOArtworkTierConcurrent;
+}
+
+- (BOOL)findArtworkForRequest:(WOArtworkRequest *)aRequest data:(NSData **)data record:(WOCoverRecord *)record
+{
+    NSString *path = [aRequest trackPath];
+    if (!path)
+        return NO;
+    *data = [WOEmbeddedArtwork artworkDataWithContentsOfFile:path];
+    return (*data != nil);
+}
+
+@end
+
+// "cover.jpg", "folder.jpg" and friends next to the track, in order of preference; matched without regard to case
+static NSString *WOFolderArtworkNames[] = {
+    @"cover.jpg", @"cover.jpeg", @"cover.png",
+    @"folder.jpg", @"folder.jpeg", @"folder.png",
+    @"front.jpg", @"front.jpeg", @"front.png",
+    @"albumart.jpg", @"albumart.png"
+};
+
+// image files that sit next to the track
+@interface WOFolderArtworkProvider : NSObject <WOArtworkProvider> {
+
+}
+
+@end
+
+@implementation WOFolderArtworkProvider
+
+- (WOArtworkTier)tier
+{
+    return WOArtworkTierConcurrent;
+}
+
+- (BOOL)findArtworkForRequest:(WOArtworkRequest *)aRequest data:(NSData **)data record:(WOCoverRecord *)record
+{
+    NSString *folder = [[aRequest trackPath] stringByDeletingLastPathComponent];
+    if (!folder)
+        return NO;
+
+    // one directory listing rather than an open() per candidate name
+    NSArray *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:folder error:NULL];
+    NSMutableDictionary *names = [NSMutableDictionary dictionaryWithCapacity:[contents count]];
+    for (NSString *name in contents)
+        [names setObject:name forKey:[name lowercaseString]];
+
+    for (NSUInteger i = 0; i < sizeof(WOFolderArtworkNames) / sizeof(WOFolderArtworkNames[0]); i++)
+    {
+        NSString *name = [names objectForKey:WOFolderArtworkNames[i]];
+        if (!name)
+            continue;
+        if ([aRequest isCancelled])
+            return NO;
+        NSData *image = [NSData dataWithContentsOfMappedFile:[folder stringByAppendingPathComponent:name]];
+        unsigned format, width, height;
+        if (image && [WOCoverStore sniffImageData:image format:&format width:&width height:&height])
+        {
+            *data = image;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+@end
+
+// the cover search, which stores what it finds and posts WO_DOWNLOAD_DONE_NOTIFICATION
+@interface WORemoteArtworkProvider : NSObject <WOArtworkProvider> {
+
+}
+
+@end
+
+@implementation WORemoteArtworkProvider
+
+- (WOArtworkTier)tier
+{
+    return WOArtworkTierRemote;
+}
+
+- (BOOL)findArtworkForRequest:(WOArtworkRequest *)aRequest data:(NSData **)data record:(WOCoverRecord *)record
+{
+    // a racer that missed the deadline may have got there first
+    if ([[WOCoverDownloader coverStore] lookupKey:[aRequest coverKey] record:record buyNowURL:NULL])
+        return YES;
+
+    // queues the search unless the index knows there is nothing to find
+    [WOCoverDownloader albumCoverExists:[aRequest songInfo]];
+    return NO;
+}
+
+@end
+
+#pragma mark -
+
+@interface WOArtworkPipeline ()
+
+- (BOOL)askProvider:(id <WOArtworkProvider>)aProvider
+         forRequest:(WOArtworkRequest *)aRequest
+               data:(NSData **)data
+             record:(WOCoverRecord *)record;
+- (BOOL)askProvidersInTier:(WOArtworkTier)tier forRequest:(WOArtworkRequest *)aRequest;
+- (BOOL)finishRequest:(WOArtworkRequest *)aRequest;
+- (void)race:(NSArray *)arguments;
+- (void)raceSettled:(WOArtworkRace *)race;
+- (void)raceExpired:(WOArtworkRace *)race;
+- (void)playerArtworkDidArrive:(NSData *)data;
+
+@end
+
+@implementation WOArtworkPipeline
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithStore:(WOCoverStore *)aStore
+{
+    NSParameterAssert(aStore != nil);
+    if ((self = [super init]))
+    {
+        self->store     = aStore;
+        self->providers = [NSMutableArray array];
+        self->condition = [[NSCondition alloc] init];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)addProvider:(id <WOArtworkProvider>)aProvider
+{
+    NSParameterAssert(aProvider != nil);
+    [providers addObject:aProvider];
+}
+
+- (void)addStandardProvidersWithPlayerQueue:(WOPlayerQueue *)aQueue
+{
+    [self addProvider:[[WOStoreArtworkProvider alloc] initWithStore:store]];
+    [self addProvider:[[WOEmbeddedArtworkProvider alloc] init]];
+    [self addProvider:[[WOFolderArtworkProvider alloc] init]];
+    [self addProvider:[[WORemoteArtworkProvider alloc] init]];
+    playerQueue = aQueue;
+}
+
+- (BOOL)findArtworkForRequest:(WOArtworkRequest *)aRequest
+{
+    NSParameterAssert(aRequest != nil);
+    [self cancel];
+
+    // not enough information to identify a cover
+    if (![aRequest coverKey])
+        return NO;
+
+    if ([self askProvidersInTier:WOArtworkTierImmediate forRequest:aRequest])
+        return YES;
+
+    WOArtworkRace *race = [[WOArtworkRace alloc] init];
+    race->request = aRequest;
+    for (id <WOArtworkProvider> provider in providers)
+    {
+        if ([provider tier] != WOArtworkTierConcurrent)
+            continue;
+        race->remaining++;
+        [NSThread detachNewThreadSelector:@selector(race:)
+                                 toTarget:self
+                               withObject:[NSArray arrayWithObjects:race, provider, nil]];
+    }
+    if (race->remaining == 0)
+        return [self finishRequest:aRequest];
+
+    // give the race one frame before leaving it to the background
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:WO_ARTWORK_FRAME_BUDGET];
+    [condition lock];
+    while (race->state == WOArtworkRacing && [condition waitUntilDate:limit])
+        ;
+    WOArtworkRaceState state = race->state;
+    [condition unlock];
+    if (state == WOArtworkRacing)
+    {
+        currentRace = race;
+        [self performSelector:@selector(raceExpired:) withObject:race afterDelay:WO_ARTWORK_RACE_DEADLINE];
+        return NO;
+    }
+
+    // settled in time; the raceSettled: message on its way from the winner will be ignored
+    race->reported = YES;
+    if (state == WOArtworkRaceWon)
+    {
+        [delegate artworkPipeline:self foundCover:&race->record forRequest:aRequest];
+        return YES;
+    }
+    return [self finishRequest:aRequest];
+}
+
+- (void)cancel
+{
+    playerRequest = nil;
+    if (!currentRace)
+        return;
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(raceExpired:) object:currentRace];
+    [condition lock];
+    if (currentRace->state == WOArtworkRacing)
+        currentRace->state = WOArtworkRaceExpired;
+    [condition unlock];
+    [currentRace->request cancel];
+    currentRace = nil;
+}
+
+- (BOOL)storeImageData:(NSData *)data forRequest:(WOArtworkRequest *)aRequest record:(WOCoverRecord *)record
+{
+    // write the image out as it came (with pre-scaled variants), then index it
+    memset(record, 0, sizeof(*record));
+    record->key         = [aRequest coverKey];
+    record->location    = WOCoverLocationPermanent;
+    if ([store ingestImageData:data record:record buyNowURL:nil])
+        return YES;
+
+    // ImageIO couldn't read it (typically PICT from iTunes): let AppKit transcode it to JPEG
+    NSImage             *image = [[NSImage alloc] initWithData:data];
+    NSData              *TIFFData = [image TIFFRepresentation];
+    NSBitmapImageRep    *rep = TIFFData ? [NSBitmapImageRep imageRepWithData:TIFFData] : nil;
+    NSNumber            *quality = [NSNumber numberWithFloat:0.80];
+    NSDictionary        *properties = [NSDictionary dictionaryWithObject:quality forKey:NSImageCompressionFactor];
+    NSData              *JPEGData = [rep representationUsingType:NSJPEGFileType properties:properties];
+    return JPEGData && [store ingestImageData:JPEGData record:record buyNowURL:nil];
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// enclose this in an exception handling block because I've heard reports that talking to iTunes can crash
+- (BOOL)askProvider:(id <WOArtworkProvider>)aProvider
+         forRequest:(WOArtworkRequest *)aRequest
+               data:(NSData **)data
+             record:(WOCoverRecord *)record
+{
+    BOOL found = NO;
+    *data = nil;
+    memset(record, 0, sizeof(*record));
+    NS_DURING
+        found = [aProvider findArtworkForRequest:aRequest data:data record:record];
+    NS_HANDLER
+        ELOG(@"Warning: exception caught while looking for cover art with %@: %@", aProvider, [localException reason]);
+    NS_ENDHANDLER
+    return found;
+}
+
+// asks the providers in tier one after the other, storing what they find and telling the delegate; main thread only
+- (BOOL)askProvidersInTier:(WOArtworkTier)tier forRequest:(WOArtworkRequest *)aRequest
+{
+    for (id <WOArtworkProvider> provider in providers)
+    {
+        if ([provider tier] != tier)
+            continue;
+        NSData          *data;
+        WOCoverRecord   record;
+        if ([self askProvider:provider forRequest:aRequest data:&data record:&record] &&
+            (!data || [self storeImageData:data forRequest:aRequest record:&record]))
+        {
+            [delegate artworkPipeline:self foundCover:&record forRequest:aRequest];
+            return YES;
+        }
+    }
+    return NO;
+}
+
+// what comes after the race: the player, then the remote tier; main thread only
+- (BOOL)finishRequest:(WOArtworkRequest *)aRequest
+{
+    // the player answers in playerArtworkDidArrive:, which goes on to the remote tier if need be
+    if (playerQueue && [playerQueue sendCommand:@selector(artworkOfCurrentTrack)
+                                      arguments:nil
+                                         target:self
+                                       selector:@selector(playerArtworkDidArrive:)])
+    {
+        playerAnswersOutstanding++;
+        playerRequest = aRequest;
+        return NO;
+    }
+    return [self askProvidersInTier:WOArtworkTierRemote forRequest:aRequest];
+}
+
+// body of a racer thread
+- (void)race:(NSArray *)arguments
+{
+    NSAutoreleasePool       *pool       = [[NSAutoreleasePool alloc] init];
+    WOArtworkRace           *race       = [arguments objectAtIndex:0];
+    id <WOArtworkProvider>  provider    = [arguments objectAtIndex:1];
+    WOArtworkRequest        *request    = race->request;
+    NSData                  *data       = nil;
+    WOCoverRecord           record;
+    BOOL                    found       = NO;
+    if (![request isCancelled])
+        found = [self askProvider:provider forRequest:request data:&data record:&record];
+    if (found && data)
+    {
+        // only the first image is stored; the others are dropped unless it turns out to be unreadable
+        @synchronized (race)
+        {
+            found = ![request isCancelled] && [self storeImageData:data forRequest:request record:&record];
+            if (found)
+                [request cancel];
+        }
+    }
+    else if (found)
+        [request cancel];
+
+    BOOL settled = NO;
+    [condition lock];
+    if (race->state == WOArtworkRacing)
+    {
+        if (found)
+        {
+            race->record    = record;
+            race->state     = WOArtworkRaceWon;
+            settled         = YES;
+        }
+        else if (--race->remaining == 0)
+        {
+            race->state     = WOArtworkRaceLost;
+            settled         = YES;
+        }
+        if (settled)
+            [condition broadcast];
+    }
+    [condition unlock];
+    if (settled)
+        [self performSelectorOnMainThread:@selector(raceSettled:) withObject:race waitUntilDone:NO];
+    [pool drain];
+}
+
+// main thread only
+- (void)raceSettled:(WOArtworkRace *)race
+{
+    if (race != currentRace || race->reported)
+        return;
+    race->reported  = YES;
+    currentRace     = nil;
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(raceExpired:) object:race];
+    [condition lock];
+    WOArtworkRaceState state = race->state;
+    [condition unlock];
+    if (state == WOArtworkRaceWon)
+        [delegate artworkPipeline:self foundCover:&race->record forRequest:race->request];
+    else
+        [self finishRequest:race->request];
+}
+
+// main thread only
+- (void)raceExpired:(WOArtworkRace *)race
+{
+    [condition lock];
+    if (race->state == WOArtworkRacing)
+        race->state = WOArtworkRaceExpired;
+    [condition unlock];
+    [race->request cancel];
+    [self raceSettled:race];
+}
+
+// sent by the player queue with the result of artworkOfCurrentTrack; main thread only
+- (void)playerArtworkDidArrive:(NSData *)data
+{
+    // answers to commands sent for earlier requests are dropped
+    if (--playerAnswersOutstanding > 0 || !playerRequest)
+        return;
+    WOArtworkRequest    *request = playerRequest;
+    WOCoverRecord       record;
+    playerRequest = nil;
+    if (data && [self storeImageData:data forRequest:request record:&record])
+        [delegate artworkPipeline:self foundCover:&record forRequest:request];
+    else
+        [self askProvidersInTier:WOArtworkTierRemote forRequest:request];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize delegate;
+
+@end
@@ -0,0 +1,34 @@
+//
+//  WOArtworkProvider.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+#import "WOCoverStore.h"
+
+@class WOArtworkRequest;
+
+//! How a provider is scheduled by WOArtworkPipeline; tiers are tried in this order
+typedef enum {
+
+    WOArtworkTierImmediate,     //!< Answers from memory; run in turn on the main thread before anything else
+    WOArtworkTierConcurrent,    //!< Reads local files; run at the same time as the others in its tier, each on its own
+                                //!< thread, and the first to find something wins
+    WOArtworkTierRemote         //!< Starts a search that reports back by itself; run last
+
+} WOArtworkTier;
+
+//! A source of album artwork for a WOArtworkPipeline
+@protocol WOArtworkProvider
+
+- (WOArtworkTier)tier;
+
+//! Returns YES if artwork was found for \p aRequest, either setting \p data to the encoded image (which the pipeline
+//! stores) or leaving it nil and filling in \p record with a cover that is already in the store. Providers in the
+//! concurrent tier are called on secondary threads and should give up early once the request is cancelled.
+- (BOOL)findArtworkForRequest:(WOArtworkRequest *)aRequest data:(NSData **)data record:(WOCoverRecord *)record;
+
+@end
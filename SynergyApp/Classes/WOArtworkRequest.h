@@ -0,0 +1,42 @@
+//
+//  WOArtworkRequest.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class WOSongInfo;
+
+//! The track a WOArtworkPipeline is looking for artwork for, as seen by its providers.
+//!
+//! \warn Threadsafe
+@interface WOArtworkRequest : NSObject {
+
+    WOSongInfo  *songInfo;
+
+    //! Audio file of the track, or nil if it is not known (streams, or iTunes has not said)
+    NSString    *trackPath;
+
+    //! Set once providers still running in the background should stop: the request has been answered or superseded,
+    //! or the race it was in has run out of time
+    BOOL        cancelled;
+}
+
+- (id)initWithSongInfo:(WOSongInfo *)aSongInfo trackPath:(NSString *)aPath;
+
+- (void)cancel;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(readonly) WOSongInfo *songInfo;
+@property(readonly) NSString *trackPath;
+
+//! Shorthand for the song info's cover key
+@property(readonly) uint64_t coverKey;
+
+@property(readonly, getter=isCancelled) BOOL cancelled;
+
+@end
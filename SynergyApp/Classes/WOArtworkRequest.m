@@ -0,0 +1,60 @@
+// WOArtworkRequest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOArtworkRequest.h"
+
+// other headers
+#import "WOSongInfo.h"
+
+@implementation WOArtworkRequest
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithSongInfo:(WOSongInfo *)aSongInfo trackPath:(NSString *)aPath
+{
+    NSParameterAssert(aSongInfo != nil);
+    if ((self = [super init]))
+    {
+        self->songInfo  = aSongInfo;
+        self->trackPath = [aPath copy];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)cancel
+{
+    @synchronized (self)
+    {
+        cancelled = YES;
+    }
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize songInfo;
+@synthesize trackPath;
+
+- (uint64_t)coverKey
+{
+    return [songInfo coverKey];
+}
+
+- (BOOL)isCancelled
+{
+    BOOL value;
+    @synchronized (self)
+    {
+        value = cancelled;
+    }
+    return value;
+}
+
+@end
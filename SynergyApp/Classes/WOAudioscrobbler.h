@@ -6,90 +6,46 @@
 //  Copyright 2006-present Greg Hurrell.
 
 #import <Cocoa/Cocoa.h>
+#import "WOAudioscrobblerEngine.h"
+#import "WOHTTPClient.h"
 
-typedef enum {
+@class WOAudioscrobblerLibraryImporter;
 
-    WOAudioscrobblerIdle,
-    WOAudioscrobblerWaitingForHandshake,
-    WOAudioscrobblerHandshakeFailed,
-    WOAudioscrobblerHandshakeSucceeded,
-    WOAudioscrobblerBadUser,
-    WOAudioscrobblerWaitingForSubmissionResponse,
-    WOAudioscrobblerSubmissionFailed,
-    WOAudioscrobblerSubmissionSucceeded,
-    WOAudioscrobblerWaitingToRetrySubmission,
-    WOAudioscrobblerBadAuth,
-    WOAudioscrobblerNoAuth                          //!< State when username and/or password is not set
-
-} WOAudioscrobblerState;
-
-//! \sa     http://www.audioscrobbler.net/wiki/Protocol1.0_1.1
+//! Runs the Audioscrobbler engine inside the application: the shared WOHTTPClient serves as the transport (so the
+//! handshake, the submissions and any mirrors to the same server share kept-alive connections), the main run loop as
+//! the clock, and the submission queue is journaled to disk and flushed when the application terminates.
+//!
 //! \warn   Not threadsafe; should only be called from a single thread (most likely the main thread)
-@interface WOAudioscrobbler : NSObject {
-
-    NSString                *protocolVersion;
-
-    WOAudioscrobblerState   currentState;
-
-    //! FIFO (first-in, first-out submissions queue)
-    NSMutableArray          *queue;
-
-    //! Keep count of submission failures.
-    unsigned                submissionFailures;
-
-    //! Keep count of "BADAUTH" retries.
-    unsigned                badauthRetries;
-
-    //! "INTERVAL commands can be at the end of any response block, but don't expect them to be. Always observe the latest INTERVAL you get."
-    unsigned                lastKnownInterval;
+@interface WOAudioscrobbler : WOAudioscrobblerEngine <WOAudioscrobblerTransport, WOAudioscrobblerClock,
+    WOHTTPRequestDelegate> {
 
+    WOHTTPRequest           *request;
 
-    //! Instance variables starting with underscores; Apple officially does it in Leopard (synthesized instance variables with properties)
-    NSURLConnection         *connection;
+    //! Engines for additional endpoints; they share this engine's play log but have sessions of their own
+    NSMutableArray          *mirrors;
 
-    NSMutableData           *receivedData;
+    //! Non-nil while plays made while Synergy was not running are being recovered from the iTunes library
+    WOAudioscrobblerLibraryImporter *libraryImporter;
 
-    //! Passed in from last.fm during handshake
-    NSURL                   *submissionURL;
-
-    //! Passed in from last.fm during handshake
-    NSString                *challenge;
-
-    //! User agent string passed with all new requests
-    NSString                *userAgent;
-
-    NSString                *user;
-
-    NSString                *password;
+    //! YES once the library watermark reflects this session, so that its end time may be recorded
+    BOOL                    libraryImportFinished;
 }
 
+//! Designated initializer; \p aLog is shared with another engine when mirroring, or nil to use the journal
+- (id)initWithHandshakeURLBase:(NSString *)aBase playLog:(WOAudioscrobblerPlayLog *)aLog;
 
-#pragma mark -
-#pragma mark Custom methods
-
-//! \warn Can only start a session when idle
-- (void)startSession;
-
-//! Can be used to force a session to be renegotiated (a new handshake)
-- (void)refreshSession;
-
-- (void)submitSong:(NSString *)track artist:(NSString *)artist album:(NSString *)album length:(unsigned)length;
+//! Sends a copy of every play to the protocol-compatible server at \p aBase as well. The mirror takes its credentials from
+//! this engine and follows its session; it should be added before the session is started.
+- (void)addMirrorWithHandshakeURLBase:(NSString *)aBase;
 
-- (void)finalizeSession;
+//! Recovers plays made since Synergy last ran from the iTunes library on a background thread and queues them; if
+//! \p submit is NO the library is only scanned to bring the watermark up to date
+- (void)importLibraryPlays:(BOOL)submit;
 
 #pragma mark -
 #pragma mark Properties
 
-@property(copy)     NSString                *protocolVersion;
-@property           WOAudioscrobblerState   currentState;
-@property(copy)     NSMutableArray          *queue;
-@property           unsigned                lastKnownInterval;
-@property(assign)   NSURLConnection         *connection;
-@property(copy)     NSMutableData           *receivedData;
-@property(copy)     NSURL                   *submissionURL;
-@property(copy)     NSString                *challenge;
-@property(copy)     NSString                *userAgent;
-@property(copy)     NSString                *user;
-@property(copy)     NSString                *password;
+@property(assign)   WOHTTPRequest           *request;
+@property(assign)   WOAudioscrobblerLibraryImporter *libraryImporter;
 
 @end
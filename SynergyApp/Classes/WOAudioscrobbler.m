@@ -6,78 +6,23 @@
 // class header
 #import "WOAudioscrobbler.h"
 
-// system headers
-#import <openssl/md5.h>                     /* requires -lcrypto linker flag, TODO: in Synergy Advance, use CDSA instead */
-
 // other headers
-#import "WOAudioscrobblerController.h"      /* WOAudioscrobblerLog */
-
-// WOPublic headers
-#import "WOPublic/WOConvenienceMacros.h"
-#import "WOPublic/WODebugMacros.h"
-
-// TODO: wrap this up (or equivalent code) in a plug-in for Synergy Advance
+#import "WOAudioscrobblerJournal.h"
+#import "WOAudioscrobblerLibraryImporter.h"
+#import "WOAudioscrobblerLog.h"
+#import "WOAudioscrobblerPlayLog.h"
 
 //! Default timeout in seconds as noted in the NSURLRequest documentation
 #define WO_DEFAULT_URL_REQUEST_TIMEOUT  60
 
-//! Handshake delay in seconds after repeated failures failure: "A Handshake should occur just once during a SESSION, e.g. when the APP first loads, or after the APP detects 3 catastrophic (i.e. DNS resolution or connection refused) failures in submitting. In this case, the APP should not handshake more than once every 30 minutes."
-#define WO_HANDSHAKE_DELAY_ON_FAILURES  (60 * 30)
-
-#ifdef WO_AUDIOSCROBBLER_TEST_MODE
-
-#define WO_ASSIGNED_PLUGIN_ID           @"tst"
-#define WO_ASSIGNED_PLUGIN_VERSION      @"1.0"
-
-#else
-
-//! Synergy's Audioscrobbler plug-in ID as assigned by Russ of last.fm
-#define WO_ASSIGNED_PLUGIN_ID           @"syn"
-
-//! Synergy's Audioscrobbler plug-in version as assigned by Russ of last.fm
-#define WO_ASSIGNED_PLUGIN_VERSION      @"0.1"
-
-#endif /* WO_AUDIOSCROBBLER_TEST_MODE */
-
-//! Base URL used for posting handshake requests
-#define WO_HANDSHAKE_URL_BASE           @"http://post.audioscrobbler.com/"
-
-//! Audioscrobbler protocol version
-#define WO_PROTOCOL_VERSION             @"1.1"
-
-//! Default delay between submissions in seconds
-#define WO_DEFAULT_INTERVAL             1
-
-//! Reply keywords from Audioscrobbler
-#define WO_UP_TO_DATE   @"UPTODATE"
-#define WO_UPDATE       @"UPDATE"
-#define WO_FAILED       @"FAILED"
-#define WO_BADUSER      @"BADUSER"
-#define WO_INTERVAL     @"INTERVAL"
-#define WO_OK           @"OK"
-#define WO_BADAUTH      @"BADAUTH"
-
 //! HTTP headers
 #define WO_USER_AGENT @"User-Agent"
 
-#define WO_DEFAULT_USER_AGENT @"Synergy (NSURLConnection) $Rev: 338 $"
-
-//! Dictionary keys for items in queue
-#define WO_TRACK_KEY    @"WOTrack"
-#define WO_ARTIST_KEY   @"WOArtist"
-#define WO_ALBUM_KEY    @"WOAlbum"
-#define WO_MBID_KEY     @"WOMBID"
-#define WO_LENGTH_KEY   @"WOLength"
-#define WO_DATE_KEY     @"WODate"
+#define WO_DEFAULT_USER_AGENT @"Synergy (WOHTTPClient) $Rev: 338 $"
 
 @interface WOAudioscrobbler ()
 
-- (void)requestHandshake;
-- (NSString *)dateString;
-- (BOOL)queueIsEmpty;
-- (void)enqueue:(id)object;
-- (NSDictionary *)firstObjectInQueue;
-- (void)doSubmission:(NSDictionary *)songInfo;
+- (void)recordSessionEndDate;
 
 @end
 
@@ -87,15 +32,34 @@
 #pragma mark NSObject overrides
 
 - (id)init
+{
+    return [self initWithHandshakeURLBase:nil playLog:nil];
+}
+
+- (id)initWithHandshakeURLBase:(NSString *)aBase playLog:(WOAudioscrobblerPlayLog *)aLog
 {
     if ((self = [super init]))
     {
         WOAudioscrobblerLog(@"Initializing WOAudioscrobbler object");
-        self->protocolVersion      = WO_PROTOCOL_VERSION;
-        self->currentState         = WOAudioscrobblerIdle;
-        self->queue                = [NSMutableArray array];
-        self->userAgent            = WO_DEFAULT_USER_AGENT;
-        self->lastKnownInterval    = WO_DEFAULT_INTERVAL;
+        self.transport = self;
+        self.clock = self;
+        self.userAgent = WO_DEFAULT_USER_AGENT;
+        if (aBase)
+            self.handshakeURLBase = aBase;
+        self->mirrors = [NSMutableArray array];
+
+        // mirrors are driven entirely by the engine whose log they share
+        if (aLog)
+        {
+            [self attachPlayLog:aLog];
+            return self;
+        }
+
+        NSString *journalPath = [WOAudioscrobblerJournal defaultPath];
+        if (journalPath)
+            [self attachJournal:[[WOAudioscrobblerJournal alloc] initWithPath:journalPath]];
+        else
+            NSLog(@"warning: no Audioscrobbler journal available; unsent plays will not survive a restart");
 
         [[NSNotificationCenter defaultCenter] addObserver:self
                                                  selector:@selector(willTerminate:)
@@ -112,640 +76,227 @@
     [super finalize];
 }
 
-#pragma mark -
-#pragma mark Custom methods
-
-- (void)startSession
-{
-    WOAudioscrobblerLog(@"Start Audioscrobbler session");
-    WOAssert(self.currentState == WOAudioscrobblerIdle);
-    [self requestHandshake];
-}
-
-- (void)refreshSession
+- (void)willTerminate:(NSNotification *)aNotification
 {
-    // cancel any in-progress URL requests
-    if (self.connection)
-    {
-        [self.connection cancel];
-        self.connection = nil;
-        self.receivedData = nil;
-    }
+    [self finalizeSession];
 
-    // reset state and request the handshake again
-    self.currentState = WOAudioscrobblerIdle;
-    WOAudioscrobblerLog(@"Refresh Audioscrobbler session");
-    [self requestHandshake];
+    // plays from here on happen while Synergy is not watching and are left for the next library import
+    [self recordSessionEndDate];
 }
 
+// live plays, as opposed to those recovered from the library
 - (void)submitSong:(NSString *)track artist:(NSString *)artist album:(NSString *)album length:(unsigned)length
 {
-    NSParameterAssert(length >= 30);
-    if (!track || [track isEqualToString:@""])
-    {
-        // doubtful that this will ever happen as iTunes always seems to define a title, even if it is only the filename
-        NSLog(@"Cannot submit to last.fm if track has no title");
-        return;
-    }
+    [super submitSong:track artist:artist album:album length:length];
 
-    // "all the post variables noted here MUST be supplied for each entry, even if they are blank."
-    if (!artist)    artist = @"";
-    if (!album)     album = @"";
-    NSString        *mbid = @"";
-
-    NSDictionary *song = [NSDictionary dictionaryWithObjectsAndKeys:
-        track,                                      WO_TRACK_KEY,
-        artist,                                     WO_ARTIST_KEY,
-        album,                                      WO_ALBUM_KEY,
-        mbid,                                       WO_MBID_KEY,
-        [NSNumber numberWithUnsignedInt:length],    WO_LENGTH_KEY,
-        [self dateString],                          WO_DATE_KEY, nil];
-    WOAudioscrobblerLog(@"Adding song to submission queue; song information: %@", song);
-    [self enqueue:song];
+    // after a crash there is no willTerminate:, so the watermark has to keep up with every play scrobbled live or the
+    // next import would rebuild them all from their play counts and scrobble them again
+    [self recordSessionEndDate];
 }
 
-- (void)finalizeSession
+// moves the library watermark's time up to now, once the journal holds every play queued so far; does nothing until
+// the import has brought the watermark up to date for this session
+- (void)recordSessionEndDate
 {
-    WOAudioscrobblerLog(@"Finalize Audioscrobbler session");
-    [NSObject cancelPreviousPerformRequestsWithTarget:self];
-    self.currentState = WOAudioscrobblerIdle;
+    if (!libraryImportFinished)
+        return;
+    [self.journal synchronize];
+    [WOAudioscrobblerLibraryImporter recordSessionEndDate:[NSDate date]
+                                                   atPath:[WOAudioscrobblerLibraryImporter defaultWatermarkPath]];
 }
 
 #pragma mark -
-#pragma mark Low-level utility methods
+#pragma mark Mirroring
 
-- (void)willTerminate:(NSNotification *)aNotification
+- (void)addMirrorWithHandshakeURLBase:(NSString *)aBase
 {
-    [self finalizeSession];
+    NSParameterAssert(aBase != nil);
+    if (!self.playLog)
+        [self attachPlayLog:[[WOAudioscrobblerPlayLog alloc] init]];
+    WOAudioscrobblerLog(@"Adding mirror endpoint %@", aBase);
+    WOAudioscrobbler *mirror = [[WOAudioscrobbler alloc] initWithHandshakeURLBase:aBase playLog:self.playLog];
+    mirror.user = self.user;
+    mirror.password = self.password;
+    mirror.maximumBatchSize = self.maximumBatchSize;
+    [mirrors addObject:mirror];
 }
 
-- (BOOL)startConnectionWithURL:(NSURL *)aURL body:(NSData *)aData isPost:(BOOL)post
-{
-    WOAudioscrobblerLog(@"Starting connection attempt");
-    if (self.connection)
-        WOAudioscrobblerLog(@"warning: existing connection still active");
-    NSParameterAssert(aURL != nil);
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:aURL
-                                                           cachePolicy:NSURLRequestReloadIgnoringCacheData
-                                                       timeoutInterval:WO_DEFAULT_URL_REQUEST_TIMEOUT];
-    [request setValue:[self userAgent] forHTTPHeaderField:WO_USER_AGENT];
-
-    if (aData)
-        [request setHTTPBody:aData];
-
-    if (post)
-        // "Submissions MUST be sent using an HTTP POST request to the URL obtained from the HANDSHAKE process."
-        [request setHTTPMethod:@"POST"];
-
-    self.receivedData = [NSMutableData data];
-    self.connection = [NSURLConnection connectionWithRequest:request delegate:self]; // deep-copies the request
-    if (!self.connection)
-        NSLog(@"NSURLConnection failed for URL %@", aURL);
-    return self.connection ? YES : NO;
-}
+// session control and credentials are passed on to the mirrors; each then proceeds at its own pace
 
-- (NSString *)escapedString:(NSString *)aString;
+- (void)setUser:(NSString *)aUser
 {
-    // "UTF-8 encoding is used first, then URL encoding"
-    if (!aString) return nil;
-
-    // also escape legal-but-reserved characters as defined in RFC 2396: <http://www.ietf.org/rfc/rfc2396.txt>
-    return NSMakeCollectable(CFURLCreateStringByAddingPercentEscapes
-        (NULL, (CFStringRef)aString, NULL, CFSTR(";/?:@&=+$,"), kCFStringEncodingUTF8));
+    [super setUser:aUser];
+    for (WOAudioscrobbler *mirror in mirrors)
+        mirror.user = aUser;
 }
 
-- (NSString *)dateString
+- (void)setPassword:(NSString *)aPassword
 {
-    // "The date format uses the ISO 8601 format except that the time zone specifier MUST NOT be used, the date/time separator MUST be a single space, and all values MUST be expressed with UTC times. For example, a time of 7AM, Pacific Standard Time (UTC + 8) would normally be expressed in ISO 8601 as 2006-02-12T07:00:00+0800. For submission it would be expressed as 2006-02-11 23:00:00."
-    return [[NSDate date] descriptionWithCalendarFormat:@"%Y-%m-%d %H:%M:%S"
-                                               timeZone:[NSTimeZone timeZoneWithAbbreviation:@"UTC"]
-                                                 locale:nil];
+    [super setPassword:aPassword];
+    for (WOAudioscrobbler *mirror in mirrors)
+        mirror.password = aPassword;
 }
 
-- (NSURL *)handshakeURL
+- (void)startSession
 {
-    // http://post.audioscrobbler.com/?hs=true&p=1.1&c=osx&v=&u=
-    //  hs = true           : "a handshake is requested"
-    //  p = 1.1             : "the Audioscrobbler protocol version"
-    //  c = clientid = osx  : "Applescriptable MacOS X Application (iTunes)"
-    //  v = clientver       : "is the version of the APP plugin"
-    //  u = user            : "the user name"
-
-    NSURL *URL = [NSURL URLWithString:WO_STRING(@"%@?hs=true&p=%@&c=%@&v=%@&u=%@", WO_HANDSHAKE_URL_BASE, WO_PROTOCOL_VERSION,
-                                          WO_ASSIGNED_PLUGIN_ID, WO_ASSIGNED_PLUGIN_VERSION, [self escapedString:[self user]])];
-
-    WOAudioscrobblerLog(@"Handshake URL is %@", URL);
-    return URL;
+    [super startSession];
+    for (WOAudioscrobbler *mirror in mirrors)
+        [mirror startSession];
 }
 
-- (void)requestHandshake
+- (void)refreshSession
 {
-    // don't even bother trying unless both username and password are non-blank
-    if ((self.user && ![self.user isEqualToString:@""]) &&
-        (self.password && ![self.password isEqualToString:@""]))
-    {
-        WOAudioscrobblerLog(@"Will request handshake");
-        NSURL *URL = [self handshakeURL];
-        if ([self startConnectionWithURL:URL body:nil isPost:NO])
-        {
-            WOAudioscrobblerLog(@"Waiting for handshake reply");
-            self.currentState = WOAudioscrobblerWaitingForHandshake;
-        }
-        else
-        {
-            WOAudioscrobblerLog(@"Failed before handshake reply received");
-            self.currentState = WOAudioscrobblerHandshakeFailed;
-        }
-    }
-    else
-    {
-        WOAudioscrobblerLog(@"Not proceeding with handshake (neither the username nor the password may be blank)");
-        self.currentState = WOAudioscrobblerNoAuth;
-    }
+    [super refreshSession];
+    for (WOAudioscrobbler *mirror in mirrors)
+        [mirror refreshSession];
 }
 
-- (void)processHandshake:(NSArray *)lines;
+- (void)finalizeSession
 {
-    WOAudioscrobblerLog(@"Processing handshake reply");
-    NSParameterAssert(lines != nil);
-    unsigned count = [lines count];
-    NSParameterAssert(count >= 1);
-    NSString *firstLine = [lines objectAtIndex:0];
-    if ([firstLine hasPrefix:WO_UP_TO_DATE])
-    {
-        WOAudioscrobblerLog(@"Received UPTODATE message");
-        // UPTODATE ("your version is up to date")
-        // <md5 challenge>
-        // <url to submit script>
-        // INTERVAL n ("the number of seconds you must wait between sending updates", 0 or more)
-
-        if (count < 3)
-        {
-            NSLog(@"Handshake response too short:\n%@", lines);
-            self.currentState = WOAudioscrobblerHandshakeFailed;
-            return;
-        }
-
-        self.challenge      = [lines objectAtIndex:1];
-        self.submissionURL  = [NSURL URLWithString:[lines objectAtIndex:2]];
-        self.currentState   = WOAudioscrobblerHandshakeSucceeded;
-        badauthRetries = 0; // reset
-    }
-    else if ([firstLine hasPrefix:WO_UPDATE])
-    {
-        WOAudioscrobblerLog(@"Received UPDATE message");
-        // UPDATE <updateurl> ("If you are using an outdated version of a plugin, you will see something like this, indicating an update is available")
-        // <md5 challenge>
-        // <url to submit script>
-        // INTERVAL n (as above)
-
-        if ([firstLine length] > [WO_UPDATE length])
-        {
-            NSString *updateURL = [firstLine substringFromIndex:[WO_UPDATE length]];
-            NSLog(@"last.fm reports new version available from %@", updateURL);
-        }
-
-        if (count < 3)
-        {
-            NSLog(@"Handshake response too short:\n%@", lines);
-            self.currentState = WOAudioscrobblerHandshakeFailed;
-            return;
-        }
-
-        self.challenge      = [lines objectAtIndex:1];
-        self.submissionURL  = [NSURL URLWithString:[lines objectAtIndex:2]];
-        self.currentState   = WOAudioscrobblerHandshakeSucceeded;
-        badauthRetries = 0; // reset
-    }
-    else if ([firstLine hasPrefix:WO_FAILED])
-    {
-        WOAudioscrobblerLog(@"Received FAILED message");
-        // "If the request fails, you will get:"
-        // FAILED <reason>
-        // INTERVAL n
-
-        if ([firstLine length] > [WO_FAILED length])
-        {
-            NSString *failureReason = [firstLine substringFromIndex:[WO_FAILED length]];
-            NSLog(@"last.fm handshake failed; reported reason: \"%@\"", failureReason);
-        }
-        else
-            NSLog(@"last.fm handshake failed");
+    [super finalizeSession];
+    for (WOAudioscrobbler *mirror in mirrors)
+        [mirror finalizeSession];
+}
 
-        self.currentState = WOAudioscrobblerHandshakeFailed;
-    }
-    else if ([firstLine hasPrefix:WO_BADUSER])
-    {
-        WOAudioscrobblerLog(@"Received BADUSER message");
-        // "If the user is invalid:"
-        // BADUSER
-        // INTERVAL n
+#pragma mark -
+#pragma mark Library import
 
-        NSLog(@"last.fm handshake failed; returned result: %@", firstLine);
-        self.currentState = WOAudioscrobblerBadUser;
-    }
-    else
+- (void)importLibraryPlays:(BOOL)submit
+{
+    if (self.libraryImporter)
+        return; // already running
+    NSString *libraryPath   = [WOAudioscrobblerLibraryImporter defaultLibraryPath];
+    NSString *watermarkPath = [WOAudioscrobblerLibraryImporter defaultWatermarkPath];
+    if (!libraryPath || !watermarkPath)
     {
-        NSLog(@"Unrecognized handshake response:\n%@", lines);
-        self.currentState = WOAudioscrobblerHandshakeFailed;
+        WOAudioscrobblerLog(@"No iTunes library or watermark location available; not importing plays");
+        return;
     }
+    WOAudioscrobblerLog(@"Will import plays from iTunes library at %@", libraryPath);
+    self.libraryImporter = [[WOAudioscrobblerLibraryImporter alloc] initWithLibraryPath:libraryPath
+                                                                          watermarkPath:watermarkPath];
+    [NSThread detachNewThreadSelector:@selector(libraryImportThread:)
+                             toTarget:self
+                           withObject:[NSNumber numberWithBool:submit]];
 }
 
-- (NSString *)challengeResponse
+- (void)libraryImportThread:(NSNumber *)submit
 {
-    // "The MD5 response is md5(md5(your_password) + challenge), where MD5 is the ascii-encoded, lowercase MD5 representation, and + represents concatenation. MD5 strings must be converted to their hex value before concatenation with the challenge string and before submission to the final MD5 response."
-
-    // "The ascii-encoded, lowercase MD5 representation MUST be used, and MD5 strings MUST be converted to their hex value before concatenation with the challenge string and before submission to the final MD5 response. "
-
-    // calculate password hash
-    NSData *passwordData = [self.password dataUsingEncoding:NSUTF8StringEncoding];
-    unsigned char *digest = MD5([passwordData bytes], [passwordData length], NULL);
-    NSMutableString *string = [NSMutableString string];
-    for (int i = 0; i < MD5_DIGEST_LENGTH; i++)
-        [string appendFormat:@"%02x", *digest++];
-
-    // append challenge (salt)
-    [string appendString:self.challenge];
-
-    // calculate and return digest of whole
-    NSData *response = [string dataUsingEncoding:NSUTF8StringEncoding];
-    digest = MD5([response bytes], [response length], NULL);
-    [string setString:@""];
-    for (int i = 0; i < MD5_DIGEST_LENGTH; i++)
-        [string appendFormat:@"%02x", *digest++];
-    return string;
-}
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    NSArray *plays = [self.libraryImporter scanGeneratingPlays:[submit boolValue] untilDate:[NSDate date]];
 
-- (void)next
-{
-    unsigned delay = self.lastKnownInterval;
-    WOAudioscrobblerLog(@"Will handle next item on the queue after delay (Audioscrobbler specified delay in seconds: %d)", delay);
-
-    // handle the next item on the queue
-    [self performSelector:@selector(nextOperation:) withObject:nil afterDelay:delay];
+    // the engine is not threadsafe, so hand the plays over to the main thread
+    [self performSelectorOnMainThread:@selector(libraryImportDidFinish:) withObject:plays waitUntilDone:NO];
+    [pool drain];
 }
 
-// called when the Audioscrobbler-specified delay interval has passed and the next operation can be performed
-- (void)nextOperation:(id)ignored
+// plays is nil if the library could not be read
+- (void)libraryImportDidFinish:(NSArray *)plays
 {
-    if ([self queueIsEmpty])
-    {
-        WOAudioscrobblerLog(@"Queue is empty, not proceeding");
-        return;
-    }
-
-    switch (self.currentState)
+    if (plays)
     {
-        case WOAudioscrobblerIdle:
-        case WOAudioscrobblerHandshakeSucceeded:
-        case WOAudioscrobblerWaitingToRetrySubmission:
-        case WOAudioscrobblerSubmissionSucceeded:
-            WOAudioscrobblerLog(@"Will proceed with submission");
-            [self doSubmission:[self firstObjectInQueue]];
-            break;
-        case WOAudioscrobblerSubmissionFailed:
-            // "A Handshake should occur just once during a SESSION, e.g. when the APP first loads, or after the APP detects 3 catastrophic (i.e. DNS resolution or connection refused) failures in submitting. In this case, the APP should not handshake more than once every 30 minutes. If the APP fails to connect to the handshake URL, the user should be informed."
-            WOAudioscrobblerLog(@"Submission previously failed, will retry");
-            [self doSubmission:[self firstObjectInQueue]];
-            break;
-        case WOAudioscrobblerHandshakeFailed:
-            WOAudioscrobblerLog(@"Handshake previously failed, will retry");
-            [self requestHandshake];
-            break;
-        case WOAudioscrobblerNoAuth:
-            WOAudioscrobblerLog(@"Missing username or password; cannot proceed");
-            break;
-        case WOAudioscrobblerBadAuth:
-            // "If it returns BADAUTH, you may need to re-handshake (you're likely to get temporarily blocked if you're attempting to resubmit at one-second intervals after getting repeated BADAUTH errors)."
-            if (badauthRetries < 3) // the limit of 3 is not specified in the protocol but it seems like a nice number
-            {
-                WOAudioscrobblerLog(@"Previously received a bad auth error; will try again to handshake");
-                badauthRetries++;   // will reset to 0 if handshake is successful
-                [self requestHandshake];
-            }
-            else
-                WOAudioscrobblerLog(@"Previously received 3 bad auth errors; cannot proceed");
-            break;
-        case WOAudioscrobblerBadUser:
-            WOAudioscrobblerLog(@"Previously received a bad user error; cannot proceed");
-            // non-recoverable errors
-            break;
-        case WOAudioscrobblerWaitingForHandshake:
-            // should never get here, right? this is a programmer error
-            WOAudioscrobblerLog(@"Error: did not expect WOAudioscrobblerWaitingForHandshake status; please report");
-            break;
-        case WOAudioscrobblerWaitingForSubmissionResponse:
-            // should never get here, right? this is a programmer error
-            WOAudioscrobblerLog(@"Error: did not expect WOAudioscrobblerWaitingForSubmissionResponse status; please report");
-            break;
-        default:
-            // programmer error again
-            WOAudioscrobblerLog(@"Error: did not expect status %d; please report", [self currentState]);
-            break;
+        WOAudioscrobblerLog(@"Recovered %d plays from iTunes library", [plays count]);
+        for (NSDictionary *play in plays)
+            [self submitSong:[play objectForKey:WO_TRACK_KEY]
+                      artist:[play objectForKey:WO_ARTIST_KEY]
+                       album:[play objectForKey:WO_ALBUM_KEY]
+                      length:[[play objectForKey:WO_LENGTH_KEY] unsignedIntValue]
+                        date:[play objectForKey:WO_PLAY_DATE_KEY]];
+
+        // the plays must be safely journaled before the watermark moves past them
+        [self.journal synchronize];
+        libraryImportFinished = [self.libraryImporter commit];
+
+        // the commit stamps the time the scan started; anything played since then was scrobbled live
+        [self recordSessionEndDate];
     }
+    self.libraryImporter = nil;
 }
 
 #pragma mark -
-#pragma mark Queue helper methods
+#pragma mark WOAudioscrobblerTransport
 
-- (BOOL)queueIsEmpty
+- (BOOL)startRequestWithURL:(NSURL *)aURL body:(NSData *)aData isPost:(BOOL)post forEngine:(WOAudioscrobblerEngine *)anEngine
 {
-    return (self.queue.count == 0) ? YES : NO;
-}
+    if (self.request)
+        WOAudioscrobblerLog(@"warning: existing request still active");
+    NSParameterAssert(aURL != nil);
+    WOHTTPRequest *newRequest = [WOHTTPRequest requestWithURL:aURL];
+    [newRequest setTimeoutInterval:WO_DEFAULT_URL_REQUEST_TIMEOUT];
+    [newRequest setValue:[self userAgent] forHTTPHeaderField:WO_USER_AGENT];
 
-- (void)enqueue:(id)object
-{
-    WOAudioscrobblerLog(@"Enqueuing object: %@", object);
-    NSParameterAssert(object != nil);
-    BOOL empty = [self queueIsEmpty];
-    [self.queue addObject:object];
-    WOAudioscrobblerLog(@"Number of items currently on the queue: %d", self.queue.count);
-
-    // special case handling for items added to empty queues: process immediately
-    if (empty)
-    {
-        WOAudioscrobblerLog(@"Queue was empty: processing item");
-        [self next];
-    }
-    else
+    if (aData)
     {
-        // some states are also worth submitting
-        switch (self.currentState)
-        {
-            case WOAudioscrobblerIdle:
-            case WOAudioscrobblerHandshakeSucceeded:
-            case WOAudioscrobblerSubmissionSucceeded:
-            case WOAudioscrobblerWaitingToRetrySubmission:
-                WOAudioscrobblerLog(@"Queue was non-empty, but ready to submit: processing item");
-                [self next];
-                break;
-            case WOAudioscrobblerSubmissionFailed:
-            case WOAudioscrobblerHandshakeFailed:
-            case WOAudioscrobblerBadAuth:
-                WOAudioscrobblerLog(@"Queue was non-empty, last attempt failed: processing item");
-                [self next];
-                break;
-            case WOAudioscrobblerBadUser:
-            case WOAudioscrobblerWaitingForHandshake:
-            case WOAudioscrobblerWaitingForSubmissionResponse:
-            case WOAudioscrobblerNoAuth:
-            default:
-                WOAudioscrobblerLog(@"Queue was non-empty, but not ready to submit: not processing item");
-                break;
-        }
+        // deep copy because the engine reuses the memory behind aData for the next submission
+        [newRequest setHTTPBody:[NSData dataWithBytes:[aData bytes] length:[aData length]]];
+        [newRequest setValue:@"application/x-www-form-urlencoded" forHTTPHeaderField:@"Content-Type"];
     }
-}
 
-- (void)dequeueFirstObject
-{
-    WOAudioscrobblerLog(@"Dequeueing first object");
-    [self.queue removeObjectAtIndex:0];
+    if (post)
+        // "Submissions MUST be sent using an HTTP POST request to the URL obtained from the HANDSHAKE process."
+        [newRequest setHTTPMethod:@"POST"];
+
+    [newRequest setDelegate:self];
+    self.request = newRequest;
+    [[WOHTTPClient sharedClient] startRequest:newRequest];
+    return YES;
 }
 
-// return first object in the queue without actually dequeuing it; returns nil if queue is empty
-- (NSDictionary *)firstObjectInQueue
+- (void)cancelRequestForEngine:(WOAudioscrobblerEngine *)anEngine
 {
-    return [self queueIsEmpty] ? nil : [self.queue objectAtIndex:0];
+    [self.request cancel];
+    self.request = nil;
 }
 
 #pragma mark -
-#pragma mark High-level methods
+#pragma mark WOAudioscrobblerClock
 
-- (void)doSubmission:(NSDictionary *)songInfo
+- (NSDate *)currentDate
 {
-    NSString *artist    = [songInfo objectForKey:WO_ARTIST_KEY];
-    NSString *track     = [songInfo objectForKey:WO_TRACK_KEY];
-    NSString *album     = [songInfo objectForKey:WO_ALBUM_KEY];
-    NSString *mbid      = [songInfo objectForKey:WO_MBID_KEY];
-    unsigned length     = [[songInfo objectForKey:WO_LENGTH_KEY] unsignedIntValue];
-    NSString *date      = [songInfo objectForKey:WO_DATE_KEY];
-
-    // u=<user>&s=<MD5 response>&a[0]=<artist>&t[0]=<track>&b[0]=<album>&m[0]=<mbid>&l[0]=<length>&i[0]=<time>
-    //  <user>: last.fm username (MUST be the same as the username given in the HANDSHAKE)
-    // <MD5 response>: Demonstrates the HANDSHAKE credentials.
-    // <artist>: The name of the artist
-    // <track>: The name of the track
-    // <album>: The name of the album the track is from
-    // <mbid>: The MusicBrainz? ID of the track
-    // <length>: The length (duration) of the track in whole (integer) seconds
-    // <time>: The date and time the track was played, described in a modified ISO 8601 format.
-
-    // Submissions MUST be sent using an HTTP POST request to the URL obtained from the HANDSHAKE process.
-    // The submission is formatted as if it were an x-www-urlencoded HTML form response, with the body of the HTTP request containing a single line with key-value pairs separated by =, with multiple pairs separated by &.
-    // The submission MUST be correctly double-encoded.
-    // The value of each field is expressed as a UTF-8 encoded string and then URL encoded.
-    // All the characters not part of a value are already valid UTF-8 and MUST NOT be further URL encoded.
-    NSString *string = WO_STRING(@"u=%@&s=%@&a[0]=%@&t[0]=%@&b[0]=%@&m[0]=%@&l[0]=%d&i[0]=%@",
-                                 [self escapedString:[self user]],
-                                 [self escapedString:[self challengeResponse]],
-                                 [self escapedString:artist],
-                                 [self escapedString:track],
-                                 [self escapedString:album],
-                                 [self escapedString:mbid],
-                                 length,
-                                 [self escapedString:date]);
-    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
-
-    if (self.submissionURL)
-        WOAudioscrobblerLog(@"Will perform submission using URL: %@", self.submissionURL);
-    else
-    {
-        WOAudioscrobblerLog(@"Cannot perform submission because do not have a submission URL");
-        self.currentState = WOAudioscrobblerSubmissionFailed;
-        return;
-    }
-
-    WOAudioscrobblerLog(@"Submission as URL-encoded string is: %@", string);
-    WOAudioscrobblerLog(@"Submission as data is: %@", data);
-
-    if ([self startConnectionWithURL:self.submissionURL body:data isPost:YES])
-    {
-        WOAudioscrobblerLog(@"Waiting for submission response");
-        self.currentState = WOAudioscrobblerWaitingForSubmissionResponse;
-    }
-    else
-    {
-        WOAudioscrobblerLog(@"Failed before submission response received");
-        self.currentState = WOAudioscrobblerSubmissionFailed;
-    }
+    return [NSDate date];
 }
 
-- (void)processSubmissionResponse:(NSArray *)lines
+- (void)scheduleSelector:(SEL)aSelector target:(id)aTarget afterDelay:(NSTimeInterval)delay
 {
-    WOAudioscrobblerLog(@"Processing submission response");
-    NSParameterAssert(lines != nil);
-    unsigned count = [lines count];
-    NSParameterAssert(count >= 1);
-    NSString *firstLine = [lines objectAtIndex:0];
-    if ([firstLine hasPrefix:WO_OK])
-    {
-        WOAudioscrobblerLog(@"Received OK response");
-        // OK
-        // INTERVAL n
-        // "If the server returns OK, you should remove the submitted tracks from your plugin's cache. "
-        self.currentState = WOAudioscrobblerSubmissionSucceeded;
-        [self dequeueFirstObject];
-        [self next];
-    }
-    else if ([firstLine hasPrefix:WO_FAILED])
-    {
-        WOAudioscrobblerLog(@"Received FAILED response");
-        // FAILED <reason>
-        // INTERVAL n
-        // "If it returns FAILED <reason>: The space after FAILED followed by an error message is optional."
-        // "This indicates something went wrong, and you should cache the submission and retry later."
-        if ([firstLine length] > [WO_FAILED length])
-        {
-            NSString *failureReason = [firstLine substringFromIndex:[WO_FAILED length]];
-            NSLog(@"last.fm submission failed; reported reason: \"%@\"", failureReason);
-        }
-        else
-            NSLog(@"last.fm submission failed");
-
-        // will retry next time asked to submit a track
-        self.currentState = WOAudioscrobblerWaitingToRetrySubmission;
-    }
-    else if ([firstLine hasPrefix:WO_BADAUTH])
-    {
-        WOAudioscrobblerLog(@"Received BADAUTH response");
-        // BADAUTH
-        // INTERVAL n
-        // "If it returns BADAUTH, you may need to re-handshake"
-        self.currentState = WOAudioscrobblerBadAuth;
+    [aTarget performSelector:aSelector withObject:nil afterDelay:delay];
+}
 
-    }
-    else
-    {
-        NSLog(@"Unrecognized submission response:\n%@", lines);
-        self.currentState = WOAudioscrobblerSubmissionFailed;
-    }
+- (void)cancelScheduledSelectorsForTarget:(id)aTarget
+{
+    [NSObject cancelPreviousPerformRequestsWithTarget:aTarget];
 }
 
 #pragma mark -
-#pragma mark NSURLConnection delegate methods
+#pragma mark WOHTTPRequestDelegate
 
-- (void)connection:(NSURLConnection *)connection didReceiveResponse:(NSURLResponse *)response
+- (void)HTTPRequest:(WOHTTPRequest *)aRequest didReceiveResponseWithStatus:(NSInteger)status
 {
-    // was a bug; see: <http://wincent.com/a/support/bugs/show_bug.cgi?id=641>
-    //  *** -[NSConcreteData setLength:]: unrecognized selector sent to instance 0x1065590
-    [self.receivedData setLength:0];
+    [self transportDidReceiveResponse];
 }
 
-- (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data
+- (void)HTTPRequest:(WOHTTPRequest *)aRequest didReceiveData:(NSData *)data
 {
-    [self.receivedData appendData:data];
+    [self transportDidReceiveData:data];
 }
 
-- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error
+- (void)HTTPRequest:(WOHTTPRequest *)aRequest didFailWithError:(NSError *)error
 {
-    // clean up (this is the last message sent by the connection)
-    self.connection = nil;
-    self.receivedData = nil;
-    NSLog(@"NSURLConnection for URL %@ returned error: %@", [[error userInfo] objectForKey:NSURLErrorFailingURLStringErrorKey],
-          [error localizedDescription]);
-    switch (self.currentState)
-    {
-        case (WOAudioscrobblerWaitingForHandshake):
-            self.currentState = WOAudioscrobblerHandshakeFailed;
-            break;
-        case (WOAudioscrobblerWaitingForSubmissionResponse):
-            self.currentState = WOAudioscrobblerSubmissionFailed;
-            break;
-        default:
-            break;
-    }
+    // clean up (this is the last message sent for the request)
+    self.request = nil;
+    [self transportDidFailWithError:error];
 }
 
--(void)connectionDidFinishLoading:(NSURLConnection *)connection
+- (void)HTTPRequestDidFinishLoading:(WOHTTPRequest *)aRequest
 {
-    // clean up (this is the last message sent by the connection)
-    WOAudioscrobblerLog(@"Connection to Audioscrobbler did finish loading (response received)");
-    self.connection = nil;
-    NSString *string = [[NSString alloc] initWithData:self.receivedData encoding:NSUTF8StringEncoding];
-    if (!string)
-    {
-        NSLog(@"warning: last.fm returned empty string");
-        switch (self.currentState)
-        {
-            case (WOAudioscrobblerWaitingForHandshake):
-                self.currentState = WOAudioscrobblerHandshakeFailed;
-                break;
-            case (WOAudioscrobblerWaitingForSubmissionResponse):
-                self.currentState = WOAudioscrobblerSubmissionFailed;
-                break;
-            default:
-                break;
-        }
-        return; // no point in continuing
-    }
-
-    // split into lines and remove blank lines
-    NSMutableArray *lines = [NSMutableArray array];
-    NSEnumerator *enumerator = [[string componentsSeparatedByString:@"\n"] objectEnumerator];
-    NSString *line;
-    while ((line = [enumerator nextObject]))
-    {
-        if (![line isEqualToString:@""])
-            [lines addObject:line];
-    }
-    if ([lines count] == 0)
-    {
-        WOAudioscrobblerLog(@"Response contained no non-blank lines; not proceeding");
-        return; // no point in continuing
-    }
-
-    // "INTERVAL commands can be at the end of any response block, but don't expect them to be. Always observe the latest INTERVAL you get."
-    NSString *lastLine = [lines lastObject];
-    if ([lastLine hasPrefix:WO_INTERVAL])
-    {
-        WOAudioscrobblerLog(@"Received an INTERVAL directive");
-        NSScanner *scanner = [NSScanner scannerWithString:lastLine];
-        [scanner scanString:WO_INTERVAL intoString:NULL];
-        int interval;
-        if ([scanner scanInt:&interval] && (interval > 0))
-        {
-            WOAudioscrobblerLog(@"Storing interval value: %d", interval);
-            self.lastKnownInterval = (unsigned)interval;
-        }
-        else
-            NSLog(@"Invalid interval specification received from last.fm: %@", lastLine);
-    }
-
-    // now handle the rest of the response
-    switch (self.currentState)
-    {
-        case WOAudioscrobblerWaitingForHandshake:
-            [self processHandshake:lines];
-            break;
-        case WOAudioscrobblerWaitingForSubmissionResponse:
-            [self processSubmissionResponse:lines];
-            break;
-        default:
-            break;
-    }
+    // clean up (this is the last message sent for the request)
+    self.request = nil;
+    [self transportDidFinishLoading];
 }
 
 #pragma mark -
 #pragma mark Properties
 
-@synthesize protocolVersion;
-@synthesize currentState;
-@synthesize queue;
-@synthesize lastKnownInterval;
-@synthesize connection;
-
-// cannot synthesize this setter because it would send a copy rather than a mutableCopy message
-- (void)setReceivedData:(NSMutableData *)aReceivedData
-{
-    if (aReceivedData != receivedData)
-        receivedData = [aReceivedData mutableCopy];
-}
-
-@synthesize receivedData;
-@synthesize submissionURL;
-@synthesize challenge;
-@synthesize userAgent;
-@synthesize user;
-@synthesize password;
+@synthesize request;
+@synthesize libraryImporter;
 
 @end
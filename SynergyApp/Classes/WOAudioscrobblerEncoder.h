@@ -0,0 +1,49 @@
+//
+//  WOAudioscrobblerEncoder.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+//! Length of a lowercase hexadecimal MD5 digest, excluding the terminating NUL
+#define WO_MD5_HEX_LENGTH   32
+
+//! Builds Audioscrobbler submission bodies.
+//!
+//! The MD5 challenge response is computed once per session (when the password or challenge changes) rather than once per
+//! submission, and every field is percent-encoded straight from its UTF-8 bytes into a single output buffer that is reused
+//! from one submission to the next, so steady-state encoding allocates nothing.
+//!
+//! \warn Not threadsafe; should only be used by the engine that owns it
+@interface WOAudioscrobblerEncoder : NSObject {
+
+    //! Reused for every body; grows to fit the largest submission seen
+    NSMutableData   *buffer;
+
+    //! md5(password) as lowercase hex, NUL-terminated
+    char            passwordHash[WO_MD5_HEX_LENGTH + 1];
+
+    //! md5(md5(password) + challenge) as lowercase hex, NUL-terminated
+    char            challengeResponse[WO_MD5_HEX_LENGTH + 1];
+
+    BOOL            havePassword;
+
+    NSString        *challenge;
+}
+
+- (void)setPassword:(NSString *)aPassword;
+
+//! Recomputes the cached challenge response; called once per successful handshake
+- (void)setChallenge:(NSString *)aChallenge;
+
+//! Returns NO until both a password and a challenge have been supplied
+- (BOOL)hasCredentials;
+
+//! Encodes a submission of the plays in \p batch (queue dictionaries) on behalf of \p user.
+//! \warn The returned object is the encoder's internal buffer; it is only valid until the next call and must be copied if
+//! it is to be kept
+- (NSData *)submissionBodyForUser:(NSString *)user batch:(NSArray *)batch;
+
+@end
@@ -0,0 +1,232 @@
+// WOAudioscrobblerEncoder.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerEncoder.h"
+
+// system headers
+#import <openssl/md5.h>                     /* requires -lcrypto linker flag */
+
+// other headers
+#import "WOAudioscrobblerEngine.h"          /* queue dictionary keys */
+
+//! Initial size of the output buffer; comfortably holds a full ten-track batch of typical metadata
+#define WO_ENCODER_INITIAL_CAPACITY     4096
+
+//! Strings without a direct UTF-8 pointer are transcoded through a stack buffer of this size
+#define WO_ENCODER_CHUNK_SIZE           256
+
+//! Non-zero for bytes that may appear unescaped: the RFC 2396 "unreserved" set (alphanumerics and -_.!~*'()). Everything
+//! else, including the reserved characters ;/?:@&=+$, and all non-ASCII UTF-8 bytes, is percent-encoded.
+static uint8_t WOEncoderUnreserved[256];
+
+static const char WOUppercaseHexDigits[] = "0123456789ABCDEF";
+static const char WOLowercaseHexDigits[] = "0123456789abcdef";
+
+typedef struct WOEncoderCursor {
+    NSMutableData   *buffer;
+    uint8_t         *bytes;
+    NSUInteger      used;
+    NSUInteger      capacity;
+} WOEncoderCursor;
+
+static void WOEncoderMD5Hex(const void *bytes, size_t length, char *hex)
+{
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    MD5(bytes, length, digest);
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++)
+    {
+        hex[2 * i]      = WOLowercaseHexDigits[digest[i] >> 4];
+        hex[2 * i + 1]  = WOLowercaseHexDigits[digest[i] & 0x0f];
+    }
+    hex[WO_MD5_HEX_LENGTH] = '\0';
+}
+
+static inline void WOEncoderReserve(WOEncoderCursor *cursor, NSUInteger extra)
+{
+    if (cursor->used + extra <= cursor->capacity)
+        return;
+    NSUInteger capacity = MAX(cursor->capacity * 2, cursor->used + extra);
+    [cursor->buffer setLength:capacity];
+    cursor->bytes = [cursor->buffer mutableBytes];
+    cursor->capacity = capacity;
+}
+
+static inline void WOEncoderAppendLiteral(WOEncoderCursor *cursor, const char *literal, size_t length)
+{
+    WOEncoderReserve(cursor, length);
+    memcpy(cursor->bytes + cursor->used, literal, length);
+    cursor->used += length;
+}
+
+static void WOEncoderAppendEscapedBytes(WOEncoderCursor *cursor, const uint8_t *bytes, size_t length)
+{
+    // worst case every byte becomes %XX
+    WOEncoderReserve(cursor, length * 3);
+    uint8_t *out = cursor->bytes + cursor->used;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint8_t byte = bytes[i];
+        if (WOEncoderUnreserved[byte])
+            *out++ = byte;
+        else
+        {
+            *out++ = '%';
+            *out++ = WOUppercaseHexDigits[byte >> 4];
+            *out++ = WOUppercaseHexDigits[byte & 0x0f];
+        }
+    }
+    cursor->used = out - cursor->bytes;
+}
+
+// "UTF-8 encoding is used first, then URL encoding"
+static void WOEncoderAppendEscapedString(WOEncoderCursor *cursor, NSString *string)
+{
+    if (!string)
+        return;
+
+    // fast path: many strings can hand out their UTF-8 bytes directly
+    const char *direct = CFStringGetCStringPtr((CFStringRef)string, kCFStringEncodingUTF8);
+    if (direct)
+    {
+        WOEncoderAppendEscapedBytes(cursor, (const uint8_t *)direct, strlen(direct));
+        return;
+    }
+
+    uint8_t chunk[WO_ENCODER_CHUNK_SIZE];
+    NSRange remaining = NSMakeRange(0, [string length]);
+    while (remaining.length > 0)
+    {
+        NSUInteger used = 0;
+        if (![string getBytes:chunk
+                    maxLength:sizeof(chunk)
+                   usedLength:&used
+                     encoding:NSUTF8StringEncoding
+                      options:0
+                        range:remaining
+               remainingRange:&remaining] || used == 0)
+            break;  // unencodable input (for example, an unpaired surrogate): drop the remainder
+        WOEncoderAppendEscapedBytes(cursor, chunk, used);
+    }
+}
+
+static void WOEncoderAppendUnsigned(WOEncoderCursor *cursor, unsigned value)
+{
+    char digits[10];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    WOEncoderReserve(cursor, count);
+    while (count)
+        cursor->bytes[cursor->used++] = (uint8_t)digits[--count];
+}
+
+// appends "&<letter>[<index>]="
+static inline void WOEncoderAppendFieldName(WOEncoderCursor *cursor, char letter, unsigned index)
+{
+    char prefix[3] = { '&', letter, '[' };
+    WOEncoderAppendLiteral(cursor, prefix, sizeof(prefix));
+    WOEncoderAppendUnsigned(cursor, index);
+    WOEncoderAppendLiteral(cursor, "]=", 2);
+}
+
+@implementation WOAudioscrobblerEncoder
+
+#pragma mark -
+#pragma mark NSObject overrides
+
++ (void)initialize
+{
+    const char *unreserved = "-_.!~*'()";
+    for (int c = 0; c < 256; c++)
+        WOEncoderUnreserved[c] = ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) ? 1 : 0;
+    while (*unreserved)
+        WOEncoderUnreserved[(uint8_t)*unreserved++] = 1;
+}
+
+- (id)init
+{
+    if ((self = [super init]))
+        self->buffer = [NSMutableData dataWithLength:WO_ENCODER_INITIAL_CAPACITY];
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)updateChallengeResponse
+{
+    // "The MD5 response is md5(md5(your_password) + challenge), where MD5 is the ascii-encoded, lowercase MD5 representation, and + represents concatenation. MD5 strings must be converted to their hex value before concatenation with the challenge string and before submission to the final MD5 response."
+    challengeResponse[0] = '\0';
+    if (!havePassword || !challenge)
+        return;
+    const char *salt = [challenge UTF8String];
+    size_t saltLength = strlen(salt);
+    char *plaintext = malloc(WO_MD5_HEX_LENGTH + saltLength);
+    if (!plaintext)
+        return;
+    memcpy(plaintext, passwordHash, WO_MD5_HEX_LENGTH);
+    memcpy(plaintext + WO_MD5_HEX_LENGTH, salt, saltLength);
+    WOEncoderMD5Hex(plaintext, WO_MD5_HEX_LENGTH + saltLength, challengeResponse);
+    free(plaintext);
+}
+
+- (void)setPassword:(NSString *)aPassword
+{
+    havePassword = aPassword ? YES : NO;
+    if (havePassword)
+    {
+        const char *bytes = [aPassword UTF8String];
+        WOEncoderMD5Hex(bytes, strlen(bytes), passwordHash);
+    }
+    [self updateChallengeResponse];
+}
+
+- (void)setChallenge:(NSString *)aChallenge
+{
+    challenge = [aChallenge copy];
+    [self updateChallengeResponse];
+}
+
+- (BOOL)hasCredentials
+{
+    return challengeResponse[0] ? YES : NO;
+}
+
+- (NSData *)submissionBodyForUser:(NSString *)user batch:(NSArray *)batch
+{
+    WOEncoderCursor cursor = { buffer, [buffer mutableBytes], 0, [buffer length] };
+
+    // u=<user>&s=<MD5 response>&a[0]=<artist>&t[0]=<track>&b[0]=<album>&m[0]=<mbid>&l[0]=<length>&i[0]=<time>
+    // All the characters not part of a value are already valid UTF-8 and MUST NOT be further URL encoded.
+    WOEncoderAppendLiteral(&cursor, "u=", 2);
+    WOEncoderAppendEscapedString(&cursor, user);
+    WOEncoderAppendLiteral(&cursor, "&s=", 3);
+    WOEncoderAppendLiteral(&cursor, challengeResponse, strlen(challengeResponse));  // lowercase hex never needs escaping
+
+    unsigned index = 0;
+    for (NSDictionary *play in batch)
+    {
+        WOEncoderAppendFieldName(&cursor, 'a', index);
+        WOEncoderAppendEscapedString(&cursor, [play objectForKey:WO_ARTIST_KEY]);
+        WOEncoderAppendFieldName(&cursor, 't', index);
+        WOEncoderAppendEscapedString(&cursor, [play objectForKey:WO_TRACK_KEY]);
+        WOEncoderAppendFieldName(&cursor, 'b', index);
+        WOEncoderAppendEscapedString(&cursor, [play objectForKey:WO_ALBUM_KEY]);
+        WOEncoderAppendFieldName(&cursor, 'm', index);
+        WOEncoderAppendEscapedString(&cursor, [play objectForKey:WO_MBID_KEY]);
+        WOEncoderAppendFieldName(&cursor, 'l', index);
+        WOEncoderAppendUnsigned(&cursor, [[play objectForKey:WO_LENGTH_KEY] unsignedIntValue]);
+        WOEncoderAppendFieldName(&cursor, 'i', index);
+        WOEncoderAppendEscapedString(&cursor, [play objectForKey:WO_DATE_KEY]);
+        index++;
+    }
+    return [NSData dataWithBytesNoCopy:cursor.bytes length:cursor.used freeWhenDone:NO];
+}
+
+@end
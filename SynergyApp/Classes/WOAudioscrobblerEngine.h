@@ -0,0 +1,213 @@
+//
+//  WOAudioscrobblerEngine.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 31 October 2006.
+//  Copyright 2006-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class WOAudioscrobblerEngine, WOAudioscrobblerEncoder, WOAudioscrobblerJournal, WOAudioscrobblerPlayLog,
+       WOAudioscrobblerResponseParser, WOAudioscrobblerScheduler;
+
+//! \name Queue item keys
+//! Dictionary keys for items in the submission queue
+//! \startgroup
+
+#define WO_TRACK_KEY    @"WOTrack"
+#define WO_ARTIST_KEY   @"WOArtist"
+#define WO_ALBUM_KEY    @"WOAlbum"
+#define WO_MBID_KEY     @"WOMBID"
+#define WO_LENGTH_KEY   @"WOLength"
+#define WO_DATE_KEY     @"WODate"
+#define WO_SEQUENCE_KEY @"WOSequence"   //!< Assigned by WOAudioscrobblerJournal
+
+//! \endgroup
+
+typedef enum {
+
+    WOAudioscrobblerIdle,
+    WOAudioscrobblerWaitingForHandshake,
+    WOAudioscrobblerHandshakeFailed,
+    WOAudioscrobblerHandshakeSucceeded,
+    WOAudioscrobblerBadUser,
+    WOAudioscrobblerWaitingForSubmissionResponse,
+    WOAudioscrobblerSubmissionFailed,
+    WOAudioscrobblerSubmissionSucceeded,
+    WOAudioscrobblerWaitingToRetrySubmission,
+    WOAudioscrobblerBadAuth,
+    WOAudioscrobblerNoAuth                          //!< State when username and/or password is not set
+
+} WOAudioscrobblerState;
+
+//! Carries handshake and submission requests for a WOAudioscrobblerEngine.
+//!
+//! After a successful start the transport must report back with zero or more transportDidReceiveResponse and
+//! transportDidReceiveData: messages followed by exactly one transportDidFinishLoading or transportDidFailWithError:.
+//! At most one request is outstanding per engine.
+@protocol WOAudioscrobblerTransport
+
+//! Returns NO if the request could not be started (no callbacks will follow).
+//! \p aData may be backed by a reused buffer: a transport that needs the bytes after returning must copy them.
+- (BOOL)startRequestWithURL:(NSURL *)aURL body:(NSData *)aData isPost:(BOOL)post forEngine:(WOAudioscrobblerEngine *)anEngine;
+
+//! Cancels the outstanding request, if any; no further callbacks may be sent for it
+- (void)cancelRequestForEngine:(WOAudioscrobblerEngine *)anEngine;
+
+@end
+
+//! Supplies the time and deferred execution for a WOAudioscrobblerEngine, so that it can be driven by the run loop or by a
+//! simulated clock.
+@protocol WOAudioscrobblerClock
+
+- (NSDate *)currentDate;
+
+//! Sends \p aSelector (with a nil argument) to \p aTarget once \p delay seconds have elapsed
+- (void)scheduleSelector:(SEL)aSelector target:(id)aTarget afterDelay:(NSTimeInterval)delay;
+
+- (void)cancelScheduledSelectorsForTarget:(id)aTarget;
+
+@end
+
+//! The Audioscrobbler 1.1 handshake/submission state machine, independent of any particular networking API or run loop.
+//!
+//! \sa     http://www.audioscrobbler.net/wiki/Protocol1.0_1.1
+//! \warn   Not threadsafe; should only be called from a single thread (most likely the main thread)
+@interface WOAudioscrobblerEngine : NSObject {
+
+    id <WOAudioscrobblerTransport>  transport;
+
+    id <WOAudioscrobblerClock>      clock;
+
+    //! All deferred work (submissions, retries and re-handshakes) is queued here; created whenever the clock is set
+    WOAudioscrobblerScheduler       *scheduler;
+
+    NSString                *protocolVersion;
+
+    //! Handshake requests are sent here; defaults to the last.fm submission server. Also identifies this endpoint's cursor
+    //! in the play log, so it must be set before a log is attached.
+    NSString                *handshakeURLBase;
+
+    WOAudioscrobblerState   currentState;
+
+    //! FIFO (first-in, first-out submissions queue), possibly shared with engines for other endpoints
+    WOAudioscrobblerPlayLog *playLog;
+
+    //! Sequence number of the last play accepted by this endpoint; everything after it in the play log is still to be sent
+    unsigned long long      cursor;
+
+    //! Keep count of submission failures.
+    unsigned                submissionFailures;
+
+    //! Keep count of handshake failures.
+    unsigned                handshakeFailures;
+
+    //! Consecutive requests that got no response at all (DNS resolution, connection refused and so on)
+    unsigned                catastrophicFailures;
+
+    //! Keep count of "BADAUTH" retries.
+    unsigned                badauthRetries;
+
+    //! When the last handshake was attempted; used to enforce the 30-minute floor between handshakes after repeated failures
+    NSDate                  *lastHandshakeDate;
+
+    //! xorshift state used to jitter retry delays
+    uint32_t                jitterState;
+
+    //! Maximum number of queued tracks packed into a single submission (1 disables batching)
+    unsigned                maximumBatchSize;
+
+    //! Number of tracks (taken from the head of the queue) in the submission currently in flight
+    unsigned                pendingBatchCount;
+
+    //! "INTERVAL commands can be at the end of any response block, but don't expect them to be. Always observe the latest INTERVAL you get."
+    unsigned                lastKnownInterval;
+
+    //! YES while a request is outstanding
+    BOOL                    awaitingResponse;
+
+    //! Tokenizes each reply as it arrives; reused from one request to the next
+    WOAudioscrobblerResponseParser  *responseParser;
+
+    //! Passed in from last.fm during handshake
+    NSURL                   *submissionURL;
+
+    //! Passed in from last.fm during handshake
+    NSString                *challenge;
+
+    //! Builds submission bodies; caches the challenge response for the current session
+    WOAudioscrobblerEncoder *encoder;
+
+    //! User agent string passed with all new requests
+    NSString                *userAgent;
+
+    NSString                *user;
+
+    NSString                *password;
+}
+
+
+#pragma mark -
+#pragma mark Custom methods
+
+//! Restores unacknowledged plays from \p aJournal and records all subsequent queue activity in it
+- (void)attachJournal:(WOAudioscrobblerJournal *)aJournal;
+
+//! Reads plays from \p aLog, which may be shared with engines for other endpoints; anything queued beforehand is moved
+//! over to it
+- (void)attachPlayLog:(WOAudioscrobblerPlayLog *)aLog;
+
+//! Sent by the play log whenever a play is appended, whichever engine appended it
+- (void)playLogDidAppendPlay:(WOAudioscrobblerPlayLog *)aLog;
+
+//! \warn Can only start a session when idle
+- (void)startSession;
+
+//! Can be used to force a session to be renegotiated (a new handshake)
+- (void)refreshSession;
+
+- (void)submitSong:(NSString *)track artist:(NSString *)artist album:(NSString *)album length:(unsigned)length;
+
+//! Queues a play that started at \p date rather than now (for example, one recovered from the iTunes library)
+- (void)submitSong:(NSString *)track
+            artist:(NSString *)artist
+             album:(NSString *)album
+            length:(unsigned)length
+              date:(NSDate *)date;
+
+- (void)finalizeSession;
+
+//! Reseeds the generator used to jitter retry delays so that a simulated run can be reproduced exactly
+- (void)setJitterSeed:(uint32_t)aSeed;
+
+#pragma mark -
+#pragma mark Transport callbacks
+
+- (void)transportDidReceiveResponse;
+- (void)transportDidReceiveData:(NSData *)data;
+- (void)transportDidFailWithError:(NSError *)error;
+- (void)transportDidFinishLoading;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(assign)   id <WOAudioscrobblerTransport>  transport;
+@property(assign)   id <WOAudioscrobblerClock>      clock;
+@property(readonly) WOAudioscrobblerScheduler       *scheduler;
+@property(copy)     NSString                *protocolVersion;
+@property(copy)     NSString                *handshakeURLBase;
+@property           WOAudioscrobblerState   currentState;
+@property(readonly) WOAudioscrobblerPlayLog *playLog;
+@property(readonly) unsigned long long      cursor;
+@property(readonly) WOAudioscrobblerJournal *journal;
+@property           unsigned                lastKnownInterval;
+@property           unsigned                maximumBatchSize;
+@property           BOOL                    awaitingResponse;
+@property(copy)     NSURL                   *submissionURL;
+@property(copy)     NSString                *challenge;
+@property(readonly) WOAudioscrobblerEncoder *encoder;
+@property(copy)     NSString                *userAgent;
+@property(copy)     NSString                *user;
+@property(copy)     NSString                *password;
+
+@end
@@ -0,0 +1,840 @@
+// WOAudioscrobblerEngine.m
+// Synergy
+//
+// Copyright 2006-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerEngine.h"
+
+// other headers
+#import "WOAudioscrobblerEncoder.h"
+#import "WOAudioscrobblerJournal.h"
+#import "WOAudioscrobblerLog.h"
+#import "WOAudioscrobblerPlayLog.h"
+#import "WOAudioscrobblerResponseParser.h"
+#import "WOAudioscrobblerScheduler.h"
+
+// WOPublic headers
+#import "WOPublic/WOConvenienceMacros.h"
+#import "WOPublic/WODebugMacros.h"
+
+// TODO: wrap this up (or equivalent code) in a plug-in for Synergy Advance
+
+//! Handshake delay in seconds after repeated failures failure: "A Handshake should occur just once during a SESSION, e.g. when the APP first loads, or after the APP detects 3 catastrophic (i.e. DNS resolution or connection refused) failures in submitting. In this case, the APP should not handshake more than once every 30 minutes."
+#define WO_HANDSHAKE_DELAY_ON_FAILURES  (60 * 30)
+
+//! Number of consecutive catastrophic failures after which a new handshake is required (and rate-limited as above)
+#define WO_CATASTROPHIC_FAILURE_LIMIT   3
+
+//! Number of consecutive BADAUTH replies after which handshakes are rate-limited as above; not specified in the protocol
+//! but it seems like a nice number
+#define WO_BADAUTH_RETRY_LIMIT          3
+
+//! Delay in seconds before the first retry after a failure; doubles with each consecutive failure
+#define WO_RETRY_BASE_DELAY             60
+
+//! Upper bound in seconds for the retry delay
+#define WO_RETRY_MAX_DELAY              (60 * 120)
+
+#ifdef WO_AUDIOSCROBBLER_TEST_MODE
+
+#define WO_ASSIGNED_PLUGIN_ID           @"tst"
+#define WO_ASSIGNED_PLUGIN_VERSION      @"1.0"
+
+#else
+
+//! Synergy's Audioscrobbler plug-in ID as assigned by Russ of last.fm
+#define WO_ASSIGNED_PLUGIN_ID           @"syn"
+
+//! Synergy's Audioscrobbler plug-in version as assigned by Russ of last.fm
+#define WO_ASSIGNED_PLUGIN_VERSION      @"0.1"
+
+#endif /* WO_AUDIOSCROBBLER_TEST_MODE */
+
+//! Base URL used for posting handshake requests
+#define WO_HANDSHAKE_URL_BASE           @"http://post.audioscrobbler.com/"
+
+//! Audioscrobbler protocol version
+#define WO_PROTOCOL_VERSION             @"1.1"
+
+//! Default delay between submissions in seconds
+#define WO_DEFAULT_INTERVAL             1
+
+//! Maximum number of tracks per submission: "You may submit up to 10 songs at once, using the array notation a[0] through a[9]"
+#define WO_MAX_SUBMISSIONS_PER_REQUEST  10
+
+#define WO_DEFAULT_USER_AGENT @"Synergy $Rev: 338 $"
+
+@interface WOAudioscrobblerEngine ()
+
+- (void)requestHandshake;
+- (NSString *)dateStringForDate:(NSDate *)date;
+- (BOOL)queueIsEmpty;
+- (void)enqueue:(id)object;
+- (NSArray *)nextBatchInQueue;
+- (void)doSubmission:(NSArray *)batch;
+- (void)handshakeDidFail;
+- (void)submissionDidFail;
+
+@end
+
+@implementation WOAudioscrobblerEngine
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)init
+{
+    if ((self = [super init]))
+    {
+        WOAudioscrobblerLog(@"Initializing WOAudioscrobblerEngine object");
+        self->protocolVersion      = WO_PROTOCOL_VERSION;
+        self->handshakeURLBase     = WO_HANDSHAKE_URL_BASE;
+        self->currentState         = WOAudioscrobblerIdle;
+        self->userAgent            = WO_DEFAULT_USER_AGENT;
+        self->lastKnownInterval    = WO_DEFAULT_INTERVAL;
+        self->maximumBatchSize     = WO_MAX_SUBMISSIONS_PER_REQUEST;
+        self->pendingBatchCount    = 0;
+        self->encoder              = [[WOAudioscrobblerEncoder alloc] init];
+        self->responseParser       = [[WOAudioscrobblerResponseParser alloc] init];
+        [self setJitterSeed:arc4random()];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)attachJournal:(WOAudioscrobblerJournal *)aJournal
+{
+    NSParameterAssert(aJournal != nil);
+    WOAssert(self.journal == nil);
+    [self attachPlayLog:[[WOAudioscrobblerPlayLog alloc] initWithJournal:aJournal]];
+}
+
+- (void)attachPlayLog:(WOAudioscrobblerPlayLog *)aLog
+{
+    NSParameterAssert(aLog != nil);
+    NSArray *earlier = self.playLog ? [self.playLog playsAfterSequence:self.cursor limit:UINT_MAX] : nil;
+    self->playLog = aLog;
+    self->cursor = [aLog addEndpoint:self];
+
+    // restored plays go ahead of anything queued before the log was attached
+    for (NSDictionary *play in earlier)
+        [aLog appendPlay:play];
+}
+
+- (void)startSession
+{
+    WOAudioscrobblerLog(@"Start Audioscrobbler session");
+    WOAssert(self.currentState == WOAudioscrobblerIdle);
+    [self requestHandshake];
+}
+
+- (void)refreshSession
+{
+    // cancel any in-progress request
+    if (self.awaitingResponse)
+    {
+        [self.transport cancelRequestForEngine:self];
+        self.awaitingResponse = NO;
+    }
+
+    // any batch that was in flight stays on the queue and will be resubmitted whole
+    pendingBatchCount = 0;
+
+    // an explicit refresh starts over: no pending retry and no back-off carried over from the old session
+    [self.scheduler cancelSelector:@selector(nextOperation:) target:self];
+    handshakeFailures       = 0;
+    catastrophicFailures    = 0;
+    badauthRetries          = 0;
+
+    // reset state and request the handshake again
+    self.currentState = WOAudioscrobblerIdle;
+    WOAudioscrobblerLog(@"Refresh Audioscrobbler session");
+    [self requestHandshake];
+}
+
+- (void)submitSong:(NSString *)track artist:(NSString *)artist album:(NSString *)album length:(unsigned)length
+{
+    [self submitSong:track artist:artist album:album length:length date:[self.clock currentDate]];
+}
+
+- (void)submitSong:(NSString *)track
+            artist:(NSString *)artist
+             album:(NSString *)album
+            length:(unsigned)length
+              date:(NSDate *)date
+{
+    NSParameterAssert(length >= 30);
+    NSParameterAssert(date != nil);
+    if (!track || [track isEqualToString:@""])
+    {
+        // doubtful that this will ever happen as iTunes always seems to define a title, even if it is only the filename
+        NSLog(@"Cannot submit to last.fm if track has no title");
+        return;
+    }
+
+    // "all the post variables noted here MUST be supplied for each entry, even if they are blank."
+    if (!artist)    artist = @"";
+    if (!album)     album = @"";
+    NSString        *mbid = @"";
+
+    NSDictionary *song = [NSDictionary dictionaryWithObjectsAndKeys:
+        track,                                      WO_TRACK_KEY,
+        artist,                                     WO_ARTIST_KEY,
+        album,                                      WO_ALBUM_KEY,
+        mbid,                                       WO_MBID_KEY,
+        [NSNumber numberWithUnsignedInt:length],    WO_LENGTH_KEY,
+        [self dateStringForDate:date],              WO_DATE_KEY, nil];
+    WOAudioscrobblerLog(@"Adding song to submission queue; song information: %@", song);
+    [self enqueue:song];
+}
+
+- (void)finalizeSession
+{
+    WOAudioscrobblerLog(@"Finalize Audioscrobbler session");
+    [self.scheduler cancelAllForTarget:self];
+    self.currentState = WOAudioscrobblerIdle;
+}
+
+- (void)setJitterSeed:(uint32_t)aSeed
+{
+    jitterState = aSeed ? aSeed : 0x9e3779b9; // zero is a fixed point for xorshift
+}
+
+#pragma mark -
+#pragma mark Low-level utility methods
+
+- (BOOL)startConnectionWithURL:(NSURL *)aURL body:(NSData *)aData isPost:(BOOL)post
+{
+    WOAudioscrobblerLog(@"Starting connection attempt");
+    if (self.awaitingResponse)
+        WOAudioscrobblerLog(@"warning: existing connection still active");
+    NSParameterAssert(aURL != nil);
+    [responseParser reset];
+    self.awaitingResponse = YES;
+    if ([self.transport startRequestWithURL:aURL body:aData isPost:post forEngine:self])
+        return YES;
+    NSLog(@"Audioscrobbler transport failed for URL %@", aURL);
+    self.awaitingResponse = NO;
+    return NO;
+}
+
+- (NSString *)escapedString:(NSString *)aString;
+{
+    // "UTF-8 encoding is used first, then URL encoding"
+    if (!aString) return nil;
+
+    // also escape legal-but-reserved characters as defined in RFC 2396: <http://www.ietf.org/rfc/rfc2396.txt>
+    return NSMakeCollectable(CFURLCreateStringByAddingPercentEscapes
+        (NULL, (CFStringRef)aString, NULL, CFSTR(";/?:@&=+$,"), kCFStringEncodingUTF8));
+}
+
+- (NSString *)dateStringForDate:(NSDate *)date
+{
+    // "The date format uses the ISO 8601 format except that the time zone specifier MUST NOT be used, the date/time separator MUST be a single space, and all values MUST be expressed with UTC times. For example, a time of 7AM, Pacific Standard Time (UTC + 8) would normally be expressed in ISO 8601 as 2006-02-12T07:00:00+0800. For submission it would be expressed as 2006-02-11 23:00:00."
+    return [date descriptionWithCalendarFormat:@"%Y-%m-%d %H:%M:%S"
+                                      timeZone:[NSTimeZone timeZoneWithAbbreviation:@"UTC"]
+                                        locale:nil];
+}
+
+- (NSURL *)handshakeURL
+{
+    // http://post.audioscrobbler.com/?hs=true&p=1.1&c=osx&v=&u=
+    //  hs = true           : "a handshake is requested"
+    //  p = 1.1             : "the Audioscrobbler protocol version"
+    //  c = clientid = osx  : "Applescriptable MacOS X Application (iTunes)"
+    //  v = clientver       : "is the version of the APP plugin"
+    //  u = user            : "the user name"
+
+    NSURL *URL = [NSURL URLWithString:WO_STRING(@"%@?hs=true&p=%@&c=%@&v=%@&u=%@", self.handshakeURLBase, WO_PROTOCOL_VERSION,
+                                          WO_ASSIGNED_PLUGIN_ID, WO_ASSIGNED_PLUGIN_VERSION, [self escapedString:[self user]])];
+
+    WOAudioscrobblerLog(@"Handshake URL is %@", URL);
+    return URL;
+}
+
+- (void)requestHandshake
+{
+    // don't even bother trying unless both username and password are non-blank
+    if ((self.user && ![self.user isEqualToString:@""]) &&
+        (self.password && ![self.password isEqualToString:@""]))
+    {
+        WOAudioscrobblerLog(@"Will request handshake");
+        NSURL *URL = [self handshakeURL];
+        self->lastHandshakeDate = [self.clock currentDate];
+        if ([self startConnectionWithURL:URL body:nil isPost:NO])
+        {
+            WOAudioscrobblerLog(@"Waiting for handshake reply");
+            self.currentState = WOAudioscrobblerWaitingForHandshake;
+        }
+        else
+        {
+            WOAudioscrobblerLog(@"Failed before handshake reply received");
+            [self handshakeDidFail];
+        }
+    }
+    else
+    {
+        WOAudioscrobblerLog(@"Not proceeding with handshake (neither the username nor the password may be blank)");
+        self.currentState = WOAudioscrobblerNoAuth;
+    }
+}
+
+// UPTODATE and UPDATE replies share everything after the status line
+- (void)processHandshakeCredentials:(WOAudioscrobblerResponseParser *)reply
+{
+    NSString *challengeLine = [reply lineAtIndex:1];
+    NSString *URLLine       = [reply lineAtIndex:2];
+    if (!challengeLine || !URLLine)
+    {
+        NSLog(@"Handshake response too short or malformed (%d lines)", reply.lineCount);
+        [self handshakeDidFail];
+        return;
+    }
+
+    self.challenge      = challengeLine;
+    self.submissionURL  = [NSURL URLWithString:URLLine];
+    self.currentState   = WOAudioscrobblerHandshakeSucceeded;
+    badauthRetries      = 0; // reset
+    handshakeFailures   = 0;
+
+    // plays restored from the journal (or queued while waiting) would otherwise wait for the next enqueue
+    if (![self queueIsEmpty])
+        [self next];
+}
+
+- (void)processHandshake:(WOAudioscrobblerResponseParser *)reply
+{
+    WOAudioscrobblerLog(@"Processing handshake reply");
+    NSParameterAssert(reply != nil);
+    NSParameterAssert(reply.lineCount >= 1);
+    switch (reply.status)
+    {
+        case WOAudioscrobblerReplyUpToDate:
+            WOAudioscrobblerLog(@"Received UPTODATE message");
+            // UPTODATE ("your version is up to date")
+            // <md5 challenge>
+            // <url to submit script>
+            // INTERVAL n ("the number of seconds you must wait between sending updates", 0 or more)
+            [self processHandshakeCredentials:reply];
+            break;
+        case WOAudioscrobblerReplyUpdate:
+        {
+            WOAudioscrobblerLog(@"Received UPDATE message");
+            // UPDATE <updateurl> ("If you are using an outdated version of a plugin, you will see something like this, indicating an update is available")
+            // <md5 challenge>
+            // <url to submit script>
+            // INTERVAL n (as above)
+            NSString *updateURL = [reply argument];
+            if (updateURL)
+                NSLog(@"last.fm reports new version available from %@", updateURL);
+            [self processHandshakeCredentials:reply];
+            break;
+        }
+        case WOAudioscrobblerReplyFailed:
+        {
+            WOAudioscrobblerLog(@"Received FAILED message");
+            // "If the request fails, you will get:"
+            // FAILED <reason>
+            // INTERVAL n
+            NSString *failureReason = [reply argument];
+            if (failureReason)
+                NSLog(@"last.fm handshake failed; reported reason: \"%@\"", failureReason);
+            else
+                NSLog(@"last.fm handshake failed");
+            [self handshakeDidFail];
+            break;
+        }
+        case WOAudioscrobblerReplyBadUser:
+            WOAudioscrobblerLog(@"Received BADUSER message");
+            // "If the user is invalid:"
+            // BADUSER
+            // INTERVAL n
+            NSLog(@"last.fm handshake failed; returned result: %@", [reply lineAtIndex:0]);
+            self.currentState = WOAudioscrobblerBadUser;
+            break;
+        default:
+            NSLog(@"Unrecognized handshake response: %@", [reply lineAtIndex:0]);
+            [self handshakeDidFail];
+            break;
+    }
+}
+
+// exponential back-off with "equal jitter": half of the delay is fixed and half random, so that clients that failed
+// together do not all retry together
+- (NSTimeInterval)backoffAfterFailures:(unsigned)failures
+{
+    if (failures == 0)
+        return 0.0;
+    NSTimeInterval ceiling = MIN(WO_RETRY_BASE_DELAY * (NSTimeInterval)(1U << MIN(failures - 1, 16U)), WO_RETRY_MAX_DELAY);
+    jitterState ^= jitterState << 13;
+    jitterState ^= jitterState >> 17;
+    jitterState ^= jitterState << 5;
+    return ceiling / 2.0 + (ceiling / 2.0) * ((jitterState % 1024) / 1024.0);
+}
+
+// the latest INTERVAL is a lower bound for every operation; failure states may push the next operation further out
+- (NSTimeInterval)delayBeforeNextOperation
+{
+    NSTimeInterval delay = self.lastKnownInterval;
+    switch (self.currentState)
+    {
+        case WOAudioscrobblerSubmissionFailed:
+        case WOAudioscrobblerWaitingToRetrySubmission:
+            delay = MAX(delay, [self backoffAfterFailures:submissionFailures]);
+            break;
+        case WOAudioscrobblerHandshakeFailed:
+        case WOAudioscrobblerBadAuth:
+            delay = MAX(delay, [self backoffAfterFailures:handshakeFailures]);
+            if (lastHandshakeDate &&
+                (catastrophicFailures >= WO_CATASTROPHIC_FAILURE_LIMIT || badauthRetries >= WO_BADAUTH_RETRY_LIMIT))
+            {
+                NSTimeInterval elapsed = [[self.clock currentDate] timeIntervalSinceDate:lastHandshakeDate];
+                delay = MAX(delay, WO_HANDSHAKE_DELAY_ON_FAILURES - elapsed);
+            }
+            break;
+        default:
+            break;
+    }
+    return delay;
+}
+
+- (void)next
+{
+    if ([self queueIsEmpty])
+        return;
+
+    // at most one pending operation; it will pick up whatever has been queued by the time it runs
+    if ([self.scheduler isSelectorScheduled:@selector(nextOperation:) target:self])
+    {
+        WOAudioscrobblerLog(@"Next operation already scheduled");
+        return;
+    }
+
+    NSTimeInterval delay = [self delayBeforeNextOperation];
+    WOAudioscrobblerLog(@"Will handle next item on the queue after delay (Audioscrobbler specified delay in seconds: %d, "
+                        @"effective delay: %.0f)", self.lastKnownInterval, delay);
+
+    // handle the next item on the queue
+    [self.scheduler scheduleSelector:@selector(nextOperation:) target:self afterDelay:delay];
+}
+
+- (void)handshakeDidFail
+{
+    handshakeFailures++;
+    self.currentState = WOAudioscrobblerHandshakeFailed;
+    [self next];
+}
+
+- (void)submissionDidFail
+{
+    // the whole batch stays on the queue
+    pendingBatchCount = 0;
+    submissionFailures++;
+    self.currentState = WOAudioscrobblerSubmissionFailed;
+    [self next];
+}
+
+// called when the Audioscrobbler-specified delay interval has passed and the next operation can be performed
+- (void)nextOperation:(id)ignored
+{
+    if ([self queueIsEmpty])
+    {
+        WOAudioscrobblerLog(@"Queue is empty, not proceeding");
+        return;
+    }
+
+    switch (self.currentState)
+    {
+        case WOAudioscrobblerIdle:
+        case WOAudioscrobblerHandshakeSucceeded:
+        case WOAudioscrobblerWaitingToRetrySubmission:
+        case WOAudioscrobblerSubmissionSucceeded:
+            WOAudioscrobblerLog(@"Will proceed with submission");
+            [self doSubmission:[self nextBatchInQueue]];
+            break;
+        case WOAudioscrobblerSubmissionFailed:
+            // "A Handshake should occur just once during a SESSION, e.g. when the APP first loads, or after the APP detects 3 catastrophic (i.e. DNS resolution or connection refused) failures in submitting. In this case, the APP should not handshake more than once every 30 minutes. If the APP fails to connect to the handshake URL, the user should be informed."
+            WOAudioscrobblerLog(@"Submission previously failed, will retry");
+            [self doSubmission:[self nextBatchInQueue]];
+            break;
+        case WOAudioscrobblerHandshakeFailed:
+            WOAudioscrobblerLog(@"Handshake previously failed, will retry");
+            [self requestHandshake];
+            break;
+        case WOAudioscrobblerNoAuth:
+            WOAudioscrobblerLog(@"Missing username or password; cannot proceed");
+            break;
+        case WOAudioscrobblerBadAuth:
+            // "If it returns BADAUTH, you may need to re-handshake (you're likely to get temporarily blocked if you're attempting to resubmit at one-second intervals after getting repeated BADAUTH errors)."
+            // after WO_BADAUTH_RETRY_LIMIT attempts delayBeforeNextOperation spaces handshakes 30 minutes apart
+            WOAudioscrobblerLog(@"Previously received a bad auth error; will try again to handshake");
+            badauthRetries++;   // will reset to 0 if handshake is successful
+            [self requestHandshake];
+            break;
+        case WOAudioscrobblerBadUser:
+            WOAudioscrobblerLog(@"Previously received a bad user error; cannot proceed");
+            // non-recoverable errors
+            break;
+        case WOAudioscrobblerWaitingForHandshake:
+            // should never get here, right? this is a programmer error
+            WOAudioscrobblerLog(@"Error: did not expect WOAudioscrobblerWaitingForHandshake status; please report");
+            break;
+        case WOAudioscrobblerWaitingForSubmissionResponse:
+            // should never get here, right? this is a programmer error
+            WOAudioscrobblerLog(@"Error: did not expect WOAudioscrobblerWaitingForSubmissionResponse status; please report");
+            break;
+        default:
+            // programmer error again
+            WOAudioscrobblerLog(@"Error: did not expect status %d; please report", [self currentState]);
+            break;
+    }
+}
+
+#pragma mark -
+#pragma mark Queue helper methods
+
+- (BOOL)queueIsEmpty
+{
+    return ([self.playLog countOfPlaysAfterSequence:self.cursor] == 0) ? YES : NO;
+}
+
+- (void)enqueue:(id)object
+{
+    WOAudioscrobblerLog(@"Enqueuing object: %@", object);
+    NSParameterAssert(object != nil);
+    if (!self.playLog)
+        [self attachPlayLog:[[WOAudioscrobblerPlayLog alloc] init]];
+    [self.playLog appendPlay:object];   // comes back through playLogDidAppendPlay:
+}
+
+- (void)playLogDidAppendPlay:(WOAudioscrobblerPlayLog *)aLog
+{
+    unsigned count = [aLog countOfPlaysAfterSequence:self.cursor];
+    BOOL empty = (count == 1);
+    WOAudioscrobblerLog(@"Number of items currently on the queue for %@: %d", self.handshakeURLBase, count);
+
+    // special case handling for items added to empty queues: process immediately
+    if (empty)
+    {
+        WOAudioscrobblerLog(@"Queue was empty: processing item");
+        [self next];
+    }
+    else
+    {
+        // some states are also worth submitting
+        switch (self.currentState)
+        {
+            case WOAudioscrobblerIdle:
+            case WOAudioscrobblerHandshakeSucceeded:
+            case WOAudioscrobblerSubmissionSucceeded:
+            case WOAudioscrobblerWaitingToRetrySubmission:
+                WOAudioscrobblerLog(@"Queue was non-empty, but ready to submit: processing item");
+                [self next];
+                break;
+            case WOAudioscrobblerSubmissionFailed:
+            case WOAudioscrobblerHandshakeFailed:
+            case WOAudioscrobblerBadAuth:
+                WOAudioscrobblerLog(@"Queue was non-empty, last attempt failed: processing item");
+                [self next];
+                break;
+            case WOAudioscrobblerBadUser:
+            case WOAudioscrobblerWaitingForHandshake:
+            case WOAudioscrobblerWaitingForSubmissionResponse:
+            case WOAudioscrobblerNoAuth:
+            default:
+                WOAudioscrobblerLog(@"Queue was non-empty, but not ready to submit: not processing item");
+                break;
+        }
+    }
+}
+
+// moves this endpoint's cursor past every item belonging to the submission in flight in one step; items enqueued while
+// waiting for the response are appended at the tail so they are unaffected
+- (void)dequeuePendingBatch
+{
+    NSArray *batch = [self.playLog playsAfterSequence:self.cursor limit:pendingBatchCount];
+    WOAudioscrobblerLog(@"Dequeueing batch of %d objects", [batch count]);
+    pendingBatchCount = 0;
+    if ([batch count] == 0)
+        return;
+
+    // the play log retires the plays once every endpoint has moved past them
+    cursor = [[[batch lastObject] objectForKey:WO_SEQUENCE_KEY] unsignedLongLongValue];
+    [self.playLog acknowledgeSequence:cursor forEndpoint:self];
+}
+
+// return up to maximumBatchSize objects from the head of the queue without dequeuing them; returns nil if queue is empty
+- (NSArray *)nextBatchInQueue
+{
+    if ([self queueIsEmpty])
+        return nil;
+    return [self.playLog playsAfterSequence:self.cursor limit:self.maximumBatchSize];
+}
+
+#pragma mark -
+#pragma mark High-level methods
+
+- (void)doSubmission:(NSArray *)batch
+{
+    NSParameterAssert(batch != nil);
+    unsigned count = [batch count];
+    NSParameterAssert(count >= 1 && count <= WO_MAX_SUBMISSIONS_PER_REQUEST);
+
+    // u=<user>&s=<MD5 response>&a[0]=<artist>&t[0]=<track>&b[0]=<album>&m[0]=<mbid>&l[0]=<length>&i[0]=<time>
+    //  <user>: last.fm username (MUST be the same as the username given in the HANDSHAKE)
+    // <MD5 response>: Demonstrates the HANDSHAKE credentials.
+    // <artist>: The name of the artist
+    // <track>: The name of the track
+    // <album>: The name of the album the track is from
+    // <mbid>: The MusicBrainz? ID of the track
+    // <length>: The length (duration) of the track in whole (integer) seconds
+    // <time>: The date and time the track was played, described in a modified ISO 8601 format.
+    // Additional tracks in the same submission use the next array index: a[1], t[1] ... i[1] and so on up to a[9].
+
+    // Submissions MUST be sent using an HTTP POST request to the URL obtained from the HANDSHAKE process.
+    // The submission is formatted as if it were an x-www-urlencoded HTML form response, with the body of the HTTP request containing a single line with key-value pairs separated by =, with multiple pairs separated by &.
+    // The submission MUST be correctly double-encoded.
+    // The value of each field is expressed as a UTF-8 encoded string and then URL encoded.
+    // All the characters not part of a value are already valid UTF-8 and MUST NOT be further URL encoded.
+
+    // the encoder's buffer is only borrowed; the transport copies it into the request
+    NSData *data = [self.encoder submissionBodyForUser:self.user batch:batch];
+
+    if (self.submissionURL)
+        WOAudioscrobblerLog(@"Will perform submission using URL: %@", self.submissionURL);
+    else
+    {
+        // only a handshake can supply one; the batch stays on the queue
+        WOAudioscrobblerLog(@"Cannot perform submission because do not have a submission URL; will handshake again");
+        pendingBatchCount = 0;
+        self.currentState = WOAudioscrobblerHandshakeFailed;
+        [self next];
+        return;
+    }
+
+    WOAudioscrobblerLog(@"Submission as data is: %@", data);
+
+    if ([self startConnectionWithURL:self.submissionURL body:data isPost:YES])
+    {
+        WOAudioscrobblerLog(@"Waiting for submission response (%d tracks in batch)", count);
+        pendingBatchCount = count;
+        self.currentState = WOAudioscrobblerWaitingForSubmissionResponse;
+    }
+    else
+    {
+        WOAudioscrobblerLog(@"Failed before submission response received");
+        [self submissionDidFail];
+    }
+}
+
+- (void)processSubmissionResponse:(WOAudioscrobblerResponseParser *)reply
+{
+    WOAudioscrobblerLog(@"Processing submission response");
+    NSParameterAssert(reply != nil);
+    NSParameterAssert(reply.lineCount >= 1);
+    switch (reply.status)
+    {
+        case WOAudioscrobblerReplyOK:
+            WOAudioscrobblerLog(@"Received OK response");
+            // OK
+            // INTERVAL n
+            // "If the server returns OK, you should remove the submitted tracks from your plugin's cache. "
+            self.currentState = WOAudioscrobblerSubmissionSucceeded;
+            submissionFailures = 0;
+            [self dequeuePendingBatch];
+            [self next];
+            break;
+        case WOAudioscrobblerReplyFailed:
+        {
+            WOAudioscrobblerLog(@"Received FAILED response");
+            // FAILED <reason>
+            // INTERVAL n
+            // "If it returns FAILED <reason>: The space after FAILED followed by an error message is optional."
+            // "This indicates something went wrong, and you should cache the submission and retry later."
+            NSString *failureReason = [reply argument];
+            if (failureReason)
+                NSLog(@"last.fm submission failed; reported reason: \"%@\"", failureReason);
+            else
+                NSLog(@"last.fm submission failed");
+
+            // the whole batch stays on the queue and is retried after a back-off
+            pendingBatchCount = 0;
+            submissionFailures++;
+            self.currentState = WOAudioscrobblerWaitingToRetrySubmission;
+            [self next];
+            break;
+        }
+        case WOAudioscrobblerReplyBadAuth:
+            WOAudioscrobblerLog(@"Received BADAUTH response");
+            // BADAUTH
+            // INTERVAL n
+            // "If it returns BADAUTH, you may need to re-handshake"
+            pendingBatchCount = 0;
+            self.currentState = WOAudioscrobblerBadAuth;
+            [self next];
+            break;
+        default:
+            NSLog(@"Unrecognized submission response: %@", [reply lineAtIndex:0]);
+            [self submissionDidFail];
+            break;
+    }
+}
+
+#pragma mark -
+#pragma mark Transport callbacks
+
+- (void)transportDidReceiveResponse
+{
+    // was a bug; see: <http://wincent.com/a/support/bugs/show_bug.cgi?id=641>
+    //  *** -[NSConcreteData setLength:]: unrecognized selector sent to instance 0x1065590
+    // a redirect or multipart reply starts over
+    [responseParser reset];
+}
+
+- (void)transportDidReceiveData:(NSData *)data
+{
+    // replies are tokenized as they arrive rather than buffered until the end
+    if (self.awaitingResponse)
+        [responseParser parseBytes:[data bytes] length:[data length]];
+}
+
+- (void)transportDidFailWithError:(NSError *)error
+{
+    // clean up (this is the last message sent by the transport)
+    self.awaitingResponse = NO;
+    NSLog(@"Audioscrobbler request for URL %@ returned error: %@", [[error userInfo] objectForKey:NSURLErrorFailingURLStringErrorKey],
+          [error localizedDescription]);
+    switch (self.currentState)
+    {
+        case (WOAudioscrobblerWaitingForHandshake):
+            catastrophicFailures++;
+            [self handshakeDidFail];
+            break;
+        case (WOAudioscrobblerWaitingForSubmissionResponse):
+            if (++catastrophicFailures >= WO_CATASTROPHIC_FAILURE_LIMIT)
+            {
+                // "after the APP detects 3 catastrophic (i.e. DNS resolution or connection refused) failures in submitting"
+                // a new handshake is needed; delayBeforeNextOperation holds it to the 30-minute floor
+                WOAudioscrobblerLog(@"Repeated catastrophic failures; will handshake again");
+                pendingBatchCount = 0;
+                self.currentState = WOAudioscrobblerHandshakeFailed;
+                [self next];
+            }
+            else
+                [self submissionDidFail];
+            break;
+        default:
+            break;
+    }
+}
+
+- (void)transportDidFinishLoading
+{
+    // clean up (this is the last message sent by the transport)
+    WOAudioscrobblerLog(@"Connection to Audioscrobbler did finish loading (response received)");
+    self.awaitingResponse = NO;
+    catastrophicFailures = 0;   // the server is reachable
+    [responseParser finish];
+    if (responseParser.lineCount == 0)
+    {
+        NSLog(@"warning: last.fm returned empty response");
+        switch (self.currentState)
+        {
+            case (WOAudioscrobblerWaitingForHandshake):
+                [self handshakeDidFail];
+                break;
+            case (WOAudioscrobblerWaitingForSubmissionResponse):
+                [self submissionDidFail];
+                break;
+            default:
+                break;
+        }
+        return; // no point in continuing
+    }
+
+    // "INTERVAL commands can be at the end of any response block, but don't expect them to be. Always observe the latest INTERVAL you get."
+    if (responseParser.interval > 0)
+    {
+        WOAudioscrobblerLog(@"Storing interval value: %d", responseParser.interval);
+        self.lastKnownInterval = responseParser.interval;
+    }
+    else if (responseParser.sawInvalidInterval)
+        NSLog(@"Invalid interval specification received from last.fm");
+
+    // now handle the rest of the response
+    switch (self.currentState)
+    {
+        case WOAudioscrobblerWaitingForHandshake:
+            [self processHandshake:responseParser];
+            break;
+        case WOAudioscrobblerWaitingForSubmissionResponse:
+            [self processSubmissionResponse:responseParser];
+            break;
+        default:
+            break;
+    }
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize transport;
+
+// all deferred work goes through a scheduler driven by the clock
+- (void)setClock:(id <WOAudioscrobblerClock>)aClock
+{
+    if (self.scheduler)
+        [self.scheduler cancelAllForTarget:self];
+    clock = aClock;
+    scheduler = aClock ? [[WOAudioscrobblerScheduler alloc] initWithClock:aClock] : nil;
+}
+
+@synthesize clock;
+@synthesize scheduler;
+@synthesize protocolVersion;
+@synthesize handshakeURLBase;
+@synthesize currentState;
+@synthesize playLog;
+@synthesize cursor;
+
+- (WOAudioscrobblerJournal *)journal
+{
+    return self.playLog.journal;
+}
+@synthesize lastKnownInterval;
+
+// clamp to the protocol limit; a value of 1 reproduces the old one-track-per-request behaviour
+- (void)setMaximumBatchSize:(unsigned)aSize
+{
+    maximumBatchSize = MAX((unsigned)1, MIN(aSize, (unsigned)WO_MAX_SUBMISSIONS_PER_REQUEST));
+}
+
+@synthesize maximumBatchSize;
+
+@synthesize awaitingResponse;
+@synthesize submissionURL;
+
+// the encoder caches the challenge response, so it must see every change to the credentials
+- (void)setChallenge:(NSString *)aChallenge
+{
+    challenge = [aChallenge copy];
+    [self.encoder setChallenge:challenge];
+}
+
+@synthesize challenge;
+@synthesize userAgent;
+@synthesize user;
+
+- (void)setPassword:(NSString *)aPassword
+{
+    password = [aPassword copy];
+    [self.encoder setPassword:password];
+}
+
+@synthesize password;
+@synthesize encoder;
+
+@end
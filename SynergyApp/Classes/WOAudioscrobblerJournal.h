@@ -0,0 +1,87 @@
+//
+//  WOAudioscrobblerJournal.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Cocoa/Cocoa.h>
+
+//! Append-only on-disk record of the plays enqueued for, and acknowledged by, last.fm. Used to restore the WOAudioscrobbler
+//! submission queue after a quit or crash.
+//!
+//! Every record is a fixed 16-byte header (magic, type, payload length, CRC-32 of the header fields and payload) followed by
+//! a payload zero-padded to an 8-byte boundary. Play records carry a sequence number plus the track fields; acknowledgement records carry only the
+//! highest sequence number accepted by every endpoint. The queue is strictly FIFO, so that single watermark retires every
+//! earlier play. When plays are mirrored to several endpoints, cursor records additionally carry each endpoint's own
+//! position, so that an endpoint that is ahead of the others does not resubmit after a restart.
+//!
+//! Appends are buffered on the calling thread and group-committed (one write and one fsync per group) by a private writer
+//! thread, so enqueuing a play never waits for the disk.
+//!
+//! \warn Apart from the private writer thread, should only be used from a single thread (most likely the main thread)
+@interface WOAudioscrobblerJournal : NSObject {
+
+    NSString            *path;
+
+    //! Sequence number that will be assigned to the next appended play
+    unsigned long long  nextSequence;
+
+    //! Highest sequence number acknowledged so far
+    unsigned long long  acknowledgedSequence;
+
+    //! Number of acknowledgements since the journal was last compacted
+    unsigned            acknowledgementsSinceCompaction;
+
+    //! Highest sequence number acknowledged by each endpoint (NSString identifier to NSNumber)
+    NSMutableDictionary *cursors;
+
+    //! Guards pendingData, pendingSnapshot and writerBusy
+    NSCondition         *condition;
+
+    //! Encoded records waiting to be group-committed by the writer thread
+    NSMutableData       *pendingData;
+
+    //! Replacement file contents waiting to be installed by the writer thread (compaction)
+    NSData              *pendingSnapshot;
+
+    //! YES while the writer thread has a group in flight
+    BOOL                writerBusy;
+
+    //! Only ever touched by the writer thread; opened lazily, -1 when closed
+    int                 fd;
+}
+
+//! Returns ~/Library/Application Support/Synergy/Audioscrobbler Journal, or nil if the folder cannot be found or created
++ (NSString *)defaultPath;
+
+- (id)initWithPath:(NSString *)aPath;
+
+//! Memory-maps the journal, validates its records and returns the unacknowledged plays in submission order. Each play is
+//! tagged with its sequence number under WO_SEQUENCE_KEY. A torn or corrupt tail is truncated away.
+//! \warn Must be called once, before any other message
+- (NSMutableArray *)replay;
+
+//! Assigns \p play the next sequence number, schedules it for writing and returns the tagged copy that should be enqueued
+- (NSDictionary *)appendPlay:(NSDictionary *)play;
+
+//! Records that \p play and every play before it have been accepted by every endpoint
+- (void)acknowledgePlay:(NSDictionary *)play;
+
+//! Returns the highest sequence number acknowledged by every endpoint
+- (unsigned long long)acknowledgedSequence;
+
+//! Returns the position of the endpoint identified by \p identifier as restored by replay, or acknowledgedSequence if the
+//! endpoint has no cursor of its own
+- (unsigned long long)cursorForEndpoint:(NSString *)identifier;
+
+//! Records that the endpoint identified by \p identifier has accepted every play up to and including \p sequence
+- (void)recordCursor:(unsigned long long)sequence forEndpoint:(NSString *)identifier;
+
+//! Rewrites the journal so that it contains only \p liveQueue, provided that enough acknowledgements have accumulated
+- (void)compactIfNeededWithQueue:(NSArray *)liveQueue;
+
+//! Blocks until every record appended so far is on disk
+- (void)synchronize;
+
+@end
@@ -0,0 +1,514 @@
+// WOAudioscrobblerJournal.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerJournal.h"
+
+// system headers
+#import <errno.h>
+#import <fcntl.h>
+#import <stddef.h>
+#import <unistd.h>
+
+// other headers
+#import "WOAudioscrobblerEngine.h"          /* queue dictionary keys */
+#import "WOAudioscrobblerLog.h"
+#import "WONSFileManagerExtensions.h"
+
+//! Journal file name inside ~/Library/Application Support/Synergy
+#define WO_JOURNAL_FILENAME                 @"Audioscrobbler Journal"
+
+//! Marks the start of every record ("WOAJ")
+#define WO_JOURNAL_MAGIC                    0x574F414AU
+
+//! Record types
+#define WO_JOURNAL_RECORD_PLAY              1
+#define WO_JOURNAL_RECORD_ACKNOWLEDGEMENT   2
+#define WO_JOURNAL_RECORD_CURSOR            3
+
+//! Number of acknowledgements after which the journal is rewritten to drop retired plays
+#define WO_JOURNAL_COMPACTION_THRESHOLD     512
+
+//! Records and their payloads are padded to this boundary
+#define WO_JOURNAL_ALIGNMENT                8
+
+#define WO_JOURNAL_PAD(length)  (((length) + (WO_JOURNAL_ALIGNMENT - 1)) & ~(WO_JOURNAL_ALIGNMENT - 1))
+
+//! Number of variable-length string fields in a play record (track, artist, album, mbid, date)
+#define WO_JOURNAL_STRING_FIELDS            5
+
+// all multi-byte fields are stored little-endian
+typedef struct WOAudioscrobblerJournalHeader {
+    uint32_t    magic;
+    uint16_t    type;
+    uint16_t    reserved;
+    uint32_t    length;         //!< payload length, excluding padding
+    uint32_t    checksum;       //!< CRC-32 of the type, reserved and length fields followed by the payload
+} WOAudioscrobblerJournalHeader;
+
+typedef struct WOAudioscrobblerJournalPlay {
+    uint64_t    sequence;
+    uint32_t    length;         //!< track length in seconds
+    uint16_t    fieldLengths[WO_JOURNAL_STRING_FIELDS];
+    uint16_t    reserved;
+    // followed by the UTF-8 bytes of each string field, back to back
+} WOAudioscrobblerJournalPlay;
+
+typedef struct WOAudioscrobblerJournalAcknowledgement {
+    uint64_t    sequence;
+} WOAudioscrobblerJournalAcknowledgement;
+
+typedef struct WOAudioscrobblerJournalCursor {
+    uint64_t    sequence;
+    uint16_t    identifierLength;
+    uint16_t    reserved[3];
+    // followed by the UTF-8 bytes of the endpoint identifier
+} WOAudioscrobblerJournalCursor;
+
+static uint32_t WOJournalCRCTable[256];
+
+static uint32_t WOJournalCRC32Update(uint32_t crc, const void *bytes, size_t length)
+{
+    const uint8_t *p = bytes;
+    while (length--)
+        crc = WOJournalCRCTable[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+// covers the header as stored (so a damaged type or length is caught too), apart from the magic and the checksum itself
+static uint32_t WOJournalChecksum(const WOAudioscrobblerJournalHeader *header, const void *payload, size_t length)
+{
+    uint32_t crc = WOJournalCRC32Update(0xffffffffU, &header->type,
+                                        offsetof(WOAudioscrobblerJournalHeader, checksum) -
+                                        offsetof(WOAudioscrobblerJournalHeader, type));
+    return WOJournalCRC32Update(crc, payload, length) ^ 0xffffffffU;
+}
+
+// padding is always written as zeroes; anything else means the record is damaged
+static BOOL WOJournalPaddingIsClear(const uint8_t *payload, uint32_t length)
+{
+    for (uint32_t i = length; i < WO_JOURNAL_PAD(length); i++)
+        if (payload[i])
+            return NO;
+    return YES;
+}
+
+@interface WOAudioscrobblerJournal ()
+
+- (void)appendRecordOfType:(uint16_t)type payload:(NSData *)payload toData:(NSMutableData *)data;
+- (void)appendPlay:(NSDictionary *)play toData:(NSMutableData *)data;
+- (void)appendAcknowledgementToData:(NSMutableData *)data;
+- (void)appendCursor:(unsigned long long)sequence forEndpoint:(NSString *)identifier toData:(NSMutableData *)data;
+- (void)schedule:(NSData *)records;
+- (void)writerThread:(id)ignored;
+
+@end
+
+@implementation WOAudioscrobblerJournal
+
+#pragma mark -
+#pragma mark NSObject overrides
+
++ (void)initialize
+{
+    // standard reflected CRC-32 (polynomial 0xedb88320)
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (0xedb88320U ^ (c >> 1)) : (c >> 1);
+        WOJournalCRCTable[i] = c;
+    }
+}
+
++ (NSString *)defaultPath
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *applicationSupportFolder = [fm findSystemFolderType:kApplicationSupportFolderType
+                                                        forDomain:kUserDomain
+                                                         creating:YES];
+    if (!applicationSupportFolder)
+        return nil;
+    NSString *synergyFolder = [applicationSupportFolder stringByAppendingPathComponent:@"Synergy"];
+    if (![fm createDirectoryAtPath:synergyFolder withIntermediateDirectories:YES attributes:nil error:NULL])
+        return nil;
+    return [synergyFolder stringByAppendingPathComponent:WO_JOURNAL_FILENAME];
+}
+
+- (id)initWithPath:(NSString *)aPath
+{
+    NSParameterAssert(aPath != nil);
+    if ((self = [super init]))
+    {
+        self->path          = [aPath copy];
+        self->nextSequence  = 1;
+        self->condition     = [[NSCondition alloc] init];
+        self->pendingData   = [NSMutableData data];
+        self->cursors       = [NSMutableDictionary dictionary];
+        self->fd            = -1;
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (NSMutableArray *)replay
+{
+    NSMutableArray *plays = [NSMutableArray array];
+    NSError *error = nil;
+    NSData *mapped = [NSData dataWithContentsOfFile:path options:NSMappedRead error:&error];
+    if (!mapped)
+    {
+        WOAudioscrobblerLog(@"No journal to replay at %@", path);
+        [NSThread detachNewThreadSelector:@selector(writerThread:) toTarget:self withObject:nil];
+        return plays;
+    }
+
+    const uint8_t *base = [mapped bytes];
+    NSUInteger size = [mapped length];
+
+    // first pass: validate records, find the end of the intact prefix and the final watermark
+    NSUInteger offset = 0;
+    unsigned long long highest = 0;
+    while (offset + sizeof(WOAudioscrobblerJournalHeader) <= size)
+    {
+        const WOAudioscrobblerJournalHeader *header = (const WOAudioscrobblerJournalHeader *)(base + offset);
+        uint32_t length = CFSwapInt32LittleToHost(header->length);
+        NSUInteger recordSize = sizeof(WOAudioscrobblerJournalHeader) + WO_JOURNAL_PAD(length);
+        if (CFSwapInt32LittleToHost(header->magic) != WO_JOURNAL_MAGIC ||
+            length > size - offset - sizeof(WOAudioscrobblerJournalHeader) ||
+            offset + recordSize > size)
+            break;
+        const uint8_t *payload = (const uint8_t *)(header + 1);
+        if (WOJournalChecksum(header, payload, length) != CFSwapInt32LittleToHost(header->checksum) ||
+            !WOJournalPaddingIsClear(payload, length))
+            break;
+        uint16_t type = CFSwapInt16LittleToHost(header->type);
+        if (type == WO_JOURNAL_RECORD_PLAY && length >= sizeof(WOAudioscrobblerJournalPlay))
+            highest = MAX(highest, CFSwapInt64LittleToHost(((const WOAudioscrobblerJournalPlay *)payload)->sequence));
+        else if (type == WO_JOURNAL_RECORD_ACKNOWLEDGEMENT && length >= sizeof(WOAudioscrobblerJournalAcknowledgement))
+        {
+            unsigned long long sequence = CFSwapInt64LittleToHost(((const WOAudioscrobblerJournalAcknowledgement *)payload)->sequence);
+            acknowledgedSequence = MAX(acknowledgedSequence, sequence);
+            highest = MAX(highest, sequence);
+        }
+        else if (type == WO_JOURNAL_RECORD_CURSOR && length >= sizeof(WOAudioscrobblerJournalCursor))
+        {
+            const WOAudioscrobblerJournalCursor *cursor = (const WOAudioscrobblerJournalCursor *)payload;
+            uint16_t identifierLength = CFSwapInt16LittleToHost(cursor->identifierLength);
+            NSString *identifier = nil;
+            if (sizeof(WOAudioscrobblerJournalCursor) + identifierLength <= length)
+                identifier = [[NSString alloc] initWithBytes:cursor + 1 length:identifierLength encoding:NSUTF8StringEncoding];
+            if (identifier)
+            {
+                unsigned long long sequence = CFSwapInt64LittleToHost(cursor->sequence);
+                [cursors setObject:[NSNumber numberWithUnsignedLongLong:sequence] forKey:identifier];
+                highest = MAX(highest, sequence);
+            }
+        }
+        offset += recordSize;
+    }
+    NSUInteger intact = offset;
+    nextSequence = highest + 1;
+
+    // second pass: materialize only the plays past the watermark
+    offset = 0;
+    while (offset < intact)
+    {
+        const WOAudioscrobblerJournalHeader *header = (const WOAudioscrobblerJournalHeader *)(base + offset);
+        uint32_t length = CFSwapInt32LittleToHost(header->length);
+        offset += sizeof(WOAudioscrobblerJournalHeader) + WO_JOURNAL_PAD(length);
+        if (CFSwapInt16LittleToHost(header->type) != WO_JOURNAL_RECORD_PLAY || length < sizeof(WOAudioscrobblerJournalPlay))
+            continue;
+        const WOAudioscrobblerJournalPlay *record = (const WOAudioscrobblerJournalPlay *)(header + 1);
+        unsigned long long sequence = CFSwapInt64LittleToHost(record->sequence);
+        if (sequence <= acknowledgedSequence)
+            continue;
+
+        NSString *fields[WO_JOURNAL_STRING_FIELDS];
+        const char *cursor = (const char *)(record + 1);
+        const char *end = (const char *)record + length;
+        BOOL valid = YES;
+        for (int i = 0; i < WO_JOURNAL_STRING_FIELDS; i++)
+        {
+            uint16_t fieldLength = CFSwapInt16LittleToHost(record->fieldLengths[i]);
+            if (cursor + fieldLength > end)
+            {
+                valid = NO;
+                break;
+            }
+            fields[i] = [[NSString alloc] initWithBytes:cursor length:fieldLength encoding:NSUTF8StringEncoding];
+            if (!fields[i])
+                fields[i] = @"";
+            cursor += fieldLength;
+        }
+        if (!valid)
+            continue;
+        [plays addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+            fields[0],                                                              WO_TRACK_KEY,
+            fields[1],                                                              WO_ARTIST_KEY,
+            fields[2],                                                              WO_ALBUM_KEY,
+            fields[3],                                                              WO_MBID_KEY,
+            [NSNumber numberWithUnsignedInt:CFSwapInt32LittleToHost(record->length)], WO_LENGTH_KEY,
+            fields[4],                                                              WO_DATE_KEY,
+            [NSNumber numberWithUnsignedLongLong:sequence],                         WO_SEQUENCE_KEY, nil]];
+    }
+    mapped = nil;
+
+    if (intact < size)
+    {
+        NSLog(@"warning: Audioscrobbler journal has a damaged tail; discarding %lu bytes", (unsigned long)(size - intact));
+        if (truncate([path fileSystemRepresentation], (off_t)intact) != 0)
+            NSLog(@"warning: could not truncate Audioscrobbler journal (errno %d)", errno);
+    }
+    WOAudioscrobblerLog(@"Replayed journal: %d unacknowledged plays", [plays count]);
+    [NSThread detachNewThreadSelector:@selector(writerThread:) toTarget:self withObject:nil];
+    return plays;
+}
+
+- (NSDictionary *)appendPlay:(NSDictionary *)play
+{
+    NSParameterAssert(play != nil);
+    NSMutableDictionary *tagged = [play mutableCopy];
+    [tagged setObject:[NSNumber numberWithUnsignedLongLong:nextSequence++] forKey:WO_SEQUENCE_KEY];
+    NSMutableData *data = [NSMutableData data];
+    [self appendPlay:tagged toData:data];
+    [self schedule:data];
+    return tagged;
+}
+
+- (void)acknowledgePlay:(NSDictionary *)play
+{
+    NSNumber *sequence = [play objectForKey:WO_SEQUENCE_KEY];
+    if (!sequence || [sequence unsignedLongLongValue] <= acknowledgedSequence)
+        return;
+    acknowledgedSequence = [sequence unsignedLongLongValue];
+    acknowledgementsSinceCompaction++;
+    NSMutableData *data = [NSMutableData data];
+    [self appendAcknowledgementToData:data];
+    [self schedule:data];
+}
+
+- (unsigned long long)acknowledgedSequence
+{
+    return acknowledgedSequence;
+}
+
+- (unsigned long long)cursorForEndpoint:(NSString *)identifier
+{
+    NSNumber *cursor = [cursors objectForKey:identifier];
+    return cursor ? MAX([cursor unsignedLongLongValue], acknowledgedSequence) : acknowledgedSequence;
+}
+
+- (void)recordCursor:(unsigned long long)sequence forEndpoint:(NSString *)identifier
+{
+    NSParameterAssert(identifier != nil);
+    if (sequence <= [self cursorForEndpoint:identifier])
+        return;
+    [cursors setObject:[NSNumber numberWithUnsignedLongLong:sequence] forKey:identifier];
+    NSMutableData *data = [NSMutableData data];
+    [self appendCursor:sequence forEndpoint:identifier toData:data];
+    [self schedule:data];
+}
+
+- (void)compactIfNeededWithQueue:(NSArray *)liveQueue
+{
+    if (acknowledgementsSinceCompaction < WO_JOURNAL_COMPACTION_THRESHOLD)
+        return;
+    WOAudioscrobblerLog(@"Compacting journal (%d live plays)", [liveQueue count]);
+    acknowledgementsSinceCompaction = 0;
+
+    // the snapshot carries the watermark so that sequence numbers keep increasing even if the queue is empty
+    NSMutableData *snapshot = [NSMutableData data];
+    [self appendAcknowledgementToData:snapshot];
+    for (NSString *identifier in cursors)
+    {
+        unsigned long long sequence = [[cursors objectForKey:identifier] unsignedLongLongValue];
+        if (sequence > acknowledgedSequence)    // cursors at or behind the watermark carry no information
+            [self appendCursor:sequence forEndpoint:identifier toData:snapshot];
+    }
+    for (NSDictionary *play in liveQueue)
+        if ([play objectForKey:WO_SEQUENCE_KEY])
+            [self appendPlay:play toData:snapshot];
+
+    // the snapshot supersedes everything still waiting to be written
+    [condition lock];
+    pendingSnapshot = snapshot;
+    [pendingData setLength:0];
+    [condition broadcast];
+    [condition unlock];
+}
+
+- (void)synchronize
+{
+    [condition lock];
+    while (writerBusy || pendingSnapshot || [pendingData length] > 0)
+        [condition wait];
+    [condition unlock];
+}
+
+#pragma mark -
+#pragma mark Encoding
+
+- (void)appendRecordOfType:(uint16_t)type payload:(NSData *)payload toData:(NSMutableData *)data
+{
+    WOAudioscrobblerJournalHeader header;
+    header.magic    = CFSwapInt32HostToLittle(WO_JOURNAL_MAGIC);
+    header.type     = CFSwapInt16HostToLittle(type);
+    header.reserved = 0;
+    header.length   = CFSwapInt32HostToLittle((uint32_t)[payload length]);
+    header.checksum = CFSwapInt32HostToLittle(WOJournalChecksum(&header, [payload bytes], [payload length]));
+    [data appendBytes:&header length:sizeof(header)];
+    [data appendData:payload];
+    [data increaseLengthBy:WO_JOURNAL_PAD([payload length]) - [payload length]];
+}
+
+- (void)appendPlay:(NSDictionary *)play toData:(NSMutableData *)data
+{
+    NSString *fields[WO_JOURNAL_STRING_FIELDS] = {
+        [play objectForKey:WO_TRACK_KEY],
+        [play objectForKey:WO_ARTIST_KEY],
+        [play objectForKey:WO_ALBUM_KEY],
+        [play objectForKey:WO_MBID_KEY],
+        [play objectForKey:WO_DATE_KEY]
+    };
+    WOAudioscrobblerJournalPlay record;
+    record.sequence = CFSwapInt64HostToLittle([[play objectForKey:WO_SEQUENCE_KEY] unsignedLongLongValue]);
+    record.length   = CFSwapInt32HostToLittle([[play objectForKey:WO_LENGTH_KEY] unsignedIntValue]);
+    record.reserved = 0;
+    NSMutableData *payload = [NSMutableData dataWithLength:sizeof(record)];
+    for (int i = 0; i < WO_JOURNAL_STRING_FIELDS; i++)
+    {
+        const char *bytes = fields[i] ? [fields[i] UTF8String] : "";
+        size_t length = MIN(strlen(bytes), (size_t)UINT16_MAX);
+        record.fieldLengths[i] = CFSwapInt16HostToLittle((uint16_t)length);
+        [payload appendBytes:bytes length:length];
+    }
+    [payload replaceBytesInRange:NSMakeRange(0, sizeof(record)) withBytes:&record];
+    [self appendRecordOfType:WO_JOURNAL_RECORD_PLAY payload:payload toData:data];
+}
+
+- (void)appendAcknowledgementToData:(NSMutableData *)data
+{
+    WOAudioscrobblerJournalAcknowledgement record;
+    record.sequence = CFSwapInt64HostToLittle(acknowledgedSequence);
+    [self appendRecordOfType:WO_JOURNAL_RECORD_ACKNOWLEDGEMENT
+                     payload:[NSData dataWithBytes:&record length:sizeof(record)]
+                      toData:data];
+}
+
+- (void)appendCursor:(unsigned long long)sequence forEndpoint:(NSString *)identifier toData:(NSMutableData *)data
+{
+    const char *bytes = [identifier UTF8String];
+    size_t length = MIN(strlen(bytes), (size_t)UINT16_MAX);
+    WOAudioscrobblerJournalCursor record;
+    memset(&record, 0, sizeof(record));
+    record.sequence         = CFSwapInt64HostToLittle(sequence);
+    record.identifierLength = CFSwapInt16HostToLittle((uint16_t)length);
+    NSMutableData *payload = [NSMutableData dataWithBytes:&record length:sizeof(record)];
+    [payload appendBytes:bytes length:length];
+    [self appendRecordOfType:WO_JOURNAL_RECORD_CURSOR payload:payload toData:data];
+}
+
+#pragma mark -
+#pragma mark Writer thread
+
+- (void)schedule:(NSData *)records
+{
+    [condition lock];
+    [pendingData appendData:records];
+    [condition broadcast];
+    [condition unlock];
+}
+
+// returns NO on failure; retries on EINTR and partial writes
+static BOOL WOJournalWriteAll(int descriptor, const void *bytes, size_t length)
+{
+    const uint8_t *p = bytes;
+    while (length > 0)
+    {
+        ssize_t written = write(descriptor, p, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return NO;
+        }
+        p += written;
+        length -= (size_t)written;
+    }
+    return YES;
+}
+
+- (void)installSnapshot:(NSData *)snapshot
+{
+    NSString *temporaryPath = [path stringByAppendingPathExtension:@"new"];
+    int temporary = open([temporaryPath fileSystemRepresentation], O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (temporary < 0)
+    {
+        NSLog(@"warning: could not create compacted Audioscrobbler journal (errno %d)", errno);
+        return;
+    }
+    BOOL ok = WOJournalWriteAll(temporary, [snapshot bytes], [snapshot length]) && fsync(temporary) == 0;
+    close(temporary);
+    if (!ok || rename([temporaryPath fileSystemRepresentation], [path fileSystemRepresentation]) != 0)
+    {
+        NSLog(@"warning: could not install compacted Audioscrobbler journal (errno %d)", errno);
+        unlink([temporaryPath fileSystemRepresentation]);
+        return;
+    }
+
+    // subsequent groups go to the new file
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+- (void)writeGroup:(NSData *)group
+{
+    if (fd < 0)
+        fd = open([path fileSystemRepresentation], O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (fd < 0)
+    {
+        NSLog(@"warning: could not open Audioscrobbler journal (errno %d)", errno);
+        return;
+    }
+    if (!WOJournalWriteAll(fd, [group bytes], [group length]) || fsync(fd) != 0)
+        NSLog(@"warning: could not write Audioscrobbler journal (errno %d)", errno);
+}
+
+// everything that accumulates while a group is being written is committed together in the next group
+- (void)writerThread:(id)ignored
+{
+    while (YES)
+    {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        [condition lock];
+        while (!pendingSnapshot && [pendingData length] == 0)
+            [condition wait];
+        NSData *snapshot = pendingSnapshot;
+        NSData *group = pendingData;
+        pendingSnapshot = nil;
+        pendingData = [NSMutableData data];
+        writerBusy = YES;
+        [condition unlock];
+
+        if (snapshot)
+            [self installSnapshot:snapshot];
+        if ([group length] > 0)
+            [self writeGroup:group];
+
+        [condition lock];
+        writerBusy = NO;
+        [condition broadcast];
+        [condition unlock];
+        [pool drain];
+    }
+}
+
+@end
@@ -0,0 +1,104 @@
+//
+//  WOAudioscrobblerLibraryImporter.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+//! \name Imported play keys
+//! Dictionary keys for the plays returned by WOAudioscrobblerLibraryImporter; track, artist, album and length use the
+//! queue item keys from WOAudioscrobblerEngine.h
+//! \startgroup
+
+#define WO_PLAY_DATE_KEY    @"WOPlayDate"   //!< NSDate at which the play started
+
+//! \endgroup
+
+//! Per-track play count as of the last scan, keyed by iTunes persistent ID
+typedef struct WOLibraryWatermarkRecord {
+    uint64_t    persistentID;
+    uint32_t    playCount;
+    uint32_t    reserved;
+} WOLibraryWatermarkRecord;
+
+//! Recovers plays that happened while Synergy was not running from the iTunes Library XML file.
+//!
+//! The library is memory-mapped and streamed through an event-driven parser: only the fields of the track currently
+//! being parsed are held, and parsing stops as soon as the "Tracks" dictionary ends, so the (often larger) playlists
+//! section is never read. Each track's "Play Count" and "Play Date UTC" are compared with a watermark file holding the
+//! time Synergy last stopped watching iTunes and a sorted table of per-track play counts. A track last played after the
+//! watermark time yields one play per additional play count, the most recent starting one track length before its
+//! "Play Date UTC" and earlier ones spaced a track length apart, never reaching back past the watermark time.
+//!
+//! iTunes only records the time of a track's last play, so the reconstructed times of earlier plays are estimates. The
+//! first scan (when there is no watermark yet) only establishes the baseline and yields no plays.
+//!
+//! \warn Not threadsafe; a given importer should only be used from one thread at a time
+@interface WOAudioscrobblerLibraryImporter : NSObject {
+
+    NSString                    *libraryPath;
+
+    NSString                    *watermarkPath;
+
+    //! Previous watermark (memory-mapped); nil on the first scan
+    NSData                      *previousWatermark;
+
+    //! Seconds since 1970 at which Synergy last stopped watching iTunes
+    int64_t                     previousDate;
+
+    //! Play counts for the new watermark, in library order until sorted by commit
+    WOLibraryWatermarkRecord    *records;
+    NSUInteger                  recordCount;
+    NSUInteger                  recordCapacity;
+
+    //! Plays are only generated before this time (seconds since 1970)
+    int64_t                     cutoffDate;
+
+    BOOL                        generatePlays;
+
+    NSMutableArray              *plays;
+
+    //! \name Parser state
+    //! \startgroup
+
+    unsigned                    depth;
+    BOOL                        sawTracksKey;
+    BOOL                        inTracks;
+    BOOL                        capturing;
+    NSMutableString             *text;
+    int                         currentField;
+
+    NSString                    *trackName;
+    NSString                    *trackArtist;
+    NSString                    *trackAlbum;
+    unsigned                    trackTotalTime;
+    unsigned                    trackPlayCount;
+    int64_t                     trackPlayDate;
+    uint64_t                    trackPersistentID;
+    BOOL                        trackIsFile;
+    BOOL                        trackIsPodcast;
+
+    //! \endgroup
+}
+
+//! Returns the path of the library file written by iTunes, or nil if there is none
++ (NSString *)defaultLibraryPath;
+
++ (NSString *)defaultWatermarkPath;
+
+//! Updates the time in the watermark at \p aPath without touching its play counts; called after every play scrobbled
+//! live and when Synergy stops watching iTunes, so that plays it scrobbled live are not imported again even after a crash
++ (BOOL)recordSessionEndDate:(NSDate *)aDate atPath:(NSString *)aPath;
+
+- (id)initWithLibraryPath:(NSString *)aLibraryPath watermarkPath:(NSString *)aWatermarkPath;
+
+//! Parses the library and returns the plays made between the watermark and \p aDate, oldest first (or an empty array if
+//! \p generate is NO); returns nil if the library could not be read. The watermark is not updated until commit.
+- (NSArray *)scanGeneratingPlays:(BOOL)generate untilDate:(NSDate *)aDate;
+
+//! Atomically replaces the watermark with the play counts from the last scan, stamped with the scan's cut-off date
+- (BOOL)commit;
+
+@end
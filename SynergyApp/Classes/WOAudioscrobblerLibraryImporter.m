@@ -0,0 +1,437 @@
+// WOAudioscrobblerLibraryImporter.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerLibraryImporter.h"
+
+// system headers
+#import <fcntl.h>
+#import <time.h>
+#import <unistd.h>
+
+// other headers
+#import "WOAudioscrobblerEngine.h"          /* queue dictionary keys */
+#import "WONSFileManagerExtensions.h"
+
+//! Watermark file name inside ~/Library/Application Support/Synergy
+#define WO_WATERMARK_FILENAME           @"Audioscrobbler Library Watermark"
+
+//! Marks the start of the watermark file ("WOLW")
+#define WO_WATERMARK_MAGIC              0x574F4C57U
+
+#define WO_WATERMARK_VERSION            1
+
+//! Upper bound on the plays reconstructed for any one track, in case of a wildly wrong watermark
+#define WO_IMPORT_MAX_PLAYS_PER_TRACK   50
+
+//! "Songs with a duration of less than 30 seconds should not be submitted."
+#define WO_IMPORT_MINIMUM_LENGTH        30
+
+// all multi-byte fields are stored little-endian; followed by the records, sorted by persistent ID
+typedef struct WOLibraryWatermarkHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    int64_t     date;           //!< seconds since 1970
+    uint64_t    count;          //!< number of records
+} WOLibraryWatermarkHeader;
+
+//! Track dictionary keys of interest
+enum {
+    WOLibraryFieldNone,
+    WOLibraryFieldName,
+    WOLibraryFieldArtist,
+    WOLibraryFieldAlbum,
+    WOLibraryFieldTotalTime,
+    WOLibraryFieldPlayCount,
+    WOLibraryFieldPlayDateUTC,
+    WOLibraryFieldPersistentID,
+    WOLibraryFieldTrackType,
+    WOLibraryFieldPodcast
+};
+
+static int WOLibraryFieldForKey(NSString *key)
+{
+    // ordered roughly by how often they appear
+    if ([key isEqualToString:@"Name"])              return WOLibraryFieldName;
+    if ([key isEqualToString:@"Artist"])            return WOLibraryFieldArtist;
+    if ([key isEqualToString:@"Album"])             return WOLibraryFieldAlbum;
+    if ([key isEqualToString:@"Total Time"])        return WOLibraryFieldTotalTime;
+    if ([key isEqualToString:@"Persistent ID"])     return WOLibraryFieldPersistentID;
+    if ([key isEqualToString:@"Track Type"])        return WOLibraryFieldTrackType;
+    if ([key isEqualToString:@"Play Count"])        return WOLibraryFieldPlayCount;
+    if ([key isEqualToString:@"Play Date UTC"])     return WOLibraryFieldPlayDateUTC;
+    if ([key isEqualToString:@"Podcast"])           return WOLibraryFieldPodcast;
+    return WOLibraryFieldNone;
+}
+
+// parses the plist date format used by iTunes ("2009-03-01T12:34:56Z"); returns 0 on failure
+static int64_t WOLibraryParseDate(NSString *string)
+{
+    struct tm components;
+    memset(&components, 0, sizeof(components));
+    if (sscanf([string UTF8String], "%4d-%2d-%2dT%2d:%2d:%2dZ", &components.tm_year, &components.tm_mon,
+               &components.tm_mday, &components.tm_hour, &components.tm_min, &components.tm_sec) != 6)
+        return 0;
+    components.tm_year -= 1900;
+    components.tm_mon -= 1;
+    return (int64_t)timegm(&components);
+}
+
+static int WOLibraryCompareRecords(const void *a, const void *b)
+{
+    uint64_t left   = ((const WOLibraryWatermarkRecord *)a)->persistentID;
+    uint64_t right  = ((const WOLibraryWatermarkRecord *)b)->persistentID;
+    return (left < right) ? -1 : ((left > right) ? 1 : 0);
+}
+
+@interface WOAudioscrobblerLibraryImporter ()
+
+- (BOOL)loadPreviousWatermark;
+- (BOOL)previousPlayCount:(uint32_t *)count forPersistentID:(uint64_t)persistentID;
+- (void)beginTrack;
+- (void)endTrack;
+
+@end
+
+@implementation WOAudioscrobblerLibraryImporter
+
+#pragma mark -
+#pragma mark NSObject overrides
+
++ (NSString *)defaultLibraryPath
+{
+    // iTunes 9.2 and later write "iTunes Library.xml"; earlier versions wrote "iTunes Music Library.xml"
+    NSString *folder = [NSHomeDirectory() stringByAppendingPathComponent:@"Music/iTunes"];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *path = [folder stringByAppendingPathComponent:@"iTunes Library.xml"];
+    if ([fm fileExistsAtPath:path])
+        return path;
+    path = [folder stringByAppendingPathComponent:@"iTunes Music Library.xml"];
+    if ([fm fileExistsAtPath:path])
+        return path;
+    return nil;
+}
+
++ (NSString *)defaultWatermarkPath
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *applicationSupportFolder = [fm findSystemFolderType:kApplicationSupportFolderType
+                                                        forDomain:kUserDomain
+                                                         creating:YES];
+    if (!applicationSupportFolder)
+        return nil;
+    NSString *synergyFolder = [applicationSupportFolder stringByAppendingPathComponent:@"Synergy"];
+    if (![fm createDirectoryAtPath:synergyFolder withIntermediateDirectories:YES attributes:nil error:NULL])
+        return nil;
+    return [synergyFolder stringByAppendingPathComponent:WO_WATERMARK_FILENAME];
+}
+
++ (BOOL)recordSessionEndDate:(NSDate *)aDate atPath:(NSString *)aPath
+{
+    NSParameterAssert(aDate != nil);
+    NSParameterAssert(aPath != nil);
+    int fd = open([aPath fileSystemRepresentation], O_RDWR);
+    if (fd == -1)
+        return NO;
+    WOLibraryWatermarkHeader header;
+    BOOL success = NO;
+    if (pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+        NSSwapLittleIntToHost(header.magic) == WO_WATERMARK_MAGIC &&
+        NSSwapLittleIntToHost(header.version) == WO_WATERMARK_VERSION)
+    {
+        header.date = (int64_t)NSSwapHostLongLongToLittle((uint64_t)[aDate timeIntervalSince1970]);
+        success = (pwrite(fd, &header.date, sizeof(header.date), offsetof(WOLibraryWatermarkHeader, date)) ==
+                   sizeof(header.date));
+    }
+    close(fd);
+    return success;
+}
+
+- (id)initWithLibraryPath:(NSString *)aLibraryPath watermarkPath:(NSString *)aWatermarkPath
+{
+    NSParameterAssert(aLibraryPath != nil);
+    NSParameterAssert(aWatermarkPath != nil);
+    if ((self = [super init]))
+    {
+        self->libraryPath   = [aLibraryPath copy];
+        self->watermarkPath = [aWatermarkPath copy];
+        self->text          = [NSMutableString string];
+    }
+    return self;
+}
+
+- (void)finalize
+{
+    free(records);
+    [super finalize];
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (NSArray *)scanGeneratingPlays:(BOOL)generate untilDate:(NSDate *)aDate
+{
+    NSParameterAssert(aDate != nil);
+
+    // mapped rather than read: pages are faulted in as the parser advances and can be dropped again behind it
+    NSData *library = [NSData dataWithContentsOfMappedFile:libraryPath];
+    if (!library)
+    {
+        NSLog(@"warning: could not read iTunes library at %@", libraryPath);
+        return nil;
+    }
+
+    generatePlays   = [self loadPreviousWatermark] && generate;
+    cutoffDate      = (int64_t)[aDate timeIntervalSince1970];
+    recordCount     = 0;
+    plays           = [NSMutableArray array];
+    depth           = 0;
+    sawTracksKey    = NO;
+    inTracks        = NO;
+    capturing       = NO;
+    currentField    = WOLibraryFieldNone;
+
+    NSXMLParser *parser = [[NSXMLParser alloc] initWithData:library];
+    [parser setDelegate:self];
+    [parser setShouldResolveExternalEntities:NO];
+    if (![parser parse] && [[parser parserError] code] != NSXMLParserDelegateAbortedParseError)
+    {
+        NSLog(@"warning: could not parse iTunes library at %@: %@", libraryPath, [parser parserError]);
+        return nil;
+    }
+    [parser setDelegate:nil];
+
+    NSSortDescriptor *byDate = [[NSSortDescriptor alloc] initWithKey:WO_PLAY_DATE_KEY ascending:YES];
+    [plays sortUsingDescriptors:[NSArray arrayWithObject:byDate]];
+    NSArray *result = plays;
+    plays = nil;
+    return result;
+}
+
+- (BOOL)commit
+{
+    qsort(records, recordCount, sizeof(WOLibraryWatermarkRecord), WOLibraryCompareRecords);
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(WOLibraryWatermarkHeader) +
+                           recordCount * sizeof(WOLibraryWatermarkRecord)];
+    WOLibraryWatermarkHeader *header = [data mutableBytes];
+    header->magic   = NSSwapHostIntToLittle(WO_WATERMARK_MAGIC);
+    header->version = NSSwapHostIntToLittle(WO_WATERMARK_VERSION);
+    header->date    = (int64_t)NSSwapHostLongLongToLittle((uint64_t)cutoffDate);
+    header->count   = NSSwapHostLongLongToLittle(recordCount);
+    WOLibraryWatermarkRecord *out = (WOLibraryWatermarkRecord *)(header + 1);
+    for (NSUInteger i = 0; i < recordCount; i++)
+    {
+        out[i].persistentID = NSSwapHostLongLongToLittle(records[i].persistentID);
+        out[i].playCount    = NSSwapHostIntToLittle(records[i].playCount);
+        out[i].reserved     = 0;
+    }
+
+    // written to a temporary file and renamed into place; a mapped copy of the previous watermark stays valid
+    if (![data writeToFile:watermarkPath atomically:YES])
+    {
+        NSLog(@"warning: could not write Audioscrobbler library watermark to %@", watermarkPath);
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+- (BOOL)loadPreviousWatermark
+{
+    previousWatermark = [NSData dataWithContentsOfMappedFile:watermarkPath];
+    if (!previousWatermark)
+        return NO;
+    const WOLibraryWatermarkHeader *header = [previousWatermark bytes];
+    NSUInteger length = [previousWatermark length];
+    if (length < sizeof(WOLibraryWatermarkHeader) ||
+        NSSwapLittleIntToHost(header->magic) != WO_WATERMARK_MAGIC ||
+        NSSwapLittleIntToHost(header->version) != WO_WATERMARK_VERSION ||
+        (length - sizeof(WOLibraryWatermarkHeader)) / sizeof(WOLibraryWatermarkRecord) <
+        NSSwapLittleLongLongToHost(header->count))
+    {
+        NSLog(@"warning: ignoring damaged Audioscrobbler library watermark at %@", watermarkPath);
+        previousWatermark = nil;
+        return NO;
+    }
+    previousDate = (int64_t)NSSwapLittleLongLongToHost((uint64_t)header->date);
+    return YES;
+}
+
+// binary search of the mapped watermark; returns NO for tracks added since it was written
+- (BOOL)previousPlayCount:(uint32_t *)count forPersistentID:(uint64_t)persistentID
+{
+    const WOLibraryWatermarkHeader *header = [previousWatermark bytes];
+    const WOLibraryWatermarkRecord *table = (const WOLibraryWatermarkRecord *)(header + 1);
+    NSUInteger low = 0, high = (NSUInteger)NSSwapLittleLongLongToHost(header->count);
+    while (low < high)
+    {
+        NSUInteger middle = low + (high - low) / 2;
+        uint64_t candidate = NSSwapLittleLongLongToHost(table[middle].persistentID);
+        if (candidate == persistentID)
+        {
+            *count = NSSwapLittleIntToHost(table[middle].playCount);
+            return YES;
+        }
+        if (candidate < persistentID)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return NO;
+}
+
+- (void)beginTrack
+{
+    trackName           = nil;
+    trackArtist         = nil;
+    trackAlbum          = nil;
+    trackTotalTime      = 0;
+    trackPlayCount      = 0;
+    trackPlayDate       = 0;
+    trackPersistentID   = 0;
+    trackIsFile         = NO;
+    trackIsPodcast      = NO;
+}
+
+- (void)endTrack
+{
+    if (!trackPersistentID)
+        return;
+
+    if (recordCount == recordCapacity)
+    {
+        NSUInteger capacity = recordCapacity ? recordCapacity * 2 : 4096;
+        WOLibraryWatermarkRecord *grown = realloc(records, capacity * sizeof(WOLibraryWatermarkRecord));
+        if (!grown)
+            return;
+        records = grown;
+        recordCapacity = capacity;
+    }
+    records[recordCount].persistentID   = trackPersistentID;
+    records[recordCount].playCount      = trackPlayCount;
+    records[recordCount].reserved       = 0;
+    recordCount++;
+
+    // "If a user is playing a stream instead of a regular file, do not submit that stream/song."
+    unsigned length = trackTotalTime / 1000;
+    if (!generatePlays || !trackName || !trackIsFile || trackIsPodcast || length < WO_IMPORT_MINIMUM_LENGTH ||
+        trackPlayDate <= previousDate || trackPlayDate > cutoffDate)
+        return;
+
+    uint32_t previousCount = 0;     // tracks added since the last scan count from zero
+    [self previousPlayCount:&previousCount forPersistentID:trackPersistentID];
+    if (trackPlayCount <= previousCount)
+        return;
+
+    // plays are assumed back to back, ending at the recorded play date, and may not start before the watermark
+    int64_t window = (trackPlayDate - previousDate) / length;
+    int64_t count = MIN(MIN((int64_t)(trackPlayCount - previousCount), window), (int64_t)WO_IMPORT_MAX_PLAYS_PER_TRACK);
+    NSNumber *lengthNumber = [NSNumber numberWithUnsignedInt:length];
+    for (int64_t i = 1; i <= count; i++)
+    {
+        NSDate *start = [NSDate dateWithTimeIntervalSince1970:(NSTimeInterval)(trackPlayDate - i * length)];
+        [plays addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+            trackName,                      WO_TRACK_KEY,
+            trackArtist ? trackArtist : @"", WO_ARTIST_KEY,
+            trackAlbum ? trackAlbum : @"",  WO_ALBUM_KEY,
+            lengthNumber,                   WO_LENGTH_KEY,
+            start,                          WO_PLAY_DATE_KEY, nil]];
+    }
+}
+
+#pragma mark -
+#pragma mark NSXMLParser delegate methods
+
+// the library is a property list: a root dictionary whose "Tracks" key holds a dictionary of track dictionaries
+- (void)parser:(NSXMLParser *)parser
+didStartElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI
+ qualifiedName:(NSString *)qualifiedName
+    attributes:(NSDictionary *)attributes
+{
+    if ([elementName isEqualToString:@"dict"])
+    {
+        depth++;
+        if (depth == 2 && sawTracksKey)
+            inTracks = YES;
+        else if (inTracks && depth == 3)
+            [self beginTrack];
+    }
+    else if ([elementName isEqualToString:@"key"])
+    {
+        // only the root dictionary's keys and the track dictionaries' keys are of interest (not the track IDs)
+        capturing = (depth == 1 || (inTracks && depth == 3));
+        [text setString:@""];
+    }
+    else if (inTracks && depth == 3 && currentField != WOLibraryFieldNone)
+    {
+        if ([elementName isEqualToString:@"true"])
+            trackIsPodcast = (currentField == WOLibraryFieldPodcast) ? YES : trackIsPodcast;
+        else
+        {
+            capturing = YES;
+            [text setString:@""];
+        }
+    }
+}
+
+- (void)parser:(NSXMLParser *)parser
+ didEndElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI
+ qualifiedName:(NSString *)qualifiedName
+{
+    if ([elementName isEqualToString:@"dict"])
+    {
+        if (inTracks && depth == 3)
+            [self endTrack];
+        else if (inTracks && depth == 2)
+        {
+            // all tracks seen: don't bother reading the playlists
+            inTracks = NO;
+            [parser abortParsing];
+        }
+        depth--;
+    }
+    else if ([elementName isEqualToString:@"key"])
+    {
+        if (depth == 1)
+            sawTracksKey = [text isEqualToString:@"Tracks"];
+        else if (capturing)
+            currentField = WOLibraryFieldForKey(text);
+        capturing = NO;
+    }
+    else if (inTracks && depth == 3)
+    {
+        if (capturing)
+        {
+            switch (currentField)
+            {
+                case WOLibraryFieldName:            trackName = [text copy];                            break;
+                case WOLibraryFieldArtist:          trackArtist = [text copy];                          break;
+                case WOLibraryFieldAlbum:           trackAlbum = [text copy];                           break;
+                case WOLibraryFieldTotalTime:       trackTotalTime = (unsigned)[text longLongValue];    break;
+                case WOLibraryFieldPlayCount:       trackPlayCount = (unsigned)[text longLongValue];    break;
+                case WOLibraryFieldPlayDateUTC:     trackPlayDate = WOLibraryParseDate(text);           break;
+                case WOLibraryFieldPersistentID:
+                    trackPersistentID = strtoull([text UTF8String], NULL, 16);
+                    break;
+                case WOLibraryFieldTrackType:       trackIsFile = [text isEqualToString:@"File"];       break;
+                default:                                                                                break;
+            }
+        }
+        capturing = NO;
+        currentField = WOLibraryFieldNone;
+    }
+}
+
+- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string
+{
+    if (capturing)
+        [text appendString:string];
+}
+
+@end
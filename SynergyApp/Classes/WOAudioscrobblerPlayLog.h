@@ -0,0 +1,64 @@
+//
+//  WOAudioscrobblerPlayLog.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class WOAudioscrobblerEngine, WOAudioscrobblerJournal;
+
+//! The plays waiting to be submitted, shared by every endpoint they are mirrored to.
+//!
+//! Plays are kept once, in sequence order, no matter how many endpoints there are. Each endpoint (a WOAudioscrobblerEngine
+//! with its own session, INTERVAL and back-off) reads from the log through its own cursor: the sequence number of the last
+//! play it has had accepted. A play is retired, from memory and from the journal, once every endpoint's cursor has passed
+//! it, so an endpoint that is slow or failing holds on to its backlog without ever blocking the others. Only an endpoint
+//! that has been told its user does not exist stops holding plays back; the backlog of any other is capped, and the oldest
+//! plays beyond the cap are retired (and logged) even though that endpoint never had them accepted.
+//!
+//! \warn Not threadsafe; should only be called from a single thread (most likely the main thread)
+@interface WOAudioscrobblerPlayLog : NSObject {
+
+    //! Unretired plays in sequence order, each tagged under WO_SEQUENCE_KEY
+    NSMutableArray              *plays;
+
+    //! Optional; when present it assigns sequence numbers and records cursors
+    WOAudioscrobblerJournal     *journal;
+
+    //! Sequence number for the next play when there is no journal
+    unsigned long long          nextSequence;
+
+    //! Registered endpoints, in registration order
+    NSMutableArray              *endpoints;
+
+    //! Highest sequence number accepted by every registered endpoint; everything up to here has been retired
+    unsigned long long          retiredSequence;
+}
+
+//! Restores the unacknowledged plays from \p aJournal (which may be nil for a purely in-memory log)
+- (id)initWithJournal:(WOAudioscrobblerJournal *)aJournal;
+
+//! Registers \p anEngine as a reader and returns the cursor it should start from; its endpoint identifier must be stable
+//! across launches
+- (unsigned long long)addEndpoint:(WOAudioscrobblerEngine *)anEngine;
+
+//! Tags \p play with the next sequence number, records it and tells every endpoint about it
+- (void)appendPlay:(NSDictionary *)play;
+
+//! Returns up to \p limit plays following \p cursor, oldest first
+- (NSArray *)playsAfterSequence:(unsigned long long)cursor limit:(unsigned)limit;
+
+- (unsigned)countOfPlaysAfterSequence:(unsigned long long)cursor;
+
+//! Records that \p anEngine has had every play up to and including \p sequence accepted, and retires whatever no endpoint
+//! needs any more
+- (void)acknowledgeSequence:(unsigned long long)sequence forEndpoint:(WOAudioscrobblerEngine *)anEngine;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(readonly) WOAudioscrobblerJournal *journal;
+
+@end
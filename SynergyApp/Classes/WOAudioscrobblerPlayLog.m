@@ -0,0 +1,157 @@
+// WOAudioscrobblerPlayLog.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerPlayLog.h"
+
+// other headers
+#import "WOAudioscrobblerEngine.h"
+#import "WOAudioscrobblerJournal.h"
+#import "WOAudioscrobblerLog.h"
+
+// WOPublic headers
+#import "WOPublic/WODebugMacros.h"
+
+//! Most plays kept waiting for a stalled endpoint; beyond this the oldest are retired whether or not every endpoint has
+//! had them accepted (a few months of listening)
+#define WO_PLAY_LOG_CAPACITY    10000
+
+@interface WOAudioscrobblerPlayLog ()
+
+- (NSUInteger)indexOfFirstPlayAfterSequence:(unsigned long long)cursor;
+- (void)retire;
+
+@end
+
+@implementation WOAudioscrobblerPlayLog
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)init
+{
+    return [self initWithJournal:nil];
+}
+
+- (id)initWithJournal:(WOAudioscrobblerJournal *)aJournal
+{
+    if ((self = [super init]))
+    {
+        self->journal       = aJournal;
+        self->plays         = aJournal ? [aJournal replay] : [NSMutableArray array];
+        self->endpoints     = [NSMutableArray array];
+        self->nextSequence  = 1;
+        self->retiredSequence = aJournal ? [aJournal acknowledgedSequence] : 0;
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (unsigned long long)addEndpoint:(WOAudioscrobblerEngine *)anEngine
+{
+    NSParameterAssert(anEngine != nil);
+    WOAssert(![endpoints containsObject:anEngine]);
+    [endpoints addObject:anEngine];
+    return self.journal ? [self.journal cursorForEndpoint:anEngine.handshakeURLBase] : retiredSequence;
+}
+
+- (void)appendPlay:(NSDictionary *)play
+{
+    NSParameterAssert(play != nil);
+    if (self.journal)
+        play = [self.journal appendPlay:play];
+    else
+    {
+        NSMutableDictionary *tagged = [play mutableCopy];
+        [tagged setObject:[NSNumber numberWithUnsignedLongLong:nextSequence++] forKey:WO_SEQUENCE_KEY];
+        play = tagged;
+    }
+    [plays addObject:play];
+    for (WOAudioscrobblerEngine *endpoint in endpoints)
+        [endpoint playLogDidAppendPlay:self];
+
+    // keeps the backlog of an endpoint that never answers within WO_PLAY_LOG_CAPACITY
+    [self retire];
+}
+
+- (NSArray *)playsAfterSequence:(unsigned long long)cursor limit:(unsigned)limit
+{
+    NSUInteger first = [self indexOfFirstPlayAfterSequence:cursor];
+    NSUInteger count = MIN((NSUInteger)limit, [plays count] - first);
+    return [plays subarrayWithRange:NSMakeRange(first, count)];
+}
+
+- (unsigned)countOfPlaysAfterSequence:(unsigned long long)cursor
+{
+    return (unsigned)([plays count] - [self indexOfFirstPlayAfterSequence:cursor]);
+}
+
+- (void)acknowledgeSequence:(unsigned long long)sequence forEndpoint:(WOAudioscrobblerEngine *)anEngine
+{
+    // a single endpoint needs no cursor of its own: the journal's acknowledgement watermark is its cursor
+    if ([endpoints count] > 1)
+        [self.journal recordCursor:sequence forEndpoint:anEngine.handshakeURLBase];
+    [self retire];
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// binary search; sequence numbers increase strictly along the array
+- (NSUInteger)indexOfFirstPlayAfterSequence:(unsigned long long)cursor
+{
+    NSUInteger low = 0, high = [plays count];
+    while (low < high)
+    {
+        NSUInteger middle = low + (high - low) / 2;
+        if ([[[plays objectAtIndex:middle] objectForKey:WO_SEQUENCE_KEY] unsignedLongLongValue] <= cursor)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+// drops the plays that every endpoint has had accepted; only a bad user, which never recovers, is left out (bad auth and
+// missing credentials are fixed by a fresh handshake or by the user). Whatever a stalled endpoint holds back beyond
+// WO_PLAY_LOG_CAPACITY is dropped too, oldest first.
+- (void)retire
+{
+    unsigned long long slowest = ULLONG_MAX;
+    for (WOAudioscrobblerEngine *endpoint in endpoints)
+        if (endpoint.currentState != WOAudioscrobblerBadUser)
+            slowest = MIN(slowest, endpoint.cursor);
+    NSUInteger count = 0;
+    if (slowest != ULLONG_MAX && slowest > retiredSequence)
+    {
+        retiredSequence = slowest;
+        count = [self indexOfFirstPlayAfterSequence:slowest];
+        if (count > 0)
+            WOAudioscrobblerLog(@"Retiring %d plays accepted by every endpoint", count);
+    }
+    if ([plays count] - count > WO_PLAY_LOG_CAPACITY)
+    {
+        NSUInteger excess = [plays count] - count - WO_PLAY_LOG_CAPACITY;
+        NSLog(@"Audioscrobbler play log is full (%d plays); dropping the %d oldest, which not every endpoint has accepted",
+              WO_PLAY_LOG_CAPACITY, excess);
+        count += excess;
+        retiredSequence = MAX(retiredSequence,
+                              [[[plays objectAtIndex:count - 1] objectForKey:WO_SEQUENCE_KEY] unsignedLongLongValue]);
+    }
+    if (count == 0)
+        return;
+    [self.journal acknowledgePlay:[plays objectAtIndex:count - 1]];
+    [plays removeObjectsInRange:NSMakeRange(0, count)];
+    [self.journal compactIfNeededWithQueue:plays];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize journal;
+
+@end
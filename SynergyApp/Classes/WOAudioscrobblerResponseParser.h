@@ -0,0 +1,85 @@
+//
+//  WOAudioscrobblerResponseParser.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+//! Longest line retained, in bytes (excluding the line terminator); anything beyond is discarded
+#define WO_REPLY_MAX_LINE       512
+
+//! Number of leading non-blank lines retained (status, challenge and submission URL)
+#define WO_REPLY_KEPT_LINES     3
+
+typedef enum {
+
+    WOAudioscrobblerReplyNone,                      //!< No non-blank line seen yet
+    WOAudioscrobblerReplyOK,
+    WOAudioscrobblerReplyFailed,
+    WOAudioscrobblerReplyBadAuth,
+    WOAudioscrobblerReplyUpToDate,
+    WOAudioscrobblerReplyUpdate,
+    WOAudioscrobblerReplyBadUser,
+    WOAudioscrobblerReplyUnrecognized
+
+} WOAudioscrobblerReplyStatus;
+
+//! Tokenizes Audioscrobbler replies as they arrive from the transport.
+//!
+//! Bytes are fed in whatever chunks the transport delivers; they are written straight into fixed line buffers and each
+//! line is classified on its terminator by comparing raw bytes against the reply keywords. INTERVAL values are parsed
+//! from the digits in place. Blank lines are skipped and a trailing carriage return is ignored. Only the first few lines
+//! are kept (the handshake needs its second and third); strings are created only when asked for, so the work per reply
+//! is bounded by its length and allocates nothing.
+//!
+//! \warn Not threadsafe; should only be used by the engine that owns it
+@interface WOAudioscrobblerResponseParser : NSObject {
+
+    WOAudioscrobblerReplyStatus status;
+
+    //! Non-blank lines completed so far
+    unsigned                    lineCount;
+
+    //! The first WO_REPLY_KEPT_LINES non-blank lines
+    uint8_t                     lines[WO_REPLY_KEPT_LINES][WO_REPLY_MAX_LINE];
+    unsigned                    lineLengths[WO_REPLY_KEPT_LINES];
+
+    //! Later lines only ever need to be checked for INTERVAL, so they share a single scratch buffer
+    uint8_t                     scratch[WO_REPLY_MAX_LINE];
+    unsigned                    scratchLength;
+
+    //! Length of the keyword on the status line; the argument (if any) follows it
+    unsigned                    keywordLength;
+
+    //! Latest INTERVAL value received (0 if none)
+    unsigned                    interval;
+
+    //! YES if an INTERVAL line could not be parsed
+    BOOL                        sawInvalidInterval;
+}
+
+//! Prepares to parse a new reply
+- (void)reset;
+
+- (void)parseBytes:(const void *)bytes length:(NSUInteger)length;
+
+//! Completes the final line if the reply did not end with a line terminator
+- (void)finish;
+
+//! Returns the non-blank line at \p index as a string, or nil if \p index is not one of the retained lines
+- (NSString *)lineAtIndex:(unsigned)index;
+
+//! Returns the text following the keyword on the status line (for example, the reason after FAILED), or nil if empty
+- (NSString *)argument;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(readonly) WOAudioscrobblerReplyStatus status;
+@property(readonly) unsigned                    lineCount;
+@property(readonly) unsigned                    interval;
+@property(readonly) BOOL                        sawInvalidInterval;
+
+@end
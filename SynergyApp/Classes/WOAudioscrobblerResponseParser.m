@@ -0,0 +1,171 @@
+// WOAudioscrobblerResponseParser.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerResponseParser.h"
+
+typedef struct WOReplyKeyword {
+    const char                  *bytes;
+    unsigned                    length;
+    WOAudioscrobblerReplyStatus status;
+} WOReplyKeyword;
+
+//! Status line keywords, matched as prefixes; no keyword is a prefix of another so the order does not matter
+static const WOReplyKeyword WOReplyKeywords[] = {
+    { "OK",         2, WOAudioscrobblerReplyOK          },
+    { "FAILED",     6, WOAudioscrobblerReplyFailed      },
+    { "BADAUTH",    7, WOAudioscrobblerReplyBadAuth     },
+    { "UPTODATE",   8, WOAudioscrobblerReplyUpToDate    },
+    { "UPDATE",     6, WOAudioscrobblerReplyUpdate      },
+    { "BADUSER",    7, WOAudioscrobblerReplyBadUser     }
+};
+
+#define WO_INTERVAL_KEYWORD         "INTERVAL"
+#define WO_INTERVAL_KEYWORD_LENGTH  8
+
+@interface WOAudioscrobblerResponseParser ()
+
+- (void)completeLine:(const uint8_t *)line length:(unsigned)length;
+
+@end
+
+@implementation WOAudioscrobblerResponseParser
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)reset
+{
+    status              = WOAudioscrobblerReplyNone;
+    lineCount           = 0;
+    lineLengths[0]      = 0;
+    scratchLength       = 0;
+    keywordLength       = 0;
+    interval            = 0;
+    sawInvalidInterval  = NO;
+}
+
+- (void)parseBytes:(const void *)bytes length:(NSUInteger)length
+{
+    const uint8_t *cursor = bytes;
+    const uint8_t *end = cursor + length;
+    while (cursor < end)
+    {
+        // the line in progress goes directly into its final resting place
+        BOOL kept = (lineCount < WO_REPLY_KEPT_LINES);
+        uint8_t *line = kept ? lines[lineCount] : scratch;
+        unsigned *used = kept ? &lineLengths[lineCount] : &scratchLength;
+
+        const uint8_t *newline = memchr(cursor, '\n', end - cursor);
+        const uint8_t *stop = newline ? newline : end;
+        NSUInteger available = WO_REPLY_MAX_LINE - *used;
+        NSUInteger count = MIN((NSUInteger)(stop - cursor), available);
+        memcpy(line + *used, cursor, count);
+        *used += count;
+        if (!newline)
+            break;
+        cursor = newline + 1;
+        [self completeLine:line length:*used];  // advances to a fresh buffer for kept lines
+        if (!kept)
+            scratchLength = 0;
+    }
+}
+
+- (void)finish
+{
+    if (lineCount < WO_REPLY_KEPT_LINES)
+    {
+        if (lineLengths[lineCount] > 0)
+            [self completeLine:lines[lineCount] length:lineLengths[lineCount]];
+    }
+    else if (scratchLength > 0)
+        [self completeLine:scratch length:scratchLength];
+    scratchLength = 0;
+}
+
+// called once per line terminator with the line just completed
+- (void)completeLine:(const uint8_t *)line length:(unsigned)length
+{
+    if (length > 0 && line[length - 1] == '\r')
+        length--;
+    if (length == 0)
+    {
+        // blank lines are not counted; the next line reuses the same buffer
+        if (lineCount < WO_REPLY_KEPT_LINES)
+            lineLengths[lineCount] = 0;
+        return;
+    }
+
+    if (lineCount < WO_REPLY_KEPT_LINES)
+        lineLengths[lineCount] = length;    // trailing carriage return dropped
+
+    // "INTERVAL commands can be at the end of any response block, but don't expect them to be. Always observe the latest INTERVAL you get."
+    if (length >= WO_INTERVAL_KEYWORD_LENGTH && memcmp(line, WO_INTERVAL_KEYWORD, WO_INTERVAL_KEYWORD_LENGTH) == 0)
+    {
+        unsigned i = WO_INTERVAL_KEYWORD_LENGTH;
+        while (i < length && line[i] == ' ')
+            i++;
+        unsigned value = 0;
+        BOOL valid = (i < length);
+        for (; i < length; i++)
+        {
+            if (line[i] < '0' || line[i] > '9' || value > (UINT_MAX - 9) / 10)
+            {
+                valid = NO;
+                break;
+            }
+            value = value * 10 + (line[i] - '0');
+        }
+        if (valid && value > 0)
+            interval = value;
+        else
+            sawInvalidInterval = YES;
+    }
+
+    if (lineCount == 0)
+    {
+        status = WOAudioscrobblerReplyUnrecognized;
+        for (unsigned i = 0; i < sizeof(WOReplyKeywords) / sizeof(WOReplyKeywords[0]); i++)
+        {
+            const WOReplyKeyword *keyword = &WOReplyKeywords[i];
+            if (length >= keyword->length && memcmp(line, keyword->bytes, keyword->length) == 0)
+            {
+                status = keyword->status;
+                keywordLength = keyword->length;
+                break;
+            }
+        }
+    }
+
+    lineCount++;
+    if (lineCount < WO_REPLY_KEPT_LINES)
+        lineLengths[lineCount] = 0;
+}
+
+- (NSString *)lineAtIndex:(unsigned)index
+{
+    if (index >= MIN(lineCount, (unsigned)WO_REPLY_KEPT_LINES))
+        return nil;
+    return [[NSString alloc] initWithBytes:lines[index] length:lineLengths[index] encoding:NSUTF8StringEncoding];
+}
+
+- (NSString *)argument
+{
+    if (lineCount == 0 || lineLengths[0] <= keywordLength)
+        return nil;
+    return [[NSString alloc] initWithBytes:lines[0] + keywordLength
+                                    length:lineLengths[0] - keywordLength
+                                  encoding:NSUTF8StringEncoding];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize status;
+@synthesize lineCount;
+@synthesize interval;
+@synthesize sawInvalidInterval;
+
+@end
@@ -0,0 +1,65 @@
+//
+//  WOAudioscrobblerScheduler.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+#import "WOAudioscrobblerEngine.h"
+
+//! Single home for all deferred Audioscrobbler work (next submissions, retries and re-handshakes).
+//!
+//! Jobs are bucketed by whole-second deadline into a fixed-size timer wheel. Only one wake-up is ever outstanding with
+//! the underlying WOAudioscrobblerClock: it is armed for the earliest deadline. When it fires, due jobs run in deadline
+//! order, with ties broken by the order in which they were scheduled. Time only advances through the clock, so a
+//! simulated clock can replay a day of scheduling in a few milliseconds with identical results every run.
+//!
+//! \warn Not threadsafe; should only be called from the thread the clock delivers on (most likely the main thread)
+@interface WOAudioscrobblerScheduler : NSObject {
+
+    id <WOAudioscrobblerClock>  clock;
+
+    //! One NSMutableArray of pending jobs per slot; a job lives in slot (deadline tick % slot count)
+    NSMutableArray              *slots;
+
+    //! Total number of pending jobs across all slots
+    unsigned                    pendingCount;
+
+    //! Tie-breaker giving jobs with equal deadlines first-in, first-out order
+    unsigned long long          nextSerial;
+
+    //! Last whole-second tick whose jobs have been run
+    long long                   lastTick;
+
+    //! YES while a clock wake-up is outstanding
+    BOOL                        armed;
+
+    //! Tick the outstanding clock wake-up is for
+    long long                   armedTick;
+
+    //! Jobs being run by the current fireDueJobs pass (nil outside of a pass)
+    NSArray                     *firing;
+}
+
+- (id)initWithClock:(id <WOAudioscrobblerClock>)aClock;
+
+//! Sends \p aSelector (with a nil argument) to \p aTarget once at least \p delay seconds have elapsed, rounded up to the
+//! next whole second
+- (void)scheduleSelector:(SEL)aSelector target:(id)aTarget afterDelay:(NSTimeInterval)delay;
+
+//! Returns YES if \p aSelector is already pending for \p aTarget
+- (BOOL)isSelectorScheduled:(SEL)aSelector target:(id)aTarget;
+
+//! Returns the seconds remaining until \p aSelector is due for \p aTarget, or a negative value if it is not pending
+- (NSTimeInterval)delayUntilSelector:(SEL)aSelector target:(id)aTarget;
+
+- (void)cancelSelector:(SEL)aSelector target:(id)aTarget;
+
+- (void)cancelAllForTarget:(id)aTarget;
+
+//! Runs every job that is due according to the clock; normally invoked by the clock wake-up, but may be called directly
+//! after moving a simulated clock
+- (void)fireDueJobs;
+
+@end
@@ -0,0 +1,211 @@
+// WOAudioscrobblerScheduler.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerScheduler.h"
+
+//! Number of one-second slots in the wheel; jobs further out than this simply wait for a later revolution
+#define WO_SCHEDULER_SLOT_COUNT     64
+
+@interface WOAudioscrobblerSchedulerJob : NSObject {
+
+@public
+    id                  target;
+    SEL                 selector;
+    long long           tick;
+    unsigned long long  serial;
+}
+
+@end
+
+@implementation WOAudioscrobblerSchedulerJob
+
+- (NSComparisonResult)compareDeadline:(WOAudioscrobblerSchedulerJob *)other
+{
+    if (tick != other->tick)
+        return tick < other->tick ? NSOrderedAscending : NSOrderedDescending;
+    if (serial != other->serial)
+        return serial < other->serial ? NSOrderedAscending : NSOrderedDescending;
+    return NSOrderedSame;
+}
+
+@end
+
+@interface WOAudioscrobblerScheduler ()
+
+- (NSTimeInterval)now;
+- (NSMutableArray *)slotForTick:(long long)tick;
+- (WOAudioscrobblerSchedulerJob *)jobForSelector:(SEL)aSelector target:(id)aTarget;
+- (void)rearm;
+
+@end
+
+@implementation WOAudioscrobblerScheduler
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithClock:(id <WOAudioscrobblerClock>)aClock
+{
+    NSParameterAssert(aClock != nil);
+    if ((self = [super init]))
+    {
+        self->clock = aClock;
+        self->slots = [NSMutableArray arrayWithCapacity:WO_SCHEDULER_SLOT_COUNT];
+        for (unsigned i = 0; i < WO_SCHEDULER_SLOT_COUNT; i++)
+            [self->slots addObject:[NSMutableArray array]];
+        self->lastTick = (long long)floor([self now]);
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)scheduleSelector:(SEL)aSelector target:(id)aTarget afterDelay:(NSTimeInterval)delay
+{
+    NSParameterAssert(aTarget != nil);
+    WOAudioscrobblerSchedulerJob *job = [[WOAudioscrobblerSchedulerJob alloc] init];
+    job->target     = aTarget;
+    job->selector   = aSelector;
+
+    // never schedule into a tick that has already been run, otherwise the job would wait a whole revolution
+    job->tick       = MAX((long long)ceil([self now] + MAX(delay, 0.0)), lastTick + 1);
+    job->serial     = nextSerial++;
+    [[self slotForTick:job->tick] addObject:job];
+    pendingCount++;
+    [self rearm];
+}
+
+- (BOOL)isSelectorScheduled:(SEL)aSelector target:(id)aTarget
+{
+    return [self jobForSelector:aSelector target:aTarget] ? YES : NO;
+}
+
+- (NSTimeInterval)delayUntilSelector:(SEL)aSelector target:(id)aTarget
+{
+    WOAudioscrobblerSchedulerJob *job = [self jobForSelector:aSelector target:aTarget];
+    return job ? MAX((NSTimeInterval)job->tick - [self now], 0.0) : -1.0;
+}
+
+- (void)cancelSelector:(SEL)aSelector target:(id)aTarget
+{
+    for (NSMutableArray *slot in slots)
+    {
+        for (NSInteger i = (NSInteger)[slot count] - 1; i >= 0; i--)
+        {
+            WOAudioscrobblerSchedulerJob *job = [slot objectAtIndex:i];
+            if (job->target == aTarget && (!aSelector || job->selector == aSelector))
+            {
+                [slot removeObjectAtIndex:i];
+                pendingCount--;
+            }
+        }
+    }
+
+    // a running job may cancel others that are due in the same pass (finalizeSession does); disarm them too
+    for (WOAudioscrobblerSchedulerJob *job in firing)
+        if (job->target == aTarget && (!aSelector || job->selector == aSelector))
+            job->target = nil;
+    [self rearm];
+}
+
+- (void)cancelAllForTarget:(id)aTarget
+{
+    [self cancelSelector:NULL target:aTarget];
+}
+
+- (void)fireDueJobs
+{
+    long long nowTick = (long long)floor([self now]);
+    if (nowTick <= lastTick)
+    {
+        [self rearm];
+        return;
+    }
+
+    // only the slots for elapsed ticks can hold due jobs, unless a whole revolution (or more) has elapsed
+    NSMutableArray *due = [NSMutableArray array];
+    long long first = lastTick + 1;
+    long long last = MIN(nowTick, first + WO_SCHEDULER_SLOT_COUNT - 1);
+    for (long long tick = first; tick <= last; tick++)
+    {
+        NSMutableArray *slot = [self slotForTick:tick];
+        for (NSInteger i = (NSInteger)[slot count] - 1; i >= 0; i--)
+        {
+            WOAudioscrobblerSchedulerJob *job = [slot objectAtIndex:i];
+            if (job->tick <= nowTick)
+            {
+                [due addObject:job];
+                [slot removeObjectAtIndex:i];
+            }
+        }
+    }
+    lastTick = nowTick;
+    pendingCount -= [due count];
+    [due sortUsingSelector:@selector(compareDeadline:)];
+
+    firing = due;
+    for (WOAudioscrobblerSchedulerJob *job in due)
+        if (job->target)    // nil if cancelled by an earlier job in this pass
+            [job->target performSelector:job->selector withObject:nil];
+    firing = nil;
+    [self rearm];
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+- (NSTimeInterval)now
+{
+    return [[clock currentDate] timeIntervalSinceReferenceDate];
+}
+
+- (NSMutableArray *)slotForTick:(long long)tick
+{
+    long long index = tick % WO_SCHEDULER_SLOT_COUNT;
+    if (index < 0)
+        index += WO_SCHEDULER_SLOT_COUNT;
+    return [slots objectAtIndex:(NSUInteger)index];
+}
+
+- (WOAudioscrobblerSchedulerJob *)jobForSelector:(SEL)aSelector target:(id)aTarget
+{
+    for (NSMutableArray *slot in slots)
+        for (WOAudioscrobblerSchedulerJob *job in slot)
+            if (job->target == aTarget && job->selector == aSelector)
+                return job;
+    return nil;
+}
+
+// keeps exactly one clock wake-up outstanding, for the earliest pending tick
+- (void)rearm
+{
+    long long earliest = LLONG_MAX;
+    if (pendingCount > 0)
+        for (NSMutableArray *slot in slots)
+            for (WOAudioscrobblerSchedulerJob *job in slot)
+                earliest = MIN(earliest, job->tick);
+    if (armed && earliest == armedTick)
+        return;
+    if (armed)
+    {
+        [clock cancelScheduledSelectorsForTarget:self];
+        armed = NO;
+    }
+    if (earliest == LLONG_MAX)
+        return;
+    armed = YES;
+    armedTick = earliest;
+    [clock scheduleSelector:@selector(wake:) target:self afterDelay:MAX((NSTimeInterval)earliest - [self now], 0.0)];
+}
+
+- (void)wake:(id)ignored
+{
+    armed = NO;
+    [self fireDueJobs];
+}
+
+@end
@@ -0,0 +1,111 @@
+//
+//  WOCoverBackfill.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class WOCoverStore;
+
+//! Fetches covers for every album in the iTunes library ahead of time, so that they are already on disk when the albums
+//! are played.
+//!
+//! A low-priority thread streams the library XML file (stopping once the "Tracks" dictionary ends) and gathers each
+//! distinct artist and album pair, skipping podcasts, albums the store already has a cover for or a recent miss on, and
+//! albums the job has already tried. The rest are handed to WOCoverDownloader one at a time, at no more than one every
+//! minute (the "CoverBackfillRequestsPerSecond" default overrides this); the downloader only takes them when it has
+//! nothing else to do, and the overall cap on cover requests still applies, so lookups for the track being played are
+//! never held up by more than one backfill request.
+//!
+//! Each album tried is appended to a log ("Cover Backfill Log", next to the index) as a 12-byte record, so a pass that
+//! is interrupted (by quitting, losing the network or turning off cover downloads) resumes where it left off; albums are
+//! tried again 30 days after they were last tried. Once a pass has finished the library is not scanned again until the
+//! file changes. The job also stops while the covers on disk take up more than 80% of the collector's quota, so that
+//! covers nobody has looked at yet do not push out ones that have been shown.
+//!
+//! Progress (albums remaining, throughput and an estimate of the time left) is available through the properties and is
+//! logged every so often while a pass is running.
+//!
+//! \warn Threadsafe
+@interface WOCoverBackfill : NSObject {
+
+    WOCoverStore        *store;
+
+    NSString            *libraryPath;
+
+    NSString            *logPath;
+
+    //! Albums per second handed to the downloader
+    double              requestsPerSecond;
+
+    //! Last attempt (seconds since 1970, NSNumber) keyed by cover key (NSNumber); backfill thread only
+    NSMutableDictionary *attemptTimes;
+
+    //! Number of records in the log file; backfill thread only
+    NSUInteger          logCount;
+
+    //! Modification date of the library file as of the last complete pass; backfill thread only
+    NSDate              *completedLibraryDate;
+
+    BOOL                started;
+
+    //! \name Progress
+    //! Guarded by \c @synchronized(self)
+    //! \startgroup
+
+    NSUInteger          remainingCount;
+    NSUInteger          completedCount;
+    NSTimeInterval      passStarted;
+
+    //! \endgroup
+
+    //! \name Parser state
+    //! \startgroup
+
+    unsigned            depth;
+    BOOL                sawTracksKey;
+    BOOL                inTracks;
+    BOOL                capturing;
+    NSMutableString     *text;
+    int                 currentField;
+
+    NSString            *trackArtist;
+    NSString            *trackAlbum;
+    BOOL                trackIsPodcast;
+
+    //! Keys (NSNumber) of the albums seen so far
+    NSMutableSet        *seenKeys;
+
+    //! Sorted keys of the covers in the store when the scan started
+    NSData              *coveredKeys;
+
+    //! Albums still to be tried (WOSongInfo), in library order
+    NSMutableArray      *pending;
+
+    //! \endgroup
+}
+
+//! Replays the log at \p aLogPath (which need not exist yet)
+- (id)initWithStore:(WOCoverStore *)aStore libraryPath:(NSString *)aLibraryPath logPath:(NSString *)aLogPath;
+
+//! Starts the backfill thread, which waits a few minutes before its first pass; further calls do nothing
+- (void)start;
+
+#pragma mark -
+#pragma mark Properties
+
+//! Albums the current pass has still to try (0 when no pass is running)
+@property(readonly) NSUInteger remainingCount;
+
+//! Albums the current pass has tried so far
+@property(readonly) NSUInteger completedCount;
+
+//! Albums tried per hour over the current pass (0 until the first has been tried)
+@property(readonly) double throughput;
+
+//! Seconds the current pass is expected to take to finish (0 when no pass is running)
+@property(readonly) NSTimeInterval estimatedTimeRemaining;
+
+@end
@@ -0,0 +1,495 @@
+// WOCoverBackfill.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOCoverBackfill.h"
+
+// system headers
+#import <stdio.h>
+#import <stdlib.h>
+#import <time.h>
+
+// other headers
+#import "SynergyController.h"
+#import "WOCoverCollector.h"
+#import "WOCoverDownloader.h"
+#import "WOCoverStore.h"
+#import "WOSongInfo.h"
+
+//! Default number of albums handed to the downloader per second (one a minute); can be overridden with the
+//! "CoverBackfillRequestsPerSecond" default
+#define WO_COVER_BACKFILL_REQUESTS_PER_SECOND   (double)(1.0 / 60.0)
+
+//! Delay (seconds) before the first pass after launch, so as not to compete with start-up
+#define WO_COVER_BACKFILL_DELAY                 (NSTimeInterval)(60.0 * 5)
+
+//! Delay (seconds) before checking whether the library has changed since the last complete pass
+#define WO_COVER_BACKFILL_RESCAN_INTERVAL       (NSTimeInterval)(60.0 * 60 * 24)
+
+//! Delay (seconds) before resuming a pass that had to stop (no network, cover downloads turned off, disk near quota)
+#define WO_COVER_BACKFILL_RETRY_INTERVAL        (NSTimeInterval)(60.0 * 30)
+
+//! How long (seconds) an album may wait in the downloader's queue before the pass gives up and retries later
+#define WO_COVER_BACKFILL_ITEM_TIMEOUT          (NSTimeInterval)(60.0 * 10)
+
+//! Albums are tried again this long (seconds) after they were last tried; the same as a miss in the downloader
+#define WO_COVER_BACKFILL_RETRY_AGE             (uint32_t)(60 * 60 * 24 * 30)
+
+//! Usage is checked against the quota (and progress logged) every this many albums
+#define WO_COVER_BACKFILL_BATCH                 16
+
+//! The pass stops once usage is above this fraction of the collector's quota (which evicts down to 90%)
+#define WO_COVER_BACKFILL_HIGH_WATER            0.8
+
+// one log record, stored little-endian
+typedef struct WOCoverBackfillAttempt {
+    uint64_t    key;
+    uint32_t    time;
+} __attribute__((packed)) WOCoverBackfillAttempt;
+
+//! Track dictionary keys of interest
+enum {
+    WOBackfillFieldNone,
+    WOBackfillFieldArtist,
+    WOBackfillFieldAlbum,
+    WOBackfillFieldPodcast
+};
+
+static int WOBackfillFieldForKey(NSString *key)
+{
+    if ([key isEqualToString:@"Artist"])    return WOBackfillFieldArtist;
+    if ([key isEqualToString:@"Album"])     return WOBackfillFieldAlbum;
+    if ([key isEqualToString:@"Podcast"])   return WOBackfillFieldPodcast;
+    return WOBackfillFieldNone;
+}
+
+static int WOBackfillCompareKeys(const void *a, const void *b)
+{
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+    return (left < right) ? -1 : (left > right);
+}
+
+@interface WOCoverBackfill ()
+
+- (void)backfill:(id)ignored;
+- (NSTimeInterval)runPass;
+- (NSArray *)scanLibrary;
+- (BOOL)nearQuota;
+- (void)recordAttemptForKey:(uint64_t)key;
+- (void)compactLogIfNeeded;
+- (void)logProgress;
+- (void)beginTrack;
+- (void)endTrack;
+
+@end
+
+@implementation WOCoverBackfill
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithStore:(WOCoverStore *)aStore libraryPath:(NSString *)aLibraryPath logPath:(NSString *)aLogPath
+{
+    NSParameterAssert(aStore != nil);
+    NSParameterAssert(aLibraryPath != nil);
+    NSParameterAssert(aLogPath != nil);
+    if ((self = [super init]))
+    {
+        self->store             = aStore;
+        self->libraryPath       = [aLibraryPath copy];
+        self->logPath           = [aLogPath copy];
+        self->requestsPerSecond = WO_COVER_BACKFILL_REQUESTS_PER_SECOND;
+        self->attemptTimes      = [NSMutableDictionary dictionary];
+        self->text              = [NSMutableString string];
+
+        NSNumber *rate = NSMakeCollectable(CFPreferencesCopyAppValue(CFSTR("CoverBackfillRequestsPerSecond"),
+                                                                     CFSTR("org.wincent.Synergy")));
+        if ([rate isKindOfClass:[NSNumber class]] && [rate doubleValue] > 0.0)
+            requestsPerSecond = [rate doubleValue];
+
+        // later records supersede earlier ones
+        NSData *log = [NSData dataWithContentsOfMappedFile:logPath];
+        const WOCoverBackfillAttempt *records = [log bytes];
+        logCount = [log length] / sizeof(WOCoverBackfillAttempt);
+        for (NSUInteger i = 0; i < logCount; i++)
+            [attemptTimes setObject:[NSNumber numberWithUnsignedInt:NSSwapLittleIntToHost(records[i].time)]
+                             forKey:[NSNumber numberWithUnsignedLongLong:NSSwapLittleLongLongToHost(records[i].key)]];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)start
+{
+    @synchronized (self)
+    {
+        if (!started)
+        {
+            [NSThread detachNewThreadSelector:@selector(backfill:) toTarget:self withObject:nil];
+            started = YES;
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// body of the backfill thread
+- (void)backfill:(id)ignored
+{
+    [NSThread setThreadPriority:0.1];
+    NSTimeInterval delay = WO_COVER_BACKFILL_DELAY;
+    for (;;)
+    {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        [NSThread sleepForTimeInterval:delay];
+        delay = [self runPass];
+        @synchronized (self)
+        {
+            remainingCount = 0;
+        }
+        [pool drain];
+    }
+}
+
+// returns the delay before the next pass; backfill thread only
+- (NSTimeInterval)runPass
+{
+    if (![[SynergyController sharedInstance] hitAmazon])
+        return WO_COVER_BACKFILL_RETRY_INTERVAL;
+
+    NSDate *libraryDate = [[[NSFileManager defaultManager] attributesOfItemAtPath:libraryPath error:NULL]
+                           fileModificationDate];
+    if (!libraryDate)
+        return WO_COVER_BACKFILL_RESCAN_INTERVAL;   // no library (yet)
+    if ([libraryDate isEqualToDate:completedLibraryDate])
+        return WO_COVER_BACKFILL_RESCAN_INTERVAL;
+    if ([self nearQuota])
+        return WO_COVER_BACKFILL_RETRY_INTERVAL;
+
+    NSArray *albums = [self scanLibrary];
+    if (!albums)
+        return WO_COVER_BACKFILL_RETRY_INTERVAL;
+    @synchronized (self)
+    {
+        remainingCount  = [albums count];
+        completedCount  = 0;
+        passStarted     = [NSDate timeIntervalSinceReferenceDate];
+    }
+    if ([albums count] > 0)
+        NSLog(@"Fetching album covers for %u albums in the iTunes library", (unsigned)[albums count]);
+
+    NSTimeInterval interval = 1.0 / requestsPerSecond;
+    NSTimeInterval nextRequest = 0.0;
+    NSUInteger tried = 0;
+    for (WOSongInfo *song in albums)
+    {
+        NSTimeInterval wait = nextRequest - [NSDate timeIntervalSinceReferenceDate];
+        if (wait > 0.0)
+            [NSThread sleepForTimeInterval:wait];
+        if (![[SynergyController sharedInstance] hitAmazon] ||
+            (tried > 0 && tried % WO_COVER_BACKFILL_BATCH == 0 && [self nearQuota]))
+            return WO_COVER_BACKFILL_RETRY_INTERVAL;
+
+        nextRequest = [NSDate timeIntervalSinceReferenceDate] + interval;
+        NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:WO_COVER_BACKFILL_ITEM_TIMEOUT];
+        if (![WOCoverDownloader backfillCover:song beforeDate:limit])
+        {
+            // no network connection (or none that reaches the server); pick up from
+            // here next time without recording an attempt
+            NSLog(@"warning: album cover backfill stalled; will try again in %.0f minutes",
+                  WO_COVER_BACKFILL_RETRY_INTERVAL / 60.0);
+            return WO_COVER_BACKFILL_RETRY_INTERVAL;
+        }
+        [self recordAttemptForKey:[song coverKey]];
+        tried++;
+        @synchronized (self)
+        {
+            remainingCount--;
+            completedCount++;
+        }
+        if (tried % WO_COVER_BACKFILL_BATCH == 0)
+            [self logProgress];
+    }
+
+    if (tried > 0)
+        NSLog(@"Finished fetching album covers for the iTunes library (%u albums)", (unsigned)tried);
+    [self compactLogIfNeeded];
+    completedLibraryDate = libraryDate;
+    return WO_COVER_BACKFILL_RESCAN_INTERVAL;
+}
+
+// returns the albums still to be tried, or nil if the library could not be read; backfill thread only
+- (NSArray *)scanLibrary
+{
+    // mapped rather than read: pages are faulted in as the parser advances and can be dropped again behind it
+    NSData *library = [NSData dataWithContentsOfMappedFile:libraryPath];
+    if (!library)
+    {
+        NSLog(@"warning: could not read iTunes library at %@", libraryPath);
+        return nil;
+    }
+
+    // a sorted snapshot of the covered keys rather than lookupKey:, which would count as using every cover
+    NSData *records = [store coverRecords];
+    const WOCoverRecord *covers = [records bytes];
+    NSUInteger coverCount = [records length] / sizeof(WOCoverRecord);
+    NSMutableData *keys = [NSMutableData dataWithLength:coverCount * sizeof(uint64_t)];
+    uint64_t *keyBytes = [keys mutableBytes];
+    for (NSUInteger i = 0; i < coverCount; i++)
+        keyBytes[i] = covers[i].key;
+    qsort(keyBytes, coverCount, sizeof(uint64_t), WOBackfillCompareKeys);
+
+    coveredKeys     = keys;
+    seenKeys        = [NSMutableSet set];
+    pending         = [NSMutableArray array];
+    depth           = 0;
+    sawTracksKey    = NO;
+    inTracks        = NO;
+    capturing       = NO;
+    currentField    = WOBackfillFieldNone;
+
+    NSXMLParser *parser = [[NSXMLParser alloc] initWithData:library];
+    [parser setDelegate:self];
+    [parser setShouldResolveExternalEntities:NO];
+    BOOL parsed = ([parser parse] || [[parser parserError] code] == NSXMLParserDelegateAbortedParseError);
+    if (!parsed)
+        NSLog(@"warning: could not parse iTunes library at %@: %@", libraryPath, [parser parserError]);
+    [parser setDelegate:nil];
+
+    NSArray *result = parsed ? pending : nil;
+    coveredKeys = nil;
+    seenKeys    = nil;
+    pending     = nil;
+    return result;
+}
+
+// YES if the covers on disk already take up most of the collector's quota
+- (BOOL)nearQuota
+{
+    unsigned long long quota = [[store collector] quota];
+    if (quota == 0)
+        return NO;
+    NSData *records = [store coverRecords];
+    const WOCoverRecord *covers = [records bytes];
+    NSUInteger count = [records length] / sizeof(WOCoverRecord);
+    unsigned long long used = 0;
+    for (NSUInteger i = 0; i < count; i++)
+        used += covers[i].bytes;
+    return used > (unsigned long long)(quota * WO_COVER_BACKFILL_HIGH_WATER);
+}
+
+// appends a record to the log; backfill thread only
+- (void)recordAttemptForKey:(uint64_t)key
+{
+    uint32_t now = (uint32_t)time(NULL);
+    [attemptTimes setObject:[NSNumber numberWithUnsignedInt:now] forKey:[NSNumber numberWithUnsignedLongLong:key]];
+    WOCoverBackfillAttempt attempt = { NSSwapHostLongLongToLittle(key), NSSwapHostIntToLittle(now) };
+    FILE *file = fopen([logPath fileSystemRepresentation], "ab");
+    if (!file || fwrite(&attempt, sizeof(attempt), 1, file) != 1)
+        NSLog(@"warning: could not append to album cover backfill log at %@", logPath);
+    else
+        logCount++;
+    if (file)
+        fclose(file);
+}
+
+// rewrites the log with one record per album once superseded records dominate; backfill thread only
+- (void)compactLogIfNeeded
+{
+    if (logCount <= [attemptTimes count] * 2)
+        return;
+    NSMutableData *log = [NSMutableData dataWithCapacity:[attemptTimes count] * sizeof(WOCoverBackfillAttempt)];
+    for (NSNumber *key in attemptTimes)
+    {
+        WOCoverBackfillAttempt attempt = {
+            NSSwapHostLongLongToLittle([key unsignedLongLongValue]),
+            NSSwapHostIntToLittle([[attemptTimes objectForKey:key] unsignedIntValue])
+        };
+        [log appendBytes:&attempt length:sizeof(attempt)];
+    }
+    if ([log writeToFile:logPath atomically:YES])
+        logCount = [attemptTimes count];
+    else
+        NSLog(@"warning: could not rewrite album cover backfill log at %@", logPath);
+}
+
+- (void)logProgress
+{
+    NSUInteger remaining = [self remainingCount];
+    NSTimeInterval left = [self estimatedTimeRemaining];
+    NSLog(@"Album cover backfill: %u done, %u to go (%.1f per hour, about %.1f hours left)",
+          (unsigned)[self completedCount], (unsigned)remaining, [self throughput], left / 3600.0);
+}
+
+- (void)beginTrack
+{
+    trackArtist     = nil;
+    trackAlbum      = nil;
+    trackIsPodcast  = NO;
+}
+
+- (void)endTrack
+{
+    // only albums are backfilled: a song on its own is usually a single or a stream
+    if (trackIsPodcast || [trackArtist length] == 0 || [trackAlbum length] == 0)
+        return;
+    uint64_t key = [WOCoverStore keyForArtist:trackArtist album:trackAlbum song:nil];
+    if (!key)
+        return;
+    NSNumber *keyNumber = [NSNumber numberWithUnsignedLongLong:key];
+    if ([seenKeys containsObject:keyNumber])
+        return;
+    [seenKeys addObject:keyNumber];
+
+    if (bsearch(&key, [coveredKeys bytes], [coveredKeys length] / sizeof(uint64_t), sizeof(uint64_t),
+                WOBackfillCompareKeys) ||
+        [store isKnownMissingKey:key reason:NULL])
+        return;
+    uint32_t attempted = [[attemptTimes objectForKey:keyNumber] unsignedIntValue];
+    if (attempted && (uint32_t)time(NULL) < attempted + WO_COVER_BACKFILL_RETRY_AGE)
+        return;
+
+    WOSongInfo *song = [[WOSongInfo alloc] init];
+    [song setArtist:trackArtist];
+    [song setAlbum:trackAlbum];
+    [pending addObject:song];
+}
+
+#pragma mark -
+#pragma mark NSXMLParser delegate methods
+
+// the library is a property list: a root dictionary whose "Tracks" key holds a dictionary of track dictionaries
+- (void)parser:(NSXMLParser *)parser
+didStartElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI
+ qualifiedName:(NSString *)qualifiedName
+    attributes:(NSDictionary *)attributes
+{
+    if ([elementName isEqualToString:@"dict"])
+    {
+        depth++;
+        if (depth == 2 && sawTracksKey)
+            inTracks = YES;
+        else if (inTracks && depth == 3)
+            [self beginTrack];
+    }
+    else if ([elementName isEqualToString:@"key"])
+    {
+        capturing = (depth == 1 || (inTracks && depth == 3));
+        [text setString:@""];
+    }
+    else if (inTracks && depth == 3 && currentField != WOBackfillFieldNone)
+    {
+        if ([elementName isEqualToString:@"true"])
+            trackIsPodcast = (currentField == WOBackfillFieldPodcast) ? YES : trackIsPodcast;
+        else
+        {
+            capturing = YES;
+            [text setString:@""];
+        }
+    }
+}
+
+- (void)parser:(NSXMLParser *)parser
+ didEndElement:(NSString *)elementName
+  namespaceURI:(NSString *)namespaceURI
+ qualifiedName:(NSString *)qualifiedName
+{
+    if ([elementName isEqualToString:@"dict"])
+    {
+        if (inTracks && depth == 3)
+            [self endTrack];
+        else if (inTracks && depth == 2)
+        {
+            // all tracks seen: don't bother reading the playlists
+            inTracks = NO;
+            [parser abortParsing];
+        }
+        depth--;
+    }
+    else if ([elementName isEqualToString:@"key"])
+    {
+        if (depth == 1)
+            sawTracksKey = [text isEqualToString:@"Tracks"];
+        else if (capturing)
+            currentField = WOBackfillFieldForKey(text);
+        capturing = NO;
+    }
+    else if (inTracks && depth == 3)
+    {
+        if (capturing)
+        {
+            if (currentField == WOBackfillFieldArtist)
+                trackArtist = [text copy];
+            else if (currentField == WOBackfillFieldAlbum)
+                trackAlbum = [text copy];
+        }
+        capturing = NO;
+        currentField = WOBackfillFieldNone;
+    }
+}
+
+- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string
+{
+    if (capturing)
+        [text appendString:string];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (NSUInteger)remainingCount
+{
+    NSUInteger value;
+    @synchronized (self)
+    {
+        value = remainingCount;
+    }
+    return value;
+}
+
+- (NSUInteger)completedCount
+{
+    NSUInteger value;
+    @synchronized (self)
+    {
+        value = completedCount;
+    }
+    return value;
+}
+
+- (double)throughput
+{
+    NSUInteger completed;
+    NSTimeInterval started;
+    @synchronized (self)
+    {
+        completed   = completedCount;
+        started     = passStarted;
+    }
+    NSTimeInterval elapsed = [NSDate timeIntervalSinceReferenceDate] - started;
+    if (completed == 0 || elapsed <= 0.0)
+        return 0.0;
+    return completed * 3600.0 / elapsed;
+}
+
+- (NSTimeInterval)estimatedTimeRemaining
+{
+    NSUInteger remaining = [self remainingCount];
+    if (remaining == 0)
+        return 0.0;
+
+    // until something has been tried, assume the job runs at its cap
+    double perHour = [self throughput];
+    if (perHour <= 0.0)
+        return remaining / requestsPerSecond;
+    return remaining * 3600.0 / perHour;
+}
+
+@end
@@ -0,0 +1,65 @@
+//
+//  WOCoverCollector.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class WOCoverStore;
+
+//! Keeps a WOCoverStore within a size quota by deleting the least recently used covers.
+//!
+//! The store reports every lookup and ingest through noteAccessToKey:, which only updates a table in memory (at most
+//! once an hour per cover) and queues a 12-byte record for the access log; it never touches the disk, so it is safe to
+//! call from the main thread. The log ("Cover Access Log", next to the index) is appended to by the collector's own
+//! low-priority thread, replayed when the collector is created and rewritten compactly once it is mostly superseded
+//! entries.
+//!
+//! Every few minutes the thread adds up the sizes recorded in the index. When they exceed the quota it evicts covers in
+//! least-recently-used order, a small batch at a time with a pause between batches, until usage is back below 90% of the
+//! quota. Covers used within the last hour are never evicted, so the cover on display stays put however small the quota.
+//! Covers that have not been used since the log was started count as the least recently used of all.
+//!
+//! \warn Threadsafe
+@interface WOCoverCollector : NSObject {
+
+    WOCoverStore        *store;
+
+    NSString            *logPath;
+
+    //! Bytes; 0 means no limit
+    unsigned long long  quota;
+
+    //! Last access (seconds since 1970, NSNumber) keyed by cover key (NSNumber)
+    NSMutableDictionary *accessTimes;
+
+    //! Access records not yet appended to the log
+    NSMutableData       *pendingLog;
+
+    //! Number of records in the log file
+    NSUInteger          logCount;
+
+    BOOL                started;
+
+    //! Guards everything above; signalled to wake the collector early
+    NSCondition         *condition;
+}
+
+//! Replays the access log at \p aPath (which need not exist yet); \p aQuota is in bytes, and 0 means no limit
+- (id)initWithStore:(WOCoverStore *)aStore logPath:(NSString *)aPath quota:(unsigned long long)aQuota;
+
+//! Records that the cover for \p key has just been used; cheap, and never touches the disk
+- (void)noteAccessToKey:(uint64_t)key;
+
+//! Starts the collector thread; further calls do nothing
+- (void)start;
+
+#pragma mark -
+#pragma mark Properties
+
+//! Lowering the quota wakes the collector straight away
+@property unsigned long long quota;
+
+@end
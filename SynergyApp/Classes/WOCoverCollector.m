@@ -0,0 +1,284 @@
+// WOCoverCollector.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOCoverCollector.h"
+
+// system headers
+#import <stdio.h>
+#import <stdlib.h>
+#import <time.h>
+
+// other headers
+#import "WOCoverStore.h"
+
+//! Accesses to one cover closer together than this (seconds) are logged only once; covers used more recently than this
+//! are never evicted
+#define WO_COVER_ACCESS_RESOLUTION      (uint32_t)(60 * 60)
+
+//! Delay (seconds) before the first pass after launch
+#define WO_COVER_COLLECT_DELAY          (NSTimeInterval)60.0
+
+//! Delay (seconds) between passes
+#define WO_COVER_COLLECT_INTERVAL       (NSTimeInterval)(60.0 * 10)
+
+//! Covers evicted per batch (one index rewrite each)
+#define WO_COVER_COLLECT_BATCH          32
+
+//! Pause (seconds) between batches
+#define WO_COVER_COLLECT_BATCH_INTERVAL (NSTimeInterval)1.0
+
+//! Eviction stops once usage is below this fraction of the quota
+#define WO_COVER_COLLECT_LOW_WATER      0.9
+
+//! The log is rewritten once it holds more than twice as many records as there are live covers, plus this many
+#define WO_COVER_LOG_SLACK              1024
+
+// one access log record, stored little-endian
+typedef struct WOCoverAccess {
+    uint64_t    key;
+    uint32_t    time;
+} __attribute__((packed)) WOCoverAccess;
+
+// one cover as seen by a collection pass
+typedef struct WOCoverCandidate {
+    uint64_t    key;
+    uint32_t    time;
+    uint32_t    bytes;
+} WOCoverCandidate;
+
+// least recently used first
+static int WOCoverCandidateCompare(const void *a, const void *b)
+{
+    uint32_t left = ((const WOCoverCandidate *)a)->time;
+    uint32_t right = ((const WOCoverCandidate *)b)->time;
+    return (left < right) ? -1 : (left > right);
+}
+
+@interface WOCoverCollector ()
+
+- (void)collect:(id)ignored;
+- (void)flushLog;
+- (void)evict;
+- (void)compactLogIfNeeded;
+
+@end
+
+@implementation WOCoverCollector
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithStore:(WOCoverStore *)aStore logPath:(NSString *)aPath quota:(unsigned long long)aQuota
+{
+    NSParameterAssert(aStore != nil);
+    NSParameterAssert(aPath != nil);
+    if ((self = [super init]))
+    {
+        self->store         = aStore;
+        self->logPath       = [aPath copy];
+        self->quota         = aQuota;
+        self->accessTimes   = [NSMutableDictionary dictionary];
+        self->pendingLog    = [NSMutableData data];
+        self->condition     = [[NSCondition alloc] init];
+
+        // later records supersede earlier ones
+        NSData *log = [NSData dataWithContentsOfMappedFile:logPath];
+        const WOCoverAccess *records = [log bytes];
+        logCount = [log length] / sizeof(WOCoverAccess);
+        for (NSUInteger i = 0; i < logCount; i++)
+            [accessTimes setObject:[NSNumber numberWithUnsignedInt:NSSwapLittleIntToHost(records[i].time)]
+                            forKey:[NSNumber numberWithUnsignedLongLong:NSSwapLittleLongLongToHost(records[i].key)]];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)noteAccessToKey:(uint64_t)key
+{
+    if (key == 0)
+        return;
+    uint32_t now = (uint32_t)time(NULL);
+    NSNumber *accessKey = [NSNumber numberWithUnsignedLongLong:key];
+    [condition lock];
+    uint32_t last = [[accessTimes objectForKey:accessKey] unsignedIntValue];
+    if (now >= last + WO_COVER_ACCESS_RESOLUTION)
+    {
+        [accessTimes setObject:[NSNumber numberWithUnsignedInt:now] forKey:accessKey];
+        WOCoverAccess access = { NSSwapHostLongLongToLittle(key), NSSwapHostIntToLittle(now) };
+        [pendingLog appendBytes:&access length:sizeof(access)];
+    }
+    [condition unlock];
+}
+
+- (void)start
+{
+    [condition lock];
+    if (!started)
+    {
+        [NSThread detachNewThreadSelector:@selector(collect:) toTarget:self withObject:nil];
+        started = YES;
+    }
+    [condition unlock];
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// body of the collector thread
+- (void)collect:(id)ignored
+{
+    [NSThread setThreadPriority:0.1];
+    NSTimeInterval delay = WO_COVER_COLLECT_DELAY;
+    for (;;)
+    {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        [condition lock];
+        [condition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:delay]];
+        [condition unlock];
+        [self flushLog];
+        [self evict];
+        [self compactLogIfNeeded];
+        delay = WO_COVER_COLLECT_INTERVAL;
+        [pool drain];
+    }
+}
+
+// appends the queued access records to the log; collector thread only
+- (void)flushLog
+{
+    [condition lock];
+    NSData *pending = pendingLog;
+    pendingLog = [NSMutableData data];
+    [condition unlock];
+    NSUInteger count = [pending length] / sizeof(WOCoverAccess);
+    if (count == 0)
+        return;
+    FILE *file = fopen([logPath fileSystemRepresentation], "ab");
+    if (!file || fwrite([pending bytes], sizeof(WOCoverAccess), count, file) != count)
+        NSLog(@"warning: could not append to album cover access log at %@", logPath);
+    else
+    {
+        [condition lock];
+        logCount += count;
+        [condition unlock];
+    }
+    if (file)
+        fclose(file);
+}
+
+// deletes least recently used covers until usage is comfortably within the quota; collector thread only
+- (void)evict
+{
+    [condition lock];
+    unsigned long long limit = quota;
+    [condition unlock];
+    if (limit == 0)
+        return;
+
+    NSData *records = [store coverRecords];
+    const WOCoverRecord *covers = [records bytes];
+    NSUInteger count = [records length] / sizeof(WOCoverRecord);
+    unsigned long long used = 0;
+    for (NSUInteger i = 0; i < count; i++)
+        used += covers[i].bytes;
+    if (used <= limit)
+        return;
+
+    NSMutableData *candidateData = [NSMutableData dataWithLength:count * sizeof(WOCoverCandidate)];
+    WOCoverCandidate *candidates = [candidateData mutableBytes];
+    [condition lock];
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        candidates[i].key   = covers[i].key;
+        candidates[i].bytes = covers[i].bytes;
+        candidates[i].time  = [[accessTimes objectForKey:
+                                [NSNumber numberWithUnsignedLongLong:covers[i].key]] unsignedIntValue];
+    }
+    [condition unlock];
+    qsort(candidates, count, sizeof(WOCoverCandidate), WOCoverCandidateCompare);
+
+    unsigned long long target = (unsigned long long)(limit * WO_COVER_COLLECT_LOW_WATER);
+    uint32_t recent = (uint32_t)time(NULL) - WO_COVER_ACCESS_RESOLUTION;
+    NSUInteger next = 0;
+    while (used > target && next < count && candidates[next].time < recent)
+    {
+        uint64_t batch[WO_COVER_COLLECT_BATCH];
+        NSUInteger batchCount = 0;
+        while (batchCount < WO_COVER_COLLECT_BATCH && used > target && next < count && candidates[next].time < recent)
+        {
+            batch[batchCount++] = candidates[next].key;
+            used -= MIN(used, (unsigned long long)candidates[next].bytes);
+            next++;
+        }
+        [store removeCoversForKeys:batch count:batchCount];
+        [condition lock];
+        for (NSUInteger i = 0; i < batchCount; i++)
+            [accessTimes removeObjectForKey:[NSNumber numberWithUnsignedLongLong:batch[i]]];
+        [condition unlock];
+
+        // give lookups and downloads room to breathe between index rewrites
+        if (used > target)
+            [NSThread sleepForTimeInterval:WO_COVER_COLLECT_BATCH_INTERVAL];
+    }
+}
+
+// rewrites the log with one record per live cover once superseded records dominate; collector thread only
+- (void)compactLogIfNeeded
+{
+    [condition lock];
+    NSMutableData *log = nil;
+    if (logCount > [accessTimes count] * 2 + WO_COVER_LOG_SLACK)
+    {
+        log = [NSMutableData dataWithCapacity:[accessTimes count] * sizeof(WOCoverAccess)];
+        for (NSNumber *key in accessTimes)
+        {
+            WOCoverAccess access = {
+                NSSwapHostLongLongToLittle([key unsignedLongLongValue]),
+                NSSwapHostIntToLittle([[accessTimes objectForKey:key] unsignedIntValue])
+            };
+            [log appendBytes:&access length:sizeof(access)];
+        }
+        [pendingLog setLength:0];   // already reflected in accessTimes
+    }
+    [condition unlock];
+    if (!log)
+        return;
+
+    // written to a temporary file and renamed into place
+    if ([log writeToFile:logPath atomically:YES])
+    {
+        [condition lock];
+        logCount = [log length] / sizeof(WOCoverAccess);
+        [condition unlock];
+    }
+    else
+        NSLog(@"warning: could not compact album cover access log at %@", logPath);
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (unsigned long long)quota
+{
+    [condition lock];
+    unsigned long long value = quota;
+    [condition unlock];
+    return value;
+}
+
+- (void)setQuota:(unsigned long long)aQuota
+{
+    [condition lock];
+    BOOL lower = (aQuota != 0 && (quota == 0 || aQuota < quota));
+    quota = aQuota;
+    if (lower)
+        [condition signal];
+    [condition unlock];
+}
+
+@end
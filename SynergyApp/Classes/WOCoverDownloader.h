@@ -5,7 +5,7 @@
 
 #import <Cocoa/Cocoa.h>
 
-@class WOSongInfo;
+@class WOCoverStore, WOSongInfo;
 
 //! Log Amazon-related events conditionally (if user preferences request it).
 void WOAmazonLog(NSString *format, ...);
@@ -21,6 +21,18 @@ void WOAmazonLog(NSString *format, ...);
 // cover exists on the disk
 + (BOOL)albumCoverExists:(WOSongInfo *)song;
 
+// queues song for a download that yields to all others and blocks until it is
+// done with; returns NO if it is not by limit or the search failed for want of
+// a network (not for the main thread)
++ (BOOL)backfillCover:(WOSongInfo *)song beforeDate:(NSDate *)limit;
+
+// returns index of the album covers on disk (nil if the folders could not be
+// created)
++ (WOCoverStore *)coverStore;
+
+// saves the cover index if the store has been opened (at quit)
++ (void)synchronizeCoverStore;
+
 // returns path to album covers folder
 + (NSString *)albumCoversPath;
 
@@ -37,4 +49,8 @@ void WOAmazonLog(NSString *format, ...);
 + (BOOL)preprocess;
 + (void)setPreprocess:(BOOL)preprocess;
 
+// cap on the rate of cover requests (defaults to one every 10 seconds)
++ (double)requestsPerSecond;
++ (void)setRequestsPerSecond:(double)requestsPerSecond;
+
 @end
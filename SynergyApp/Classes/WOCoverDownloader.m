@@ -4,7 +4,14 @@
 // Copyright 2003-present Greg Hurrell. All rights reserved.
 
 #import "SynergyController.h"
+#import "WOAudioscrobblerLibraryImporter.h"
+#import "WOCoverBackfill.h"
+#import "WOCoverCollector.h"
 #import "WOCoverDownloader.h"
+#import "WOCoverImageCache.h"
+#import "WOCoverStore.h"
+#import "WOHTTPClient.h"
+#import "WOKeywordNormalizer.h"
 #import "WOSongInfo.h"
 #import "WODebug.h"
 #import "WOExceptions.h"
@@ -46,8 +53,9 @@ void WOAmazonLog(NSString *format, ...)
 
 // private methods:
 
-// method (launched in a separate thread) to download album covers to disk
-+ (void)_downloadCover:(WOSongInfo *)songInfo;
+// download a single album cover to disk (called on a worker thread); returns
+// NO if downloads are not currently permitted
++ (BOOL)_downloadCover:(WOSongInfo *)songInfo;
 
 // query xml.amazon.com for URL to the album cover
 //+ (NSURL *)_searchForAlbumCover:(WOSongInfo *)song;
@@ -64,11 +72,17 @@ void WOAmazonLog(NSString *format, ...)
 
     // queue management methods
 + (void)_removeFromQueue:(WOSongInfo *)song;
++ (void)_giveUpOnSong:(WOSongInfo *)song reason:(unsigned)reason;
 + (void)_addToQueue:(WOSongInfo *)song;
-+ (void)_processNextItemInQueue;
++ (WOSongInfo *)_nextEligibleItemInQueue;
++ (BOOL)_backfillQueueContainsSong:(WOSongInfo *)song;
++ (WOSongInfo *)_waitForNextItemInQueue;
 
-+ (void)_startTimer;
-+ (void)_suspendTimer;
+    // worker pool and rate limiting
++ (void)_startWorkers;
++ (void)_downloadWorker:(id)ignored;
++ (void)_refillTokens;
++ (NSTimeInterval)_takeToken;
 
 + (BOOL)_netConnectionEstablished;
 
@@ -76,8 +90,6 @@ void WOAmazonLog(NSString *format, ...)
 static Boolean UnsolicitedAllowedSCF(const char *serverName);
 
     // filesystem routines
-+ (NSString *)_filenameWithPath:(WOSongInfo *)song;
-
 + (NSString *)_albumCoversPath;
 
 @end
@@ -95,26 +107,37 @@ completed before a new download begins. This effectively means that when new
 downloads are inserted just behind the head (the currently downloading file) of
 the queue.
 
-Every one second, the class marks another download as ready to begin, and spawns
-a new thread in which the download will take place. The management of this queue
-is completely transparent to the programmer.
-
-If there is a connection failure or other error, items in the queue will
-automatically be retried, at an increasing interval. This ensures that problems
-aren't exacerbated at the server end if it is overloaded.
-
-On each failure, the item in question is moved down one place in the queue so
-that other waiting items have a chance at getting a download. In addition to
-the moving down the queue, the interval is doubled for each failure, up to a
-limit of 512 seconds. So, the intervals run like so: 1, 2, 4, 8, 16, 32, 64,
-128, 256 and 512 seconds.
-
-*** note, I've massively increased these numbers to reduce load on the amazon servers.... we now go
-10, 20, 40, 80, 160, 320, 640, 1280, 2560, 5120 seconds
+A small, fixed pool of worker threads (started when the first item is added to
+the queue) takes items from the queue. Before each request a worker must take a
+token from a token bucket which refills at a configurable rate (see
+setRequestsPerSecond:); if no token is available the worker sleeps until the
+moment one will be, and when the queue is empty the workers sleep until a new
+item is added. No thread is ever created per download, and there is no polling
+timer. The management of this queue is completely transparent to the
+programmer.
+
+Failed searches are not retried within a run. A search that finds nothing (no
+result, or only a 1x1 placeholder image) or that fails with a network error is
+recorded in the cover index along with the reason and an expiry time (30 days,
+or 6 hours for network errors), and the item is dropped from the queue.
+_addToQueue: consults the index, so the same search is not repeated, on this
+run or a later one, until its entry expires. This ensures that problems aren't
+exacerbated at the server end if it is overloaded, and that the queue doesn't
+fill up with permanent failures.
 
 Once finished, the completed download is moved to:
 ~/Library/Application Support/Synergy/Album Covers/
 
+That folder is kept within a size quota (256 MB unless overridden by the
+"AlbumCoversQuotaBytes" default) by a WOCoverCollector, which deletes the least
+recently used covers from a background thread.
+
+Covers for the rest of the library are fetched ahead of time by a
+WOCoverBackfill, which hands albums over one at a time through
+backfillCover:beforeDate:. Those go into a separate queue that workers only
+look at when nothing in the main queue is eligible, so the track being played
+always goes first; if it turns up in the backfill queue it is moved across.
+
 "*/
 
 // Constants:
@@ -122,8 +145,41 @@ Once finished, the completed download is moved to:
 // initial capacity of the download queue, will grow if necessary
 #define WO_INITIAL_QUEUE_CAPACITY (unsigned)100
 
-// minimum interval (secs) between cover downloads
-#define WO_COVER_DOWNLOAD_INTERVAL  (float)10.0
+// default cap on the rate of cover requests (one every 10 seconds); can be
+// overridden with the "CoverDownloadRequestsPerSecond" default
+#define WO_COVER_REQUESTS_PER_SECOND    (double)0.1
+
+// most requests that may be made back-to-back after an idle period
+#define WO_COVER_REQUEST_BURST          (double)1.0
+
+// number of worker threads performing downloads
+#define WO_COVER_DOWNLOAD_WORKERS       (unsigned)2
+
+// how long (secs) workers hold off when downloads are not permitted (no net
+// connection and connect-on-demand is off)
+#define WO_COVER_OFFLINE_INTERVAL       (NSTimeInterval)10.0
+
+// how long (secs) to remember that a search found nothing (30 days), or failed
+// for any other reason (6 hours), before searching again
+#define WO_COVER_MISS_LIFETIME          (NSTimeInterval)(60 * 60 * 24 * 30)
+#define WO_COVER_NETWORK_MISS_LIFETIME  (NSTimeInterval)(60 * 60 * 6)
+
+// default size limit for the covers on disk (256 MB); can be overridden with the
+// "AlbumCoversQuotaBytes" default (0 for no limit)
+#define WO_COVER_QUOTA                  (unsigned long long)(256 * 1024 * 1024)
+
+// access-time log used by the collector, kept next to the cover index
+#define WO_COVER_ACCESS_LOG_FILENAME    @"Cover Access Log"
+
+// progress of the library backfill, kept next to the cover index
+#define WO_COVER_BACKFILL_LOG_FILENAME  @"Cover Backfill Log"
+
+// longest cover image accepted (bytes); anything larger is treated as a
+// failed download
+#define WO_COVER_MAXIMUM_IMAGE_BYTES    (NSUInteger)(8 * 1024 * 1024)
+
+// sent with searches and image downloads
+#define WO_COVER_USER_AGENT     @"Synergy (WOHTTPClient)"
 
 // amazon.com associate ID (define as @"" if no associate ID)
 #define WO_AMAZON_ASSOCIATE_ID  @""
@@ -145,17 +201,44 @@ static BOOL             _connectOnDemand;
 // whether or not to pre-process search keywords
 static BOOL             _preprocess;
 
-// global timer to ensure new downloads are at least one second apart
-static NSTimer          *_downloadTimer;
-
 // global storage for download queue, an array of WOSongInfo objs
 static NSMutableArray   *_downloadQueue;
 
+// low-priority items from the library backfill, oldest first (guarded by
+// _downloadQueueCondition)
+static NSMutableArray   *_backfillQueue;
+
+// guards both queues and the token bucket; workers wait on it for new items and
+// for tokens, and backfillCover:beforeDate: for its item to be done with, so it
+// is always broadcast rather than signalled
+static NSCondition      *_downloadQueueCondition;
+
+// number of worker threads started so far (guarded by _downloadQueueCondition)
+static unsigned         _workerCount;
+
+// token bucket (guarded by _downloadQueueCondition)
+static double           _requestsPerSecond;
+static double           _tokens;
+static NSTimeInterval   _tokensUpdated;
+
+// workers take nothing from the queue before this time (guarded by
+// _downloadQueueCondition)
+static NSTimeInterval   _offlineUntil;
+
 // locks for thread safety
 // TODO: for Synergy 3.5 will break compatibility with Jaguar, so can start using @synchronized and @try etc
-static NSLock           *_downloadQueueLock;
 static NSLock           *_connectOnDemandLock;
 static NSLock           *_preprocessLock;
+static NSLock           *_coverStoreLock;
+
+// index of the covers on disk, opened on first use
+static WOCoverStore     *_coverStore;
+
+// started along with the store (guarded by _coverStoreLock)
+static WOCoverBackfill  *_coverBackfill;
+
+// size limit passed to the store's collector
+static unsigned long long _coverQuota;
 
 static NSString *WOCoverDownloaderAlbumCoversPath = nil;
 static NSString *WOCoverDownloaderTempAlbumCoversPath = nil;
@@ -165,54 +248,70 @@ static NSString *WOCoverDownloaderTempAlbumCoversPath = nil;
     _connectOnDemand        = YES;
     _preprocess             = YES;
     _downloadQueue          = [[NSMutableArray alloc] initWithCapacity:WO_INITIAL_QUEUE_CAPACITY];
-    _downloadQueueLock      = [[NSLock alloc] init];
+    _backfillQueue          = [[NSMutableArray alloc] init];
+    _downloadQueueCondition = [[NSCondition alloc] init];
     _connectOnDemandLock    = [[NSLock alloc] init];
     _preprocessLock         = [[NSLock alloc] init];
-    _downloadTimer          = nil;   // timer will get started when first item is added to queue
-}
-
-+ (void)_startTimer
-{
-    // only works if called from main thread
-    if (!_downloadTimer)
-    {
-        _downloadTimer = [NSTimer scheduledTimerWithTimeInterval:WO_COVER_DOWNLOAD_INTERVAL  // fires every 10 seconds
-                                                          target:self
-                                                        selector:@selector(_processNextItemInQueue:)
-                                                        userInfo:nil
-                                                         repeats:YES];
-    }
-}
-
-+ (void)_suspendTimer
-{
-    if (_downloadTimer)
-    {
-        [_downloadTimer invalidate];
-        _downloadTimer = nil;
-    }
+    _coverStoreLock         = [[NSLock alloc] init];
+    _coverStore             = nil;
+    _coverBackfill          = nil;
+    _workerCount            = 0;    // workers get started when first item is added to queue
+    _requestsPerSecond      = WO_COVER_REQUESTS_PER_SECOND;
+    _tokens                 = WO_COVER_REQUEST_BURST;
+    _tokensUpdated          = [NSDate timeIntervalSinceReferenceDate];
+    _offlineUntil           = 0.0;
+    _coverQuota             = WO_COVER_QUOTA;
+
+    NSNumber *quota = NSMakeCollectable(CFPreferencesCopyAppValue(CFSTR("AlbumCoversQuotaBytes"),
+                                                                  CFSTR("org.wincent.Synergy")));
+    if ([quota isKindOfClass:[NSNumber class]] && [quota longLongValue] >= 0)
+        _coverQuota = [quota unsignedLongLongValue];
+
+    NSNumber *rate = NSMakeCollectable(CFPreferencesCopyAppValue(CFSTR("CoverDownloadRequestsPerSecond"),
+                                                                 CFSTR("org.wincent.Synergy")));
+    if ([rate isKindOfClass:[NSNumber class]] && [rate doubleValue] > 0.0)
+        _requestsPerSecond = [rate doubleValue];
 }
 
 // queue management methods (all private)
 
 + (void)_removeFromQueue:(WOSongInfo *)song
 {
-    [_downloadQueueLock lock];
+    [_downloadQueueCondition lock];
 
     [_downloadQueue removeObject:song];
+    [_backfillQueue removeObject:song];
+    [_downloadQueueCondition broadcast];
 
-    // no need to stop timer if queue is now empty (this is handled in
-    // _processNextItemInQueue)
+    [_downloadQueueCondition unlock];
+}
 
-    [_downloadQueueLock unlock];
++ (void)_giveUpOnSong:(WOSongInfo *)song reason:(unsigned)reason
+/*"
+ Records in the cover index that the search for song found nothing and removes
+ it from the queue; it will not be queued again until the entry expires.
+"*/
+{
+    NSTimeInterval lifetime = (reason == WOCoverMissNoResult || reason == WOCoverMissPlaceholder) ?
+        WO_COVER_MISS_LIFETIME : WO_COVER_NETWORK_MISS_LIFETIME;
+    WOAmazonLog(@"Giving up on %@ (reason %d) for %.0f seconds", [song album], reason, lifetime);
+    [[self coverStore] addMissForKey:[song coverKey] reason:reason lifetime:lifetime];
+    [self _removeFromQueue:song];
 }
 
 + (void)_addToQueue:(WOSongInfo *)song
 /*"
-Adds a new item to the queue. If the timer is suspended then reinstate it.
+Adds a new item to the queue and wakes a worker to process it, starting the
+ worker pool if this is the first item ever added. Does nothing if a recent
+ search for the same cover found nothing. A backfill item for the same cover
+ that no worker has started on yet is dropped in favour of the new one; one
+ already being downloaded counts as a duplicate.
 "*/
 {
-    [_downloadQueueLock lock];
+    if ([[self coverStore] isKnownMissingKey:[song coverKey] reason:NULL])
+        return;
+
+    [_downloadQueueCondition lock];
 
     unsigned queueLength = [_downloadQueue count];
 
@@ -227,10 +326,8 @@ Adds a new item to the queue. If the timer is suspended then reinstate it.
 
         while ((queueItem = [enumerator nextObject]))
         {
-            // should be testing based on *duplicate search strings*... or at least, that's what I think we should be doing...
-            if ([[queueItem song] isEqualToString:[song song]] &&
-                [[queueItem album] isEqualToString:[song album]] &&
-                [[queueItem artist] isEqualToString:[song artist]])
+            // the cover key identifies the search string
+            if ([queueItem coverKey] == [song coverKey])
             {
                 isDuplicate = YES;
                 break;
@@ -238,59 +335,187 @@ Adds a new item to the queue. If the timer is suspended then reinstate it.
         }
     }
 
+    // promote from the backfill queue
+    for (NSUInteger i = 0; !isDuplicate && i < [_backfillQueue count]; i++)
+    {
+        WOSongInfo *queueItem = [_backfillQueue objectAtIndex:i];
+        if ([queueItem coverKey] == [song coverKey])
+        {
+            if ([queueItem attemptedDownload])
+                isDuplicate = YES;
+            else
+                [_backfillQueue removeObjectAtIndex:i];
+            break;
+        }
+    }
+
     // insert item at head of queue if not a duplicate
     if (!isDuplicate)
+    {
         [_downloadQueue insertObject:song atIndex:queueLength];
+        [_downloadQueueCondition broadcast];
+    }
 
-    [_downloadQueueLock unlock];
+    if (_workerCount == 0)
+        [self _startWorkers];
 
-    if (!_downloadTimer)
-        [self _startTimer];
+    [_downloadQueueCondition unlock];
 }
 
-+ (void)_processNextItemInQueue:(NSTimer *)timer
++ (WOSongInfo *)_nextEligibleItemInQueue
 /*"
- Called once per second, when the global timer fires, this method checks the
- connectOnDemand setting and the current network connection status to see
- whether it is permissible to start a new download. It then examines the global
- download queue and if any items are waiting spawns a new thread to process
- the download of the highest priority item.
-
- When the last item is removed from the queue, the timer-driven updates are
- suspended to conserve CPU usage. As soon as new item is added to the queue they
- are reinstated. This is useful during normal listening when several minutes
- may pass without the need to initiate any new downloads.
+ Returns the highest priority item in the queue for which a download may begin,
+ or failing that the oldest backfill item not yet started, or nil if there is
+ neither. The caller must hold _downloadQueueCondition.
 "*/
 {
-    // find first eligible item in queue
-    [_downloadQueueLock lock];
+    // step through queue looking for eligible download
+    NSEnumerator *enumerator = [_downloadQueue reverseObjectEnumerator];
 
-    // check for a zero-length queue; if found, suspend timer
-    if ([_downloadQueue count] == 0)
-        [self _suspendTimer];
-    else
+    WOSongInfo *queueItem;
+
+    while ((queueItem = [enumerator nextObject]))
     {
-        // step through queue looking for eligible download
-        NSEnumerator *enumerator = [_downloadQueue reverseObjectEnumerator];
+        if ( // brand new queue item, no download ever attempted
+             ([queueItem attemptedDownload] == NO) ||
+             // older (failed) queue item that is ready to retry
+             ([queueItem readyToRetry]))
+            return queueItem;
+    }
 
-        WOSongInfo *queueItem;
+    // only once the main queue has nothing to offer
+    for (queueItem in _backfillQueue)
+    {
+        if (![queueItem attemptedDownload])
+            return queueItem;
+    }
+    return nil;
+}
 
-        while ((queueItem = [enumerator nextObject]))
++ (BOOL)_backfillQueueContainsSong:(WOSongInfo *)song
+/*"
+ Identity rather than equality: the item may have been promoted and a different
+ song with the same cover key queued since. The caller must hold
+ _downloadQueueCondition.
+"*/
+{
+    return [_backfillQueue indexOfObjectIdenticalTo:song] != NSNotFound;
+}
+
++ (WOSongInfo *)_waitForNextItemInQueue
+/*"
+ Blocks the calling worker until there is an eligible item in the queue and a
+ token with which to request it, then claims the item (so that no other worker
+ picks it up) and returns it.
+
+ When the queue holds nothing eligible the worker sleeps until _addToQueue:
+ (or backfillCover:beforeDate:) broadcasts; items waiting on a retry are not polled for (retries are currently
+ disabled in WOSongInfo, and the next addition wakes a worker anyway). When
+ there is an item but no token the worker sleeps until the moment the next
+ token will be available.
+"*/
+{
+    [_downloadQueueCondition lock];
+
+    WOSongInfo *song = nil;
+    for (;;)
+    {
+        NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+        if (now < _offlineUntil)
         {
-            if ( // brand new queue item, no download ever attempted
-                 ([queueItem attemptedDownload] == NO) ||
-                 // older (failed) queue item that is ready to retry
-                 ([queueItem readyToRetry]))
-            {
-                // eligible item found! start download in new thread
-                [NSThread detachNewThreadSelector:@selector(_downloadCover:)
-                                         toTarget:self
-                                       withObject:queueItem];
-                break;
-            }
+            [_downloadQueueCondition waitUntilDate:[NSDate dateWithTimeIntervalSinceReferenceDate:_offlineUntil]];
+            continue;
+        }
+
+        song = [self _nextEligibleItemInQueue];
+        if (!song)
+        {
+            [_downloadQueueCondition wait];
+            continue;
+        }
+
+        NSTimeInterval delay = [self _takeToken];
+        if (delay <= 0.0)
+            break;
+        [_downloadQueueCondition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:delay]];
+    }
+
+    // claim it
+    [song setAttemptedDownload:YES];
+    [song setReadyToRetry:NO];
+
+    [_downloadQueueCondition unlock];
+    return song;
+}
+
+// worker pool and rate limiting (all private)
+
++ (void)_startWorkers
+/*"
+ Starts the fixed pool of worker threads. The caller must hold
+ _downloadQueueCondition.
+"*/
+{
+    while (_workerCount < WO_COVER_DOWNLOAD_WORKERS)
+    {
+        [NSThread detachNewThreadSelector:@selector(_downloadWorker:)
+                                 toTarget:self
+                               withObject:nil];
+        _workerCount++;
+    }
+}
+
++ (void)_downloadWorker:(id)ignored
+/*"
+ Body of each worker thread: repeatedly waits for the next item and downloads
+ it. Workers live for the rest of the run, idling on _downloadQueueCondition
+ when there is nothing to do.
+"*/
+{
+    for (;;)
+    {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+        WOSongInfo *song = [self _waitForNextItemInQueue];
+        if (![self _downloadCover:song])
+        {
+            // not permitted to download right now: hand the item back and hold
+            // off all workers for a while rather than spinning
+            [_downloadQueueCondition lock];
+            [song setAttemptedDownload:NO];
+            _offlineUntil = [NSDate timeIntervalSinceReferenceDate] + WO_COVER_OFFLINE_INTERVAL;
+            [_downloadQueueCondition unlock];
         }
+
+        [pool drain];
     }
-    [_downloadQueueLock unlock];
+}
+
++ (void)_refillTokens
+/*"
+ Credits the token bucket for the time elapsed since it was last examined. The
+ caller must hold _downloadQueueCondition.
+"*/
+{
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    _tokens = MIN(WO_COVER_REQUEST_BURST, _tokens + (now - _tokensUpdated) * _requestsPerSecond);
+    _tokensUpdated = now;
+}
+
++ (NSTimeInterval)_takeToken
+/*"
+ Takes a token if one is available, returning 0. Otherwise returns the number of
+ seconds until the next token will be available. The caller must hold
+ _downloadQueueCondition.
+"*/
+{
+    [self _refillTokens];
+    if (_tokens >= 1.0)
+    {
+        _tokens -= 1.0;
+        return 0.0;
+    }
+    return (1.0 - _tokens) / _requestsPerSecond;
 }
 
 + (BOOL)_netConnectionEstablished
@@ -326,9 +551,56 @@ static Boolean UnsolicitedAllowedSCF(const char *serverName)
 
 // for those callers who would rather receive a BOOL confirming that the album cover exists on the disk
 + (BOOL)albumCoverExists:(WOSongInfo *)song
+/*"
+ Consults the cover index only (no image is loaded and the disk is not
+ touched). Like albumCover:, adds the song to the download queue if there is no
+ cover.
+"*/
+{
+    WOCoverRecord record;
+    if ([[self coverStore] lookupKey:[song coverKey] record:&record buyNowURL:NULL])
+        return YES;
+
+    // the _addToQueue method is smart enough to avoid adding a duplicate
+    if ([song coverKey])
+        [self _addToQueue:song];
+    return NO;
+}
+
++ (BOOL)backfillCover:(WOSongInfo *)song beforeDate:(NSDate *)limit
+/*"
+ Queues song behind everything in the main queue and blocks the calling thread
+ until the workers are done with it: its cover was found, the search gave up,
+ or it was promoted to the main queue because the track came up in the player.
+ Returns NO if that has not happened by limit, in which case the item is
+ withdrawn unless a download has already started, and also if the search gave
+ up because of a network error, so that an outage stalls the backfill instead
+ of being recorded as an attempt. Never call this from the main thread.
+"*/
 {
-    // unfortunately, we can't *really* know if the image exists on disk without actually trying to load it...
-    return [[self class] albumCover:song] ? YES : NO;
+    NSParameterAssert(song != nil);
+    unsigned reason;
+    if (![song coverKey])
+        return YES;
+    // a miss from an earlier outage is searched for again: the backfill paces itself
+    if ([[self coverStore] isKnownMissingKey:[song coverKey] reason:&reason] && reason != WOCoverMissNetworkError)
+        return YES;
+
+    [_downloadQueueCondition lock];
+    [_backfillQueue addObject:song];
+    [_downloadQueueCondition broadcast];
+    if (_workerCount == 0)
+        [self _startWorkers];
+    while ([self _backfillQueueContainsSong:song] && [_downloadQueueCondition waitUntilDate:limit])
+        ;
+    BOOL done = ![self _backfillQueueContainsSong:song];
+    if (!done && ![song attemptedDownload])
+        [_backfillQueue removeObjectIdenticalTo:song];
+    [_downloadQueueCondition unlock];
+    if (done && [[self coverStore] isKnownMissingKey:[song coverKey] reason:&reason] &&
+        reason == WOCoverMissNetworkError)
+        return NO;
+    return done;
 }
 
 + (NSImage *)albumCover:(WOSongInfo *)song
@@ -343,75 +615,94 @@ Given an identifier, this method returns an NSImage containing the album cover
  only the first time a new track is encountered.
 "*/
 {
-    NSImage *image = nil;
-
-    // grab filename (format is like "Album-BrandNewDay,Artist-String.jpg")
-    NSString *filename = [self _filenameWithPath:song];
-
-    // only proceed if filename is not nil (nil would mean there is not enough
-    // information to construct a filename, or couldn't construct path)
-    if (!filename)
+    // nil would mean there is not enough information to identify a cover
+    if (![song coverKey])
         return nil;
 
-    if ([[NSFileManager defaultManager] fileExistsAtPath:filename])
-        image = [[NSImage alloc] initWithContentsOfFile:filename];
+    NSImage *image = nil;
+    WOCoverStore *store = [self coverStore];
+    WOCoverRecord record;
+    if ([store lookupKey:[song coverKey] record:&record buyNowURL:NULL])
+        image = [[WOCoverImageCache sharedCache] imageWithContentsOfFile:[store pathForRecord:&record]];
 
+    // no image found, add to download queue
     if (!image)
-    {
-        // if no image file, as a last-ditch effort try with .tiff extension instead
-        NSString *altFilename =
-        [[filename stringByDeletingPathExtension] stringByAppendingPathExtension:
-            @"tiff"];
+        // the _addToQueue method is smart enough to avoid adding a duplicate
+        [self _addToQueue:song];
 
-        if ([[NSFileManager defaultManager] fileExistsAtPath:altFilename])
-            image = [[NSImage alloc] initWithContentsOfFile:altFilename];
+    return image;
+}
 
-        // if we have a tiff, better update the songinfo object correspondingly
-        if (image)
++ (WOCoverStore *)coverStore
+{
+    [_coverStoreLock lock];
+    if (!_coverStore)
+    {
+        NSString *coversPath = [self albumCoversPath];
+        NSString *tempCoversPath = [self tempAlbumCoversPath];
+        if (coversPath && tempCoversPath)
         {
-            NSString *newFilename = [altFilename lastPathComponent];
-            [song setFilename:newFilename]; // no effect!
+            _coverStore = [[WOCoverStore alloc] initWithFolder:coversPath temporaryFolder:tempCoversPath];
+
+            // keeps the folder within _coverQuota, from a background thread
+            NSString *logPath = [coversPath stringByAppendingPathComponent:WO_COVER_ACCESS_LOG_FILENAME];
+            WOCoverCollector *collector = [[WOCoverCollector alloc] initWithStore:_coverStore
+                                                                          logPath:logPath
+                                                                            quota:_coverQuota];
+            [_coverStore setCollector:collector];
+            [collector start];
+
+            // fetches covers for the rest of the library in the background,
+            // unless turned off with the "CoverBackfill" default
+            Boolean valid;
+            Boolean enabled = CFPreferencesGetAppBooleanValue(CFSTR("CoverBackfill"),
+                                                              CFSTR("org.wincent.Synergy"), &valid);
+            NSString *libraryPath = [WOAudioscrobblerLibraryImporter defaultLibraryPath];
+            if ((enabled || !valid) && libraryPath)
+            {
+                NSString *backfillLogPath = [coversPath stringByAppendingPathComponent:WO_COVER_BACKFILL_LOG_FILENAME];
+                _coverBackfill = [[WOCoverBackfill alloc] initWithStore:_coverStore
+                                                            libraryPath:libraryPath
+                                                                logPath:backfillLogPath];
+                [_coverBackfill start];
+            }
         }
     }
+    WOCoverStore *store = _coverStore;
+    [_coverStoreLock unlock];
+    return store;
+}
 
-    // still no image found, add to download queue
-    if (!image)
-        // the _addToQueue method is smart enough to avoid adding a duplicate
-        [self _addToQueue:song];
-
-    return image;
++ (void)synchronizeCoverStore
+{
+    [_coverStoreLock lock];
+    WOCoverStore *store = _coverStore;
+    [_coverStoreLock unlock];
+    if (store && ![store synchronize])
+        NSLog(@"warning: album cover index could not be saved");
 }
 
 
-// method (launched in a separate thread) to download album covers to disk
-+ (void)_downloadCover:(WOSongInfo *)song
+// download a single album cover to disk (called on a worker thread)
++ (BOOL)_downloadCover:(WOSongInfo *)song
 /*"
- This method should be called in a separate thread using
- detachNewThreadSelector:toTarget:withObject. Note that multiple concurrent
- threads could be running if the user rapidly skips through tracks. It is left
- up to the SynergyController class to determine whether or not calling this
- method is the appropriate action; in other words, it must first check whether
- the album cover image already exists on disk, and whether the user preferences
- allow network connections for the purpose of downloading cover images.
-
- The download starts immediately if an interval of one second or more has
- elapsed since the last download started. This is achieved by adding the object
- to the queue and firing the timer immediately. This should only happen when
- there are no other objects in the queue. Otherwise, the object is merely added
- to the queue and handled later on by the timer-driven _processNextItemInQueue
- method.
+ Called by the worker threads once an item has been claimed from the queue and
+ a token taken for it; at most WO_COVER_DOWNLOAD_WORKERS downloads are ever in
+ progress at once. Checks whether the user preferences allow network connections
+ for the purpose of downloading cover images and, if so, performs the search
+ and download. Returns NO (without making any request) if they do not, in which
+ case the caller returns the item to the queue.
 "*/
 {
-    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
-
     // are we allowed to connect on demand?
     // or failing that, is there a network connection already established?
-    if ([[SynergyController sharedInstance] hitAmazon] &&
-        ([self connectOnDemand] || [self _netConnectionEstablished]))
-        // will also do the download if it finds a suitable candidate
-        [self _searchForAlbumCover:song];
+    if (!([[SynergyController sharedInstance] hitAmazon] &&
+          ([self connectOnDemand] || [self _netConnectionEstablished])))
+        return NO;
 
-    [pool drain];
+    // will also do the download if it finds a suitable candidate
+    [self _searchForAlbumCover:song];
+    return YES;
 }
 
 
@@ -506,44 +797,14 @@ This is the method that does the actual work of formatting an appropriate query
     }
     WOAmazonLog(@"Search keywords (before filtering): %@", searchKeywords);
 
-    // additional filtering/pre-processing
+    // additional filtering/pre-processing: fold case and accents (amazon
+    // seems to choke on them) and strip "(Disc 1)" and the like, all in one
+    // pass; the same normalized names key the cover index
     if ([self preprocess])
     {
-        // should I also convert accented characters to non-accented versions?
-        // amazon seems to choke on them...
-
         // strip out things between () if first search fails?
         // strip out stuff after "-" if fails?
-
-        // words to strip -- words are stripped in order, so important to strip
-        // "(Disc 1)" before "Disc 1"
-        NSArray *filterWords = [NSArray arrayWithObjects:
-            @"(Disc 1)",
-            @"Disc 1",
-            @"(Disc 2)",
-            @"Disc 2",
-            @"(OST)",
-            @"OST",
-            @"soundtrack",
-            @"(single)",
-            @"(CD1)",
-            @"CD1",
-            @"(CD2)",
-            @"CD2",
-            @"(remix)",
-
-            // and for the French
-            @"Disque 1",
-            @"Disque 2",
-
-            // other reader suggestions
-            @"[Bonus Tracks]",
-
-            nil];
-
-        // strip out the filtered words
-        for (NSString *filterWord in filterWords)
-            [searchKeywords setString:[searchKeywords stringByRemoving:filterWord]];
+        [searchKeywords setString:[[WOKeywordNormalizer sharedNormalizer] normalizedString:searchKeywords]];
     }
     WOAmazonLog(@"Search keywords (after filtering): %@", searchKeywords);
 
@@ -635,16 +896,29 @@ This is the method that does the actual work of formatting an appropriate query
     //                      URL
     //                  LargeImage
     //                      URL
+    //
+    // the shared client keeps the connection to ecs.amazonaws.com open
+    // between searches; the worker just waits for the reply
     WOAmazonLog(@"Query URL: %@", queryURL);
     NSError *error = nil;
-    NSXMLDocument *xml = [[NSXMLDocument alloc] initWithContentsOfURL:queryURL
-                                                              options:NSDataReadingUncached
-                                                                error:&error];
-    if (error)
+    NSMutableData *reply = [NSMutableData data];
+    WOHTTPRequest *request = [WOHTTPRequest requestWithURL:queryURL];
+    [request setValue:WO_COVER_USER_AGENT forHTTPHeaderField:@"User-Agent"];
+    [request setResponseBuffer:reply];
+    if (![[WOHTTPClient sharedClient] sendSynchronousRequest:request])
     {
-        WOAmazonLog(@"-[NSXMLDocument initWithContentsOfURL:options:error:] failed: %@",
-            [error localizedDescription]);
-        [song incrementRetryInterval];
+        WOAmazonLog(@"Cover search failed: %@", [[request error] localizedDescription]);
+        [self _giveUpOnSong:song reason:WOCoverMissNetworkError];
+        return;
+    }
+
+    // error replies from ECS are XML too; anything else (a proxy's error page,
+    // say) is not an outage, so must not hold up the backfill
+    NSXMLDocument *xml = [[NSXMLDocument alloc] initWithData:reply options:0 error:&error];
+    if (!xml)
+    {
+        WOAmazonLog(@"Unreadable cover search reply: %@", [error localizedDescription]);
+        [self _giveUpOnSong:song reason:WOCoverMissBadReply];
         return;
     }
     WOAmazonLog(@"Result: %@", [xml XMLString]);
@@ -695,39 +969,18 @@ This is the method that does the actual work of formatting an appropriate query
     }
 
     // if no URL found, we've failed
+    //
+    // likely cause for failure: not found in amazon database, or only a 1x1
+    // placeholder image there
+    // likely remedy: no remedy (for a good while, at least)
+    //
+    // either way it's remembered in the cover index so that the search isn't
+    // repeated on the next run, and the item doesn't hang around the queue
+    // taking up memory; transient network failures are dealt with (and
+    // remembered for a shorter time) as they happen
     if (!imageURL)
-    {
-        // failure
-        //
-        // this is the kind of failure from which we are unlikely to recover
-        // do we want this kind of thing to hang around in the queue forever,
-        // taking up memory and resources?
-        //
-        // likely cause for failure: not found in amazon database
-        // likely remedy: no remedy
-        //
-        // likely cause: transient network failure
-        // likely remedy: eventual restoration of network connectivity
-        //
-        // in the former case, we definitely don't want it hanging around the
-        // queue
-        //
-        // in the latter case, it's ok if it hangs around the queue
-        //
-        if (haveURL)
-            // only return item to queue if the failure is not likely to be
-            // permanent
-            [song incrementRetryInterval];
-        else
-            // remove the item from the queue
-            // policy change 27 March 2004: don't retry here... I suspect what
-            // was happening was it was getting re-added straight away (ie. not
-            // when the song was played again, but literally three seconds
-            // later...) so now, it will only retry on next Synergy run...
-            // benefit: less load on Amazon servers, cost: additional memory
-            // used because song stays in queue
-            [song setReadyToRetry:NO];
-    }
+        [self _giveUpOnSong:song
+                     reason:(haveURL ? WOCoverMissPlaceholder : WOCoverMissNoResult)];
 }
 
 + (BOOL)_downloadAlbumCover:(WOSongInfo *)song
@@ -745,43 +998,48 @@ This is the method that does the actual work of formatting an appropriate query
     BOOL returnStatus = YES;
 
     NS_DURING
-        // this will block until the data is completely retrieved
-        NSImage *coverImage = [[NSImage alloc] initWithContentsOfURL:cover];
+        // this will block until the data is completely retrieved (image hosts
+        // are reached over kept-alive connections too)
+        NSMutableData *coverData = [NSMutableData data];
+        WOHTTPRequest *request = [WOHTTPRequest requestWithURL:cover];
+        [request setValue:WO_COVER_USER_AGENT forHTTPHeaderField:@"User-Agent"];
+        [request setResponseBuffer:coverData];
+        [request setMaximumResponseLength:WO_COVER_MAXIMUM_IMAGE_BYTES];
 
         // did it work?
-        if (!coverImage)
+        if (![[WOHTTPClient sharedClient] sendSynchronousRequest:request] ||
+            [request statusCode] != 200 || [coverData length] == 0)
         {
             [NSException raise:WO_DOWNLOAD_ALBUM_COVER_IMAGE_FAILURE
                         format:WO_DOWNLOAD_ALBUM_COVER_IMAGE_FAILURE_TEXT];
         }
 
-        // check to see if it's one of Amazon's 1x1 pixel gifs!
-        NSSize imageSize = [coverImage size];
-
-        if ((imageSize.width == 1) ||
-            (imageSize.height == 1))
+        // check to see if it's one of Amazon's 1x1 pixel gifs! (the header
+        // is enough; no need to decode)
+        unsigned format, width, height;
+        if ([WOCoverStore sniffImageData:coverData format:&format width:&width height:&height] &&
+            ((width == 1) || (height == 1)))
         {
             // consider this a failure
             returnStatus = NO;
         }
         else
         {
-            // save a copy to disk; make a jpeg
-            NSData *tiffData =
-            [coverImage TIFFRepresentationUsingCompression:NSTIFFCompressionLZW
-                                                    factor:1.0];
-            NSBitmapImageRep    *rep = [NSBitmapImageRep imageRepWithData:tiffData];
-            NSNumber            *quality = [NSNumber numberWithFloat:0.80];
-            NSDictionary        *properties = [NSDictionary dictionaryWithObject:quality
-                                                                          forKey:NSImageCompressionFactor];
-            NSData *coverData = [rep representationUsingType:NSJPEGFileType properties:properties];
-
-            // actually write the jpg out to disk
-            if (![coverData writeToFile:[self _filenameWithPath:song]
-                             atomically:YES])
+            WOCoverStore *store = [self coverStore];
+            if (!store || ![song coverKey])
+                [NSException raise:WO_STORE_ALBUM_COVER_IMAGE_FAILURE
+                            format:WO_STORE_ALBUM_COVER_IMAGE_FAILURE_TEXT];
+
+            // save the bytes to disk as they came (with pre-scaled variants),
+            // then index them
+            WOCoverRecord record;
+            memset(&record, 0, sizeof(record));
+            record.key      = [song coverKey];
+            record.location = WOCoverLocationPermanent;
+            if (![store ingestImageData:coverData record:&record buyNowURL:[song buyNowURL]])
             {
-                [NSException raise:WO_DOWNLOAD_ALBUM_COVER_IMAGE_FAILURE
-                            format:WO_DOWNLOAD_ALBUM_COVER_IMAGE_FAILURE_TEXT];
+                [NSException raise:WO_STORE_ALBUM_COVER_IMAGE_FAILURE
+                            format:WO_STORE_ALBUM_COVER_IMAGE_FAILURE_TEXT];
             }
 
             // note that download is done....
@@ -807,24 +1065,15 @@ This is the method that does the actual work of formatting an appropriate query
         ELOG(@"%@", [localException reason]);
 
         // although we failed to get the image, we still return YES here
-        // because in returning the download to the end of the queue we are
-        // still successfully "handling" the download request
+        // because in recording the failure we are still successfully
+        // "handling" the download request
         returnStatus = YES;
 
-        // return download to *end* of queue, extending timer as necessary
-
-        [_downloadQueueLock lock];
-
-        // first remove it from the queue
-        [_downloadQueue removeObject:song];
-
-        // increment its retry interval
-        [song incrementRetryInterval];
-
-        // then add it back in at the end
-        [_downloadQueue insertObject:song atIndex:0];
-
-        [_downloadQueueLock unlock];
+        // only a failed download is an outage: anything else (a full disk,
+        // say) would otherwise stall the backfill
+        [self _giveUpOnSong:song
+                     reason:([[localException name] isEqualToString:WO_DOWNLOAD_ALBUM_COVER_IMAGE_FAILURE] ?
+                             WOCoverMissNetworkError : WOCoverMissLocalError)];
 
     NS_ENDHANDLER
 
@@ -837,29 +1086,6 @@ This is the method that does the actual work of formatting an appropriate query
     return [self _albumCoversPath];
 }
 
-+ (NSString *)_filenameWithPath:(WOSongInfo *)song
-/*"
- Returns a suitable file name and full path for which an album cover image. The
- filename is comprised of album-artist with a jpg extension; the WOSongInfo
- object handles construction of the filename based on its artist and album
- instance variables.
-"*/
-{
-    NSString *filenameWithPath = nil;
-
-    // filename should already be in the WOSongInfo object
-    if (![song filename])
-        // not enough information to construct filename!
-        return nil;
-
-    // but need to calculate path
-    filenameWithPath =
-        [[self _albumCoversPath] stringByAppendingPathComponent:
-            [song filename]];
-
-    return filenameWithPath;
-}
-
 + (NSString *)_albumCoversPath
 /*"
   Returns an NSString pointing to the album covers folder, creating it if
@@ -1078,4 +1304,26 @@ This is the method that does the actual work of formatting an appropriate query
     [_preprocessLock unlock];
 }
 
++ (double)requestsPerSecond
+{
+    [_downloadQueueCondition lock];
+    double returnValue = _requestsPerSecond;
+    [_downloadQueueCondition unlock];
+    return returnValue;
+}
+
++ (void)setRequestsPerSecond:(double)requestsPerSecond
+/*"
+ Sets the cap on the rate at which cover requests are made. Waiting workers are
+ woken so that they recompute how long to wait for the next token.
+"*/
+{
+    NSParameterAssert(requestsPerSecond > 0.0);
+    [_downloadQueueCondition lock];
+    [self _refillTokens];   // credit the time elapsed so far at the old rate
+    _requestsPerSecond = requestsPerSecond;
+    [_downloadQueueCondition broadcast];
+    [_downloadQueueCondition unlock];
+}
+
 @end
@@ -0,0 +1,183 @@
+//
+//  WOCoverStore.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class WOCoverCollector;
+
+//! \name Cover locations
+//! \startgroup
+
+#define WOCoverLocationPermanent    0   //!< "Album Covers"
+#define WOCoverLocationTemporary    1   //!< "Temporary Album Covers" (deleted at quit)
+#define WOCoverLocationNone         2   //!< searched for and not found; see WOCoverRecord.reason
+
+//! \endgroup
+
+//! \name Cover formats
+//! \startgroup
+
+#define WOCoverFormatJPEG           0
+#define WOCoverFormatTIFF           1
+#define WOCoverFormatPNG            2
+#define WOCoverFormatGIF            3
+
+//! \endgroup
+
+//! Number of pre-scaled variants generated for each cover at ingest; their longest sides are 128, 64, 32 and 16 pixels
+//! (largest notification icon, floater sizes down to the mini floater and menu thumbnail)
+#define WOCoverVariantCount         4
+
+//! \name Reasons a search found nothing
+//! \startgroup
+
+#define WOCoverMissNoResult         1   //!< the search returned no image URL
+#define WOCoverMissPlaceholder      2   //!< every image URL led to a 1x1 placeholder
+#define WOCoverMissNetworkError     3   //!< the search or the image download failed
+#define WOCoverMissBadReply         4   //!< the search service answered with something that was not XML
+#define WOCoverMissLocalError       5   //!< the image arrived but could not be stored
+
+//! \endgroup
+
+//! What the index knows about one cover, or about a search that found none
+typedef struct WOCoverRecord {
+    uint64_t    key;            //!< hash of the normalised artist/album/song name; never 0
+    uint32_t    URLOffset;      //!< offset of the "buy now" URL in the index's string pool
+    uint32_t    expires;        //!< misses only: seconds since 1970 after which the search may be tried again
+    uint16_t    width;          //!< in pixels; 0 if unknown
+    uint16_t    height;         //!< in pixels; 0 if unknown
+    uint16_t    URLLength;      //!< length in bytes of the UTF-8 "buy now" URL; 0 if none
+    uint8_t     location;       //!< WOCoverLocationPermanent, WOCoverLocationTemporary or WOCoverLocationNone
+    uint8_t     format;         //!< WOCoverFormatJPEG or WOCoverFormatTIFF
+    uint8_t     reason;         //!< misses only: one of the WOCoverMiss reasons
+    uint8_t     variants;       //!< bit i set if the i-th pre-scaled variant (largest first) exists
+    uint8_t     reserved[2];
+    uint32_t    bytes;          //!< covers only: size on disk of the image and all of its variants
+} WOCoverRecord;
+
+//! Content-addressed store of album cover images.
+//!
+//! Every cover is identified by a 64-bit hash of its normalised artist/album/song name (see keyForArtist:album:song:) and
+//! its image file is named after that hash, so its path can be computed without touching the disk. A compact index file
+//! in the "Album Covers" folder, memory-mapped and probed with open addressing, records for each key the image's
+//! location, format and dimensions plus the "buy now" URL; a lookup is a single hash probe with no filesystem calls.
+//!
+//! Every insertion or removal builds a new index in memory and swaps it in for lookups at once; lookups never wait for a
+//! change to be built or saved. The file is rewritten (to a temporary file, renamed into place) at most every few seconds
+//! and by synchronize, so a burst of insertions costs one write. If it is missing or damaged it is rebuilt from the
+//! folder's contents; covers saved by earlier versions under
+//! "Artist-...,Album-....jpg" names are renamed after their keys at the same time, and their ".plist" "buy now" links are
+//! carried over.
+//!
+//! When a cover is ingested its bytes are written out exactly as they arrived whenever the format (sniffed from the
+//! header) is one the floater can display, so a cover is never re-encoded on the way in. The image is then decoded once,
+//! straight to the size of the largest variant it needs, and a pyramid of smaller JPEG variants is derived from that, each
+//! scaled from the next larger one, so that consumers can load the variant nearest the size they need instead of
+//! decoding and rescaling the full-size image (see pathForRecord:fittingSize:).
+//!
+//! The index also remembers searches that found nothing ("misses"), with the reason and an expiry time, so that a cover
+//! known not to exist is not searched for again on every launch. Expired misses are dropped when the store is opened.
+//!
+//! Every successful lookup and ingest is reported to the store's collector, if it has one, which keeps the folder within
+//! a size quota by evicting the least recently used covers (see WOCoverCollector).
+//!
+//! \warn Threadsafe
+@interface WOCoverStore : NSObject {
+
+    NSString    *folder;
+
+    NSString    *temporaryFolder;
+
+    NSString    *indexPath;
+
+    //! Memory-mapped index, or the in-memory one that replaced it until it is saved; replaced wholesale on every change
+    NSData      *index;
+
+    //! Guards index; held only to read or swap the pointer, never across disk access
+    NSLock      *lock;
+
+    //! Serialises changes, which are built from the current index and saved while holding only this
+    NSLock      *writeLock;
+
+    //! When the index file was last written; guarded by writeLock
+    NSTimeInterval  savedAt;
+
+    //! YES if index has changes the file lacks; guarded by writeLock
+    BOOL        unsaved;
+
+    WOCoverCollector    *collector;
+}
+
+//! Returns the key for a track, mirroring the search order of WOCoverDownloader (album and artist, then song and
+//! artist, then album, then song); returns 0 if there is not enough information to identify a cover. The names are
+//! normalized first (see WOKeywordNormalizer), so "Abbey Road (Disc 1)" and "ABBEY ROAD" share a cover.
++ (uint64_t)keyForArtist:(NSString *)anArtist album:(NSString *)anAlbum song:(NSString *)aSong;
+
+//! Returns YES if the header of \p data identifies it as a JPEG, PNG, GIF or TIFF image, which can be stored as-is, and
+//! sets \p format accordingly; \p width and \p height are set from the header where that is cheap (0 otherwise). Does not
+//! decode the image.
++ (BOOL)sniffImageData:(NSData *)data format:(unsigned *)format width:(unsigned *)width height:(unsigned *)height;
+
+//! Maps (or rebuilds) the index in \p aFolder; covers in \p aTemporaryFolder are forgotten when the store is opened
+- (id)initWithFolder:(NSString *)aFolder temporaryFolder:(NSString *)aTemporaryFolder;
+
+//! Returns YES and fills in \p record (and \p aURL, if non-NULL, with the "buy now" URL or nil) if the index has a cover
+//! for \p key
+- (BOOL)lookupKey:(uint64_t)key record:(WOCoverRecord *)record buyNowURL:(NSURL **)aURL;
+
+//! Returns YES (and the reason, if \p reason is non-NULL) if a search for \p key found nothing and has not yet expired
+- (BOOL)isKnownMissingKey:(uint64_t)key reason:(unsigned *)reason;
+
+//! Returns the path of the image file for \p key; the file need not exist yet
+- (NSString *)pathForKey:(uint64_t)key location:(unsigned)location format:(unsigned)format;
+
+- (NSString *)pathForRecord:(const WOCoverRecord *)record;
+
+//! Returns the path of the smallest variant of \p record's image whose longest side is at least \p side pixels, or of
+//! the full-size image if there is no such variant
+- (NSString *)pathForRecord:(const WOCoverRecord *)record fittingSize:(float)side;
+
+//! Returns the paths of \p record's pre-scaled variants (NSString) keyed by their longest side in pixels (NSNumber)
+- (NSDictionary *)variantPathsForRecord:(const WOCoverRecord *)record;
+
+//! Returns YES and fills in \p record if \p path names an image in the store (as returned by pathForRecord:) that the
+//! index has a cover for; does not touch the disk
+- (BOOL)lookupPath:(NSString *)path record:(WOCoverRecord *)record;
+
+//! Writes \p data (an encoded image) to pathForRecord: along with its pre-scaled variants, then adds \p record to the
+//! index; \p record need only have its key and location filled in, and on return also has its format, dimensions and
+//! variants. The bytes are written verbatim unless sniffImageData:format:width:height: does not recognise them, in which
+//! case they are transcoded to JPEG. Files of a cover previously stored under the same key that the new one does not
+//! overwrite (another format or location, fewer variants) are deleted. Returns NO if the image could not be decoded or
+//! written.
+- (BOOL)ingestImageData:(NSData *)data record:(WOCoverRecord *)record buyNowURL:(NSURL *)aURL;
+
+//! Adds or replaces the entry for \p record's key; if \p aURL is nil any existing "buy now" URL is kept. The image file
+//! should already be in place at pathForRecord:.
+- (BOOL)addRecord:(const WOCoverRecord *)record buyNowURL:(NSURL *)aURL;
+
+//! Records that a search for \p key found nothing, for \p reason; the search may be tried again after \p lifetime
+//! seconds. Replaces any existing entry, except that a cover is never replaced by a miss.
+- (BOOL)addMissForKey:(uint64_t)key reason:(unsigned)reason lifetime:(NSTimeInterval)lifetime;
+
+//! Returns the index entries for every cover (but not for misses) as packed WOCoverRecord structs in host byte order
+- (NSData *)coverRecords;
+
+//! Drops the covers for the \p count keys at \p keys from the index (rewriting it once) and then deletes their image
+//! files and variants; misses are left alone. Returns the number of covers removed.
+- (NSUInteger)removeCoversForKeys:(const uint64_t *)keys count:(NSUInteger)count;
+
+//! Writes out any changes not yet saved to the index file; returns NO if it could not be written
+- (BOOL)synchronize;
+
+#pragma mark -
+#pragma mark Properties
+
+//! Told about every cover that is looked up or ingested; should be set before the store is shared between threads
+@property(assign) WOCoverCollector *collector;
+
+@end
@@ -0,0 +1,961 @@
+// WOCoverStore.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOCoverStore.h"
+
+// system headers
+#import <ApplicationServices/ApplicationServices.h>   /* CGImageSource, CGImageDestination */
+#import <math.h>
+#import <time.h>
+
+// other headers
+#import "WOCoverCollector.h"
+#import "WOCoverImageCache.h"
+#import "WOKeywordNormalizer.h"
+
+//! Index file name inside the "Album Covers" folder
+#define WO_COVER_INDEX_FILENAME         @"Cover Index"
+
+//! Marks the start of the index file ("WOCI")
+#define WO_COVER_INDEX_MAGIC            0x574F4349U
+
+#define WO_COVER_INDEX_VERSION          3   /* 2 added WOCoverRecord.bytes, 3 keys normalized names */
+
+//! Smallest number of slots in the hash table; always a power of two
+#define WO_COVER_INDEX_MIN_CAPACITY     64
+
+//! Changes are written to the index file at most this often (in seconds); the rest wait for the next change or for
+//! synchronize
+#define WO_COVER_INDEX_SAVE_INTERVAL    5.0
+
+//! JPEG quality of the pre-scaled variants (as for full-size covers)
+#define WO_COVER_VARIANT_QUALITY        0.8
+
+//! 64-bit FNV-1a parameters
+#define WO_FNV_OFFSET_BASIS             0xcbf29ce484222325ULL
+#define WO_FNV_PRIME                    0x100000001b3ULL
+
+// file name extension for each format, indexed by WOCoverFormat value
+static NSString * const WOCoverExtensions[] = { @"jpg", @"tiff", @"png", @"gif" };
+
+// longest side of each pre-scaled variant, largest first; each is scaled from the one before it
+static const unsigned WOCoverVariantSizes[WOCoverVariantCount] = { 128, 64, 32, 16 };
+
+// all multi-byte fields are stored little-endian; followed by the hash table (capacity slots, each laid out as a
+// WOCoverRecord, with key 0 marking an empty slot) and then the string pool holding the "buy now" URLs
+typedef struct WOCoverIndexHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    capacity;       //!< number of slots; a power of two
+    uint32_t    count;          //!< number of occupied slots
+    uint32_t    poolLength;     //!< length of the string pool in bytes
+    uint32_t    reserved;
+} WOCoverIndexHeader;
+
+static void WOCoverRecordSwapLittleToHost(WOCoverRecord *record)
+{
+    record->key         = NSSwapLittleLongLongToHost(record->key);
+    record->expires     = NSSwapLittleIntToHost(record->expires);
+    record->width       = NSSwapLittleShortToHost(record->width);
+    record->height      = NSSwapLittleShortToHost(record->height);
+    record->URLLength   = NSSwapLittleShortToHost(record->URLLength);
+    record->URLOffset   = NSSwapLittleIntToHost(record->URLOffset);
+    record->bytes       = NSSwapLittleIntToHost(record->bytes);
+}
+
+static void WOCoverRecordSwapHostToLittle(WOCoverRecord *record)
+{
+    record->key         = NSSwapHostLongLongToLittle(record->key);
+    record->expires     = NSSwapHostIntToLittle(record->expires);
+    record->width       = NSSwapHostShortToLittle(record->width);
+    record->height      = NSSwapHostShortToLittle(record->height);
+    record->URLLength   = NSSwapHostShortToLittle(record->URLLength);
+    record->URLOffset   = NSSwapHostIntToLittle(record->URLOffset);
+    record->bytes       = NSSwapHostIntToLittle(record->bytes);
+}
+
+// FNV-1a over the UTF-16 units of the canonically decomposed name, skipping the characters that earlier versions
+// stripped from cover filenames (whitespace, newlines, ":" and "/"), so that a legacy filename hashes to the same key as
+// the track it was saved for (see WOCoverKeyForLegacyStem); returns 0 if nothing is left after stripping
+static uint64_t WOCoverHashName(NSString *name)
+{
+    CFStringRef decomposed = (CFStringRef)[name decomposedStringWithCanonicalMapping];
+    CFCharacterSetRef whitespace = CFCharacterSetGetPredefined(kCFCharacterSetWhitespaceAndNewline);
+    CFIndex length = CFStringGetLength(decomposed);
+    CFStringInlineBuffer buffer;
+    CFStringInitInlineBuffer(decomposed, &buffer, CFRangeMake(0, length));
+    uint64_t hash = WO_FNV_OFFSET_BASIS;
+    BOOL empty = YES;
+    for (CFIndex i = 0; i < length; i++)
+    {
+        UniChar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+        if (c == ':' || c == '/' || CFCharacterSetIsCharacterMember(whitespace, c))
+            continue;
+        hash = (hash ^ (c & 0xff)) * WO_FNV_PRIME;
+        hash = (hash ^ (c >> 8)) * WO_FNV_PRIME;
+        empty = NO;
+    }
+    if (empty)
+        return 0;
+    return hash ? hash : 1; // 0 marks an empty slot
+}
+
+// the key for names that have already been normalized; 0 if there is nothing to key on
+static uint64_t WOCoverKeyForNames(NSString *artist, NSString *album, NSString *song)
+{
+    NSString *name;
+    if ([album length] > 0 && [artist length] > 0)
+        name = [NSString stringWithFormat:@"Artist-%@,Album-%@", artist, album];
+    else if ([song length] > 0 && [artist length] > 0)
+        name = [NSString stringWithFormat:@"Artist-%@,Song-%@", artist, song];
+    else if ([album length] > 0)
+        name = [NSString stringWithFormat:@"Album-%@", album];
+    else if ([song length] > 0)
+        name = [NSString stringWithFormat:@"Song-%@", song];
+    else
+        return 0;
+    return WOCoverHashName(name);
+}
+
+// the key for a cover saved by an earlier version as "Artist-...,Album-...", "Artist-...,Song-...", "Album-..." or
+// "Song-..." (with whitespace stripped); 0 if the stem is not in that form. The names are normalized without relying on
+// whitespace, so that "AbbeyRoad(Disc1)" keys like "Abbey Road (Disc 1)" does.
+static uint64_t WOCoverKeyForLegacyStem(NSString *stem)
+{
+    NSString *artist = nil;
+    if ([stem hasPrefix:@"Artist-"])
+    {
+        NSRange album = [stem rangeOfString:@",Album-"];
+        NSRange song = [stem rangeOfString:@",Song-"];
+        NSRange separator = (album.location != NSNotFound) ? album : song;
+        if (separator.location == NSNotFound)
+            return 0;
+        artist = [stem substringWithRange:NSMakeRange(7, separator.location - 7)];
+        stem = [stem substringFromIndex:separator.location + 1];
+    }
+    WOKeywordNormalizer *normalizer = [WOKeywordNormalizer sharedNormalizer];
+    artist = [normalizer normalizedStringIgnoringWhitespace:artist];
+    if ([stem hasPrefix:@"Album-"])
+        return WOCoverKeyForNames(artist, [normalizer normalizedStringIgnoringWhitespace:[stem substringFromIndex:6]], nil);
+    else if ([stem hasPrefix:@"Song-"])
+        return WOCoverKeyForNames(artist, nil, [normalizer normalizedStringIgnoringWhitespace:[stem substringFromIndex:5]]);
+    return 0;
+}
+
+// parses a content-addressed file name stem (16 lowercase hex digits)
+static BOOL WOCoverParseKey(NSString *stem, uint64_t *key)
+{
+    if ([stem length] != 16)
+        return NO;
+    uint64_t value = 0;
+    for (NSUInteger i = 0; i < 16; i++)
+    {
+        unichar c = [stem characterAtIndex:i];
+        if (c >= '0' && c <= '9')
+            value = (value << 4) | (c - '0');
+        else if (c >= 'a' && c <= 'f')
+            value = (value << 4) | (c - 'a' + 10);
+        else
+            return NO;
+    }
+    if (value == 0)
+        return NO;
+    *key = value;
+    return YES;
+}
+
+// walks the JPEG marker segments up to the first start-of-frame, which holds the dimensions
+static BOOL WOCoverReadJPEGDimensions(const uint8_t *bytes, NSUInteger length, unsigned *width, unsigned *height)
+{
+    NSUInteger offset = 2;
+    while (offset + 4 <= length)
+    {
+        if (bytes[offset] != 0xff)
+            return NO;
+        uint8_t marker = bytes[offset + 1];
+        if (marker == 0xff)             // fill byte
+        {
+            offset++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd9))
+        {
+            offset += 2;                // standalone marker: no length
+            continue;
+        }
+        NSUInteger segmentLength = (bytes[offset + 2] << 8) | bytes[offset + 3];
+        if (segmentLength < 2)
+            return NO;
+
+        // SOF0-SOF15, except DHT (c4), JPG (c8) and DAC (cc)
+        if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+        {
+            if (offset + 9 > length)
+                return NO;
+            *height = (bytes[offset + 5] << 8) | bytes[offset + 6];
+            *width  = (bytes[offset + 7] << 8) | bytes[offset + 8];
+            return YES;
+        }
+        offset += 2 + segmentLength;
+    }
+    return NO;
+}
+
+// reads just enough of the image file at path to learn its dimensions
+static void WOCoverReadDimensions(NSString *path, WOCoverRecord *record)
+{
+    CGImageSourceRef source = CGImageSourceCreateWithURL((CFURLRef)[NSURL fileURLWithPath:path], NULL);
+    if (!source)
+        return;
+    NSDictionary *properties = NSMakeCollectable(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+    CFRelease(source);
+    NSUInteger width = [[properties objectForKey:(NSString *)kCGImagePropertyPixelWidth] unsignedIntegerValue];
+    NSUInteger height = [[properties objectForKey:(NSString *)kCGImagePropertyPixelHeight] unsignedIntegerValue];
+    record->width   = (uint16_t)MIN(width, (NSUInteger)UINT16_MAX);
+    record->height  = (uint16_t)MIN(height, (NSUInteger)UINT16_MAX);
+}
+
+static uint32_t WOCoverFileSize(NSString *path)
+{
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:NULL];
+    return (uint32_t)MIN([attributes fileSize], (unsigned long long)UINT32_MAX);
+}
+
+// scales image (whose original dimensions are width x height) so that its longest side is side pixels
+static CGImageRef WOCoverCreateScaledImage(CGImageRef image, unsigned side, size_t width, size_t height)
+{
+    size_t longest = MAX(width, height);
+    size_t scaledWidth = MAX((size_t)1, (size_t)round((double)width * side / longest));
+    size_t scaledHeight = MAX((size_t)1, (size_t)round((double)height * side / longest));
+    CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, scaledWidth, scaledHeight, 8, 0, space,
+                                                 kCGImageAlphaNoneSkipLast);
+    CGColorSpaceRelease(space);
+    if (!context)
+        return NULL;
+    CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+    CGContextDrawImage(context, CGRectMake(0, 0, scaledWidth, scaledHeight), image);
+    CGImageRef scaled = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    return scaled;
+}
+
+static NSData *WOCoverJPEGData(CGImageRef image)
+{
+    NSMutableData *data = [NSMutableData data];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((CFMutableDataRef)data, CFSTR("public.jpeg"),
+                                                                         1, NULL);
+    if (!destination)
+        return nil;
+    NSDictionary *properties =
+        [NSDictionary dictionaryWithObject:[NSNumber numberWithFloat:WO_COVER_VARIANT_QUALITY]
+                                    forKey:(NSString *)kCGImageDestinationLossyCompressionQuality];
+    CGImageDestinationAddImage(destination, image, (CFDictionaryRef)properties);
+    BOOL finalized = CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    return finalized ? data : nil;
+}
+
+// probes a validated index for key; returns the slot (in little-endian byte order) or NULL
+static const WOCoverRecord *WOCoverIndexFind(NSData *index, uint64_t key)
+{
+    if (!index || key == 0)
+        return NULL;
+    const WOCoverIndexHeader *header = [index bytes];
+    const WOCoverRecord *slots = (const WOCoverRecord *)(header + 1);
+    uint32_t capacity = NSSwapLittleIntToHost(header->capacity);
+    uint32_t mask = capacity - 1;
+    for (uint32_t probe = 0, i = (uint32_t)key & mask; probe < capacity; probe++, i = (i + 1) & mask)
+    {
+        uint64_t slotKey = NSSwapLittleLongLongToHost(slots[i].key);
+        if (slotKey == 0)
+            return NULL;
+        if (slotKey == key)
+            return slots + i;
+    }
+    return NULL;
+}
+
+@interface WOCoverStore ()
+
+- (BOOL)loadIndex;
+- (BOOL)rebuildIndex;
+- (void)copyEntriesOfIndex:(NSData *)anIndex
+                      into:(NSMutableData *)records
+                      pool:(NSMutableData *)pool
+                   purging:(BOOL)purge;
+- (BOOL)replaceEntry:(WOCoverRecord *)entry inRecords:(NSMutableData *)records keepingCover:(BOOL)keepCover;
+- (NSString *)pathForVariant:(unsigned)variant ofKey:(uint64_t)key location:(unsigned)location;
+- (void)removeFilesOfRecord:(const WOCoverRecord *)gone keepingFilesOf:(const WOCoverRecord *)kept;
+- (BOOL)installIndexWithRecords:(NSData *)records pool:(NSData *)pool;
+- (BOOL)saveIndex;
+
+@end
+
+@implementation WOCoverStore
+
+#pragma mark -
+#pragma mark NSObject overrides
+
++ (uint64_t)keyForArtist:(NSString *)anArtist album:(NSString *)anAlbum song:(NSString *)aSong
+{
+    WOKeywordNormalizer *normalizer = [WOKeywordNormalizer sharedNormalizer];
+    anArtist    = [normalizer normalizedString:anArtist];
+    anAlbum     = [normalizer normalizedString:anAlbum];
+    aSong       = [normalizer normalizedString:aSong];
+    return WOCoverKeyForNames(anArtist, anAlbum, aSong);
+}
+
++ (BOOL)sniffImageData:(NSData *)data format:(unsigned *)format width:(unsigned *)width height:(unsigned *)height
+{
+    NSParameterAssert(format != NULL && width != NULL && height != NULL);
+    const uint8_t *bytes = [data bytes];
+    NSUInteger length = [data length];
+    *width  = 0;
+    *height = 0;
+    if (length >= 4 && bytes[0] == 0xff && bytes[1] == 0xd8 && bytes[2] == 0xff)
+    {
+        *format = WOCoverFormatJPEG;
+        (void)WOCoverReadJPEGDimensions(bytes, length, width, height);
+    }
+    else if (length >= 24 && memcmp(bytes, "\x89PNG\r\n\x1a\n", 8) == 0)
+    {
+        *format = WOCoverFormatPNG;
+        if (memcmp(bytes + 12, "IHDR", 4) == 0)
+        {
+            *width  = ((uint32_t)bytes[16] << 24) | (bytes[17] << 16) | (bytes[18] << 8) | bytes[19];
+            *height = ((uint32_t)bytes[20] << 24) | (bytes[21] << 16) | (bytes[22] << 8) | bytes[23];
+        }
+    }
+    else if (length >= 10 && (memcmp(bytes, "GIF87a", 6) == 0 || memcmp(bytes, "GIF89a", 6) == 0))
+    {
+        // logical screen size; enough to spot Amazon's 1x1 placeholders
+        *format = WOCoverFormatGIF;
+        *width  = bytes[6] | (bytes[7] << 8);
+        *height = bytes[8] | (bytes[9] << 8);
+    }
+    else if (length >= 8 && (memcmp(bytes, "II*\0", 4) == 0 || memcmp(bytes, "MM\0*", 4) == 0))
+        *format = WOCoverFormatTIFF;    // dimensions are buried in the first IFD; left to ImageIO
+    else
+        return NO;
+    return YES;
+}
+
+- (id)initWithFolder:(NSString *)aFolder temporaryFolder:(NSString *)aTemporaryFolder
+{
+    NSParameterAssert(aFolder != nil);
+    NSParameterAssert(aTemporaryFolder != nil);
+    if ((self = [super init]))
+    {
+        self->folder            = [aFolder copy];
+        self->temporaryFolder   = [aTemporaryFolder copy];
+        self->indexPath         = [aFolder stringByAppendingPathComponent:WO_COVER_INDEX_FILENAME];
+        self->lock              = [[NSLock alloc] init];
+        self->writeLock         = [[NSLock alloc] init];
+
+        [writeLock lock];
+        if (![self loadIndex] && ![self rebuildIndex])
+            NSLog(@"warning: could not build album cover index at %@", indexPath);
+        else
+        {
+            // temporary covers do not outlive the run that saved them, nor misses their expiry
+            NSMutableData *records = [NSMutableData data];
+            NSMutableData *pool = [NSMutableData data];
+            [self copyEntriesOfIndex:index into:records pool:pool purging:YES];
+            const WOCoverIndexHeader *header = [index bytes];
+            if ([records length] / sizeof(WOCoverRecord) != NSSwapLittleIntToHost(header->count))
+                [self installIndexWithRecords:records pool:pool];
+        }
+        [writeLock unlock];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (BOOL)lookupKey:(uint64_t)key record:(WOCoverRecord *)record buyNowURL:(NSURL **)aURL
+{
+    NSParameterAssert(record != NULL);
+    [lock lock];
+    NSData *current = index;
+    [lock unlock];
+
+    // index was validated when it was mapped
+    const WOCoverRecord *slot = WOCoverIndexFind(current, key);
+    if (!slot || slot->location == WOCoverLocationNone)
+        return NO;
+    *record = *slot;
+    WOCoverRecordSwapLittleToHost(record);
+    [collector noteAccessToKey:key];
+    if (aURL)
+    {
+        *aURL = nil;
+        const WOCoverIndexHeader *header = [current bytes];
+        const char *pool = (const char *)((const WOCoverRecord *)(header + 1) + NSSwapLittleIntToHost(header->capacity));
+        if (record->URLLength > 0 &&
+            (uint64_t)record->URLOffset + record->URLLength <= NSSwapLittleIntToHost(header->poolLength))
+        {
+            NSString *URLString = [[NSString alloc] initWithBytes:pool + record->URLOffset
+                                                           length:record->URLLength
+                                                         encoding:NSUTF8StringEncoding];
+            if (URLString)
+                *aURL = [NSURL URLWithString:URLString];
+        }
+    }
+    return YES;
+}
+
+- (BOOL)isKnownMissingKey:(uint64_t)key reason:(unsigned *)reason
+{
+    [lock lock];
+    NSData *current = index;
+    [lock unlock];
+    const WOCoverRecord *slot = WOCoverIndexFind(current, key);
+    if (!slot || slot->location != WOCoverLocationNone ||
+        NSSwapLittleIntToHost(slot->expires) <= (uint32_t)time(NULL))
+        return NO;
+    if (reason)
+        *reason = slot->reason;
+    return YES;
+}
+
+- (NSString *)pathForKey:(uint64_t)key location:(unsigned)location format:(unsigned)format
+{
+    NSParameterAssert(format <= WOCoverFormatGIF);
+    NSString *name = [NSString stringWithFormat:@"%016llx.%@", (unsigned long long)key, WOCoverExtensions[format]];
+    return [((location == WOCoverLocationTemporary) ? temporaryFolder : folder) stringByAppendingPathComponent:name];
+}
+
+- (NSString *)pathForRecord:(const WOCoverRecord *)record
+{
+    NSParameterAssert(record != NULL);
+    return [self pathForKey:record->key location:record->location format:record->format];
+}
+
+- (NSString *)pathForRecord:(const WOCoverRecord *)record fittingSize:(float)side
+{
+    NSParameterAssert(record != NULL);
+
+    // variants are largest first, so the last one that is big enough is the smallest that fits
+    int best = -1;
+    for (unsigned i = 0; i < WOCoverVariantCount; i++)
+        if ((record->variants & (1 << i)) && WOCoverVariantSizes[i] >= side)
+            best = i;
+    if (best == -1)
+        return [self pathForRecord:record];
+    return [self pathForVariant:best ofKey:record->key location:record->location];
+}
+
+- (NSDictionary *)variantPathsForRecord:(const WOCoverRecord *)record
+{
+    NSParameterAssert(record != NULL);
+    NSMutableDictionary *paths = [NSMutableDictionary dictionary];
+    for (unsigned i = 0; i < WOCoverVariantCount; i++)
+        if (record->variants & (1 << i))
+            [paths setObject:[self pathForVariant:i ofKey:record->key location:record->location]
+                      forKey:[NSNumber numberWithUnsignedInt:WOCoverVariantSizes[i]]];
+    return paths;
+}
+
+- (BOOL)lookupPath:(NSString *)path record:(WOCoverRecord *)record
+{
+    uint64_t key;
+    if (!path || !WOCoverParseKey([[path lastPathComponent] stringByDeletingPathExtension], &key))
+        return NO;
+    return [self lookupKey:key record:record buyNowURL:NULL] && [[self pathForRecord:record] isEqualToString:path];
+}
+
+- (BOOL)ingestImageData:(NSData *)data record:(WOCoverRecord *)record buyNowURL:(NSURL *)aURL
+{
+    NSParameterAssert(data != nil);
+    NSParameterAssert(record != NULL);
+    if (record->key == 0)
+        return NO;
+
+    CGImageSourceRef source = CGImageSourceCreateWithData((CFDataRef)data, NULL);
+    if (!source)
+        return NO;
+    unsigned format, width, height;
+    if (![[self class] sniffImageData:data format:&format width:&width height:&height])
+    {
+        // something the floater can't be relied on to read (PICT, BMP...): the only case that is re-encoded
+        CGImageRef image = CGImageSourceCreateImageAtIndex(source, 0, NULL);
+        data = image ? WOCoverJPEGData(image) : nil;
+        if (image)
+            CGImageRelease(image);
+        format = WOCoverFormatJPEG;
+        width = height = 0;
+    }
+    if (data && (width == 0 || height == 0))
+    {
+        // header only; no decode
+        NSDictionary *properties = NSMakeCollectable(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+        width   = [[properties objectForKey:(NSString *)kCGImagePropertyPixelWidth] unsignedIntValue];
+        height  = [[properties objectForKey:(NSString *)kCGImagePropertyPixelHeight] unsignedIntValue];
+    }
+    // a cover already stored under this key may leave files behind that the new one won't overwrite
+    WOCoverRecord previousRecord;
+    BOOL replacing = [self lookupKey:record->key record:&previousRecord buyNowURL:NULL];
+
+    record->format = format;
+    NSString *path = [self pathForRecord:record];
+    if (!data || width == 0 || height == 0 || ![data writeToFile:path atomically:YES])
+    {
+        CFRelease(source);
+        return NO;
+    }
+    WOCoverImageCache *cache = [WOCoverImageCache sharedCache];
+    [cache removeImageForPath:path];
+    uint64_t bytes = [data length];
+
+    record->width       = (uint16_t)MIN(width, (unsigned)UINT16_MAX);
+    record->height      = (uint16_t)MIN(height, (unsigned)UINT16_MAX);
+    record->variants    = 0;
+    CGImageRef previous = NULL;
+    for (unsigned i = 0; i < WOCoverVariantCount; i++)
+    {
+        // never scale up: for sizes beyond the original the full-size image serves
+        if (MAX(width, height) <= WOCoverVariantSizes[i])
+            continue;
+        CGImageRef scaled;
+        if (!previous)
+        {
+            // the only decode this cover will ever need, straight to the largest variant's size (a JPEG decoder
+            // can skip most of the work of a full-size decode)
+            NSDictionary *options = [NSDictionary dictionaryWithObjectsAndKeys:
+                (id)kCFBooleanTrue,                 (NSString *)kCGImageSourceCreateThumbnailFromImageAlways,
+                [NSNumber numberWithUnsignedInt:WOCoverVariantSizes[i]],
+                                                    (NSString *)kCGImageSourceThumbnailMaxPixelSize,
+                nil];
+            scaled = CGImageSourceCreateThumbnailAtIndex(source, 0, (CFDictionaryRef)options);
+        }
+        else
+            scaled = WOCoverCreateScaledImage(previous, WOCoverVariantSizes[i], width, height);
+        if (!scaled)
+            break;
+        NSData *encoded = WOCoverJPEGData(scaled);
+        NSString *variantPath = [self pathForVariant:i ofKey:record->key location:record->location];
+        if ([encoded writeToFile:variantPath atomically:YES])
+        {
+            record->variants |= (1 << i);
+            bytes += [encoded length];
+        }
+        [cache removeImageForPath:variantPath];
+        if (previous)
+            CGImageRelease(previous);
+        previous = scaled;
+    }
+    if (previous)
+        CGImageRelease(previous);
+    CFRelease(source);
+    record->bytes = (uint32_t)MIN(bytes, (uint64_t)UINT32_MAX);
+
+    // even if the index can't be saved it is updated for this run
+    [self addRecord:record buyNowURL:aURL];
+    if (replacing)
+        [self removeFilesOfRecord:&previousRecord keepingFilesOf:record];
+    [collector noteAccessToKey:record->key];
+    return YES;
+}
+
+- (BOOL)addRecord:(const WOCoverRecord *)record buyNowURL:(NSURL *)aURL
+{
+    NSParameterAssert(record != NULL);
+    if (record->key == 0)
+        return NO;
+    [writeLock lock];
+    NSMutableData *records = [NSMutableData data];
+    NSMutableData *pool = [NSMutableData data];
+    [self copyEntriesOfIndex:index into:records pool:pool purging:NO];
+
+    WOCoverRecord entry = *record;
+    entry.URLLength = 0;
+    entry.URLOffset = 0;
+    entry.expires   = 0;
+    entry.reason    = 0;
+    memset(entry.reserved, 0, sizeof(entry.reserved));
+    NSData *URLBytes = [[aURL absoluteString] dataUsingEncoding:NSUTF8StringEncoding];
+    if ([URLBytes length] > 0 && [URLBytes length] <= UINT16_MAX)
+    {
+        entry.URLOffset = (uint32_t)[pool length];
+        entry.URLLength = (uint16_t)[URLBytes length];
+        [pool appendData:URLBytes];
+    }
+
+    [self replaceEntry:&entry inRecords:records keepingCover:NO];
+    BOOL success = [self installIndexWithRecords:records pool:pool];
+    [writeLock unlock];
+    return success;
+}
+
+- (BOOL)addMissForKey:(uint64_t)key reason:(unsigned)reason lifetime:(NSTimeInterval)lifetime
+{
+    if (key == 0)
+        return NO;
+    WOCoverRecord entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.key       = key;
+    entry.location  = WOCoverLocationNone;
+    entry.reason    = (uint8_t)reason;
+    entry.expires   = (uint32_t)MIN((double)UINT32_MAX, time(NULL) + lifetime);
+
+    [writeLock lock];
+    NSMutableData *records = [NSMutableData data];
+    NSMutableData *pool = [NSMutableData data];
+    [self copyEntriesOfIndex:index into:records pool:pool purging:NO];
+    BOOL success = YES;
+    if ([self replaceEntry:&entry inRecords:records keepingCover:YES])
+        success = [self installIndexWithRecords:records pool:pool];
+    [writeLock unlock];
+    return success;
+}
+
+- (NSData *)coverRecords
+{
+    NSMutableData *records = [NSMutableData data];
+    NSMutableData *pool = [NSMutableData data];
+    [lock lock];
+    NSData *current = index;
+    [lock unlock];
+    [self copyEntriesOfIndex:current into:records pool:pool purging:NO];
+
+    // squeeze out the misses in place
+    WOCoverRecord *entries = [records mutableBytes];
+    NSUInteger count = [records length] / sizeof(WOCoverRecord), covers = 0;
+    for (NSUInteger i = 0; i < count; i++)
+        if (entries[i].location != WOCoverLocationNone)
+            entries[covers++] = entries[i];
+    [records setLength:covers * sizeof(WOCoverRecord)];
+    return records;
+}
+
+- (NSUInteger)removeCoversForKeys:(const uint64_t *)keys count:(NSUInteger)count
+{
+    NSParameterAssert(keys != NULL || count == 0);
+    NSMutableSet *doomed = [NSMutableSet setWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++)
+        [doomed addObject:[NSNumber numberWithUnsignedLongLong:keys[i]]];
+
+    NSMutableData *removed = [NSMutableData data];
+    [writeLock lock];
+    NSMutableData *records = [NSMutableData data];
+    NSMutableData *pool = [NSMutableData data];
+    [self copyEntriesOfIndex:index into:records pool:pool purging:NO];
+    WOCoverRecord *entries = [records mutableBytes];
+    NSUInteger total = [records length] / sizeof(WOCoverRecord), kept = 0;
+    for (NSUInteger i = 0; i < total; i++)
+    {
+        if (entries[i].location != WOCoverLocationNone &&
+            [doomed containsObject:[NSNumber numberWithUnsignedLongLong:entries[i].key]])
+            [removed appendBytes:&entries[i] length:sizeof(WOCoverRecord)];
+        else
+            entries[kept++] = entries[i];
+    }
+    if (kept < total)
+    {
+        // the URLs of removed entries stay in the pool until the next rebuild; they are only a few bytes each
+        [records setLength:kept * sizeof(WOCoverRecord)];
+        [self installIndexWithRecords:records pool:pool];
+    }
+    [writeLock unlock];
+
+    // files go only once the index no longer points at them
+    const WOCoverRecord *gone = [removed bytes];
+    NSUInteger goneCount = [removed length] / sizeof(WOCoverRecord);
+    for (NSUInteger i = 0; i < goneCount; i++)
+        [self removeFilesOfRecord:&gone[i] keepingFilesOf:NULL];
+    return goneCount;
+}
+
+- (BOOL)synchronize
+{
+    [writeLock lock];
+    BOOL success = unsaved ? [self saveIndex] : YES;
+    [writeLock unlock];
+    return success;
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// caller holds writeLock; only called before the store is shared
+- (BOOL)loadIndex
+{
+    NSData *mapped = [NSData dataWithContentsOfMappedFile:indexPath];
+    if (!mapped)
+        return NO;
+    const WOCoverIndexHeader *header = [mapped bytes];
+    NSUInteger length = [mapped length];
+    if (length < sizeof(WOCoverIndexHeader) ||
+        NSSwapLittleIntToHost(header->magic) != WO_COVER_INDEX_MAGIC ||
+        NSSwapLittleIntToHost(header->version) != WO_COVER_INDEX_VERSION)
+        return NO;
+    uint32_t capacity = NSSwapLittleIntToHost(header->capacity);
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || NSSwapLittleIntToHost(header->count) >= capacity ||
+        (uint64_t)length < sizeof(WOCoverIndexHeader) + (uint64_t)capacity * sizeof(WOCoverRecord) +
+        NSSwapLittleIntToHost(header->poolLength))
+        return NO;
+    index = mapped;
+    return YES;
+}
+
+// caller holds writeLock
+- (BOOL)rebuildIndex
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSArray *contents = [fm contentsOfDirectoryAtPath:folder error:NULL];
+    if (!contents)
+        return NO;
+    NSMutableData *records = [NSMutableData data];
+    NSMutableData *pool = [NSMutableData data];
+    NSMutableSet *seen = [NSMutableSet set];
+    NSMutableDictionary *variants = [NSMutableDictionary dictionary];
+    for (NSString *name in contents)
+    {
+        NSString *extension = [[name pathExtension] lowercaseString];
+        unsigned format;
+        if ([extension isEqualToString:@"jpg"] || [extension isEqualToString:@"jpeg"])
+            format = WOCoverFormatJPEG;
+        else if ([extension isEqualToString:@"tiff"] || [extension isEqualToString:@"tif"])
+            format = WOCoverFormatTIFF;
+        else if ([extension isEqualToString:@"png"])
+            format = WOCoverFormatPNG;
+        else if ([extension isEqualToString:@"gif"])
+            format = WOCoverFormatGIF;
+        else
+            continue;
+
+        NSString *stem = [name stringByDeletingPathExtension];
+        uint64_t key;
+
+        // pre-scaled variant ("<key>-<size>.jpg")
+        if ([stem length] > 17 && [stem characterAtIndex:16] == '-' &&
+            WOCoverParseKey([stem substringToIndex:16], &key))
+        {
+            unsigned size = (unsigned)[[stem substringFromIndex:17] intValue];
+            for (unsigned i = 0; i < WOCoverVariantCount; i++)
+            {
+                if (WOCoverVariantSizes[i] != size)
+                    continue;
+                NSNumber *variantKey = [NSNumber numberWithUnsignedLongLong:key];
+                unsigned mask = [[variants objectForKey:variantKey] unsignedIntValue] | (1 << i);
+                [variants setObject:[NSNumber numberWithUnsignedInt:mask] forKey:variantKey];
+            }
+            continue;
+        }
+
+        BOOL legacy = !WOCoverParseKey(stem, &key);
+        if (legacy && (key = WOCoverKeyForLegacyStem(stem)) == 0)
+            continue;
+        NSNumber *seenKey = [NSNumber numberWithUnsignedLongLong:key];
+        if ([seen containsObject:seenKey])
+            continue;
+
+        WOCoverRecord record;
+        memset(&record, 0, sizeof(record));
+        record.key      = key;
+        record.location = WOCoverLocationPermanent;
+        record.format   = format;
+        NSString *path = [self pathForRecord:&record];
+        if (legacy)
+        {
+            NSString *source = [folder stringByAppendingPathComponent:name];
+            if (![fm moveItemAtPath:source toPath:path error:NULL])
+                continue;
+
+            // carry over the "buy now" link from the sidecar plist
+            NSString *buyNowFile = [[source stringByDeletingPathExtension] stringByAppendingPathExtension:@"plist"];
+            NSString *URLString = [[NSDictionary dictionaryWithContentsOfFile:buyNowFile] objectForKey:@"BuyNowLink"];
+            NSData *URLBytes = [URLString dataUsingEncoding:NSUTF8StringEncoding];
+            if ([URLBytes length] > 0 && [URLBytes length] <= UINT16_MAX)
+            {
+                record.URLOffset = (uint32_t)[pool length];
+                record.URLLength = (uint16_t)[URLBytes length];
+                [pool appendData:URLBytes];
+            }
+        }
+        WOCoverReadDimensions(path, &record);
+        [records appendBytes:&record length:sizeof(record)];
+        [seen addObject:seenKey];
+    }
+
+    WOCoverRecord *found = [records mutableBytes];
+    for (NSUInteger i = 0, max = [records length] / sizeof(WOCoverRecord); i < max; i++)
+    {
+        found[i].variants = (uint8_t)[[variants objectForKey:
+                                       [NSNumber numberWithUnsignedLongLong:found[i].key]] unsignedIntValue];
+        uint64_t bytes = WOCoverFileSize([self pathForRecord:&found[i]]);
+        for (unsigned j = 0; j < WOCoverVariantCount; j++)
+            if (found[i].variants & (1 << j))
+                bytes += WOCoverFileSize([self pathForVariant:j ofKey:found[i].key location:found[i].location]);
+        found[i].bytes = (uint32_t)MIN(bytes, (uint64_t)UINT32_MAX);
+    }
+    return [self installIndexWithRecords:records pool:pool];
+}
+
+// copies the occupied slots of anIndex (in host byte order) and the URLs they refer to, optionally leaving out temporary
+// covers and expired misses
+- (void)copyEntriesOfIndex:(NSData *)anIndex
+                      into:(NSMutableData *)records
+                      pool:(NSMutableData *)pool
+                   purging:(BOOL)purge
+{
+    uint32_t now = (uint32_t)time(NULL);
+    if (!anIndex)
+        return;
+    const WOCoverIndexHeader *header = [anIndex bytes];
+    const WOCoverRecord *slots = (const WOCoverRecord *)(header + 1);
+    uint32_t capacity = NSSwapLittleIntToHost(header->capacity);
+    uint32_t poolLength = NSSwapLittleIntToHost(header->poolLength);
+    const char *oldPool = (const char *)(slots + capacity);
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        if (slots[i].key == 0)
+            continue;
+        WOCoverRecord record = slots[i];
+        WOCoverRecordSwapLittleToHost(&record);
+        if (purge && (record.location == WOCoverLocationTemporary ||
+                      (record.location == WOCoverLocationNone && record.expires <= now)))
+            continue;
+        if (record.URLLength > 0 && (uint64_t)record.URLOffset + record.URLLength <= poolLength)
+        {
+            const char *URL = oldPool + record.URLOffset;
+            record.URLOffset = (uint32_t)[pool length];
+            [pool appendBytes:URL length:record.URLLength];
+        }
+        else
+        {
+            record.URLOffset = 0;
+            record.URLLength = 0;
+        }
+        [records appendBytes:&record length:sizeof(record)];
+    }
+}
+
+- (NSString *)pathForVariant:(unsigned)variant ofKey:(uint64_t)key location:(unsigned)location
+{
+    NSString *name = [NSString stringWithFormat:@"%016llx-%u.jpg", (unsigned long long)key,
+                      WOCoverVariantSizes[variant]];
+    return [((location == WOCoverLocationTemporary) ? temporaryFolder : folder) stringByAppendingPathComponent:name];
+}
+
+// deletes the image and variants of gone, and drops them from the image cache, except for any files that kept (which
+// may be NULL) also has
+- (void)removeFilesOfRecord:(const WOCoverRecord *)gone keepingFilesOf:(const WOCoverRecord *)kept
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    WOCoverImageCache *cache = [WOCoverImageCache sharedCache];
+    BOOL sameFolder = kept && kept->key == gone->key && kept->location == gone->location;
+    if (!sameFolder || kept->format != gone->format)
+    {
+        NSString *path = [self pathForRecord:gone];
+        [fm removeItemAtPath:path error:NULL];
+        [cache removeImageForPath:path];
+    }
+    for (unsigned i = 0; i < WOCoverVariantCount; i++)
+    {
+        if (!(gone->variants & (1 << i)) || (sameFolder && (kept->variants & (1 << i))))
+            continue;
+        NSString *variantPath = [self pathForVariant:i ofKey:gone->key location:gone->location];
+        [fm removeItemAtPath:variantPath error:NULL];
+        [cache removeImageForPath:variantPath];
+    }
+}
+
+// replaces the entry for entry's key (keeping its URL if entry has none) or appends entry; if keepCover is YES an
+// existing cover is left alone instead; returns NO if records was not changed
+- (BOOL)replaceEntry:(WOCoverRecord *)entry inRecords:(NSMutableData *)records keepingCover:(BOOL)keepCover
+{
+    WOCoverRecord *existing = [records mutableBytes];
+    NSUInteger count = [records length] / sizeof(WOCoverRecord);
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        if (existing[i].key != entry->key)
+            continue;
+        if (keepCover && existing[i].location != WOCoverLocationNone)
+            return NO;
+        if (entry->URLLength == 0)
+        {
+            entry->URLOffset = existing[i].URLOffset;
+            entry->URLLength = existing[i].URLLength;
+        }
+        existing[i] = *entry;
+        return YES;
+    }
+    [records appendBytes:entry length:sizeof(*entry)];
+    return YES;
+}
+
+// lays out a fresh index holding records (host byte order, distinct keys) and installs it for lookups, saving it too if
+// the last save was long enough ago; only the pointer swap is done under lock, so lookups never wait for the building or
+// the disk; caller holds writeLock
+- (BOOL)installIndexWithRecords:(NSData *)records pool:(NSData *)pool
+{
+    NSUInteger count = [records length] / sizeof(WOCoverRecord);
+    uint32_t capacity = WO_COVER_INDEX_MIN_CAPACITY;
+    while (capacity < count * 2)    // load factor at most one half
+        capacity <<= 1;
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(WOCoverIndexHeader) +
+                           capacity * sizeof(WOCoverRecord) + [pool length]];
+    WOCoverIndexHeader *header = [data mutableBytes];
+    header->magic       = NSSwapHostIntToLittle(WO_COVER_INDEX_MAGIC);
+    header->version     = NSSwapHostIntToLittle(WO_COVER_INDEX_VERSION);
+    header->capacity    = NSSwapHostIntToLittle(capacity);
+    header->count       = NSSwapHostIntToLittle((uint32_t)count);
+    header->poolLength  = NSSwapHostIntToLittle((uint32_t)[pool length]);
+    WOCoverRecord *slots = (WOCoverRecord *)(header + 1);
+    const WOCoverRecord *source = [records bytes];
+    uint32_t mask = capacity - 1;
+    for (NSUInteger j = 0; j < count; j++)
+    {
+        uint32_t i = (uint32_t)source[j].key & mask;
+        while (slots[i].key != 0)
+            i = (i + 1) & mask;
+        slots[i] = source[j];
+        WOCoverRecordSwapHostToLittle(&slots[i]);
+    }
+    memcpy(slots + capacity, [pool bytes], [pool length]);
+
+    // lookups already holding the old index stay valid
+    [lock lock];
+    index = data;
+    [lock unlock];
+    unsaved = YES;
+    if ([NSDate timeIntervalSinceReferenceDate] - savedAt < WO_COVER_INDEX_SAVE_INTERVAL)
+        return YES;
+    return [self saveIndex];
+}
+
+// writes index to a temporary file, renames it into place and maps it in place of the in-memory copy; caller holds
+// writeLock, so index cannot change underneath
+- (BOOL)saveIndex
+{
+    NSData *data = index;
+    savedAt = [NSDate timeIntervalSinceReferenceDate];
+    if (![data writeToFile:indexPath atomically:YES])
+    {
+        // the in-memory index is good for the rest of this run at least
+        NSLog(@"warning: could not write album cover index to %@", indexPath);
+        return NO;
+    }
+    unsaved = NO;
+    NSData *mapped = [NSData dataWithContentsOfMappedFile:indexPath];
+    if (mapped)
+    {
+        [lock lock];
+        index = mapped;
+        [lock unlock];
+    }
+    return YES;
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize collector;
+
+@end
@@ -0,0 +1,29 @@
+//
+//  WOEmbeddedArtwork.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+//! Reads album artwork straight out of audio files, without asking iTunes for it.
+//!
+//! The file is memory-mapped and only its tags are walked: an ID3v2 tag at the start of the file (MP3, and sometimes
+//! FLAC) for an APIC frame (PIC in ID3v2.2), the "moov/udta/meta/ilst/covr" atoms of an MPEG-4 file (AAC, Apple
+//! Lossless) or the PICTURE metadata blocks of a FLAC stream. A front cover is preferred to any other picture. The audio
+//! data itself is never touched, so the cost does not depend on the length of the track.
+//!
+//! Unless the picture has to be reconstructed (ID3v2 unsynchronisation), the returned data is a view of the mapped file:
+//! nothing is copied, and the mapping lives as long as the data does.
+//!
+//! \warn Threadsafe
+@interface WOEmbeddedArtwork : NSObject {
+
+}
+
+//! Returns the encoded bytes of the picture embedded in the audio file at \p path (JPEG or PNG as a rule; see
+//! +[WOCoverStore sniffImageData:format:width:height:]), or nil if the file can't be read or carries no picture
++ (NSData *)artworkDataWithContentsOfFile:(NSString *)path;
+
+@end
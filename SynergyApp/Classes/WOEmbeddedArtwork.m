@@ -0,0 +1,384 @@
+// WOEmbeddedArtwork.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOEmbeddedArtwork.h"
+
+// system headers
+#import <string.h>
+
+//! ID3v2 and FLAC picture type for the front cover
+#define WO_PICTURE_TYPE_FRONT_COVER     3
+
+// where the picture is in the file (or in a reconstructed copy of its tag)
+typedef struct WOArtworkSpan {
+    const uint8_t   *bytes;
+    size_t          length;
+    int             type;           // ID3v2/FLAC picture type; -1 if unknown
+    BOOL            unsynchronised; // ID3v2.4: span is a whole APIC frame body still to be resynchronised
+} WOArtworkSpan;
+
+static uint32_t WOReadBig32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint32_t WOReadBig24(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static uint32_t WOReadSyncsafe32(const uint8_t *p)
+{
+    return ((uint32_t)(p[0] & 0x7f) << 21) | ((uint32_t)(p[1] & 0x7f) << 14) | ((uint32_t)(p[2] & 0x7f) << 7) |
+        (p[3] & 0x7f);
+}
+
+// keeps the first front cover, or failing that the first picture of any kind
+static BOOL WOPreferArtwork(WOArtworkSpan *best, BOOL found, const WOArtworkSpan *candidate)
+{
+    if (!found || (best->type != WO_PICTURE_TYPE_FRONT_COVER && candidate->type == WO_PICTURE_TYPE_FRONT_COVER))
+        *best = *candidate;
+    return YES;
+}
+
+// undoes ID3v2 unsynchronisation ("FF 00" back to "FF"); out may be in; returns the new length
+static size_t WOResynchronise(const uint8_t *in, size_t length, uint8_t *out)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        out[j++] = in[i];
+        if (in[i] == 0xff && i + 1 < length && in[i + 1] == 0x00)
+            i++;
+    }
+    return j;
+}
+
+// length (terminator included) of a string in an ID3v2 text encoding, or 0 if it is unterminated
+static size_t WOID3StringLength(const uint8_t *p, size_t length, uint8_t encoding)
+{
+    if (encoding == 1 || encoding == 2)     // UTF-16: two-byte terminator
+    {
+        for (size_t i = 0; i + 1 < length; i += 2)
+            if (p[i] == 0 && p[i + 1] == 0)
+                return i + 2;
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++)
+        if (p[i] == 0)
+            return i + 1;
+    return 0;
+}
+
+// parses the body of an APIC frame (PIC in ID3v2.2)
+static BOOL WOParseID3Picture(const uint8_t *p, size_t length, BOOL v22, WOArtworkSpan *span)
+{
+    if (length < 2)
+        return NO;
+    uint8_t encoding = p[0];
+    size_t offset = 1;
+    if (v22)
+        offset += 3;                        // image format ("JPG", "PNG")
+    else
+    {
+        size_t mimeLength = WOID3StringLength(p + offset, length - offset, 0);
+        if (mimeLength == 0)
+            return NO;
+        offset += mimeLength;
+    }
+    if (offset >= length)
+        return NO;
+    int type = p[offset++];
+    size_t descriptionLength = WOID3StringLength(p + offset, length - offset, encoding);
+    if (descriptionLength == 0 || offset + descriptionLength >= length)
+        return NO;
+    offset += descriptionLength;
+    span->bytes             = p + offset;
+    span->length            = length - offset;
+    span->type              = type;
+    span->unsynchronised    = NO;
+    return YES;
+}
+
+// walks the frames of an ID3v2 tag (header, extended header and tag-level unsynchronisation already dealt with)
+static BOOL WOFindID3v2Artwork(const uint8_t *frames, size_t length, unsigned major, WOArtworkSpan *best)
+{
+    BOOL found = NO;
+    size_t headerLength = (major == 2) ? 6 : 10;
+    size_t offset = 0;
+    while (offset + headerLength <= length)
+    {
+        const uint8_t *frame = frames + offset;
+        if (frame[0] == 0)
+            break;                          // padding
+        size_t size;
+        uint16_t flags = 0;
+        if (major == 2)
+            size = WOReadBig24(frame + 3);
+        else
+        {
+            size = (major == 4) ? WOReadSyncsafe32(frame + 4) : WOReadBig32(frame + 4);
+            flags = (uint16_t)((frame[8] << 8) | frame[9]);
+        }
+        if (size > length - offset - headerLength)
+            break;
+        offset += headerLength + size;
+
+        if (memcmp(frame, (major == 2) ? "PIC" : "APIC", (major == 2) ? 3 : 4) != 0)
+            continue;
+        const uint8_t *body = frame + headerLength;
+        size_t extra = 0;
+        if (major == 3)
+        {
+            if (flags & 0x00c0)             // compressed or encrypted
+                continue;
+            if (flags & 0x0020)             // grouping identity
+                extra += 1;
+        }
+        else if (major == 4)
+        {
+            if (flags & 0x000c)             // compressed or encrypted
+                continue;
+            if (flags & 0x0040)             // grouping identity
+                extra += 1;
+            if (flags & 0x0001)             // data length indicator
+                extra += 4;
+        }
+        if (extra >= size)
+            continue;
+
+        WOArtworkSpan candidate;
+        if (major == 4 && (flags & 0x0002))
+        {
+            // can't be parsed in place; the caller resynchronises and parses it
+            candidate.bytes             = body + extra;
+            candidate.length            = size - extra;
+            candidate.type              = -1;
+            candidate.unsynchronised    = YES;
+        }
+        else if (!WOParseID3Picture(body + extra, size - extra, major == 2, &candidate))
+            continue;
+        found = WOPreferArtwork(best, found, &candidate);
+    }
+    return found;
+}
+
+// finds the first child atom of type among the atoms filling [p, p + length)
+static const uint8_t *WOFindMP4Atom(const uint8_t *p, size_t length, const char *type, size_t *payloadLength)
+{
+    size_t offset = 0;
+    while (offset + 8 <= length)
+    {
+        uint64_t size = WOReadBig32(p + offset);
+        size_t headerLength = 8;
+        if (size == 1)                      // 64-bit size follows the type
+        {
+            if (offset + 16 > length)
+                return NULL;
+            size = ((uint64_t)WOReadBig32(p + offset + 8) << 32) | WOReadBig32(p + offset + 12);
+            headerLength = 16;
+        }
+        else if (size == 0)                 // extends to the end of the enclosing atom
+            size = length - offset;
+        if (size < headerLength || size > length - offset)
+            return NULL;
+        if (memcmp(p + offset + 4, type, 4) == 0)
+        {
+            *payloadLength = (size_t)size - headerLength;
+            return p + offset + headerLength;
+        }
+        offset += (size_t)size;
+    }
+    return NULL;
+}
+
+// moov/udta/meta/ilst/covr/data; top-level atoms (including mdat, however large) are skipped by size
+static BOOL WOFindMP4Artwork(const uint8_t *bytes, size_t length, WOArtworkSpan *span)
+{
+    size_t n = length;
+    const uint8_t *atom = bytes;
+    if (!(atom = WOFindMP4Atom(atom, n, "moov", &n)) ||
+        !(atom = WOFindMP4Atom(atom, n, "udta", &n)) ||
+        !(atom = WOFindMP4Atom(atom, n, "meta", &n)))
+        return NO;
+
+    // meta is normally a full atom (version and flags before its children), but not in every file
+    if (n >= 4 && WOReadBig32(atom) == 0)
+    {
+        atom += 4;
+        n -= 4;
+    }
+    if (!(atom = WOFindMP4Atom(atom, n, "ilst", &n)) ||
+        !(atom = WOFindMP4Atom(atom, n, "covr", &n)) ||
+        !(atom = WOFindMP4Atom(atom, n, "data", &n)))
+        return NO;
+
+    // type indicator (13 for JPEG, 14 for PNG) and locale precede the image
+    if (n <= 8)
+        return NO;
+    span->bytes             = atom + 8;
+    span->length            = n - 8;
+    span->type              = WO_PICTURE_TYPE_FRONT_COVER;
+    span->unsynchronised    = NO;
+    return YES;
+}
+
+// parses a FLAC PICTURE metadata block
+static BOOL WOParseFLACPicture(const uint8_t *p, size_t length, WOArtworkSpan *span)
+{
+    if (length < 8)
+        return NO;
+    int type = (int)WOReadBig32(p);
+    size_t mimeLength = WOReadBig32(p + 4);
+    size_t offset = 8;
+    if (mimeLength > length - offset || length - offset - mimeLength < 4)
+        return NO;
+    offset += mimeLength;
+    size_t descriptionLength = WOReadBig32(p + offset);
+    offset += 4;
+    if (descriptionLength > length - offset || length - offset - descriptionLength < 20)
+        return NO;
+    offset += descriptionLength + 16;       // width, height, depth, colours
+    size_t dataLength = WOReadBig32(p + offset);
+    offset += 4;
+    if (dataLength == 0 || dataLength > length - offset)
+        return NO;
+    span->bytes             = p + offset;
+    span->length            = dataLength;
+    span->type              = type;
+    span->unsynchronised    = NO;
+    return YES;
+}
+
+// walks the metadata blocks of a FLAC stream; stops at the first audio frame
+static BOOL WOFindFLACArtwork(const uint8_t *bytes, size_t length, WOArtworkSpan *best)
+{
+    if (length < 4 || memcmp(bytes, "fLaC", 4) != 0)
+        return NO;
+    BOOL found = NO;
+    size_t offset = 4;
+    BOOL last = NO;
+    while (!last && offset + 4 <= length)
+    {
+        last = (bytes[offset] & 0x80) != 0;
+        unsigned type = bytes[offset] & 0x7f;
+        size_t size = WOReadBig24(bytes + offset + 1);
+        offset += 4;
+        if (size > length - offset)
+            break;
+        WOArtworkSpan candidate;
+        if (type == 6 && WOParseFLACPicture(bytes + offset, size, &candidate))
+            found = WOPreferArtwork(best, found, &candidate);
+        offset += size;
+    }
+    return found;
+}
+
+//! An immutable view of part of another NSData; keeps the other object (and so, for a mapped file, the mapping) alive
+@interface WOSubdata : NSData {
+
+    NSData      *parent;
+    const void  *start;
+    NSUInteger  count;
+}
+
+- (id)initWithData:(NSData *)aParent bytes:(const void *)someBytes length:(NSUInteger)aLength;
+
+@end
+
+@implementation WOSubdata
+
+- (id)initWithData:(NSData *)aParent bytes:(const void *)someBytes length:(NSUInteger)aLength
+{
+    if ((self = [super init]))
+    {
+        self->parent    = aParent;
+        self->start     = someBytes;
+        self->count     = aLength;
+    }
+    return self;
+}
+
+- (const void *)bytes
+{
+    return start;
+}
+
+- (NSUInteger)length
+{
+    return count;
+}
+
+@end
+
+@implementation WOEmbeddedArtwork
+
++ (NSData *)artworkDataWithContentsOfFile:(NSString *)path
+{
+    NSData *file = path ? [NSData dataWithContentsOfMappedFile:path] : nil;
+    const uint8_t *bytes = [file bytes];
+    size_t length = [file length];
+    if (length < 12)
+        return nil;
+
+    // tag-level unsynchronisation means working from a reconstructed copy of the tag
+    NSData *backing = file;
+    WOArtworkSpan span;
+    BOOL found = NO;
+    size_t offset = 0;
+    if (memcmp(bytes, "ID3", 3) == 0 && bytes[3] >= 2 && bytes[3] <= 4)
+    {
+        unsigned major = bytes[3];
+        uint8_t flags = bytes[5];
+        size_t tagLength = WOReadSyncsafe32(bytes + 6);
+        if (tagLength > length - 10)
+            return nil;
+        offset = 10 + tagLength + ((major == 4 && (flags & 0x10)) ? 10 : 0);   // footer
+
+        const uint8_t *frames = bytes + 10;
+        size_t framesLength = tagLength;
+        if ((flags & 0x80) && major < 4)
+        {
+            NSMutableData *tag = [NSMutableData dataWithBytes:frames length:framesLength];
+            framesLength = WOResynchronise([tag bytes], framesLength, [tag mutableBytes]);
+            [tag setLength:framesLength];
+            frames = [tag bytes];
+            backing = tag;
+        }
+        if ((flags & 0x40) && major > 2 && framesLength >= 4)
+        {
+            // extended header; its size excludes itself in ID3v2.3 and includes itself in ID3v2.4
+            size_t extended = (major == 3) ? WOReadBig32(frames) + 4 : WOReadSyncsafe32(frames);
+            if (extended > framesLength)
+                return nil;
+            frames += extended;
+            framesLength -= extended;
+        }
+        found = WOFindID3v2Artwork(frames, framesLength, major, &span);
+    }
+    if (!found)
+    {
+        backing = file;
+        if (offset < length)
+            found = WOFindFLACArtwork(bytes + offset, length - offset, &span);
+        if (!found && memcmp(bytes + 4, "ftyp", 4) == 0)
+            found = WOFindMP4Artwork(bytes, length, &span);
+    }
+    if (!found)
+        return nil;
+
+    if (span.unsynchronised)
+    {
+        NSMutableData *frame = [NSMutableData dataWithBytes:span.bytes length:span.length];
+        [frame setLength:WOResynchronise([frame bytes], [frame length], [frame mutableBytes])];
+        if (!WOParseID3Picture([frame bytes], [frame length], NO, &span))
+            return nil;
+        backing = frame;
+    }
+    return [[WOSubdata alloc] initWithData:backing bytes:span.bytes length:span.length];
+}
+
+@end
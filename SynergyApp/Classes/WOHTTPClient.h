@@ -0,0 +1,179 @@
+//
+//  WOHTTPClient.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class WOHTTPClient, WOHTTPConnection, WOHTTPRequest;
+
+//! Messages are sent on the thread that started the request, which must run its run loop; none are sent after the
+//! request has been cancelled. Each request gets at most one response message, then zero or more data messages, then
+//! exactly one finish or failure message. Redirects are followed without telling the delegate.
+@protocol WOHTTPRequestDelegate
+
+- (void)HTTPRequest:(WOHTTPRequest *)aRequest didReceiveResponseWithStatus:(NSInteger)status;
+
+//! Body bytes as they arrive; not sent if the request has a response buffer
+- (void)HTTPRequest:(WOHTTPRequest *)aRequest didReceiveData:(NSData *)data;
+
+- (void)HTTPRequestDidFinishLoading:(WOHTTPRequest *)aRequest;
+
+//! \p error is in NSURLErrorDomain, with the failing URL under NSURLErrorFailingURLStringErrorKey
+- (void)HTTPRequest:(WOHTTPRequest *)aRequest didFailWithError:(NSError *)error;
+
+@end
+
+//! A single HTTP exchange carried out by WOHTTPClient.
+//!
+//! Set up the request, then hand it to the client from any thread. The body is either passed to the delegate in pieces
+//! or appended straight to a caller-supplied response buffer, which the caller must leave alone until the request is
+//! done. A request can be started only once.
+//!
+//! \warn Threadsafe once started (cancel, waitUntilDone and the response properties); set-up is not
+@interface WOHTTPRequest : NSObject {
+
+    //! Updated as redirects are followed
+    NSURL                       *URL;
+    NSString                    *HTTPMethod;
+    NSData                      *HTTPBody;
+    NSMutableDictionary         *headerFields;
+
+    //! Seconds without any progress before the request fails
+    NSTimeInterval              timeoutInterval;
+
+    NSMutableData               *responseBuffer;
+
+    //! Longest body accepted (bytes); 0 means no limit
+    NSUInteger                  maximumResponseLength;
+
+    id <WOHTTPRequestDelegate>  delegate;
+    NSThread                    *delegateThread;
+
+    //! \name Network thread state
+    //! \startgroup
+
+    WOHTTPClient                *client;
+    WOHTTPConnection            *connection;
+    NSString                    *routeKey;
+    NSTimer                     *timeoutTimer;
+    NSTimeInterval              lastActivity;
+    NSUInteger                  receivedLength;
+    unsigned                    redirectCount;
+    BOOL                        retriedStale;
+
+    //! \endgroup
+
+    //! \name Outcome
+    //! Guarded by \c condition, which is broadcast once the request is done
+    //! \startgroup
+
+    NSInteger                   statusCode;
+    NSDictionary                *responseHeaders;
+    NSError                     *error;
+    BOOL                        started;
+    BOOL                        done;
+    BOOL                        cancelled;
+    NSCondition                 *condition;
+
+    //! \endgroup
+}
+
++ (WOHTTPRequest *)requestWithURL:(NSURL *)aURL;
+
+//! Designated initializer; a GET with a 60-second timeout
+- (id)initWithURL:(NSURL *)aURL;
+
+- (void)setValue:(NSString *)aValue forHTTPHeaderField:(NSString *)aField;
+
+//! Stops the request; its connection is closed if a response was in progress. The delegate hears nothing more and
+//! waitUntilDone returns NO.
+- (void)cancel;
+
+//! Blocks until the request has finished, failed or been cancelled; returns YES if it finished. Not for the thread that
+//! receives the delegate messages.
+- (BOOL)waitUntilDone;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(readonly) NSURL *URL;
+@property(copy)     NSString *HTTPMethod;
+@property(copy)     NSData *HTTPBody;
+@property           NSTimeInterval timeoutInterval;
+@property(assign)   NSMutableData *responseBuffer;
+@property           NSUInteger maximumResponseLength;
+@property(assign)   id <WOHTTPRequestDelegate> delegate;
+
+//! 0 until the response has arrived
+@property(readonly) NSInteger statusCode;
+
+//! Header values keyed by lowercase field name; nil until the response has arrived
+@property(readonly) NSDictionary *responseHeaders;
+
+//! Why the request failed, or nil
+@property(readonly) NSError *error;
+
+@property(readonly, getter=isCancelled) BOOL cancelled;
+
+@end
+
+//! Carries out HTTP/1.1 requests for the whole application on a single background thread.
+//!
+//! Connections are kept open after a response that allows it and reused for the next request to the same host and
+//! port, so a run of cover searches or Audioscrobbler submissions pays for the DNS lookup and the TCP (and TLS)
+//! handshakes once. At most four connections are opened per host; requests beyond that wait their turn, oldest first.
+//! An idle connection is closed after 30 seconds, or sooner if the server's Keep-Alive header says so, and a request
+//! that finds its reused connection already closed by the server is retried once on a new one, provided it is a GET or
+//! HEAD or none of it had been sent (a submission POST that may have arrived is never sent twice). Requests are not
+//! pipelined.
+//!
+//! The system's SOCKS proxy is honoured, as is its HTTP proxy for plain HTTP requests (https goes direct).
+//!
+//! \warn Threadsafe
+@interface WOHTTPClient : NSObject {
+
+    NSThread            *networkThread;
+
+    //! \name Network thread state
+    //! \startgroup
+
+    //! Requests (WOHTTPRequest) waiting for a connection, keyed by route
+    NSMutableDictionary *pendingRequests;
+
+    //! Open connections (WOHTTPConnection), busy or idle, keyed by route
+    NSMutableDictionary *connections;
+
+    NSTimer             *idleTimer;
+
+    //! \endgroup
+
+    //! \name Statistics
+    //! Guarded by \c @synchronized(self)
+    //! \startgroup
+
+    NSUInteger          connectionsOpened;
+    NSUInteger          requestsCompleted;
+
+    //! \endgroup
+}
+
++ (WOHTTPClient *)sharedClient;
+
+//! Queues \p aRequest and returns straight away
+- (void)startRequest:(WOHTTPRequest *)aRequest;
+
+//! Starts \p aRequest and waits for it (see WOHTTPRequest's waitUntilDone); for worker threads
+- (BOOL)sendSynchronousRequest:(WOHTTPRequest *)aRequest;
+
+#pragma mark -
+#pragma mark Properties
+
+//! Connections opened so far; compare with requestsCompleted to see how often a connection was reused
+@property(readonly) NSUInteger connectionsOpened;
+
+@property(readonly) NSUInteger requestsCompleted;
+
+@end
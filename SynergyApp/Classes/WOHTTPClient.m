@@ -0,0 +1,1400 @@
+// WOHTTPClient.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOHTTPClient.h"
+
+// system headers
+#import <SystemConfiguration/SystemConfiguration.h>
+#import <stdlib.h>
+#import <string.h>
+
+//! Default for timeoutInterval (seconds), as for NSURLRequest
+#define WO_HTTP_DEFAULT_TIMEOUT         (NSTimeInterval)60.0
+
+//! Most connections open to one host (or proxy) at a time
+#define WO_HTTP_MAXIMUM_CONNECTIONS     4
+
+//! Longest an unused connection is kept open (seconds)
+#define WO_HTTP_IDLE_TIMEOUT            (NSTimeInterval)30.0
+
+//! How often (seconds) idle connections are looked over while there are any
+#define WO_HTTP_IDLE_SWEEP_INTERVAL     (NSTimeInterval)5.0
+
+//! Most redirects followed for one request
+#define WO_HTTP_MAXIMUM_REDIRECTS       5
+
+//! Longest status, header or chunk-size line accepted (bytes)
+#define WO_HTTP_MAXIMUM_LINE            8192
+
+//! Most header lines accepted in one response
+#define WO_HTTP_MAXIMUM_HEADERS         100
+
+//! Bytes read from a socket at a time
+#define WO_HTTP_READ_BUFFER             16384
+
+//! How long (seconds) the system proxy settings are cached
+#define WO_HTTP_PROXY_SETTINGS_LIFETIME (NSTimeInterval)60.0
+
+//! Response parser states
+enum {
+    WOHTTPReadStatus,
+    WOHTTPReadHeaders,
+    WOHTTPReadBody,
+    WOHTTPReadChunkSize,
+    WOHTTPReadChunkData,
+    WOHTTPReadChunkEnd,
+    WOHTTPReadTrailer,
+    WOHTTPReadUntilClose,
+    WOHTTPReadDone
+};
+
+static NSError *WOHTTPError(NSInteger code, NSURL *aURL, NSString *description, NSError *underlying)
+{
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:description forKey:NSLocalizedDescriptionKey];
+    if (aURL)
+        [userInfo setObject:[aURL absoluteString] forKey:NSURLErrorFailingURLStringErrorKey];
+    if (underlying)
+        [userInfo setObject:underlying forKey:NSUnderlyingErrorKey];
+    return [NSError errorWithDomain:NSURLErrorDomain code:code userInfo:userInfo];
+}
+
+// delegate messages get through while the delegate's thread is tracking a menu, too; network thread only
+static NSArray *WOHTTPDeliveryModes(void)
+{
+    static NSArray *modes = nil;
+    if (!modes)
+        modes = [[NSArray alloc] initWithObjects:NSRunLoopCommonModes, nil];
+    return modes;
+}
+
+// YES if plain HTTP requests to aHost should go through the system's HTTP proxy, which is returned in proxyHost and proxyPort
+static BOOL WOHTTPProxyForHost(NSString *aHost, NSDictionary *proxies, NSString **proxyHost, UInt32 *proxyPort)
+{
+    if (![[proxies objectForKey:(NSString *)kSCPropNetProxiesHTTPEnable] boolValue])
+        return NO;
+    NSString *proxy = [proxies objectForKey:(NSString *)kSCPropNetProxiesHTTPProxy];
+    if (![proxy length])
+        return NO;
+    if ([[proxies objectForKey:(NSString *)kSCPropNetProxiesExcludeSimpleHostnames] boolValue] &&
+        [aHost rangeOfString:@"."].location == NSNotFound)
+        return NO;
+    for (NSString *exception in [proxies objectForKey:(NSString *)kSCPropNetProxiesExceptionsList])
+    {
+        exception = [exception lowercaseString];
+        if ([exception hasPrefix:@"*."])
+            exception = [exception substringFromIndex:1];
+        if ([aHost isEqualToString:exception] || ([exception hasPrefix:@"."] && [aHost hasSuffix:exception]))
+            return NO;
+    }
+    NSNumber *port = [proxies objectForKey:(NSString *)kSCPropNetProxiesHTTPPort];
+    *proxyHost = proxy;
+    *proxyPort = [port unsignedIntValue] ? [port unsignedIntValue] : 80;
+    return YES;
+}
+
+// returns the key under which connections for aURL are pooled (nil if aURL can't be fetched), with where to connect
+static NSString *WOHTTPRouteForURL(NSURL *aURL, NSDictionary *proxies, NSString **host, UInt32 *port, BOOL *secure,
+                                   BOOL *proxied)
+{
+    NSString *scheme = [[aURL scheme] lowercaseString];
+    NSString *urlHost = [[aURL host] lowercaseString];
+    if (![urlHost length])
+        return nil;
+    if ([scheme isEqualToString:@"http"])
+        *secure = NO;
+    else if ([scheme isEqualToString:@"https"])
+        *secure = YES;
+    else
+        return nil;
+    UInt32 urlPort = [aURL port] ? [[aURL port] unsignedIntValue] : (*secure ? 443 : 80);
+    if (!*secure && WOHTTPProxyForHost(urlHost, proxies, host, port))
+    {
+        *proxied = YES;
+        return [NSString stringWithFormat:@"proxy:%@:%u", *host, (unsigned)*port];
+    }
+    *host = urlHost;
+    *port = urlPort;
+    *proxied = NO;
+    return [NSString stringWithFormat:@"%@://%@:%u", scheme, urlHost, (unsigned)urlPort];
+}
+
+//! One socket to a host or proxy, carrying one request at a time; used only on the client's network thread
+@interface WOHTTPConnection : NSObject {
+
+    WOHTTPClient        *client;
+    NSString            *routeKey;
+    BOOL                proxied;
+    NSInputStream       *input;
+    NSOutputStream      *output;
+
+    //! Request in flight, or nil while idle
+    WOHTTPRequest       *request;
+
+    //! Request bytes not yet written
+    NSData              *outbox;
+    NSUInteger          outboxOffset;
+
+    //! \name Response parser state
+    //! \startgroup
+
+    int                 state;
+    NSMutableData       *line;
+    NSInteger           status;
+    int                 minorVersion;
+    NSMutableDictionary *headers;
+    NSString            *lastHeader;
+    unsigned            headerCount;
+    unsigned long long  remaining;
+    BOOL                reusable;
+    BOOL                receivedBytes;
+    NSURL               *redirectURL;
+
+    //! \endgroup
+
+    NSUInteger          requestsServed;
+
+    //! While idle, the connection is closed after this time
+    NSTimeInterval      idleDeadline;
+
+    //! Server's Keep-Alive timeout (seconds), or 0 if it gave none
+    NSTimeInterval      keepAliveTimeout;
+}
+
+- (id)initWithClient:(WOHTTPClient *)aClient
+            routeKey:(NSString *)aKey
+                host:(NSString *)aHost
+                port:(UInt32)aPort
+              secure:(BOOL)isSecure
+             proxied:(BOOL)isProxied
+       proxySettings:(NSDictionary *)proxies;
+
+- (void)sendRequest:(WOHTTPRequest *)aRequest;
+
+//! Drops the request in flight without telling anyone and closes the connection
+- (void)abandonRequest;
+
+- (void)close;
+
+@property(readonly)     NSString *routeKey;
+@property(readonly)     WOHTTPRequest *request;
+@property(readonly)     BOOL isOpen;
+@property(readonly)     NSTimeInterval idleDeadline;
+
+@end
+
+@interface WOHTTPConnection ()
+
+- (void)writeOutbox;
+- (void)consumeBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+- (BOOL)processLine;
+- (BOOL)processHeaders;
+- (BOOL)deliverBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+- (void)finishResponse;
+- (void)endOfStream;
+- (void)failWithCode:(NSInteger)code description:(NSString *)description underlying:(NSError *)underlying;
+- (void)dropWhileIdle;
+
+@end
+
+@interface WOHTTPRequest ()
+
+//! \name Caller's thread
+//! \startgroup
+
+- (BOOL)prepareToStartWithClient:(WOHTTPClient *)aClient;
+- (void)deliverResponse:(NSNumber *)aStatus;
+- (void)deliverData:(NSData *)data;
+- (void)deliverFinish:(id)ignored;
+- (void)deliverFailure:(NSError *)anError;
+
+//! \endgroup
+
+//! \name Network thread
+//! \startgroup
+
+- (void)noteActivity;
+- (void)beginResponseWithStatus:(NSInteger)aStatus headers:(NSDictionary *)headers;
+- (BOOL)appendBodyBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+- (NSURL *)redirectURLForStatus:(NSInteger)aStatus headers:(NSDictionary *)headers;
+- (void)followRedirectToURL:(NSURL *)aURL status:(NSInteger)aStatus;
+- (NSData *)serializedRequestForProxy:(BOOL)isProxied;
+
+//! Sets the outcome (nil for success), wakes waiters and tells the delegate, unless the request is already done
+- (void)completeWithError:(NSError *)anError;
+
+//! \endgroup
+
+@property(assign)   WOHTTPConnection *connection;
+@property(copy)     NSString *routeKey;
+@property(assign)   NSTimer *timeoutTimer;
+@property           BOOL retriedStale;
+@property(readonly) NSTimeInterval lastActivity;
+
+@end
+
+@interface WOHTTPClient ()
+
+- (void)runNetworkThread:(NSConditionLock *)ready;
+- (NSDictionary *)proxySettings;
+- (void)cancelRequest:(WOHTTPRequest *)aRequest;
+
+//! \name Network thread
+//! \startgroup
+
+- (void)enqueueRequest:(WOHTTPRequest *)aRequest;
+- (void)enqueueRequest:(WOHTTPRequest *)aRequest atFront:(BOOL)atFront;
+- (void)abortRequest:(WOHTTPRequest *)aRequest;
+- (void)requestTimerFired:(NSTimer *)aTimer;
+- (void)dispatchRoute:(NSString *)aKey;
+- (WOHTTPConnection *)openConnectionForRequest:(WOHTTPRequest *)aRequest;
+- (void)removeConnection:(WOHTTPConnection *)aConnection;
+- (void)removePendingRequest:(WOHTTPRequest *)aRequest;
+- (void)sweepIdleConnections:(NSTimer *)aTimer;
+- (void)connection:(WOHTTPConnection *)aConnection didFinishRequest:(WOHTTPRequest *)aRequest redirected:(BOOL)redirected;
+- (void)connection:(WOHTTPConnection *)aConnection
+    didFailRequest:(WOHTTPRequest *)aRequest
+             error:(NSError *)anError
+             stale:(BOOL)isStale;
+- (void)connectionBecameIdle:(WOHTTPConnection *)aConnection;
+- (void)connectionDidClose:(WOHTTPConnection *)aConnection;
+
+//! \endgroup
+
+@end
+
+#pragma mark -
+
+@implementation WOHTTPRequest
+
+#pragma mark -
+#pragma mark NSObject overrides
+
++ (WOHTTPRequest *)requestWithURL:(NSURL *)aURL
+{
+    return [[self alloc] initWithURL:aURL];
+}
+
+- (id)initWithURL:(NSURL *)aURL
+{
+    NSParameterAssert(aURL != nil);
+    if ((self = [super init]))
+    {
+        self->URL               = [aURL absoluteURL];
+        self->HTTPMethod        = @"GET";
+        self->headerFields      = [NSMutableDictionary dictionary];
+        self->timeoutInterval   = WO_HTTP_DEFAULT_TIMEOUT;
+        self->condition         = [[NSCondition alloc] init];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)setValue:(NSString *)aValue forHTTPHeaderField:(NSString *)aField
+{
+    NSParameterAssert(aField != nil);
+    if (aValue)
+        [headerFields setObject:[aValue copy] forKey:aField];
+    else
+        [headerFields removeObjectForKey:aField];
+}
+
+- (void)cancel
+{
+    [condition lock];
+    BOOL wasRunning = started && !done;
+    cancelled = YES;
+    done = YES;
+    [condition broadcast];
+    [condition unlock];
+    if (wasRunning)
+        [client cancelRequest:self];
+}
+
+- (BOOL)waitUntilDone
+{
+    NSAssert(started, @"request not started");
+    [condition lock];
+    while (!done)
+        [condition wait];
+    BOOL finished = !cancelled && !error;
+    [condition unlock];
+    return finished;
+}
+
+#pragma mark -
+#pragma mark Caller's thread
+
+- (BOOL)prepareToStartWithClient:(WOHTTPClient *)aClient
+{
+    [condition lock];
+    BOOL wasStarted = started;
+    started = YES;
+    [condition unlock];
+    if (wasStarted)
+        return NO;
+    client          = aClient;
+    delegateThread  = [NSThread currentThread];
+    lastActivity    = [NSDate timeIntervalSinceReferenceDate];
+    return YES;
+}
+
+// the deliver methods run on the delegate's thread, possibly after the request was cancelled there
+
+- (void)deliverResponse:(NSNumber *)aStatus
+{
+    if (![self isCancelled])
+        [delegate HTTPRequest:self didReceiveResponseWithStatus:[aStatus integerValue]];
+}
+
+- (void)deliverData:(NSData *)data
+{
+    if (![self isCancelled])
+        [delegate HTTPRequest:self didReceiveData:data];
+}
+
+- (void)deliverFinish:(id)ignored
+{
+    if (![self isCancelled])
+        [delegate HTTPRequestDidFinishLoading:self];
+}
+
+- (void)deliverFailure:(NSError *)anError
+{
+    if (![self isCancelled])
+        [delegate HTTPRequest:self didFailWithError:anError];
+}
+
+#pragma mark -
+#pragma mark Network thread
+
+- (void)noteActivity
+{
+    lastActivity = [NSDate timeIntervalSinceReferenceDate];
+}
+
+- (void)beginResponseWithStatus:(NSInteger)aStatus headers:(NSDictionary *)headers
+{
+    [condition lock];
+    statusCode      = aStatus;
+    responseHeaders = [headers copy];
+    [condition unlock];
+    if (delegate)
+        [self performSelector:@selector(deliverResponse:)
+                     onThread:delegateThread
+                   withObject:[NSNumber numberWithInteger:aStatus]
+                waitUntilDone:NO
+                        modes:WOHTTPDeliveryModes()];
+}
+
+- (BOOL)appendBodyBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+    receivedLength += length;
+    if (maximumResponseLength && receivedLength > maximumResponseLength)
+        return NO;
+    if (responseBuffer)
+        [responseBuffer appendBytes:bytes length:length];
+    else if (delegate)
+        [self performSelector:@selector(deliverData:)
+                     onThread:delegateThread
+                   withObject:[NSData dataWithBytes:bytes length:length]
+                waitUntilDone:NO
+                        modes:WOHTTPDeliveryModes()];
+    return YES;
+}
+
+- (NSURL *)redirectURLForStatus:(NSInteger)aStatus headers:(NSDictionary *)headers
+{
+    if (aStatus != 301 && aStatus != 302 && aStatus != 303 && aStatus != 307)
+        return nil;
+
+    // other methods are only redirected by a 303, which turns them into a GET
+    if (aStatus != 303 && ![HTTPMethod isEqualToString:@"GET"] && ![HTTPMethod isEqualToString:@"HEAD"])
+        return nil;
+    NSString *location = [headers objectForKey:@"location"];
+    if (!location || redirectCount >= WO_HTTP_MAXIMUM_REDIRECTS)
+        return nil;
+    NSURL *target = [[NSURL URLWithString:location relativeToURL:[self URL]] absoluteURL];
+    NSString *scheme = [[target scheme] lowercaseString];
+    if (![scheme isEqualToString:@"http"] && ![scheme isEqualToString:@"https"])
+        return nil;
+    return target;
+}
+
+- (void)followRedirectToURL:(NSURL *)aURL status:(NSInteger)aStatus
+{
+    [condition lock];
+    URL = aURL;
+    [condition unlock];
+    if (aStatus == 303 && ![HTTPMethod isEqualToString:@"HEAD"])
+    {
+        HTTPMethod  = @"GET";
+        HTTPBody    = nil;
+    }
+    redirectCount++;
+    receivedLength = 0;
+}
+
+- (NSData *)serializedRequestForProxy:(BOOL)isProxied
+{
+    NSURL *target = [self URL];
+    NSString *path;
+    if (isProxied)
+        path = [[[target absoluteString] componentsSeparatedByString:@"#"] objectAtIndex:0];
+    else
+    {
+        // CFURLCopyPath leaves percent escapes alone, unlike -[NSURL path]
+        path = NSMakeCollectable(CFURLCopyPath((CFURLRef)target));
+        if (![path length])
+            path = @"/";
+        if ([target query])
+            path = [NSString stringWithFormat:@"%@?%@", path, [target query]];
+    }
+    NSString *host = [target host];
+    if ([target port])
+        host = [NSString stringWithFormat:@"%@:%@", host, [target port]];
+
+    NSMutableString *head = [NSMutableString stringWithFormat:@"%@ %@ HTTP/1.1\r\nHost: %@\r\n", HTTPMethod, path, host];
+    for (NSString *field in headerFields)
+        [head appendFormat:@"%@: %@\r\n", field, [headerFields objectForKey:field]];
+    if (HTTPBody || [HTTPMethod isEqualToString:@"POST"] || [HTTPMethod isEqualToString:@"PUT"])
+        [head appendFormat:@"Content-Length: %u\r\n", (unsigned)[HTTPBody length]];
+    [head appendString:@"\r\n"];
+
+    NSMutableData *data = [NSMutableData dataWithData:[head dataUsingEncoding:NSISOLatin1StringEncoding
+                                                         allowLossyConversion:YES]];
+    if (HTTPBody)
+        [data appendData:HTTPBody];
+    return data;
+}
+
+- (void)completeWithError:(NSError *)anError
+{
+    [timeoutTimer invalidate];
+    timeoutTimer    = nil;
+    connection      = nil;
+
+    [condition lock];
+    BOOL wasDone = done;
+    if (!wasDone)
+    {
+        done    = YES;
+        error   = anError;
+        [condition broadcast];
+    }
+    [condition unlock];
+    if (wasDone || !delegate)
+        return;
+    if (anError)
+        [self performSelector:@selector(deliverFailure:)
+                     onThread:delegateThread
+                   withObject:anError
+                waitUntilDone:NO
+                        modes:WOHTTPDeliveryModes()];
+    else
+        [self performSelector:@selector(deliverFinish:)
+                     onThread:delegateThread
+                   withObject:nil
+                waitUntilDone:NO
+                        modes:WOHTTPDeliveryModes()];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (NSURL *)URL
+{
+    NSURL *value;
+    [condition lock];
+    value = URL;
+    [condition unlock];
+    return value;
+}
+
+- (NSInteger)statusCode
+{
+    NSInteger value;
+    [condition lock];
+    value = statusCode;
+    [condition unlock];
+    return value;
+}
+
+- (NSDictionary *)responseHeaders
+{
+    NSDictionary *value;
+    [condition lock];
+    value = responseHeaders;
+    [condition unlock];
+    return value;
+}
+
+- (NSError *)error
+{
+    NSError *value;
+    [condition lock];
+    value = error;
+    [condition unlock];
+    return value;
+}
+
+- (BOOL)isCancelled
+{
+    BOOL value;
+    [condition lock];
+    value = cancelled;
+    [condition unlock];
+    return value;
+}
+
+@synthesize HTTPMethod;
+@synthesize HTTPBody;
+@synthesize timeoutInterval;
+@synthesize responseBuffer;
+@synthesize maximumResponseLength;
+@synthesize delegate;
+@synthesize connection;
+@synthesize routeKey;
+@synthesize timeoutTimer;
+@synthesize retriedStale;
+@synthesize lastActivity;
+
+@end
+
+#pragma mark -
+
+@implementation WOHTTPConnection
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithClient:(WOHTTPClient *)aClient
+            routeKey:(NSString *)aKey
+                host:(NSString *)aHost
+                port:(UInt32)aPort
+              secure:(BOOL)isSecure
+             proxied:(BOOL)isProxied
+       proxySettings:(NSDictionary *)proxies
+{
+    if ((self = [super init]))
+    {
+        CFReadStreamRef readStream = NULL;
+        CFWriteStreamRef writeStream = NULL;
+        CFStreamCreatePairWithSocketToHost(kCFAllocatorDefault, (CFStringRef)aHost, aPort, &readStream, &writeStream);
+        if (!readStream || !writeStream)
+        {
+            if (readStream)
+                CFRelease(readStream);
+            if (writeStream)
+                CFRelease(writeStream);
+            return nil;
+        }
+        self->input     = NSMakeCollectable(readStream);
+        self->output    = NSMakeCollectable(writeStream);
+        self->client    = aClient;
+        self->routeKey  = [aKey copy];
+        self->proxied   = isProxied;
+        self->line      = [NSMutableData dataWithCapacity:256];
+
+        // both properties apply to the socket, and so to both streams
+        if (isSecure)
+            [input setProperty:NSStreamSocketSecurityLevelNegotiatedSSL forKey:NSStreamSocketSecurityLevelKey];
+        if ([[proxies objectForKey:(NSString *)kSCPropNetProxiesSOCKSEnable] boolValue])
+            [input setProperty:proxies forKey:NSStreamSOCKSProxyConfigurationKey];
+
+        for (NSStream *stream in [NSArray arrayWithObjects:input, output, nil])
+        {
+            [stream setDelegate:self];
+            [stream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+            [stream open];
+        }
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)sendRequest:(WOHTTPRequest *)aRequest
+{
+    NSAssert(!request, @"connection busy");
+    request         = aRequest;
+    outbox          = [aRequest serializedRequestForProxy:proxied];
+    outboxOffset    = 0;
+    state           = WOHTTPReadStatus;
+    status          = 0;
+    headers         = nil;
+    lastHeader      = nil;
+    headerCount     = 0;
+    remaining       = 0;
+    reusable        = NO;
+    receivedBytes   = NO;
+    redirectURL     = nil;
+    [line setLength:0];
+    [self writeOutbox];
+}
+
+- (void)abandonRequest
+{
+    request = nil;
+    [self close];
+}
+
+- (void)close
+{
+    for (NSStream *stream in [NSArray arrayWithObjects:input, output, nil])
+    {
+        [stream setDelegate:nil];
+        [stream removeFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+        [stream close];
+    }
+    input   = nil;
+    output  = nil;
+    outbox  = nil;
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+- (void)writeOutbox
+{
+    while (outbox && [output hasSpaceAvailable])
+    {
+        NSInteger written = [output write:(const uint8_t *)[outbox bytes] + outboxOffset
+                                maxLength:[outbox length] - outboxOffset];
+        if (written < 0)
+        {
+            [self failWithCode:NSURLErrorNetworkConnectionLost
+                   description:@"The connection was lost while sending the request"
+                    underlying:[output streamError]];
+            return;
+        }
+        if (written == 0)
+            break;
+        [request noteActivity];
+        outboxOffset += (NSUInteger)written;
+        if (outboxOffset == [outbox length])
+            outbox = nil;
+    }
+}
+
+- (void)consumeBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+    while (length > 0 && request && state != WOHTTPReadDone)
+    {
+        if (state == WOHTTPReadBody || state == WOHTTPReadChunkData || state == WOHTTPReadUntilClose)
+        {
+            // body bytes go straight from the read buffer to the request
+            NSUInteger count = length;
+            if (state != WOHTTPReadUntilClose && remaining < count)
+                count = (NSUInteger)remaining;
+            if (![self deliverBytes:bytes length:count])
+                return;
+            bytes += count;
+            length -= count;
+            if (state != WOHTTPReadUntilClose && (remaining -= count) == 0)
+                state = (state == WOHTTPReadBody) ? WOHTTPReadDone : WOHTTPReadChunkEnd;
+            continue;
+        }
+
+        const uint8_t *newline = memchr(bytes, '\n', length);
+        NSUInteger count = newline ? (NSUInteger)(newline - bytes) + 1 : length;
+        [line appendBytes:bytes length:count];
+        bytes += count;
+        length -= count;
+        if ([line length] > WO_HTTP_MAXIMUM_LINE)
+        {
+            [self failWithCode:NSURLErrorBadServerResponse description:@"The server sent an overlong line" underlying:nil];
+            return;
+        }
+        if (newline && ![self processLine])
+            return;
+    }
+    if (!request)
+        return;
+    if (state == WOHTTPReadDone)
+    {
+        // anything more belongs to no request: the server is confused, so don't trust the connection again
+        if (length > 0)
+            reusable = NO;
+        [self finishResponse];
+    }
+}
+
+// handles the line in line (including its line feed); returns NO if the response was rejected
+- (BOOL)processLine
+{
+    NSUInteger length = [line length] - 1;
+    const char *bytes = [line bytes];
+    if (length > 0 && bytes[length - 1] == '\r')
+        length--;
+    [line setLength:length];
+    [line appendBytes:"" length:1];     // NUL-terminate
+    const char *text = [line bytes];
+    BOOL ok = YES;
+
+    switch (state)
+    {
+        case WOHTTPReadStatus:
+        {
+            int code = 0;
+            if (sscanf(text, "HTTP/1.%d %3d", &minorVersion, &code) != 2 || code < 100)
+                ok = NO;
+            status      = code;
+            headers     = [NSMutableDictionary dictionary];
+            lastHeader  = nil;
+            headerCount = 0;
+            state       = WOHTTPReadHeaders;
+            break;
+        }
+        case WOHTTPReadHeaders:
+            if (length == 0)
+            {
+                [line setLength:0];
+                return [self processHeaders];
+            }
+            if (++headerCount > WO_HTTP_MAXIMUM_HEADERS)
+                ok = NO;
+            else if ((text[0] == ' ' || text[0] == '\t') && lastHeader)
+            {
+                // obsolete line folding
+                NSString *more = [[NSString stringWithCString:text encoding:NSISOLatin1StringEncoding]
+                                  stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+                [headers setObject:[NSString stringWithFormat:@"%@ %@", [headers objectForKey:lastHeader], more]
+                            forKey:lastHeader];
+            }
+            else
+            {
+                const char *colon = strchr(text, ':');
+                if (!colon || colon == text)
+                    ok = NO;
+                else
+                {
+                    NSString *name = [[[NSString alloc] initWithBytes:text
+                                                               length:(NSUInteger)(colon - text)
+                                                             encoding:NSISOLatin1StringEncoding] lowercaseString];
+                    NSString *value = [[NSString stringWithCString:colon + 1 encoding:NSISOLatin1StringEncoding]
+                                       stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+                    NSString *previous = [headers objectForKey:name];
+                    if (previous)
+                        value = [NSString stringWithFormat:@"%@, %@", previous, value];
+                    [headers setObject:value forKey:name];
+                    lastHeader = name;
+                }
+            }
+            break;
+        case WOHTTPReadChunkSize:
+        {
+            char *end = NULL;
+            unsigned long long size = strtoull(text, &end, 16);
+            if (end == text)
+                ok = NO;
+            else if (size == 0)
+                state = WOHTTPReadTrailer;
+            else
+            {
+                remaining   = size;
+                state       = WOHTTPReadChunkData;
+            }
+            break;
+        }
+        case WOHTTPReadChunkEnd:
+            if (length == 0)
+                state = WOHTTPReadChunkSize;
+            else
+                ok = NO;
+            break;
+        case WOHTTPReadTrailer:
+            if (length == 0)
+                state = WOHTTPReadDone;
+            break;
+        default:
+            break;
+    }
+    [line setLength:0];
+    if (!ok)
+        [self failWithCode:NSURLErrorBadServerResponse description:@"The server sent a malformed response" underlying:nil];
+    return ok;
+}
+
+// works out how the body is delimited once the headers are in; returns NO if the response was rejected
+- (BOOL)processHeaders
+{
+    // "100 Continue" and the like come before the real response
+    if (status < 200)
+    {
+        state = WOHTTPReadStatus;
+        return YES;
+    }
+
+    NSString *connectionOptions = [[headers objectForKey:@"connection"] lowercaseString];
+    if (minorVersion >= 1)
+        reusable = ([connectionOptions rangeOfString:@"close"].location == NSNotFound);
+    else
+        reusable = ([connectionOptions rangeOfString:@"keep-alive"].location != NSNotFound);
+    NSString *keepAlive = [[headers objectForKey:@"keep-alive"] lowercaseString];
+    NSRange timeout = [keepAlive rangeOfString:@"timeout="];
+    if (timeout.location != NSNotFound)
+        keepAliveTimeout = [[keepAlive substringFromIndex:NSMaxRange(timeout)] doubleValue];
+
+    redirectURL = [request redirectURLForStatus:status headers:headers];
+    if (!redirectURL)
+        [request beginResponseWithStatus:status headers:headers];
+
+    NSString *encoding = [[headers objectForKey:@"transfer-encoding"] lowercaseString];
+    NSString *contentLength = [headers objectForKey:@"content-length"];
+    if ([[request HTTPMethod] isEqualToString:@"HEAD"] || status == 204 || status == 304)
+        state = WOHTTPReadDone;
+    else if (encoding && ![encoding isEqualToString:@"identity"])
+    {
+        if ([encoding rangeOfString:@"chunked"].location != NSNotFound)
+            state = WOHTTPReadChunkSize;
+        else
+        {
+            state       = WOHTTPReadUntilClose;
+            reusable    = NO;
+        }
+    }
+    else if (contentLength)
+    {
+        const char *digits = [contentLength UTF8String];
+        char *end = NULL;
+        remaining = strtoull(digits, &end, 10);
+        if (end == digits || *end != '\0')
+        {
+            [self failWithCode:NSURLErrorBadServerResponse description:@"The server sent a bad Content-Length" underlying:nil];
+            return NO;
+        }
+        NSUInteger limit = [request maximumResponseLength];
+        if (!redirectURL && limit && remaining > limit)
+        {
+            [self failWithCode:NSURLErrorDataLengthExceedsMaximum
+                   description:@"The response is too large"
+                    underlying:nil];
+            return NO;
+        }
+        state = remaining ? WOHTTPReadBody : WOHTTPReadDone;
+    }
+    else
+    {
+        state       = WOHTTPReadUntilClose;
+        reusable    = NO;
+    }
+    return YES;
+}
+
+// returns NO if the request was failed
+- (BOOL)deliverBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+    if (redirectURL)
+        return YES;     // the body of a redirect is of no interest
+    if ([request appendBodyBytes:bytes length:length])
+        return YES;
+    [self failWithCode:NSURLErrorDataLengthExceedsMaximum description:@"The response is too large" underlying:nil];
+    return NO;
+}
+
+- (void)finishResponse
+{
+    WOHTTPRequest *finished = request;
+    NSURL *redirect = redirectURL;
+    request     = nil;
+    redirectURL = nil;
+    requestsServed++;
+    if (reusable)
+    {
+        NSTimeInterval idle = WO_HTTP_IDLE_TIMEOUT;
+        if (keepAliveTimeout > 1.0)
+            idle = MIN(idle, keepAliveTimeout - 1.0);
+        idleDeadline = [NSDate timeIntervalSinceReferenceDate] + idle;
+    }
+    else
+        [self close];
+    if (redirect)
+        [finished followRedirectToURL:redirect status:status];
+    [client connection:self didFinishRequest:finished redirected:(redirect != nil)];
+}
+
+- (void)endOfStream
+{
+    if (!request)
+        [self dropWhileIdle];
+    else if (state == WOHTTPReadUntilClose)
+    {
+        reusable    = NO;
+        state       = WOHTTPReadDone;
+        [self finishResponse];
+    }
+    else
+        [self failWithCode:NSURLErrorNetworkConnectionLost
+               description:@"The server closed the connection before it had finished responding"
+                underlying:nil];
+}
+
+- (void)failWithCode:(NSInteger)code description:(NSString *)description underlying:(NSError *)underlying
+{
+    WOHTTPRequest *failed = request;
+    NSError *failure = WOHTTPError(code, [failed URL], description, underlying);
+
+    // a reused connection the server had already given up on, before it said anything; safe to send again only if
+    // none of the request went out or sending it twice does no harm (a POST may have reached the server and been acted on)
+    NSString *method = [failed HTTPMethod];
+    BOOL idempotent = ([method isEqualToString:@"GET"] || [method isEqualToString:@"HEAD"]);
+    BOOL stale = (requestsServed > 0 && !receivedBytes && (outboxOffset == 0 || idempotent));
+    request = nil;
+    [self close];
+    [client connection:self didFailRequest:failed error:failure stale:stale];
+}
+
+- (void)dropWhileIdle
+{
+    [self close];
+    [client connectionDidClose:self];
+}
+
+#pragma mark -
+#pragma mark NSStream delegate methods
+
+- (void)stream:(NSStream *)aStream handleEvent:(NSStreamEvent)eventCode
+{
+    switch (eventCode)
+    {
+        case NSStreamEventHasSpaceAvailable:
+            [self writeOutbox];
+            break;
+        case NSStreamEventHasBytesAvailable:
+        {
+            uint8_t buffer[WO_HTTP_READ_BUFFER];
+            NSInteger count = [input read:buffer maxLength:sizeof(buffer)];
+            if (count > 0 && request)
+            {
+                receivedBytes = YES;
+                [request noteActivity];
+                [self consumeBytes:buffer length:(NSUInteger)count];
+            }
+            else if (count > 0)
+                [self dropWhileIdle];   // nothing was asked for
+            else if (count == 0)
+                [self endOfStream];
+            else if (request)
+                [self failWithCode:NSURLErrorNetworkConnectionLost
+                       description:@"The connection was lost"
+                        underlying:[input streamError]];
+            else
+                [self dropWhileIdle];
+            break;
+        }
+        case NSStreamEventEndEncountered:
+            [self endOfStream];
+            break;
+        case NSStreamEventErrorOccurred:
+            if (!request)
+                [self dropWhileIdle];
+            else if (requestsServed == 0 && !receivedBytes)
+                [self failWithCode:NSURLErrorCannotConnectToHost
+                       description:@"Could not connect to the server"
+                        underlying:[aStream streamError]];
+            else
+                [self failWithCode:NSURLErrorNetworkConnectionLost
+                       description:@"The connection was lost"
+                        underlying:[aStream streamError]];
+            break;
+        default:
+            break;
+    }
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (BOOL)isOpen
+{
+    return input != nil;
+}
+
+@synthesize routeKey;
+@synthesize request;
+@synthesize idleDeadline;
+
+@end
+
+#pragma mark -
+
+@implementation WOHTTPClient
+
+static WOHTTPClient *WOSharedHTTPClient = nil;
+
+#pragma mark -
+#pragma mark NSObject overrides
+
++ (WOHTTPClient *)sharedClient
+{
+    @synchronized (self)
+    {
+        if (!WOSharedHTTPClient)
+            WOSharedHTTPClient = [[self alloc] init];
+    }
+    return WOSharedHTTPClient;
+}
+
+- (id)init
+{
+    if ((self = [super init]))
+    {
+        self->pendingRequests   = [NSMutableDictionary dictionary];
+        self->connections       = [NSMutableDictionary dictionary];
+
+        // performSelector:onThread: needs the thread's run loop to exist, so wait for it
+        NSConditionLock *ready = [[NSConditionLock alloc] initWithCondition:NO];
+        self->networkThread = [[NSThread alloc] initWithTarget:self selector:@selector(runNetworkThread:) object:ready];
+        [networkThread setName:@"org.wincent.Synergy.HTTP"];
+        [networkThread start];
+        [ready lockWhenCondition:YES];
+        [ready unlock];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)startRequest:(WOHTTPRequest *)aRequest
+{
+    NSParameterAssert(aRequest != nil);
+    if (![aRequest prepareToStartWithClient:self])
+    {
+        NSLog(@"warning: HTTP request for %@ started more than once", [aRequest URL]);
+        return;
+    }
+    [self performSelector:@selector(enqueueRequest:) onThread:networkThread withObject:aRequest waitUntilDone:NO];
+}
+
+- (BOOL)sendSynchronousRequest:(WOHTTPRequest *)aRequest
+{
+    NSAssert([NSThread currentThread] != networkThread, @"synchronous request on the network thread");
+    [self startRequest:aRequest];
+    return [aRequest waitUntilDone];
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+- (void)runNetworkThread:(NSConditionLock *)ready
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    NSRunLoop *runLoop = [NSRunLoop currentRunLoop];
+
+    // without a source the run loop would return straight away while there is nothing to do
+    [runLoop addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+    [ready lock];
+    [ready unlockWithCondition:YES];
+    [pool drain];
+    for (;;)
+    {
+        pool = [[NSAutoreleasePool alloc] init];
+        [runLoop runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]];
+        [pool drain];
+    }
+}
+
+- (NSDictionary *)proxySettings
+{
+    static NSDictionary     *settings   = nil;
+    static NSTimeInterval   expiry      = 0.0;
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (now >= expiry)
+    {
+        settings    = NSMakeCollectable(SCDynamicStoreCopyProxies(NULL));
+        expiry      = now + WO_HTTP_PROXY_SETTINGS_LIFETIME;
+    }
+    return settings;
+}
+
+- (void)cancelRequest:(WOHTTPRequest *)aRequest
+{
+    [self performSelector:@selector(abortRequest:) onThread:networkThread withObject:aRequest waitUntilDone:NO];
+}
+
+#pragma mark -
+#pragma mark Network thread
+
+- (void)enqueueRequest:(WOHTTPRequest *)aRequest
+{
+    [self enqueueRequest:aRequest atFront:NO];
+}
+
+- (void)enqueueRequest:(WOHTTPRequest *)aRequest atFront:(BOOL)atFront
+{
+    if ([aRequest isCancelled])
+        return;
+    NSString *host;
+    UInt32 port;
+    BOOL secure, proxied;
+    NSString *key = WOHTTPRouteForURL([aRequest URL], [self proxySettings], &host, &port, &secure, &proxied);
+    if (!key)
+    {
+        [aRequest completeWithError:WOHTTPError(NSURLErrorUnsupportedURL, [aRequest URL], @"Unsupported URL", nil)];
+        return;
+    }
+    [aRequest setRouteKey:key];
+    [aRequest noteActivity];
+    if (![aRequest timeoutTimer])
+        [aRequest setTimeoutTimer:[NSTimer scheduledTimerWithTimeInterval:[aRequest timeoutInterval]
+                                                                   target:self
+                                                                 selector:@selector(requestTimerFired:)
+                                                                 userInfo:aRequest
+                                                                  repeats:NO]];
+    NSMutableArray *queue = [pendingRequests objectForKey:key];
+    if (!queue)
+    {
+        queue = [NSMutableArray array];
+        [pendingRequests setObject:queue forKey:key];
+    }
+    if (atFront)
+        [queue insertObject:aRequest atIndex:0];
+    else
+        [queue addObject:aRequest];
+    [self dispatchRoute:key];
+}
+
+// the request has already been marked as done
+- (void)abortRequest:(WOHTTPRequest *)aRequest
+{
+    [[aRequest timeoutTimer] invalidate];
+    [aRequest setTimeoutTimer:nil];
+    WOHTTPConnection *connection = [aRequest connection];
+    [aRequest setConnection:nil];
+    if (connection)
+    {
+        // part of a response may still be on its way
+        [connection abandonRequest];
+        [self removeConnection:connection];
+        [self dispatchRoute:[connection routeKey]];
+    }
+    else
+        [self removePendingRequest:aRequest];
+}
+
+- (void)requestTimerFired:(NSTimer *)aTimer
+{
+    WOHTTPRequest *request = [aTimer userInfo];
+    NSTimeInterval deadline = [request lastActivity] + [request timeoutInterval];
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (now < deadline)
+    {
+        // there has been progress since the timer was set
+        [request setTimeoutTimer:[NSTimer scheduledTimerWithTimeInterval:deadline - now
+                                                                  target:self
+                                                                selector:@selector(requestTimerFired:)
+                                                                userInfo:request
+                                                                 repeats:NO]];
+        return;
+    }
+    [request setTimeoutTimer:nil];
+    WOHTTPConnection *connection = [request connection];
+    [request setConnection:nil];
+    if (connection)
+    {
+        [connection abandonRequest];
+        [self removeConnection:connection];
+    }
+    else
+        [self removePendingRequest:request];
+    [request completeWithError:WOHTTPError(NSURLErrorTimedOut, [request URL], @"The request timed out", nil)];
+    [self dispatchRoute:[request routeKey]];
+}
+
+- (void)dispatchRoute:(NSString *)aKey
+{
+    NSMutableArray *queue = [pendingRequests objectForKey:aKey];
+    while ([queue count] > 0)
+    {
+        WOHTTPRequest *request = [queue objectAtIndex:0];
+        if ([request isCancelled])
+        {
+            [queue removeObjectAtIndex:0];
+            continue;
+        }
+
+        // the most recently used idle connection is the least likely to have been closed by the server
+        WOHTTPConnection *connection = nil;
+        NSArray *open = [connections objectForKey:aKey];
+        for (WOHTTPConnection *candidate in open)
+            if (![candidate request] && (!connection || [candidate idleDeadline] > [connection idleDeadline]))
+                connection = candidate;
+        if (!connection)
+        {
+            if ([open count] >= WO_HTTP_MAXIMUM_CONNECTIONS)
+                break;
+            connection = [self openConnectionForRequest:request];
+            if (!connection)
+            {
+                [queue removeObjectAtIndex:0];
+                [request completeWithError:WOHTTPError(NSURLErrorCannotConnectToHost, [request URL],
+                                                       @"Could not connect to the server", nil)];
+                continue;
+            }
+        }
+        [queue removeObjectAtIndex:0];
+        [request setConnection:connection];
+        [connection sendRequest:request];
+    }
+    if (queue && [queue count] == 0)
+        [pendingRequests removeObjectForKey:aKey];
+}
+
+- (WOHTTPConnection *)openConnectionForRequest:(WOHTTPRequest *)aRequest
+{
+    NSString *host;
+    UInt32 port;
+    BOOL secure, proxied;
+    NSDictionary *proxies = [self proxySettings];
+    NSString *key = WOHTTPRouteForURL([aRequest URL], proxies, &host, &port, &secure, &proxied);
+    WOHTTPConnection *connection = [[WOHTTPConnection alloc] initWithClient:self
+                                                                   routeKey:key
+                                                                       host:host
+                                                                       port:port
+                                                                     secure:secure
+                                                                    proxied:proxied
+                                                              proxySettings:proxies];
+    if (!connection)
+        return nil;
+    NSMutableArray *open = [connections objectForKey:key];
+    if (!open)
+    {
+        open = [NSMutableArray array];
+        [connections setObject:open forKey:key];
+    }
+    [open addObject:connection];
+    @synchronized (self)
+    {
+        connectionsOpened++;
+    }
+    return connection;
+}
+
+- (void)removeConnection:(WOHTTPConnection *)aConnection
+{
+    [aConnection close];
+    NSMutableArray *open = [connections objectForKey:[aConnection routeKey]];
+    [open removeObjectIdenticalTo:aConnection];
+    if (open && [open count] == 0)
+        [connections removeObjectForKey:[aConnection routeKey]];
+}
+
+- (void)removePendingRequest:(WOHTTPRequest *)aRequest
+{
+    NSString *key = [aRequest routeKey];
+    if (!key)
+        return;
+    NSMutableArray *queue = [pendingRequests objectForKey:key];
+    [queue removeObjectIdenticalTo:aRequest];
+    if (queue && [queue count] == 0)
+        [pendingRequests removeObjectForKey:key];
+}
+
+- (void)sweepIdleConnections:(NSTimer *)aTimer
+{
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    BOOL anyIdle = NO;
+    for (NSArray *open in [connections allValues])
+    {
+        for (WOHTTPConnection *connection in [open copy])
+        {
+            if ([connection request])
+                continue;
+            if (now >= [connection idleDeadline])
+                [self removeConnection:connection];
+            else
+                anyIdle = YES;
+        }
+    }
+    if (!anyIdle)
+    {
+        [idleTimer invalidate];
+        idleTimer = nil;
+    }
+}
+
+- (void)connection:(WOHTTPConnection *)aConnection didFinishRequest:(WOHTTPRequest *)aRequest redirected:(BOOL)redirected
+{
+    [aRequest setConnection:nil];
+    if ([aConnection isOpen])
+        [self connectionBecameIdle:aConnection];
+    else
+        [self removeConnection:aConnection];
+    if (redirected)
+        [self enqueueRequest:aRequest];     // does nothing if it has been cancelled
+    else
+    {
+        @synchronized (self)
+        {
+            requestsCompleted++;
+        }
+        [aRequest completeWithError:nil];
+    }
+    [self dispatchRoute:[aConnection routeKey]];
+}
+
+- (void)connection:(WOHTTPConnection *)aConnection
+    didFailRequest:(WOHTTPRequest *)aRequest
+             error:(NSError *)anError
+             stale:(BOOL)isStale
+{
+    [self removeConnection:aConnection];
+    [aRequest setConnection:nil];
+    if (isStale && ![aRequest retriedStale])
+    {
+        // the server closed the connection before answering and the request is safe to repeat (see failWithCode:),
+        // so try again on a fresh one
+        [aRequest setRetriedStale:YES];
+        [self enqueueRequest:aRequest atFront:YES];
+    }
+    else
+        [aRequest completeWithError:anError];
+    [self dispatchRoute:[aConnection routeKey]];
+}
+
+- (void)connectionBecameIdle:(WOHTTPConnection *)aConnection
+{
+    if (!idleTimer)
+        idleTimer = [NSTimer scheduledTimerWithTimeInterval:WO_HTTP_IDLE_SWEEP_INTERVAL
+                                                     target:self
+                                                   selector:@selector(sweepIdleConnections:)
+                                                   userInfo:nil
+                                                    repeats:YES];
+}
+
+- (void)connectionDidClose:(WOHTTPConnection *)aConnection
+{
+    [self removeConnection:aConnection];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (NSUInteger)connectionsOpened
+{
+    NSUInteger value;
+    @synchronized (self)
+    {
+        value = connectionsOpened;
+    }
+    return value;
+}
+
+- (NSUInteger)requestsCompleted
+{
+    NSUInteger value;
+    @synchronized (self)
+    {
+        value = requestsCompleted;
+    }
+    return value;
+}
+
+@end
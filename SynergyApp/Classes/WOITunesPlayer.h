@@ -0,0 +1,45 @@
+//
+//  WOITunesPlayer.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Cocoa/Cocoa.h>
+
+#import "WOPlayerBackend.h"
+
+@class WOAppleScriptTable;
+
+//! Talks to iTunes with Apple Events, AppleScript and the Scripting Bridge.
+//!
+//! iTunes 4.7 and later post a com.apple.iTunes.playerInfo distributed notification on every change of track or state,
+//! which is passed straight on to the delegate; with older versions the controller has to poll the snapshot.
+//!
+//! Nothing is sent to iTunes while it is not running: every script has an implicit "run" and would launch it again as it
+//! quits. The snapshot also checks that iTunes answers a harmless Apple Event first (see readyToReceiveAppleScript).
+@interface WOITunesPlayer : NSObject <WOPlayerBackend> {
+
+    id <WOPlayerBackendDelegate>    delegate;
+
+    //! Gets the twelve snapshot fields in one go (Scripts/getSongInfo.scpt)
+    NSAppleScript                   *getSongInfoScript;
+
+    //! Every other script, compiled once by prepare; guarded by scriptLock
+    WOAppleScriptTable              *scripts;
+
+    //! The items of the last getSongInfo result and the strings made from them, so that unchanged fields are not coerced
+    //! again and come back as the same objects (NSNull where there was nothing); guarded by scriptLock
+    NSMutableArray                  *fieldDescriptors;
+    NSMutableArray                  *fieldStrings;
+
+    //! Held while a script runs: WOPlayerQueue runs them on its worker thread, but prepare and statisticsDescription may
+    //! be sent from elsewhere, and NSAppleScript must only be used by one thread at a time
+    NSLock                          *scriptLock;
+
+    //! Cached result of sendsNotifications
+    BOOL                            sendsNotifications;
+    BOOL                            checkedVersion;
+}
+
+@end
@@ -0,0 +1,991 @@
+// WOITunesPlayer.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOITunesPlayer.h"
+
+// system headers
+#import <Carbon/Carbon.h>
+
+// other headers
+#import "iTunes.h"
+#import "NSImage+WOAdditions.h"
+#import "WOAppleScriptTable.h"
+#import "WODebug.h"
+#import "WOPlayerSnapshot.h"
+#import "WOProcessManager.h"
+#import "WOSynergyGlobal.h"
+
+//! iTunes' creator code
+#define WO_ITUNES_SIGNATURE 'hook'
+
+//! Number of items in a full getSongInfo result
+#define WO_SONG_INFO_FIELD_COUNT    12
+
+@interface WOITunesPlayer ()
+
+- (void)sendAppleEventClass:(AEEventClass)eventClass ID:(AEEventID)eventID;
+- (void)addScripts;
+- (BOOL)readyToReceiveAppleScript;
+- (NSString *)resultOfScriptNamed:(NSString *)name parameters:(NSArray *)parameters;
+- (int)changeRatingByStars:(int)stars;
+- (int)changeVolumeBySegments:(int)segments;
+- (WOPlayerSnapshot *)snapshotFromDescriptor:(NSAppleEventDescriptor *)descriptor;
+- (NSString *)stringForField:(NSInteger)index ofDescriptor:(NSAppleEventDescriptor *)descriptor;
+- (void)playerInfoNotification:(NSNotification *)aNotification;
+
+@end
+
+@implementation WOITunesPlayer
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)init
+{
+    if ((self = [super init]))
+    {
+        NSURL *url = [NSURL fileURLWithPath:
+            [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:@"Scripts/getSongInfo.scpt"]];
+        getSongInfoScript = [[NSAppleScript alloc] initWithContentsOfURL:url error:nil];
+        if (!getSongInfoScript)
+            ELOG(@"Error loading getSongInfo script");
+
+        scripts             = [[WOAppleScriptTable alloc] init];
+        [self addScripts];
+        scriptLock          = [[NSLock alloc] init];
+        fieldDescriptors    = [[NSMutableArray alloc] initWithCapacity:WO_SONG_INFO_FIELD_COUNT];
+        fieldStrings        = [[NSMutableArray alloc] initWithCapacity:WO_SONG_INFO_FIELD_COUNT];
+        for (NSUInteger i = 0; i < WO_SONG_INFO_FIELD_COUNT; i++)
+        {
+            [fieldDescriptors addObject:[NSNull null]];
+            [fieldStrings addObject:[NSNull null]];
+        }
+
+        // iTunes 4.7 and later; older versions just never post it
+        [[NSDistributedNotificationCenter defaultCenter] addObserver:self
+                                                            selector:@selector(playerInfoNotification:)
+                                                                name:@"com.apple.iTunes.playerInfo"
+                                                              object:nil];
+    }
+    return self;
+}
+
+- (void)finalize
+{
+    [[NSDistributedNotificationCenter defaultCenter] removeObserver:self];
+    [super finalize];
+}
+
+#pragma mark -
+#pragma mark WOPlayerBackend protocol
+
+- (void)setDelegate:(id <WOPlayerBackendDelegate>)aDelegate
+{
+    delegate = aDelegate;
+}
+
+- (void)prepare
+{
+    [scriptLock lock];
+    [scripts compileAll];
+    LOG(@"Compiled %u iTunes scripts", [scripts compilationCount]);
+    [scriptLock unlock];
+}
+
+- (NSString *)statisticsDescription
+{
+    [scriptLock lock];
+    NSString *description = [scripts statisticsDescription];
+    [scriptLock unlock];
+    return description;
+}
+
+- (BOOL)sendsNotifications
+{
+    if (checkedVersion)
+        return sendsNotifications;
+    checkedVersion = YES;
+
+    NSWorkspace *workspace  = [NSWorkspace sharedWorkspace];
+    NSString    *path       = [workspace fullPathForApplication:@"iTunes.app"];
+    if (path)
+    {
+        NSBundle     *bundle     = [NSBundle bundleWithPath:path];
+        NSDictionary *info       = [bundle infoDictionary];
+        NSString     *version    = [info objectForKey:@"CFBundleVersion"];
+        NSArray      *components = [version componentsSeparatedByString:@"."];
+        if (components && ([components count] >= 2))
+        {
+            int majorVersion, minorVersion;
+            NSScanner *scanner1 = [NSScanner scannerWithString:[components objectAtIndex:0]];
+            NSScanner *scanner2 = [NSScanner scannerWithString:[components objectAtIndex:1]];
+            if ([scanner1 scanInt:&majorVersion] && [scanner2 scanInt:&minorVersion])
+            {
+                if (((majorVersion == 4) && (minorVersion >= 7)) || (majorVersion > 4))
+                    sendsNotifications = YES;
+            }
+        }
+    }
+    return sendsNotifications;
+}
+
+- (BOOL)isRunning
+{
+    return [WOProcessManager processRunningWithSignature:WO_ITUNES_SIGNATURE];
+}
+
+- (BOOL)isFrontmost
+{
+    ProcessSerialNumber frontPSN;
+    if (GetFrontProcess(&frontPSN) != noErr)
+    {
+        ELOG(@"Error getting frontmost process");
+        return NO;
+    }
+    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:WO_ITUNES_SIGNATURE];
+    return ([WOProcessManager processRunningWithSignature:WO_ITUNES_SIGNATURE] &&
+            [WOProcessManager process:iTunesPSN isSameAs:frontPSN]);
+}
+
+- (BOOL)launch
+{
+    // specifying .app here ensures that OS 9 iTunes doesn't get opened -- fixes:
+    // http://bugs.wincent.org/bugs/bug.php?op=show&bugid=27
+    if ([[NSWorkspace sharedWorkspace] launchApplication:@"iTunes.app"])
+        return YES;
+    ELOG(@"Error attempting to launch iTunes");
+    return NO;
+}
+
+- (void)quit
+{
+    [self sendAppleEventClass:'aevt' ID:'quit'];
+}
+
+- (void)activate
+{
+    // based on "AEBuild*, AEPrint* and friends":
+    //  http://developer.apple.com/technotes/tn/tn2045.html#dssyntaxcprgdb
+    // and "Lazy AppleScript sending":
+    //  http://www.unsanity.org/archives/000107.php#000107
+    ProcessSerialNumber psn = [WOProcessManager PSNForSignature:WO_ITUNES_SIGNATURE];
+    if (![WOProcessManager PSNEqualsNoProcess:psn])
+    {
+        AppleEvent      event;
+        AEBuildError    error;
+        NSString        *sendString = @"&subj:'null'()";
+        OSStatus err = AEBuildAppleEvent('misc', 'actv', typeProcessSerialNumber, &psn, sizeof(ProcessSerialNumber),
+                                         kAutoGenerateReturnID, kAnyTransactionID, &event, &error,
+                                         [sendString UTF8String]);
+        if (err)
+            // print the error and where it occurs
+            ELOG(@"%lu:%lu error building \"%@\"", error.fError, error.fErrorPos,
+                 [sendString substringToIndex:error.fErrorPos]);
+        else
+        {
+            AppleEvent reply;
+            if (AESend(&event, &reply, kAENoReply, kAENormalPriority, kAEDefaultTimeout, NULL, NULL) == noErr)
+                AEDisposeDesc(&reply);
+            AEDisposeDesc(&event);
+        }
+    }
+    else
+        // not running: a script has the welcome side-effect of launching it
+        (void)[self resultOfScriptNamed:@"launch" parameters:nil];
+}
+
+- (void)hide
+{
+    NSString *result = [self resultOfScriptNamed:@"hide" parameters:nil];
+    if ([result isEqualToString:@"ERROR"])
+        ELOG(@"Error while issuing \"hide iTunes\" directive");
+    else if (![result isEqualToString:@"SUCCESS"])
+        ELOG(@"Unknown error while issuing \"hide iTunes\" directive");
+}
+
+- (WOPlayerSnapshot *)snapshot
+{
+    /*
+
+     1. that it takes a second or two before the process manager sees that
+     iTunes isn't running
+     2. that Apple events sent to a non-running app have no effect -- presumably
+     because the PSN isn't in use
+     2b. when it's not running, no error is produced, so i can't test for
+     error status in order to ascertain if it's working
+     3. that events sent to a just-launched app will be queued until the app
+     is eventually ready, and they get processed
+     4. that apple events will never cause a respawn
+     5. that apple script is the friggin culprit, because only the applescript
+     cause the respawn
+     6. that i should reimplement the getInfoScript as an AppleEvent request
+
+     */
+    if (![self isRunning])
+        // avoid triggering an unwanted re-launch
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerNotRunning];
+
+    // a transitory failure (the user dragging the window, say) is not grounds to
+    // classify iTunes as "not running", which could take the controls out of the
+    // menu bar
+    if (![self readyToReceiveAppleScript])
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerUnknown];
+
+    [scriptLock lock];
+    NSAppleEventDescriptor *descriptor = [getSongInfoScript executeAndReturnError:NULL];
+    WOPlayerSnapshot *snapshot = [self snapshotFromDescriptor:descriptor];
+    [scriptLock unlock];
+    return snapshot;
+}
+
+- (void)playPause
+{
+    // Equivalent to: tell application "iTunes" to playpause
+    [self sendAppleEventClass:WO_ITUNES_SIGNATURE ID:'PlPs'];
+}
+
+- (void)nextTrack
+{
+    // Equivalent to: tell application "iTunes" next track
+    [self sendAppleEventClass:WO_ITUNES_SIGNATURE ID:'Next'];
+}
+
+- (void)backTrack
+{
+    // Equivalent to: tell application "iTunes" back track
+    [self sendAppleEventClass:WO_ITUNES_SIGNATURE ID:'Back'];
+}
+
+- (void)previousTrack
+{
+    // Equivalent to: tell application "iTunes" previous track
+    [self sendAppleEventClass:WO_ITUNES_SIGNATURE ID:'Prev'];
+}
+
+- (void)fastForward
+{
+    // Equivalent to: tell application "iTunes" fast forward
+    [self sendAppleEventClass:WO_ITUNES_SIGNATURE ID:'Fast'];
+}
+
+- (void)rewind
+{
+    [self sendAppleEventClass:WO_ITUNES_SIGNATURE ID:'Rwnd'];
+}
+
+- (void)resume
+{
+    [self sendAppleEventClass:WO_ITUNES_SIGNATURE ID:'Resu'];
+}
+
+- (BOOL)playTrack:(id)identifier
+{
+    if (![identifier isKindOfClass:[NSAppleEventDescriptor class]])
+        return NO;
+
+    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:WO_ITUNES_SIGNATURE];
+    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN])
+        return NO;
+
+    BOOL        sent = NO;
+    AppleEvent  event, reply;
+    AEDesc      theDescriptor;
+    if (AECreateDesc(typeProcessSerialNumber, &iTunesPSN, sizeof(iTunesPSN), &theDescriptor) == noErr)
+    {
+        // Equivalent to: tell application "iTunes" to play
+        if (AECreateAppleEvent(WO_ITUNES_SIGNATURE, 'Play', &theDescriptor, kAutoGenerateReturnID, kAnyTransactionID,
+                               &event) == noErr)
+        {
+            const DescType keyword = keyDirectObject; // 'form'; was 'obj '
+            if (AEPutParamDesc(&event, keyword, [identifier aeDesc]) != noErr)
+                ELOG(@"Error putting parameter in Apple Event");
+            else if (AESend(&event, &reply, kAENoReply, kAENormalPriority, kAEDefaultTimeout, nil, nil) == noErr)
+            {
+                AEDisposeDesc(&reply);
+                sent = YES;
+            }
+            else
+                ELOG(@"Error sending Apple Event");
+            AEDisposeDesc(&event);
+        }
+        AEDisposeDesc(&theDescriptor);
+    }
+    return sent;
+}
+
+- (int)setRating:(int)rating
+{
+    // abort if we get an illegal parameter
+    if ((rating < 0) || (rating > 100))
+    {
+        ELOG(@"Out-of-range parameter submitted while setting song rating");
+        return -1;
+    }
+
+    NSString *result = [self resultOfScriptNamed:@"setRating"
+                                      parameters:[NSArray arrayWithObject:[NSNumber numberWithInt:rating]]];
+    if ([result isEqualToString:@"SUCCESS"])
+        return rating;
+    else if (![result isEqualToString:@"ERROR"])
+        // "ERROR" usually means that iTunes is running but there is no current selection
+        ELOG(@"Unknown error while setting song rating to %d", rating);
+    return -1;
+}
+
+- (int)increaseRating
+{
+    return [self changeRatingByStars:1];
+}
+
+- (int)decreaseRating
+{
+    return [self changeRatingByStars:-1];
+}
+
+- (int)volumeUp
+{
+    return [self changeVolumeBySegments:1];
+}
+
+- (int)volumeDown
+{
+    return [self changeVolumeBySegments:-1];
+}
+
+- (int)toggleMute
+{
+    NSString *result = [self resultOfScriptNamed:@"toggleMute" parameters:nil];
+    if ([result isEqualToString:@"ON"])
+        return 0;
+    else if (!result || [result isEqualToString:@"ERROR"])
+    {
+        ELOG(@"Error while toggling iTunes mute setting");
+        return -1;
+    }
+    // result contains the segment count
+    return [result intValue];
+}
+
+- (BOOL)setShuffle:(BOOL)flag
+{
+    NSString *result = [self resultOfScriptNamed:@"setShuffle"
+                                      parameters:[NSArray arrayWithObject:[NSNumber numberWithInt:(flag ? 1 : 0)]]];
+    if ([result isEqualToString:@"SUCCESS"])
+        return YES;
+    else if ([result isEqualToString:@"ERROR"])
+        ELOG(@"Error setting iTunes shuffle setting to %@", flag ? @"ON" : @"OFF");
+    else
+        ELOG(@"Unknown error while setting iTunes shuffle setting to %@", flag ? @"ON" : @"OFF");
+    return NO;
+}
+
+- (WOShuffleState)toggleShuffle
+{
+    NSString *result = [self resultOfScriptNamed:@"toggleShuffle" parameters:nil];
+    if ([result isEqualToString:@"ON"])
+        return WOShuffleOn;
+    else if ([result isEqualToString:@"OFF"])
+        return WOShuffleOff;
+    else if ([result isEqualToString:@"ERROR"])
+        ELOG(@"Error while toggling iTunes shuffle setting");
+    else
+        ELOG(@"Unknown error while toggling iTunes shuffle setting");
+    return WOShuffleUnknown;
+}
+
+- (BOOL)setRepeatMode:(WORepeatMode)mode
+{
+    NSString *modeName;
+    switch (mode)
+    {
+        case WORepeatOff:   modeName = @"off";  break;
+        case WORepeatOne:   modeName = @"one";  break;
+        case WORepeatAll:   modeName = @"all";  break;
+        default:            return NO;
+    }
+
+    NSString *result = [self resultOfScriptNamed:@"setRepeatMode" parameters:[NSArray arrayWithObject:modeName]];
+    if ([result isEqualToString:@"SUCCESS"])
+        return YES;
+    else if ([result isEqualToString:@"ERROR"])
+        ELOG(@"Error setting repeat mode to %@", [modeName uppercaseString]);
+    else
+        ELOG(@"Unknown error while setting repeat mode to %@", [modeName uppercaseString]);
+    return NO;
+}
+
+- (WORepeatMode)cycleRepeatMode
+{
+    NSString *result = [self resultOfScriptNamed:@"cycleRepeatMode" parameters:nil];
+    if ([result isEqualToString:@"ALL"])
+        return WORepeatAll;
+    else if ([result isEqualToString:@"ONE"])
+        return WORepeatOne;
+    else if ([result isEqualToString:@"OFF"])
+        return WORepeatOff;
+    else if ([result isEqualToString:@"ERROR"])
+        ELOG(@"Error while cycling to next iTunes repeat mode");
+    else
+        ELOG(@"Unknown error while cycling to next iTunes repeat mode");
+    return WORepeatUnknown;
+}
+
+- (NSArray *)playlistNames
+{
+    @try
+    {
+        // do this the hard way -- [[iTunes sources] objectWithName:@"Library"] -- only works in English
+        iTunesApplication *iTunes = [SBApplication applicationWithBundleIdentifier:@"com.apple.iTunes"];
+        iTunesSource *library = nil;
+        for (iTunesSource *source in [iTunes sources])
+        {
+            if ([source kind] == iTunesESrcLibrary)
+            {
+                library = source;
+                break;
+            }
+        }
+        return [[library playlists] arrayByApplyingSelector:@selector(name)];
+    }
+    @catch (id e)
+    {
+        // we don't want a mere Apple Event error like this one derailing the entire applicaton:
+        // *** Terminating app due to uncaught exception 'NSGenericException',
+        // reason: 'Apple event returned an error.  Event = 'core'\'cnte'{ '----':'null'(), 'kocl':'cSrc' }
+        // Error info = { ErrorNumber = -609; }
+        // incidentally, error 609 may be "connection is invalid" or a timeout ("Apple Event timed out")
+        // "there's a glitch in Apple's APIs that cause timeouts to sometimes raise error -609 instead of the usual -1712"
+        // see: http://discussions.apple.com/thread.jspa?messageID=6925244
+        // and: http://developer.apple.com/documentation/AppleScript/Conceptual/AppleScriptLangGuide/index.html
+    }
+    return nil;
+}
+
+- (BOOL)playPlaylistNamed:(NSString *)name activate:(BOOL)flag
+{
+    NSParameterAssert(name != nil);
+
+    // passed as a parameter, so the name needs no escaping
+    NSArray *parameters = [NSArray arrayWithObjects:name, [NSNumber numberWithInt:(flag ? 1 : 0)], nil];
+    NSString *result = [self resultOfScriptNamed:@"playPlaylist" parameters:parameters];
+    if ([result isEqualToString:@"SUCCESS"])
+        return YES;
+    else if ([result isEqualToString:@"ERROR"])
+        ELOG(@"Warning: AppleScript error while attempting to switch to playlist \"%@\"", name);
+    return NO;
+}
+
+- (NSData *)artworkOfCurrentTrack
+{
+    if (![self isRunning])
+        return nil;
+
+    [scriptLock lock];
+    NSAppleEventDescriptor *coverDescriptor = [scripts runScriptNamed:@"artwork"];
+    [scriptLock unlock];
+    if (!coverDescriptor || [[coverDescriptor stringValue] isEqualToString:@"NO COVER"])
+        return nil;
+    return [coverDescriptor data];
+}
+
+- (BOOL)setArtworkOfCurrentTrack:(NSImage *)image
+{
+    if (![self isRunning])
+        return NO;
+
+    NSData *PICTData = [image PICTRepresentation];
+    if (!PICTData)
+        return NO;
+
+    // was bug: had to change descriptor type from 'JFIF' to 'PICT' (iTunes 9?)
+    // error was -2003: QuickTime cantFindHandler
+    // see: https://wincent.com/issues/1412
+    NSArray *parameters = [NSArray arrayWithObject:[NSAppleEventDescriptor descriptorWithDescriptorType:'PICT'
+                                                                                                   data:PICTData]];
+
+    [scriptLock lock];
+    NSAppleEventDescriptor *result = [scripts runScriptNamed:@"setArtwork" parameters:parameters];
+    [scriptLock unlock];
+    if (!result || ![result booleanValue])
+    {
+        ELOG(@"Error transferring cover art");
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// every script the player runs apart from getSongInfo, which comes compiled in
+// the bundle; values that vary from call to call are passed to "on open"
+// handlers instead of being spliced into the source, so that each script is
+// compiled once (in prepare, on the queue's worker thread) however it is used
+- (void)addScripts
+{
+    // when iTunes is not running: a script has the welcome side-effect of
+    // launching it
+    [scripts addScriptNamed:@"launch" source:@"tell application \"iTunes\" to activate"];
+
+    [scripts addScriptNamed:@"hide" source:
+        @"tell application \"System Events\"\n"
+        @"  try\n"
+        @"    set visible of process \"iTunes\" to false\n"
+        @"    return \"SUCCESS\"\n"
+        @"  on error\n"
+        @"    return \"ERROR\"\n"
+        @"  end try\n"
+        @"end tell"];
+
+    // args: the rating (0 to 100)
+    [scripts addScriptNamed:@"setRating" source:
+        @"on open args\n"
+        @"  set newRating to item 1 of args\n"
+        @"  tell application \"iTunes\"\n"
+        @"    try\n"
+        @"      set rating of current track to newRating\n"
+        @"      return \"SUCCESS\"\n"
+        @"    on error\n"
+        @"      return \"ERROR\"\n"
+        @"    end try\n"
+        @"  end tell\n"
+        @"end open"];
+
+    // args: the number of stars to move by; a rating between two whole stars
+    // moves to the next one in that direction first
+    [scripts addScriptNamed:@"changeRating" source:
+        @"on open args\n"
+        @"  set stars to item 1 of args\n"
+        @"  tell application \"iTunes\"\n"
+        @"    try\n"
+        @"      set oldRating to rating of current track\n"
+        @"      if stars > 0 then\n"
+        @"        set newRating to ((oldRating div 20) + stars) * 20\n"
+        @"      else\n"
+        @"        set newRating to (((oldRating + 19) div 20) + stars) * 20\n"
+        @"      end if\n"
+        @"      if newRating > 100 then set newRating to 100\n"
+        @"      if newRating < 0 then set newRating to 0\n"
+        @"      set rating of current track to newRating\n"
+        @"      return newRating as string\n"
+        @"    on error\n"
+        @"      return \"ERROR\"\n"
+        @"    end try\n"
+        @"  end tell\n"
+        @"end open"];
+
+    // From the iTunes Scripting Dictionary:
+    //
+    // In "application" class:
+    //     sound volume
+    //         integer  -- the sound output volume (0 = minimum, 100 = maximum)
+    //
+    // The feedback window shows 16 segments of 6.25 each; 2 is added when setting
+    // the volume to compensate for rounding down errors.
+    //
+    // args: the number of segments to move by
+    [scripts addScriptNamed:@"changeVolume" source:
+        @"on open args\n"
+        @"  set segments to item 1 of args\n"
+        @"  tell application \"iTunes\"\n"
+        @"    set currentVol to the sound volume as real\n"
+        @"    set segmentNumber to (((currentVol / 6.25) div 1) as integer) + segments\n"
+        @"    if segmentNumber > 15 then\n"
+        @"      set the sound volume to 100\n"
+        @"      return \"16\"\n"
+        @"    else if segmentNumber < 1 then\n"
+        @"      set the sound volume to 0\n"
+        @"      return \"0\"\n"
+        @"    else\n"
+        @"      set the sound volume to ((segmentNumber * 6.25) + 2)\n"
+        @"      return segmentNumber as string\n"
+        @"    end if\n"
+        @"  end tell\n"
+        @"end open"];
+
+    [scripts addScriptNamed:@"toggleMute" source:
+        @"tell application \"iTunes\"\n"
+        @"  try\n"
+        @"    if mute is true then\n"
+        @"      set mute to false\n"
+        @"      set currentVol to the sound volume as real\n"
+        @"      set segmentNumber to ((currentVol / 6.25) div 1) as integer\n"
+        @"      if the sound volume is 100 then\n"
+        @"        return \"16\"\n"
+        @"      else\n"
+        @"        return segmentNumber as string\n"
+        @"      end if\n"
+        @"    else\n"
+        @"      set mute to true\n"
+        @"      return \"ON\"\n"
+        @"    end if\n"
+        @"  on error\n"
+        @"    return \"ERROR\"\n"
+        @"  end try\n"
+        @"end tell"];
+
+    // args: 1 for on, 0 for off
+    [scripts addScriptNamed:@"setShuffle" source:
+        @"on open args\n"
+        @"  set shuffleOn to ((item 1 of args) is 1)\n"
+        @"  tell application \"iTunes\"\n"
+        @"    try\n"
+        @"      -- this will fail if iTunes has no current selection\n"
+        @"      set currentPlaylist to the container of the current track\n"
+        @"      set shuffle of currentPlaylist to shuffleOn\n"
+        @"      return \"SUCCESS\"\n"
+        @"    on error\n"
+        @"      return \"ERROR\"\n"
+        @"    end try\n"
+        @"  end tell\n"
+        @"end open"];
+
+    [scripts addScriptNamed:@"toggleShuffle" source:
+        @"tell application \"iTunes\"\n"
+        @"  try\n"
+        @"    -- this will fail if iTunes has no current selection\n"
+        @"    set currentPlaylist to the container of the current track\n"
+        @"    if shuffle of currentPlaylist is true then\n"
+        @"      set shuffle of currentPlaylist to false\n"
+        @"      return \"OFF\"\n"
+        @"    else\n"
+        @"      set shuffle of currentPlaylist to true\n"
+        @"      return \"ON\"\n"
+        @"    end if\n"
+        @"  on error\n"
+        @"    return \"ERROR\"\n"
+        @"  end try\n"
+        @"end tell"];
+
+    // args: "off", "one" or "all"; the constants themselves cannot be passed in
+    [scripts addScriptNamed:@"setRepeatMode" source:
+        @"on open args\n"
+        @"  set modeName to item 1 of args\n"
+        @"  tell application \"iTunes\"\n"
+        @"    try\n"
+        @"      -- this will fail if iTunes has no current selection\n"
+        @"      set currentPlaylist to the container of the current track\n"
+        @"      if modeName is \"one\" then\n"
+        @"        set song repeat of currentPlaylist to one\n"
+        @"      else if modeName is \"all\" then\n"
+        @"        set song repeat of currentPlaylist to all\n"
+        @"      else\n"
+        @"        set song repeat of currentPlaylist to off\n"
+        @"      end if\n"
+        @"      return \"SUCCESS\"\n"
+        @"    on error\n"
+        @"      return \"ERROR\"\n"
+        @"    end try\n"
+        @"  end tell\n"
+        @"end open"];
+
+    [scripts addScriptNamed:@"cycleRepeatMode" source:
+        @"tell application \"iTunes\"\n"
+        @"  try\n"
+        @"    -- this will fail if iTunes has no current selection\n"
+        @"    set currentPlaylist to the container of the current track\n"
+        @"    -- cycle through in this order: off, all, one\n"
+        @"    if song repeat of currentPlaylist is off then\n"
+        @"      set song repeat of currentPlaylist to all\n"
+        @"      return \"ALL\"\n"
+        @"    else\n"
+        @"      if song repeat of currentPlaylist is all then\n"
+        @"        set song repeat of currentPlaylist to one\n"
+        @"        return \"ONE\"\n"
+        @"      else\n"
+        @"        set song repeat of currentPlaylist to off\n"
+        @"        return \"OFF\"\n"
+        @"      end if\n"
+        @"    end if\n"
+        @"  on error\n"
+        @"    return \"ERROR\"\n"
+        @"  end try\n"
+        @"end tell"];
+
+    // args: the playlist name, then 1 to bring iTunes to the front or 0 not to
+    [scripts addScriptNamed:@"playPlaylist" source:
+        @"on open args\n"
+        @"  set playlistName to item 1 of args\n"
+        @"  set shouldActivate to ((item 2 of args) is 1)\n"
+        @"  tell application \"iTunes\"\n"
+        @"    try\n"
+        @"      stop\n"
+        @"      set thePlaylist to playlist playlistName\n"
+        @"      if shouldActivate then activate\n"
+        @"      set visible of browser window 1 to true\n"
+        @"      set view of browser window 1 to thePlaylist\n"
+        @"      play\n"
+        @"      return \"SUCCESS\"\n"
+        @"    on error\n"
+        @"      return \"ERROR\"\n"
+        @"    end try\n"
+        @"  end tell\n"
+        @"end open"];
+
+    [scripts addScriptNamed:@"artwork" source:
+        @"tell application \"iTunes\"\n"
+        @"  try\n"
+        @"    if data of the artworks of the current track exists then\n"
+        @"      return data of artwork 1 of current track as picture\n"
+        @"    else\n"
+        @"      return \"NO COVER\"\n"
+        @"    end if\n"
+        @"  on error\n"
+        @"    return \"NO COVER\"\n"
+        @"  end try\n"
+        @"end tell\n"];
+
+    // args: the image as a 'PICT' descriptor
+    [scripts addScriptNamed:@"setArtwork" source:
+        @"on open args\n"
+        @"  try\n"
+        @"    set coverData to item 1 of args\n"
+        @"    tell application \"iTunes\"\n"
+        @"      with timeout of 15 seconds\n"
+        @"        set data of front artwork of current track to coverData\n"
+        @"      end timeout\n"
+        @"    end tell\n"
+        @"    return true\n"
+        @"  on error\n"
+        @"    return false\n"
+        @"  end try\n"
+        @"end open"];
+}
+
+// tell application "iTunes" to ... without a reply
+- (void)sendAppleEventClass:(AEEventClass)eventClass ID:(AEEventID)eventID
+{
+    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:WO_ITUNES_SIGNATURE];
+    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] == NO)
+    {
+        AppleEvent  event, reply;
+        AEDesc      descriptor;
+        if (AECreateDesc(typeProcessSerialNumber, &iTunesPSN, sizeof(iTunesPSN), &descriptor) == noErr)
+        {
+            if (AECreateAppleEvent(eventClass, eventID, &descriptor, kAutoGenerateReturnID, kAnyTransactionID, &event) == noErr)
+            {
+                OSErr err = AESend(&event, &reply, kAENoReply, kAENormalPriority, kAEDefaultTimeout, nil, nil);
+                if (err == noErr)
+                    AEDisposeDesc(&reply);
+                else
+                    ELOG(@"Error (%d) sending Apple Event", err);
+
+                AEDisposeDesc(&event);
+            }
+            AEDisposeDesc(&descriptor);
+        }
+    }
+}
+
+/*"
+ This is the fix for the iTunes "unwanted respawn" bug in which iTunes lingers
+ on in the list of running processes for as long as 2 seconds after exiting, and
+ an unwanted respawn results on sending it an AppleScript because all "tell"
+ statements include an implicit "run".
+
+ The workaround is to try to send an Apple Event which requires a reply, and
+ test to see if a timeout is exceeded. If the timeout is exceeded then we assume
+ that iTunes is not ready to receive the AppleScript, and in fact it is probably
+ not running.
+
+ We send the 'doex' Apple Event (equivalent to the "exists" AppleScript keyword)
+ as this will have no undesired side-effects in the event that the event does
+ make it through.
+
+ We ignore the Apple documentation which requires us to implement an "idle
+ handler" when using the kAEWaitReply mode; there do not appear to be any
+ harmful side-effects.
+"*/
+- (BOOL)readyToReceiveAppleScript
+{
+    BOOL readyToReceiveAppleScript = NO;
+    ProcessSerialNumber iTunesPSN = [WOProcessManager PSNForSignature:WO_ITUNES_SIGNATURE];
+    if ([WOProcessManager PSNEqualsNoProcess:iTunesPSN] == NO)
+    {
+        AppleEvent  event, reply;
+        AEDesc      AEdescriptor;
+        if (AECreateDesc(typeProcessSerialNumber, &iTunesPSN, sizeof(iTunesPSN), &AEdescriptor) == noErr)
+        {
+            if (AECreateAppleEvent(WO_ITUNES_SIGNATURE, 'doex', &AEdescriptor, kAutoGenerateReturnID,
+                                   kAnyTransactionID, &event) == noErr)
+            {
+                if (AESend(&event, &reply, kAEWaitReply, kAEHighPriority, kAEDefaultTimeout, nil, nil) == noErr)
+                {
+                    AEDisposeDesc(&reply);
+                    readyToReceiveAppleScript = YES;
+                }
+                AEDisposeDesc(&event);
+            }
+            AEDisposeDesc(&AEdescriptor);
+        }
+    }
+    return readyToReceiveAppleScript;
+}
+
+// runs the script called \p name from the table (with \p parameters, if not
+// nil), returning its result as a string (nil on failure)
+- (NSString *)resultOfScriptNamed:(NSString *)name parameters:(NSArray *)parameters
+{
+    [scriptLock lock];
+    NSAppleEventDescriptor *result = parameters ? [scripts runScriptNamed:name parameters:parameters]
+                                                : [scripts runScriptNamed:name];
+    [scriptLock unlock];
+    return [result stringValue];
+}
+
+- (int)changeRatingByStars:(int)stars
+{
+    NSString *result = [self resultOfScriptNamed:@"changeRating"
+                                      parameters:[NSArray arrayWithObject:[NSNumber numberWithInt:stars]]];
+    if ([result isEqualToString:@"ERROR"])
+    {
+        // this usually means that iTunes is running but there is no current selection
+        LOG(@"Error while changing song rating by %d stars", stars);
+        return -1;
+    }
+    else if (!result || [result length] == 0)
+    {
+        ELOG(@"Unknown error while changing song rating by %d stars", stars);
+        return -1;
+    }
+    return [result intValue];
+}
+
+- (int)changeVolumeBySegments:(int)segments
+{
+    NSString *result = [self resultOfScriptNamed:@"changeVolume"
+                                      parameters:[NSArray arrayWithObject:[NSNumber numberWithInt:segments]]];
+    return result ? [result intValue] : -1;
+}
+
+// the script returns either one item ("error", "not running" or "not playing")
+// or twelve: state, track, name, album, artist, composer, time, year, rating,
+// repeat, shuffle and position
+- (WOPlayerSnapshot *)snapshotFromDescriptor:(NSAppleEventDescriptor *)descriptor
+{
+    if (descriptor && [descriptor numberOfItems] == 1)
+    {
+        NSString *result = [descriptor stringValue];
+        if ([result isEqualToString:@"not running"])
+            return [WOPlayerSnapshot snapshotWithState:WOPlayerNotRunning];
+        else if ([result isEqualToString:@"not playing"])
+            return [WOPlayerSnapshot snapshotWithState:WOPlayerNotPlaying];
+        else if ([result isEqualToString:@"error"])
+            return [WOPlayerSnapshot snapshotWithState:WOPlayerError];
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerUnknown];
+    }
+    else if (!descriptor || [descriptor numberOfItems] != WO_SONG_INFO_FIELD_COUNT)
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerError];
+
+    // experimentation shows that if no selection the time the script is first
+    // run, it will from then on return a human-readable string; in the reverse
+    // case, it returns the non-human-readable version!
+    static NSString *playingString = nil;  // "«constant ****kPSP»"
+    static NSString *pausedString = nil;   // "«constant ****kPSp»"
+    static NSString *stoppedString = nil;  // "«constant ****kPSS»"
+    if (!playingString)
+    {
+        playingString = [NSString stringWithFormat:@"%Cconstant ****kPSP%C",
+                         WO_LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR,
+                         WO_RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR];
+        pausedString = [NSString stringWithFormat:@"%Cconstant ****kPSp%C",
+                        WO_LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR,
+                        WO_RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR];
+        stoppedString = [NSString stringWithFormat:@"%Cconstant ****kPSS%C",
+                         WO_LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR,
+                         WO_RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK_UNICODE_CHAR];
+    }
+
+    // for now, consider "stopped" to be equivalent to "paused"
+    WOPlayerState state;
+    NSString *stateString = [self stringForField:1 ofDescriptor:descriptor];
+    if ([stateString isEqualToString:playingString] || [stateString isEqualToString:@"playing"])
+        state = WOPlayerPlaying;
+    else if ([stateString isEqualToString:pausedString] || [stateString isEqualToString:stoppedString] ||
+             [stateString isEqualToString:@"paused"] || [stateString isEqualToString:@"stopped"])
+        state = WOPlayerPaused;
+    else
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerUnknown];
+
+    // a descriptor of a form like:
+    //  file track id 9227 of user playlist id 9213 of source id 33 of application "iTunes"
+    NSAppleEventDescriptor *songId = [descriptor descriptorAtIndex:2];
+    if (!songId)
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerError];
+
+    // year equals "0" if not set
+    NSString *year = [self stringForField:8 ofDescriptor:descriptor];
+    if ([year isEqualToString:@"0"])
+        year = @"";
+
+    // repeat mode: should be "all", "one" or "off"
+    WORepeatMode repeatMode = WORepeatUnknown;
+    NSString *repeatString = [self stringForField:10 ofDescriptor:descriptor];
+    if ([repeatString isEqualToString:@"all"])
+        repeatMode = WORepeatAll;
+    else if ([repeatString isEqualToString:@"one"])
+        repeatMode = WORepeatOne;
+    else if ([repeatString isEqualToString:@"off"])
+        repeatMode = WORepeatOff;
+
+    // shuffle state: should be "true" or "false"
+    WOShuffleState shuffleState = WOShuffleUnknown;
+    NSString *shuffleString = [self stringForField:11 ofDescriptor:descriptor];
+    if ([shuffleString isEqualToString:@"true"])
+        shuffleState = WOShuffleOn;
+    else if ([shuffleString isEqualToString:@"false"])
+        shuffleState = WOShuffleOff;
+
+    // nil strings (even the title on Snow Leopard, see https://wincent.com/issues/1381)
+    // become empty ones in the snapshot
+    return [[WOPlayerSnapshot alloc] initWithState:state
+                                   trackIdentifier:songId
+                                          trackKey:[self stringForField:2 ofDescriptor:descriptor]
+                                             title:[self stringForField:3 ofDescriptor:descriptor]
+                                             album:[self stringForField:4 ofDescriptor:descriptor]
+                                            artist:[self stringForField:5 ofDescriptor:descriptor]
+                                          composer:[self stringForField:6 ofDescriptor:descriptor]
+                                          duration:[self stringForField:7 ofDescriptor:descriptor]
+                                              year:year
+                                            rating:[[self stringForField:9 ofDescriptor:descriptor] intValue]
+                                        repeatMode:repeatMode
+                                      shuffleState:shuffleState
+                                          position:[[descriptor descriptorAtIndex:WO_SONG_INFO_FIELD_COUNT] int32Value]];
+}
+
+// the string for item \p index (1-based) of a getSongInfo result, or nil if
+// the item is missing; items whose type and bytes match the previous result
+// give back the previous string instead of being coerced again, which also
+// lets WOPlayerSnapshot's changesSince: get away with pointer comparisons
+// (for the track, item 2, the string is the description of its bytes)
+- (NSString *)stringForField:(NSInteger)index ofDescriptor:(NSAppleEventDescriptor *)descriptor
+{
+    NSAppleEventDescriptor *item = [descriptor descriptorAtIndex:index];
+    if (!item)
+        return nil;
+    NSAppleEventDescriptor *previous = [fieldDescriptors objectAtIndex:index - 1];
+    NSData *data = [item data];
+    if (previous != (id)[NSNull null] && [previous descriptorType] == [item descriptorType] &&
+        [[previous data] isEqualToData:data])
+    {
+        NSString *cached = [fieldStrings objectAtIndex:index - 1];
+        return (cached == (id)[NSNull null]) ? nil : cached;
+    }
+    NSString *string = (index == 2) ? [data description] : [item stringValue];
+    [fieldDescriptors replaceObjectAtIndex:index - 1 withObject:item];
+    [fieldStrings replaceObjectAtIndex:index - 1 withObject:(string ? (id)string : (id)[NSNull null])];
+    return string;
+}
+
+- (void)playerInfoNotification:(NSNotification *)aNotification
+{
+    NSDictionary *userInfo = [aNotification userInfo];
+    if (userInfo && ![userInfo isKindOfClass:[NSDictionary class]])
+        userInfo = nil;
+    [delegate playerBackend:self didChangeWithInfo:userInfo];
+}
+
+@end
@@ -0,0 +1,55 @@
+//
+//  WOKeywordNormalizer.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+//! Name of the user's rule file, in "~/Library/Application Support/Synergy"
+#define WO_KEYWORD_RULES_FILENAME   @"Cover Search Filters.txt"
+
+//! Turns artist, album and song names into the form used both to search for covers and to key them in WOCoverStore.
+//!
+//! In a single pass over the UTF-8 bytes of a string, every character is folded (case and diacritics, so that "Björk"
+//! and "BJORK" come out the same), runs of whitespace are collapsed to a single space, and the folded bytes are fed
+//! through an Aho-Corasick automaton compiled from the filter rules ("(Disc 1)", "Soundtrack" and so on). Once the whole
+//! string has been seen the leftmost, longest matches are cut out; a rule that starts or ends with a letter or digit only
+//! matches at a word boundary, so "OST" is removed from "Lost Highway (OST)" but not from "Lost". If the rules would leave
+//! nothing at all, the folded string is returned whole.
+//!
+//! The shared normalizer compiles the built-in rules together with those in the user's rule file (one per line; blank
+//! lines and lines starting with "#" are ignored). Because the result feeds cover keys, editing the rules changes the key
+//! of any album they affect.
+//!
+//! \warn Threadsafe (immutable once initialized)
+@interface WOKeywordNormalizer : NSObject {
+
+    //! Opaque compiled automaton (WOKeywordAutomaton)
+    void    *automaton;
+
+    //! The same, compiled from the rules with their whitespace removed
+    void    *compactAutomaton;
+}
+
+//! Built-in rules plus the user's rule file, compiled on first use
++ (WOKeywordNormalizer *)sharedNormalizer;
+
+//! The filter rules that are always applied
++ (NSArray *)standardRules;
+
+//! Designated initializer; \p rules is an array of NSString, folded like any input before they are compiled
+- (id)initWithRules:(NSArray *)rules;
+
+//! Returns the normalized form of \p aString, or nil if \p aString is nil
+- (NSString *)normalizedString:(NSString *)aString;
+
+//! Like normalizedString:, but for names that have lost their whitespace ("AbbeyRoad(Disc1)", as in the cover filenames
+//! of earlier versions), and so normalizes without any: rules match whatever whitespace they contain, and a word
+//! boundary is also taken to hold where a space was most likely stripped out between two words in title case
+//! ("LostHighwayOST"). The result has no whitespace, so it only equals the normalized form of the original name once that
+//! has had its whitespace stripped too.
+- (NSString *)normalizedStringIgnoringWhitespace:(NSString *)aString;
+
+@end
@@ -0,0 +1,609 @@
+// WOKeywordNormalizer.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOKeywordNormalizer.h"
+
+// system headers
+#import <CoreServices/CoreServices.h>
+#import <stdlib.h>
+#import <string.h>
+
+// other headers
+#import "WONSFileManagerExtensions.h"
+
+//! Most UTF-8 bytes a single character may fold to; characters with longer foldings are left alone
+#define WO_KEYWORD_MAX_FOLD         7
+
+//! Folded output is never more than this many times longer than its input (a two-byte character folding to seven)
+#define WO_KEYWORD_MAX_EXPANSION    4
+
+//! Characters below this (Latin, IPA, combining diacritics, Greek and Cyrillic) are folded through the table...
+#define WO_KEYWORD_FOLD_LIMIT       0x0530
+
+//! ...as is Latin Extended Additional (Vietnamese and friends); anything else is copied through unchanged
+#define WO_KEYWORD_FOLD_EXTRA_START 0x1e00
+#define WO_KEYWORD_FOLD_EXTRA_END   0x1f00
+
+#define WO_KEYWORD_FOLD_ENTRIES     (WO_KEYWORD_FOLD_LIMIT + WO_KEYWORD_FOLD_EXTRA_END - WO_KEYWORD_FOLD_EXTRA_START)
+
+//! States are numbered in 16 bits, and 0xffff marks a missing transition while the automaton is built
+#define WO_KEYWORD_MAX_STATES       0xffff
+
+//! Strings whose working buffers fit in this many bytes are normalized without touching the heap
+#define WO_KEYWORD_STACK_BUFFER     2048
+
+//! Matches recorded before the list moves to the heap
+#define WO_KEYWORD_STACK_MATCHES    16
+
+//! \name State and match flags
+//! \startgroup
+
+#define WOKeywordRuleEnds           0x01    //!< a rule ends at this state
+#define WOKeywordRuleWordStart      0x02    //!< the rule starts with a letter or digit, so must start at a word boundary
+#define WOKeywordRuleWordEnd        0x04    //!< the rule ends with a letter or digit, so must end at a word boundary
+#define WOKeywordMatchCut           0x80    //!< the match has been chosen to be cut out
+
+//! \endgroup
+
+// folded UTF-8 for each character covered by the table: the length, then the bytes
+static uint8_t WOKeywordFoldTable[WO_KEYWORD_FOLD_ENTRIES][WO_KEYWORD_MAX_FOLD + 1];
+
+// Aho-Corasick automaton over folded UTF-8 bytes, with every transition precomputed so that each byte of input costs a
+// single table lookup; bytes that appear in no rule share one column of the table
+typedef struct WOKeywordAutomaton {
+    uint8_t     byteClass[256];     // column for each byte; 0 for bytes in no rule
+    unsigned    classCount;
+    unsigned    stateCount;
+    uint16_t    *delta;             // stateCount rows of classCount transitions
+    uint16_t    *outputLink;        // nearest state for a proper suffix at which a rule ends; 0 if there is none
+    uint16_t    *depth;             // length in bytes of the string spelled out by each state
+    uint8_t     *flags;             // WOKeywordRule flags for each state
+} WOKeywordAutomaton;
+
+// a rule matched in the folded output
+typedef struct WOKeywordMatch {
+    size_t      start;
+    size_t      end;
+    uint8_t     flags;
+} WOKeywordMatch;
+
+typedef struct WOKeywordMatchList {
+    WOKeywordMatch  *matches;
+    size_t          count;
+    size_t          capacity;
+    BOOL            onHeap;
+} WOKeywordMatchList;
+
+static BOOL WOKeywordIsWordByte(uint8_t b)
+{
+    // bytes of multi-byte characters count as letters: they are almost always letters
+    return (b >= '0' && b <= '9') || (b >= 'a' && b <= 'z') || (b >= 'A' && b <= 'Z') || b >= 0x80;
+}
+
+static unsigned WOKeywordEncodeUTF8(uint32_t c, uint8_t *bytes)
+{
+    if (c < 0x80)
+    {
+        bytes[0] = (uint8_t)c;
+        return 1;
+    }
+    else if (c < 0x800)
+    {
+        bytes[0] = (uint8_t)(0xc0 | (c >> 6));
+        bytes[1] = (uint8_t)(0x80 | (c & 0x3f));
+        return 2;
+    }
+    bytes[0] = (uint8_t)(0xe0 | (c >> 12));
+    bytes[1] = (uint8_t)(0x80 | ((c >> 6) & 0x3f));
+    bytes[2] = (uint8_t)(0x80 | (c & 0x3f));
+    return 3;
+}
+
+static void WOKeywordAutomatonFree(WOKeywordAutomaton *automaton)
+{
+    if (!automaton)
+        return;
+    free(automaton->delta);
+    free(automaton->outputLink);
+    free(automaton->depth);
+    free(automaton->flags);
+    free(automaton);
+}
+
+// compiles count rules (already folded); rules beyond the capacity of the automaton are dropped with a warning
+static WOKeywordAutomaton *WOKeywordAutomatonCreate(const uint8_t **rules, const size_t *lengths, unsigned count)
+{
+    WOKeywordAutomaton *automaton = calloc(1, sizeof(WOKeywordAutomaton));
+    if (!automaton)
+        return NULL;
+    size_t states = 1;
+    automaton->classCount = 1;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (states + lengths[i] > WO_KEYWORD_MAX_STATES)
+        {
+            NSLog(@"warning: only the first %u of %u cover search filter rules are used", i, count);
+            count = i;
+            break;
+        }
+        states += lengths[i];
+        for (size_t j = 0; j < lengths[i]; j++)
+            if (!automaton->byteClass[rules[i][j]])
+                automaton->byteClass[rules[i][j]] = (uint8_t)automaton->classCount++;
+    }
+
+    unsigned classes = automaton->classCount;
+    automaton->delta        = malloc(states * classes * sizeof(uint16_t));
+    automaton->outputLink   = calloc(states, sizeof(uint16_t));
+    automaton->depth        = calloc(states, sizeof(uint16_t));
+    automaton->flags        = calloc(states, sizeof(uint8_t));
+    uint16_t *fail          = calloc(states, sizeof(uint16_t));
+    uint16_t *queue         = malloc(states * sizeof(uint16_t));
+    if (!automaton->delta || !automaton->outputLink || !automaton->depth || !automaton->flags || !fail || !queue)
+    {
+        free(fail);
+        free(queue);
+        WOKeywordAutomatonFree(automaton);
+        return NULL;
+    }
+    memset(automaton->delta, 0xff, states * classes * sizeof(uint16_t));
+
+    // the trie
+    automaton->stateCount = 1;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (lengths[i] == 0)
+            continue;
+        unsigned state = 0;
+        for (size_t j = 0; j < lengths[i]; j++)
+        {
+            uint16_t *next = &automaton->delta[state * classes + automaton->byteClass[rules[i][j]]];
+            if (*next == 0xffff)
+            {
+                *next = (uint16_t)automaton->stateCount++;
+                automaton->depth[*next] = automaton->depth[state] + 1;
+            }
+            state = *next;
+        }
+        automaton->flags[state] = WOKeywordRuleEnds |
+            (WOKeywordIsWordByte(rules[i][0]) ? WOKeywordRuleWordStart : 0) |
+            (WOKeywordIsWordByte(rules[i][lengths[i] - 1]) ? WOKeywordRuleWordEnd : 0);
+    }
+
+    // failure links, breadth first, turning the trie into a complete transition table as we go
+    size_t head = 0, tail = 0;
+    for (unsigned c = 0; c < classes; c++)
+    {
+        uint16_t next = automaton->delta[c];
+        if (next == 0xffff)
+            automaton->delta[c] = 0;
+        else
+            queue[tail++] = next;
+    }
+    while (head < tail)
+    {
+        unsigned state = queue[head++];
+        for (unsigned c = 0; c < classes; c++)
+        {
+            uint16_t *next = &automaton->delta[state * classes + c];
+            uint16_t fallback = automaton->delta[fail[state] * classes + c];
+            if (*next == 0xffff)
+                *next = fallback;
+            else
+            {
+                fail[*next] = fallback;
+                automaton->outputLink[*next] =
+                    (automaton->flags[fallback] & WOKeywordRuleEnds) ? fallback : automaton->outputLink[fallback];
+                queue[tail++] = *next;
+            }
+        }
+    }
+    free(fail);
+    free(queue);
+    return automaton;
+}
+
+static void WOKeywordRecordMatch(WOKeywordMatchList *list, size_t start, size_t end, uint8_t flags)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity * 2;
+        WOKeywordMatch *matches = list->onHeap ? realloc(list->matches, capacity * sizeof(WOKeywordMatch)) :
+            malloc(capacity * sizeof(WOKeywordMatch));
+        if (!matches)
+            return;     // keep what we have
+        if (!list->onHeap)
+            memcpy(matches, list->matches, list->count * sizeof(WOKeywordMatch));
+        list->matches   = matches;
+        list->capacity  = capacity;
+        list->onHeap    = YES;
+    }
+    WOKeywordMatch *match = &list->matches[list->count++];
+    match->start    = start;
+    match->end      = end;
+    match->flags    = flags;
+}
+
+// Folds length bytes of UTF-8 from in into out (which must have room for WO_KEYWORD_MAX_EXPANSION bytes per input
+// byte), collapsing runs of whitespace to one space and dropping leading whitespace, and runs the folded bytes through
+// automaton (if not NULL), recording in list every place a rule matches. Returns the number of bytes written.
+// If boundaries is not NULL (and zeroed, with room for one more byte than out) whitespace is not written at all, and
+// instead marks a word boundary in front of the next byte that is.
+static size_t WOKeywordFoldAndScan(const WOKeywordAutomaton *automaton, const uint8_t *in, size_t length, uint8_t *out,
+                                   uint8_t *boundaries, WOKeywordMatchList *list)
+{
+    size_t      written = 0;
+    unsigned    state   = 0;
+    size_t      i       = 0;
+    while (i < length)
+    {
+        // decode one character; anything malformed is copied through a byte at a time
+        uint8_t     lead = in[i];
+        unsigned    n = 1;
+        uint32_t    c = (lead < 0x80) ? lead : 0xfffd;
+        if (lead >= 0xc0 && lead < 0xf8)
+        {
+            n = (lead >= 0xf0) ? 4 : (lead >= 0xe0) ? 3 : 2;
+            c = lead & (0x7f >> n);
+            if (i + n > length)
+                n = 1;
+            else
+                for (unsigned k = 1; k < n; k++)
+                {
+                    if ((in[i + k] & 0xc0) != 0x80)
+                    {
+                        n = 1;
+                        break;
+                    }
+                    c = (c << 6) | (in[i + k] & 0x3f);
+                }
+            if (n == 1)
+                c = 0xfffd;
+        }
+
+        const uint8_t   *folded = in + i;
+        unsigned        foldedLength = n;
+        if (c < WO_KEYWORD_FOLD_LIMIT)
+        {
+            folded          = WOKeywordFoldTable[c] + 1;
+            foldedLength    = WOKeywordFoldTable[c][0];
+        }
+        else if (c >= WO_KEYWORD_FOLD_EXTRA_START && c < WO_KEYWORD_FOLD_EXTRA_END)
+        {
+            folded          = WOKeywordFoldTable[c - WO_KEYWORD_FOLD_EXTRA_START + WO_KEYWORD_FOLD_LIMIT] + 1;
+            foldedLength    = WOKeywordFoldTable[c - WO_KEYWORD_FOLD_EXTRA_START + WO_KEYWORD_FOLD_LIMIT][0];
+        }
+        else if ((c >= 0x2000 && c <= 0x200a) || c == 0x2028 || c == 0x2029 || c == 0x202f || c == 0x205f ||
+                 c == 0x3000)
+        {
+            folded          = (const uint8_t *)" ";
+            foldedLength    = 1;
+        }
+        i += n;
+
+        for (unsigned k = 0; k < foldedLength; k++)
+        {
+            uint8_t b = folded[k];
+            if (b == ' ' && boundaries)
+            {
+                boundaries[written] = 1;
+                continue;
+            }
+            if (b == ' ' && (written == 0 || out[written - 1] == ' '))
+                continue;
+            out[written++] = b;
+            if (!automaton)
+                continue;
+            state = automaton->delta[state * automaton->classCount + automaton->byteClass[b]];
+            unsigned match = (automaton->flags[state] & WOKeywordRuleEnds) ? state : automaton->outputLink[state];
+            for (; match; match = automaton->outputLink[match])
+                WOKeywordRecordMatch(list, written - automaton->depth[match], written, automaton->flags[match]);
+        }
+    }
+    return written;
+}
+
+// leftmost first, and the longest of those starting at the same place
+static int WOKeywordMatchCompare(const void *a, const void *b)
+{
+    const WOKeywordMatch *left = a;
+    const WOKeywordMatch *right = b;
+    if (left->start != right->start)
+        return (left->start < right->start) ? -1 : 1;
+    return (left->end > right->end) ? -1 : (left->end < right->end);
+}
+
+// Copies folded to out without the leftmost-longest non-overlapping matches whose word boundaries hold, collapsing the
+// whitespace around the gaps and trimming the end; returns the number of bytes written. Where boundaries is not NULL
+// (see WOKeywordFoldAndScan) it marks word boundaries that are not spelled out in folded.
+static size_t WOKeywordCutMatches(const uint8_t *folded, size_t length, const uint8_t *boundaries,
+                                  WOKeywordMatch *matches, size_t count, uint8_t *out)
+{
+    qsort(matches, count, sizeof(WOKeywordMatch), WOKeywordMatchCompare);
+    size_t cursor = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        WOKeywordMatch *match = &matches[i];
+        if (match->start < cursor ||
+            ((match->flags & WOKeywordRuleWordStart) && match->start > 0 &&
+             WOKeywordIsWordByte(folded[match->start - 1]) && !(boundaries && boundaries[match->start])) ||
+            ((match->flags & WOKeywordRuleWordEnd) && match->end < length && WOKeywordIsWordByte(folded[match->end]) &&
+             !(boundaries && boundaries[match->end])))
+            continue;
+        match->flags |= WOKeywordMatchCut;
+        cursor = match->end;
+    }
+
+    size_t written = 0;
+    size_t read = 0;
+    for (size_t i = 0; i <= count; i++)
+    {
+        size_t end = length;
+        if (i < count)
+        {
+            if (!(matches[i].flags & WOKeywordMatchCut))
+                continue;
+            end = matches[i].start;
+        }
+        for (; read < end; read++)
+        {
+            if (folded[read] == ' ' && (written == 0 || out[written - 1] == ' '))
+                continue;
+            out[written++] = folded[read];
+        }
+        if (i < count)
+            read = matches[i].end;
+    }
+    while (written > 0 && out[written - 1] == ' ')
+        written--;
+    return written;
+}
+
+// compiles rules (an array of NSData holding folded rules)
+static WOKeywordAutomaton *WOKeywordAutomatonCreateWithRules(NSArray *rules)
+{
+    WOKeywordAutomaton  *automaton  = NULL;
+    unsigned            count       = (unsigned)[rules count];
+    const uint8_t       **pointers  = malloc(MAX(count, 1U) * sizeof(uint8_t *));
+    size_t              *lengths    = malloc(MAX(count, 1U) * sizeof(size_t));
+    if (pointers && lengths)
+    {
+        for (unsigned i = 0; i < count; i++)
+        {
+            pointers[i] = [[rules objectAtIndex:i] bytes];
+            lengths[i]  = [[rules objectAtIndex:i] length];
+        }
+        automaton = WOKeywordAutomatonCreate(pointers, lengths, count);
+    }
+    free(pointers);
+    free(lengths);
+    return automaton;
+}
+
+// aString with a space wherever one was probably stripped from a name written in title case: before a capital that
+// follows a lower case letter or digit ("LostHighway"), and before the last of a run of capitals that goes on in lower
+// case ("OSTRemix")
+static NSString *WOKeywordSeparateWords(NSString *aString)
+{
+    NSUInteger length = [aString length];
+    if (length < 2)
+        return aString;
+    NSCharacterSet  *upper  = [NSCharacterSet uppercaseLetterCharacterSet];
+    NSCharacterSet  *lower  = [NSCharacterSet lowercaseLetterCharacterSet];
+    NSCharacterSet  *digits = [NSCharacterSet decimalDigitCharacterSet];
+    NSMutableString *result = [NSMutableString stringWithCapacity:length + length / 4];
+    unichar         previous = [aString characterAtIndex:0];
+    [result appendString:[aString substringToIndex:1]];
+    for (NSUInteger i = 1; i < length; i++)
+    {
+        unichar c = [aString characterAtIndex:i];
+        if ([upper characterIsMember:c] &&
+            ([lower characterIsMember:previous] || [digits characterIsMember:previous] ||
+             ([upper characterIsMember:previous] && i + 1 < length &&
+              [lower characterIsMember:[aString characterAtIndex:i + 1]])))
+            [result appendString:@" "];
+        [result appendFormat:@"%C", c];
+        previous = c;
+    }
+    return result;
+}
+
+// the work of normalizedString: and (with compact set, and automaton compiled from rules without their whitespace)
+// normalizedStringIgnoringWhitespace:
+static NSString *WOKeywordNormalize(const WOKeywordAutomaton *automaton, NSString *aString, BOOL compact)
+{
+    if (!aString)
+        return nil;
+    const char  *UTF8   = [aString UTF8String];
+    size_t      length  = strlen(UTF8);
+
+    // folded bytes first, then the same again for the result of cutting out the matches, then (if compact) the word
+    // boundaries
+    uint8_t     stackBuffer[WO_KEYWORD_STACK_BUFFER];
+    size_t      room    = length * WO_KEYWORD_MAX_EXPANSION;
+    size_t      needed  = compact ? room * 3 + 1 : room * 2;
+    uint8_t     *buffer = (needed <= sizeof(stackBuffer)) ? stackBuffer : malloc(needed);
+    if (!buffer)
+        return aString;
+    uint8_t     *folded     = buffer;
+    uint8_t     *cut        = buffer + room;
+    uint8_t     *boundaries = NULL;
+    if (compact)
+    {
+        boundaries = buffer + room * 2;
+        memset(boundaries, 0, room + 1);
+    }
+
+    WOKeywordMatch      stackMatches[WO_KEYWORD_STACK_MATCHES];
+    WOKeywordMatchList  list = { stackMatches, 0, WO_KEYWORD_STACK_MATCHES, NO };
+    size_t foldedLength = WOKeywordFoldAndScan(automaton, (const uint8_t *)UTF8, length, folded, boundaries, &list);
+    size_t cutLength = WOKeywordCutMatches(folded, foldedLength, boundaries, list.matches, list.count, cut);
+    if (cutLength == 0)
+    {
+        // the rules would leave nothing: better the whole (folded) name than none of it
+        cut = folded;
+        cutLength = foldedLength;
+        while (cutLength > 0 && cut[cutLength - 1] == ' ')
+            cutLength--;
+    }
+    NSString *result = [[NSString alloc] initWithBytes:cut length:cutLength encoding:NSUTF8StringEncoding];
+    if (list.onHeap)
+        free(list.matches);
+    if (buffer != stackBuffer)
+        free(buffer);
+    return result;
+}
+
+static WOKeywordNormalizer *WOSharedKeywordNormalizer = nil;
+
+@implementation WOKeywordNormalizer
+
++ (void)initialize
+{
+    if (self != [WOKeywordNormalizer class])
+        return;
+
+    // fold each character in the table once, up front, so that normalizing a string never has to call into CF
+    CFCharacterSetRef   whitespace  = CFCharacterSetGetPredefined(kCFCharacterSetWhitespaceAndNewline);
+    CFMutableStringRef  scratch     = CFStringCreateMutable(NULL, 0);
+    for (unsigned i = 0; i < WO_KEYWORD_FOLD_ENTRIES; i++)
+    {
+        UniChar c = (i < WO_KEYWORD_FOLD_LIMIT) ? i : i - WO_KEYWORD_FOLD_LIMIT + WO_KEYWORD_FOLD_EXTRA_START;
+        uint8_t *entry = WOKeywordFoldTable[i];
+        if (CFCharacterSetIsCharacterMember(whitespace, c))
+        {
+            entry[0] = 1;
+            entry[1] = ' ';
+            continue;
+        }
+        CFStringDelete(scratch, CFRangeMake(0, CFStringGetLength(scratch)));
+        CFStringAppendCharacters(scratch, &c, 1);
+        CFStringFold(scratch, kCFCompareCaseInsensitive | kCFCompareDiacriticInsensitive, NULL);
+        CFIndex length = CFStringGetLength(scratch);
+        CFIndex used = 0;
+        if (c != 0 && CFStringGetBytes(scratch, CFRangeMake(0, length), kCFStringEncodingUTF8, 0, false,
+                                                  entry + 1, WO_KEYWORD_MAX_FOLD, &used) == length)
+            entry[0] = (uint8_t)used;   // 0 for combining marks, which fold away
+        else
+            entry[0] = (uint8_t)WOKeywordEncodeUTF8(c, entry + 1);
+    }
+    CFRelease(scratch);
+}
+
++ (WOKeywordNormalizer *)sharedNormalizer
+{
+    @synchronized ([WOKeywordNormalizer class])
+    {
+        if (!WOSharedKeywordNormalizer)
+        {
+            NSMutableArray *rules = [NSMutableArray arrayWithArray:[self standardRules]];
+            NSString *folder = [[NSFileManager defaultManager] findSystemFolderType:kApplicationSupportFolderType
+                                                                          forDomain:kUserDomain
+                                                                           creating:NO];
+            NSString *path = [[folder stringByAppendingPathComponent:@"Synergy"]
+                stringByAppendingPathComponent:WO_KEYWORD_RULES_FILENAME];
+            NSString *contents = folder ? [NSString stringWithContentsOfFile:path
+                                                                    encoding:NSUTF8StringEncoding
+                                                                       error:NULL] : nil;
+            NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
+            for (NSString *line in [contents componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]])
+            {
+                line = [line stringByTrimmingCharactersInSet:whitespace];
+                if ([line length] > 0 && ![line hasPrefix:@"#"])
+                    [rules addObject:line];
+            }
+            WOSharedKeywordNormalizer = [[WOKeywordNormalizer alloc] initWithRules:rules];
+        }
+    }
+    return WOSharedKeywordNormalizer;
+}
+
++ (NSArray *)standardRules
+{
+    return [NSArray arrayWithObjects:
+        @"(Disc 1)",
+        @"Disc 1",
+        @"(Disc 2)",
+        @"Disc 2",
+        @"(OST)",
+        @"OST",
+        @"soundtrack",
+        @"(single)",
+        @"(CD1)",
+        @"CD1",
+        @"(CD2)",
+        @"CD2",
+        @"(remix)",
+
+        // and for the French
+        @"Disque 1",
+        @"Disque 2",
+
+        // other reader suggestions
+        @"[Bonus Tracks]",
+
+        nil];
+}
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithRules:(NSArray *)rules
+{
+    if ((self = [super init]))
+    {
+        // rules are folded just like the strings they are to be found in, and compiled a second time without their
+        // whitespace for normalizedStringIgnoringWhitespace:
+        NSMutableArray  *folded     = [NSMutableArray arrayWithCapacity:[rules count]];
+        NSMutableArray  *compact    = [NSMutableArray arrayWithCapacity:[rules count]];
+        for (NSString *rule in rules)
+        {
+            const char  *UTF8       = [rule UTF8String];
+            size_t      length      = strlen(UTF8);
+            NSMutableData *bytes    = [NSMutableData dataWithLength:length * WO_KEYWORD_MAX_EXPANSION];
+            uint8_t     *buffer     = [bytes mutableBytes];
+            size_t      written     = WOKeywordFoldAndScan(NULL, (const uint8_t *)UTF8, length, buffer, NULL, NULL);
+            while (written > 0 && buffer[written - 1] == ' ')
+                written--;
+            [bytes setLength:written];
+            if (written == 0)
+                continue;
+            [folded addObject:bytes];
+            NSMutableData *compactBytes = [NSMutableData dataWithCapacity:written];
+            for (size_t i = 0; i < written; i++)
+                if (buffer[i] != ' ')
+                    [compactBytes appendBytes:&buffer[i] length:1];
+            [compact addObject:compactBytes];
+        }
+        automaton           = WOKeywordAutomatonCreateWithRules(folded);
+        compactAutomaton    = WOKeywordAutomatonCreateWithRules(compact);
+        if (!automaton || !compactAutomaton)
+            return nil;
+    }
+    return self;
+}
+
+- (void)finalize
+{
+    WOKeywordAutomatonFree(automaton);
+    WOKeywordAutomatonFree(compactAutomaton);
+    [super finalize];
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (NSString *)normalizedString:(NSString *)aString
+{
+    return WOKeywordNormalize(automaton, aString, NO);
+}
+
+- (NSString *)normalizedStringIgnoringWhitespace:(NSString *)aString
+{
+    return WOKeywordNormalize(compactAutomaton, WOKeywordSeparateWords(aString), YES);
+}
+
+@end
@@ -0,0 +1,77 @@
+//
+//  WOMPRISPlayer.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+#import <dbus/dbus.h>
+
+#import "WOPlayerBackend.h"
+
+//! Talks to a media player on the D-Bus session bus through the MPRIS 2 interfaces (org.mpris.MediaPlayer2 and friends),
+//! for Linux desktops; built against libdbus-1 and Foundation only.
+//!
+//! Changes are not polled for: a listener thread blocks on the bus for PropertiesChanged signals from the player's
+//! /org/mpris/MediaPlayer2 object and NameOwnerChanged signals from the bus, and passes each change of track or state to
+//! the delegate in the keys of iTunes' playerInfo notification. An idle player therefore costs no CPU at all, and a change
+//! reaches the main thread as soon as the bus delivers the signal. sendsNotifications is always YES.
+//!
+//! Commands and snapshots are method calls made on a second connection, so that a slow player never holds up the
+//! listener; isRunning answers from what the listener has seen and makes no call. MPRIS cannot set ratings or artwork,
+//! fast forward or rewind (a seek of WO_MPRIS_SEEK_STEP seconds stands in for the latter two), or tell whether the
+//! player is frontmost; those commands report failure.
+//!
+//! \warn Threadsafe
+@interface WOMPRISPlayer : NSObject <WOPlayerBackend> {
+
+    id <WOPlayerBackendDelegate>    delegate;
+
+    //! Well-known name of the player ("org.mpris.MediaPlayer2.vlc"); nil until one appears if none was asked for.
+    //! Guarded by stateLock
+    NSString                        *busName;
+
+    //! Unique name currently owning busName, or nil when the player is not running; guarded by stateLock
+    NSString                        *owner;
+
+    NSLock                          *stateLock;
+
+    //! Used by the listener thread only (after init)
+    DBusConnection                  *signalConnection;
+
+    //! For method calls; guarded by callLock
+    DBusConnection                  *connection;
+
+    NSLock                          *callLock;
+
+    //! Strings of the last snapshot, so that unchanged fields come back as the same objects; used by
+    //! commands only, which all come from one thread (see prepare)
+    NSMutableArray                  *fieldStrings;
+
+    //! Volume to go back to when unmuting (0 to 1); used by commands only
+    double                          mutedVolume;
+
+    //! \name Counters for statisticsDescription
+    //! \startgroup
+
+    unsigned                        signalCount;        //!< guarded by stateLock
+    unsigned                        callCount;          //!< guarded by callLock
+    unsigned                        failedCallCount;    //!< guarded by callLock
+
+    //! \endgroup
+}
+
+//! Designated initializer; connects to the session bus and starts listening. \p aName is the well-known bus name of the
+//! player to control, or nil for the first MPRIS player found on the bus (or, if there is none yet, the first to appear).
+//! Returns nil if there is no session bus.
+- (id)initWithBusName:(NSString *)aName;
+
+#pragma mark -
+#pragma mark Properties
+
+//! The well-known name of the player being controlled, or nil if none has been found yet
+@property(readonly) NSString *busName;
+
+@end
@@ -0,0 +1,903 @@
+// WOMPRISPlayer.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOMPRISPlayer.h"
+
+// system headers
+#import <math.h>
+
+// other headers
+#import "WODebug.h"
+#import "WOPlayerSnapshot.h"
+
+#define WO_MPRIS_NAME_PREFIX            "org.mpris.MediaPlayer2."
+#define WO_MPRIS_PATH                   "/org/mpris/MediaPlayer2"
+#define WO_MPRIS_ROOT_INTERFACE         "org.mpris.MediaPlayer2"
+#define WO_MPRIS_PLAYER_INTERFACE       "org.mpris.MediaPlayer2.Player"
+#define WO_MPRIS_TRACK_LIST_INTERFACE   "org.mpris.MediaPlayer2.TrackList"
+#define WO_MPRIS_PLAYLISTS_INTERFACE    "org.mpris.MediaPlayer2.Playlists"
+#define WO_DBUS_PROPERTIES_INTERFACE    "org.freedesktop.DBus.Properties"
+
+//! How long (milliseconds) a method call may wait for the player before it is given up as failed
+#define WO_MPRIS_TIMEOUT                5000
+
+//! Seconds into a track beyond which backTrack restarts it instead of going to the previous one
+#define WO_MPRIS_BACK_TRACK_THRESHOLD   3
+
+//! Seconds skipped by fastForward and rewind, which MPRIS has no equivalent for
+#define WO_MPRIS_SEEK_STEP              10
+
+//! Number of lit segments in the feedback window at full volume
+#define WO_MPRIS_VOLUME_SEGMENTS        16
+
+//! Indices into fieldStrings
+enum {
+    WOMPRISFieldTrackKey,
+    WOMPRISFieldTitle,
+    WOMPRISFieldAlbum,
+    WOMPRISFieldArtist,
+    WOMPRISFieldComposer,
+    WOMPRISFieldDuration,
+    WOMPRISFieldYear,
+    WOMPRISFieldCount
+};
+
+static id WOMPRISObjectFromIterator(DBusMessageIter *iterator);
+
+// the remaining items at iterator, with NSNull standing in for any that can't be converted
+static NSMutableArray *WOMPRISArrayFromIterator(DBusMessageIter *iterator)
+{
+    NSMutableArray *array = [NSMutableArray array];
+    while (dbus_message_iter_get_arg_type(iterator) != DBUS_TYPE_INVALID)
+    {
+        id object = WOMPRISObjectFromIterator(iterator);
+        [array addObject:(object ? object : [NSNull null])];
+        dbus_message_iter_next(iterator);
+    }
+    return array;
+}
+
+// the item at iterator as a string, number, array or dictionary (variants are unwrapped); nil for file descriptors
+static id WOMPRISObjectFromIterator(DBusMessageIter *iterator)
+{
+    DBusBasicValue  value;
+    DBusMessageIter contents;
+    int             type = dbus_message_iter_get_arg_type(iterator);
+    switch (type)
+    {
+        case DBUS_TYPE_STRING:
+        case DBUS_TYPE_OBJECT_PATH:
+        case DBUS_TYPE_SIGNATURE:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSString stringWithUTF8String:value.str];
+        case DBUS_TYPE_BOOLEAN:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithBool:(value.bool_val ? YES : NO)];
+        case DBUS_TYPE_BYTE:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithUnsignedChar:value.byt];
+        case DBUS_TYPE_INT16:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithShort:value.i16];
+        case DBUS_TYPE_UINT16:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithUnsignedShort:value.u16];
+        case DBUS_TYPE_INT32:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithInt:value.i32];
+        case DBUS_TYPE_UINT32:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithUnsignedInt:value.u32];
+        case DBUS_TYPE_INT64:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithLongLong:value.i64];
+        case DBUS_TYPE_UINT64:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithUnsignedLongLong:value.u64];
+        case DBUS_TYPE_DOUBLE:
+            dbus_message_iter_get_basic(iterator, &value);
+            return [NSNumber numberWithDouble:value.dbl];
+        case DBUS_TYPE_VARIANT:
+            dbus_message_iter_recurse(iterator, &contents);
+            return WOMPRISObjectFromIterator(&contents);
+        case DBUS_TYPE_STRUCT:
+            dbus_message_iter_recurse(iterator, &contents);
+            return WOMPRISArrayFromIterator(&contents);
+        case DBUS_TYPE_ARRAY:
+            dbus_message_iter_recurse(iterator, &contents);
+            if (dbus_message_iter_get_element_type(iterator) != DBUS_TYPE_DICT_ENTRY)
+                return WOMPRISArrayFromIterator(&contents);
+            NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+            while (dbus_message_iter_get_arg_type(&contents) == DBUS_TYPE_DICT_ENTRY)
+            {
+                DBusMessageIter entry;
+                dbus_message_iter_recurse(&contents, &entry);
+                id key = WOMPRISObjectFromIterator(&entry);
+                dbus_message_iter_next(&entry);
+                id object = WOMPRISObjectFromIterator(&entry);
+                if (key && object)
+                    [dictionary setObject:object forKey:key];
+                dbus_message_iter_next(&contents);
+            }
+            return dictionary;
+        default:
+            return nil;
+    }
+}
+
+// the arguments of message, in order
+static NSArray *WOMPRISArguments(DBusMessage *message)
+{
+    DBusMessageIter iterator;
+    if (!dbus_message_iter_init(message, &iterator))
+        return [NSArray array];
+    return WOMPRISArrayFromIterator(&iterator);
+}
+
+// xesam:artist and xesam:composer are lists, but some players send a plain string
+static NSString *WOMPRISJoinedString(id value)
+{
+    if ([value isKindOfClass:[NSString class]])
+        return value;
+    if ([value isKindOfClass:[NSArray class]])
+        return [value componentsJoinedByString:@", "];
+    return nil;
+}
+
+// the year of an ISO 8601 xesam:contentCreated date ("2007-03-01T00:00:00Z"), or nil
+static NSString *WOMPRISYear(id value)
+{
+    if (![value isKindOfClass:[NSString class]] || [value length] < 4)
+        return nil;
+    NSString *year = [value substringToIndex:4];
+    return ([year intValue] > 0) ? year : nil;
+}
+
+// the time in microseconds as the player would show it ("3:45" or "1:02:03"), or nil
+static NSString *WOMPRISDuration(id value)
+{
+    if (![value isKindOfClass:[NSNumber class]] || [value longLongValue] <= 0)
+        return nil;
+    long long seconds = [value longLongValue] / 1000000;
+    if (seconds >= 3600)
+        return [NSString stringWithFormat:@"%lld:%02lld:%02lld", seconds / 3600, (seconds / 60) % 60, seconds % 60];
+    return [NSString stringWithFormat:@"%lld:%02lld", seconds / 60, seconds % 60];
+}
+
+static DBusHandlerResult WOMPRISSignalFilter(DBusConnection *aConnection, DBusMessage *message, void *context);
+
+@interface WOMPRISPlayer ()
+
+- (NSString *)currentOwner;
+- (DBusMessage *)newCallToMethod:(const char *)method ofInterface:(const char *)interface;
+- (DBusMessage *)newBusCallToMethod:(const char *)method;
+- (DBusMessage *)sendCall:(DBusMessage *)call;
+- (BOOL)callMethod:(const char *)method ofInterface:(const char *)interface;
+- (NSArray *)resultOfCall:(DBusMessage *)call;
+- (id)propertyNamed:(const char *)name ofInterface:(const char *)interface;
+- (BOOL)setPropertyNamed:(const char *)name type:(int)type value:(const void *)value;
+- (int)changeVolumeBySegments:(int)segments;
+- (BOOL)seekBy:(long long)microseconds;
+- (NSArray *)playlists;
+- (NSString *)stableString:(NSString *)string forField:(NSUInteger)index;
+- (void)listen:(id)unused;
+- (void)listenerDidReceiveSignal:(DBusMessage *)message;
+- (void)notifyDelegate:(NSDictionary *)info;
+
+@end
+
+@implementation WOMPRISPlayer
+
+#pragma mark -
+#pragma mark NSObject overrides
+
++ (void)initialize
+{
+    // the two connections are used from different threads
+    if (self == [WOMPRISPlayer class])
+        dbus_threads_init_default();
+}
+
+- (id)init
+{
+    return [self initWithBusName:nil];
+}
+
+- (id)initWithBusName:(NSString *)aName
+{
+    if ((self = [super init]))
+    {
+        busName         = [aName copy];
+        stateLock       = [[NSLock alloc] init];
+        callLock        = [[NSLock alloc] init];
+        fieldStrings    = [[NSMutableArray alloc] initWithCapacity:WOMPRISFieldCount];
+        for (NSUInteger i = 0; i < WOMPRISFieldCount; i++)
+            [fieldStrings addObject:@""];
+
+        DBusError error;
+        dbus_error_init(&error);
+        signalConnection = dbus_bus_get_private(DBUS_BUS_SESSION, &error);
+        connection = signalConnection ? dbus_bus_get_private(DBUS_BUS_SESSION, &error) : NULL;
+        if (!connection)
+        {
+            ELOG(@"Could not connect to the D-Bus session bus: %s", error.message);
+            dbus_error_free(&error);
+            return nil;
+        }
+        dbus_connection_set_exit_on_disconnect(signalConnection, FALSE);
+        dbus_connection_set_exit_on_disconnect(connection, FALSE);
+
+        // listen before looking, so that a player that turns up in between is not missed
+        dbus_connection_add_filter(signalConnection, WOMPRISSignalFilter, self, NULL);
+        dbus_bus_add_match(signalConnection, "type='signal',sender='org.freedesktop.DBus',"
+                           "interface='org.freedesktop.DBus',member='NameOwnerChanged',"
+                           "arg0namespace='org.mpris.MediaPlayer2'", &error);
+        if (!dbus_error_is_set(&error))
+            dbus_bus_add_match(signalConnection, "type='signal',interface='org.freedesktop.DBus.Properties',"
+                               "member='PropertiesChanged',path='/org/mpris/MediaPlayer2',"
+                               "arg0='org.mpris.MediaPlayer2.Player'", &error);
+        if (dbus_error_is_set(&error))
+        {
+            ELOG(@"Could not subscribe to MPRIS signals: %s", error.message);
+            dbus_error_free(&error);
+        }
+
+        if (!busName)
+        {
+            // the first in alphabetical order, so that the choice is the same every time
+            NSArray *names = [[[self resultOfCall:[self newBusCallToMethod:"ListNames"]] lastObject]
+                              sortedArrayUsingSelector:@selector(compare:)];
+            for (NSString *name in names)
+            {
+                if ([name isKindOfClass:[NSString class]] && [name hasPrefix:@WO_MPRIS_NAME_PREFIX])
+                {
+                    busName = [name copy];
+                    break;
+                }
+            }
+        }
+        if (busName)
+        {
+            DBusMessage *call = [self newBusCallToMethod:"GetNameOwner"];
+            const char *name = [busName UTF8String];
+            dbus_message_append_args(call, DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID);
+            id result = [[self resultOfCall:call] lastObject];     // fails when there is no owner
+            owner = [result isKindOfClass:[NSString class]] ? [result copy] : nil;
+        }
+
+        [NSThread detachNewThreadSelector:@selector(listen:) toTarget:self withObject:nil];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark WOPlayerBackend protocol
+
+- (void)setDelegate:(id <WOPlayerBackendDelegate>)aDelegate
+{
+    delegate = aDelegate;
+}
+
+- (void)prepare
+{
+    // nothing to build: the connections are made and the signals subscribed to by init
+}
+
+- (NSString *)statisticsDescription
+{
+    [stateLock lock];
+    unsigned signals = signalCount;
+    [stateLock unlock];
+    [callLock lock];
+    NSString *description = [NSString stringWithFormat:@"%u signals received, %u calls made (%u failed)",
+                             signals, callCount, failedCallCount];
+    [callLock unlock];
+    return description;
+}
+
+- (BOOL)sendsNotifications
+{
+    return YES;
+}
+
+- (BOOL)isRunning
+{
+    return ([self currentOwner] != nil);
+}
+
+- (BOOL)isFrontmost
+{
+    // MPRIS has no way to tell
+    return NO;
+}
+
+- (BOOL)launch
+{
+    NSString *name = self.busName;
+    if (!name)
+        return NO;
+    DBusMessage *call = [self newBusCallToMethod:"StartServiceByName"];
+    const char *nameString = [name UTF8String];
+    dbus_uint32_t flags = 0;
+    dbus_message_append_args(call, DBUS_TYPE_STRING, &nameString, DBUS_TYPE_UINT32, &flags, DBUS_TYPE_INVALID);
+    return ([self resultOfCall:call] != nil);
+}
+
+- (void)quit
+{
+    (void)[self callMethod:"Quit" ofInterface:WO_MPRIS_ROOT_INTERFACE];
+}
+
+- (void)activate
+{
+    (void)[self callMethod:"Raise" ofInterface:WO_MPRIS_ROOT_INTERFACE];
+}
+
+- (void)hide
+{
+    // MPRIS has no equivalent
+}
+
+- (WOPlayerSnapshot *)snapshot
+{
+    if (![self isRunning])
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerNotRunning];
+
+    DBusMessage *call = [self newCallToMethod:"GetAll" ofInterface:WO_DBUS_PROPERTIES_INTERFACE];
+    const char *interface = WO_MPRIS_PLAYER_INTERFACE;
+    if (call)
+        dbus_message_append_args(call, DBUS_TYPE_STRING, &interface, DBUS_TYPE_INVALID);
+    NSDictionary *properties = [[self resultOfCall:call] lastObject];
+    if (![properties isKindOfClass:[NSDictionary class]])
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerUnknown];
+
+    NSDictionary *metadata  = [properties objectForKey:@"Metadata"];
+    NSString *status        = [properties objectForKey:@"PlaybackStatus"];
+    if (![metadata isKindOfClass:[NSDictionary class]])
+        metadata = nil;
+    NSString *trackID       = [metadata objectForKey:@"mpris:trackid"];
+    if (![trackID isKindOfClass:[NSString class]])
+        trackID = nil;
+
+    // "Stopped" may still have a current track, which iTunes would call paused
+    WOPlayerState state;
+    if ([status isEqual:@"Playing"])
+        state = WOPlayerPlaying;
+    else if ([status isEqual:@"Paused"] || ([status isEqual:@"Stopped"] && trackID))
+        state = WOPlayerPaused;
+    else if ([status isEqual:@"Stopped"])
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerNotPlaying];
+    else
+        return [WOPlayerSnapshot snapshotWithState:WOPlayerError];
+
+    WORepeatMode repeatMode = WORepeatUnknown;
+    NSString *loopStatus = [properties objectForKey:@"LoopStatus"];
+    if ([loopStatus isEqual:@"None"])
+        repeatMode = WORepeatOff;
+    else if ([loopStatus isEqual:@"Track"])
+        repeatMode = WORepeatOne;
+    else if ([loopStatus isEqual:@"Playlist"])
+        repeatMode = WORepeatAll;
+
+    WOShuffleState shuffleState = WOShuffleUnknown;
+    NSNumber *shuffle = [properties objectForKey:@"Shuffle"];
+    if ([shuffle isKindOfClass:[NSNumber class]])
+        shuffleState = [shuffle boolValue] ? WOShuffleOn : WOShuffleOff;
+
+    // xesam:userRating runs from 0 to 1
+    NSNumber *rating = [metadata objectForKey:@"xesam:userRating"];
+    int ratingValue = [rating isKindOfClass:[NSNumber class]] ? (int)lround([rating doubleValue] * 100) : 0;
+
+    NSNumber *position = [properties objectForKey:@"Position"];
+    int positionValue = [position isKindOfClass:[NSNumber class]] ? (int)([position longLongValue] / 1000000) : 0;
+
+    NSString *key = [self stableString:trackID forField:WOMPRISFieldTrackKey];
+    return [[WOPlayerSnapshot alloc] initWithState:state
+                                   trackIdentifier:([key length] ? key : nil)
+                                          trackKey:key
+                                             title:[self stableString:[metadata objectForKey:@"xesam:title"]
+                                                             forField:WOMPRISFieldTitle]
+                                             album:[self stableString:[metadata objectForKey:@"xesam:album"]
+                                                             forField:WOMPRISFieldAlbum]
+                                            artist:[self stableString:WOMPRISJoinedString([metadata objectForKey:@"xesam:artist"])
+                                                             forField:WOMPRISFieldArtist]
+                                          composer:[self stableString:WOMPRISJoinedString([metadata objectForKey:@"xesam:composer"])
+                                                             forField:WOMPRISFieldComposer]
+                                          duration:[self stableString:WOMPRISDuration([metadata objectForKey:@"mpris:length"])
+                                                             forField:WOMPRISFieldDuration]
+                                              year:[self stableString:WOMPRISYear([metadata objectForKey:@"xesam:contentCreated"])
+                                                             forField:WOMPRISFieldYear]
+                                            rating:ratingValue
+                                        repeatMode:repeatMode
+                                      shuffleState:shuffleState
+                                          position:positionValue];
+}
+
+- (void)playPause
+{
+    (void)[self callMethod:"PlayPause" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+}
+
+- (void)nextTrack
+{
+    (void)[self callMethod:"Next" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+}
+
+- (void)backTrack
+{
+    NSNumber *position = [self propertyNamed:"Position" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    NSDictionary *metadata = [self propertyNamed:"Metadata" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    id trackID = [metadata isKindOfClass:[NSDictionary class]] ? [metadata objectForKey:@"mpris:trackid"] : nil;
+    if (![position isKindOfClass:[NSNumber class]] || ![trackID isKindOfClass:[NSString class]] ||
+        [position longLongValue] < WO_MPRIS_BACK_TRACK_THRESHOLD * 1000000LL)
+    {
+        [self previousTrack];
+        return;
+    }
+    DBusMessage *call = [self newCallToMethod:"SetPosition" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    const char *path = [trackID UTF8String];
+    dbus_int64_t start = 0;
+    if (call)
+        dbus_message_append_args(call, DBUS_TYPE_OBJECT_PATH, &path, DBUS_TYPE_INT64, &start, DBUS_TYPE_INVALID);
+    (void)[self resultOfCall:call];
+}
+
+- (void)previousTrack
+{
+    (void)[self callMethod:"Previous" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+}
+
+- (void)fastForward
+{
+    (void)[self seekBy:WO_MPRIS_SEEK_STEP * 1000000LL];
+}
+
+- (void)rewind
+{
+    (void)[self seekBy:-WO_MPRIS_SEEK_STEP * 1000000LL];
+}
+
+- (void)resume
+{
+    // fastForward and rewind are one-off seeks, so there is nothing to end
+}
+
+- (BOOL)playTrack:(id)identifier
+{
+    if (![identifier isKindOfClass:[NSString class]])
+        return NO;
+    DBusMessage *call = [self newCallToMethod:"GoTo" ofInterface:WO_MPRIS_TRACK_LIST_INTERFACE];
+    const char *path = [identifier UTF8String];
+    if (call)
+        dbus_message_append_args(call, DBUS_TYPE_OBJECT_PATH, &path, DBUS_TYPE_INVALID);
+    return ([self resultOfCall:call] != nil);
+}
+
+- (int)setRating:(int)rating
+{
+    // xesam:userRating is read-only in MPRIS
+    return -1;
+}
+
+- (int)increaseRating
+{
+    return -1;
+}
+
+- (int)decreaseRating
+{
+    return -1;
+}
+
+- (int)volumeUp
+{
+    return [self changeVolumeBySegments:1];
+}
+
+- (int)volumeDown
+{
+    return [self changeVolumeBySegments:-1];
+}
+
+- (int)toggleMute
+{
+    NSNumber *volume = [self propertyNamed:"Volume" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    if (![volume isKindOfClass:[NSNumber class]])
+        return -1;
+    double newVolume;
+    if ([volume doubleValue] > 0.0)
+    {
+        mutedVolume = [volume doubleValue];
+        newVolume = 0.0;
+    }
+    else
+        newVolume = (mutedVolume > 0.0) ? mutedVolume : 1.0;
+    if (![self setPropertyNamed:"Volume" type:DBUS_TYPE_DOUBLE value:&newVolume])
+        return -1;
+    return (int)lround(MIN(newVolume, 1.0) * WO_MPRIS_VOLUME_SEGMENTS);
+}
+
+- (BOOL)setShuffle:(BOOL)flag
+{
+    dbus_bool_t value = flag ? TRUE : FALSE;
+    return [self setPropertyNamed:"Shuffle" type:DBUS_TYPE_BOOLEAN value:&value];
+}
+
+- (WOShuffleState)toggleShuffle
+{
+    NSNumber *shuffle = [self propertyNamed:"Shuffle" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    if (![shuffle isKindOfClass:[NSNumber class]] || ![self setShuffle:![shuffle boolValue]])
+        return WOShuffleUnknown;
+    return [shuffle boolValue] ? WOShuffleOff : WOShuffleOn;
+}
+
+- (BOOL)setRepeatMode:(WORepeatMode)mode
+{
+    const char *loopStatus;
+    switch (mode)
+    {
+        case WORepeatOff:   loopStatus = "None";        break;
+        case WORepeatOne:   loopStatus = "Track";       break;
+        case WORepeatAll:   loopStatus = "Playlist";    break;
+        default:            return NO;
+    }
+    return [self setPropertyNamed:"LoopStatus" type:DBUS_TYPE_STRING value:&loopStatus];
+}
+
+- (WORepeatMode)cycleRepeatMode
+{
+    NSString *loopStatus = [self propertyNamed:"LoopStatus" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    WORepeatMode mode;
+    if ([loopStatus isEqual:@"None"])
+        mode = WORepeatAll;
+    else if ([loopStatus isEqual:@"Playlist"])
+        mode = WORepeatOne;
+    else if ([loopStatus isEqual:@"Track"])
+        mode = WORepeatOff;
+    else
+        return WORepeatUnknown;
+    return [self setRepeatMode:mode] ? mode : WORepeatUnknown;
+}
+
+- (NSArray *)playlistNames
+{
+    NSArray *playlists = [self playlists];
+    if (!playlists)
+        return nil;
+    NSMutableArray *names = [NSMutableArray arrayWithCapacity:[playlists count]];
+    for (NSArray *playlist in playlists)
+        [names addObject:[playlist objectAtIndex:1]];
+    return names;
+}
+
+- (BOOL)playPlaylistNamed:(NSString *)name activate:(BOOL)flag
+{
+    NSParameterAssert(name != nil);
+    NSString *path = nil;
+    for (NSArray *playlist in [self playlists])
+    {
+        if ([[playlist objectAtIndex:1] isEqualToString:name])
+        {
+            path = [playlist objectAtIndex:0];
+            break;
+        }
+    }
+    if (!path)
+    {
+        ELOG(@"Warning: no playlist called \"%@\"", name);
+        return NO;
+    }
+
+    (void)[self callMethod:"Stop" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    DBusMessage *call = [self newCallToMethod:"ActivatePlaylist" ofInterface:WO_MPRIS_PLAYLISTS_INTERFACE];
+    const char *pathString = [path UTF8String];
+    if (call)
+        dbus_message_append_args(call, DBUS_TYPE_OBJECT_PATH, &pathString, DBUS_TYPE_INVALID);
+    if (![self resultOfCall:call])
+        return NO;
+    if (flag)
+        [self activate];
+    return YES;
+}
+
+- (NSData *)artworkOfCurrentTrack
+{
+    // only local files: the cover search already goes to the network by itself
+    NSDictionary *metadata = [self propertyNamed:"Metadata" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    NSString *artURL = [metadata isKindOfClass:[NSDictionary class]] ? [metadata objectForKey:@"mpris:artUrl"] : nil;
+    if (![artURL isKindOfClass:[NSString class]])
+        return nil;
+    NSURL *URL = [NSURL URLWithString:artURL];
+    if (![URL isFileURL])
+        return nil;
+    return [NSData dataWithContentsOfFile:[URL path]];
+}
+
+- (BOOL)setArtworkOfCurrentTrack:(NSImage *)image
+{
+    // MPRIS has no equivalent
+    return NO;
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+- (NSString *)currentOwner
+{
+    [stateLock lock];
+    NSString *currentOwner = owner;
+    [stateLock unlock];
+    return currentOwner;
+}
+
+// a call to method on the player's object, to which the caller appends the arguments; NULL if there is no player yet
+- (DBusMessage *)newCallToMethod:(const char *)method ofInterface:(const char *)interface
+{
+    NSString *name = self.busName;
+    if (!name)
+        return NULL;
+    return dbus_message_new_method_call([name UTF8String], WO_MPRIS_PATH, interface, method);
+}
+
+// a call to method of the bus itself, to which the caller appends the arguments
+- (DBusMessage *)newBusCallToMethod:(const char *)method
+{
+    return dbus_message_new_method_call(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, method);
+}
+
+// sends call (which may be NULL, and is unreferenced) and waits for the reply; returns the reply, which the caller must
+// unreference, or NULL on failure
+- (DBusMessage *)sendCall:(DBusMessage *)call
+{
+    if (!call)
+        return NULL;
+    DBusError error;
+    dbus_error_init(&error);
+    [callLock lock];
+    callCount++;
+    DBusMessage *reply = dbus_connection_send_with_reply_and_block(connection, call, WO_MPRIS_TIMEOUT, &error);
+    if (!reply)
+        failedCallCount++;
+    [callLock unlock];
+    if (!reply)
+    {
+        LOG(@"MPRIS call %s failed: %s", dbus_message_get_member(call), error.message);
+        dbus_error_free(&error);
+    }
+    dbus_message_unref(call);
+    return reply;
+}
+
+- (BOOL)callMethod:(const char *)method ofInterface:(const char *)interface
+{
+    return ([self resultOfCall:[self newCallToMethod:method ofInterface:interface]] != nil);
+}
+
+// sends call and returns the arguments of the reply, or nil on failure
+- (NSArray *)resultOfCall:(DBusMessage *)call
+{
+    DBusMessage *reply = [self sendCall:call];
+    if (!reply)
+        return nil;
+    NSArray *arguments = WOMPRISArguments(reply);
+    dbus_message_unref(reply);
+    return arguments;
+}
+
+- (id)propertyNamed:(const char *)name ofInterface:(const char *)interface
+{
+    DBusMessage *call = [self newCallToMethod:"Get" ofInterface:WO_DBUS_PROPERTIES_INTERFACE];
+    if (call)
+        dbus_message_append_args(call, DBUS_TYPE_STRING, &interface, DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID);
+    return [[self resultOfCall:call] lastObject];
+}
+
+// sets a property of the Player interface; value points at a basic value of the D-Bus type
+- (BOOL)setPropertyNamed:(const char *)name type:(int)type value:(const void *)value
+{
+    DBusMessage *call = [self newCallToMethod:"Set" ofInterface:WO_DBUS_PROPERTIES_INTERFACE];
+    if (!call)
+        return NO;
+    const char *interface = WO_MPRIS_PLAYER_INTERFACE;
+    char signature[2] = { (char)type, '\0' };
+    DBusMessageIter arguments, variant;
+    dbus_message_iter_init_append(call, &arguments);
+    dbus_message_iter_append_basic(&arguments, DBUS_TYPE_STRING, &interface);
+    dbus_message_iter_append_basic(&arguments, DBUS_TYPE_STRING, &name);
+    dbus_message_iter_open_container(&arguments, DBUS_TYPE_VARIANT, signature, &variant);
+    dbus_message_iter_append_basic(&variant, type, value);
+    dbus_message_iter_close_container(&arguments, &variant);
+    return ([self resultOfCall:call] != nil);
+}
+
+// the Volume property runs from 0 to 1 (players may allow more); returns the new number of lit segments
+- (int)changeVolumeBySegments:(int)segments
+{
+    NSNumber *volume = [self propertyNamed:"Volume" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    if (![volume isKindOfClass:[NSNumber class]])
+        return -1;
+    int lit = (int)lround(MIN(MAX([volume doubleValue], 0.0), 1.0) * WO_MPRIS_VOLUME_SEGMENTS) + segments;
+    lit = MIN(MAX(lit, 0), WO_MPRIS_VOLUME_SEGMENTS);
+    double newVolume = (double)lit / WO_MPRIS_VOLUME_SEGMENTS;
+    return [self setPropertyNamed:"Volume" type:DBUS_TYPE_DOUBLE value:&newVolume] ? lit : -1;
+}
+
+- (BOOL)seekBy:(long long)microseconds
+{
+    DBusMessage *call = [self newCallToMethod:"Seek" ofInterface:WO_MPRIS_PLAYER_INTERFACE];
+    dbus_int64_t offset = microseconds;
+    if (call)
+        dbus_message_append_args(call, DBUS_TYPE_INT64, &offset, DBUS_TYPE_INVALID);
+    return ([self resultOfCall:call] != nil);
+}
+
+// each playlist as an array of its object path, name and icon, in the player's own order where it has one; nil if the
+// player has no playlists interface
+- (NSArray *)playlists
+{
+    NSArray *orderings = [self propertyNamed:"Orderings" ofInterface:WO_MPRIS_PLAYLISTS_INTERFACE];
+    if (![orderings isKindOfClass:[NSArray class]] || [orderings count] == 0)
+        return nil;
+
+    // every player must support at least one ordering; "UserDefined" is what iTunes shows
+    const char *ordering = [orderings containsObject:@"UserDefined"] ? "UserDefined" :
+        [[orderings objectAtIndex:0] UTF8String];
+    dbus_uint32_t index = 0, count = UINT32_MAX;
+    dbus_bool_t reverse = FALSE;
+    DBusMessage *call = [self newCallToMethod:"GetPlaylists" ofInterface:WO_MPRIS_PLAYLISTS_INTERFACE];
+    if (call)
+        dbus_message_append_args(call, DBUS_TYPE_UINT32, &index, DBUS_TYPE_UINT32, &count, DBUS_TYPE_STRING, &ordering,
+                                 DBUS_TYPE_BOOLEAN, &reverse, DBUS_TYPE_INVALID);
+    NSArray *playlists = [[self resultOfCall:call] lastObject];
+    if (![playlists isKindOfClass:[NSArray class]])
+        return nil;
+    NSMutableArray *valid = [NSMutableArray arrayWithCapacity:[playlists count]];
+    for (NSArray *playlist in playlists)
+        if ([playlist isKindOfClass:[NSArray class]] && [playlist count] == 3 &&
+            [[playlist objectAtIndex:1] isKindOfClass:[NSString class]])
+            [valid addObject:playlist];
+    return valid;
+}
+
+// hands back the previous snapshot's string for field index if it is equal (nil counting as empty), so that
+// WOPlayerSnapshot's changesSince: can get away with pointer comparisons; commands only
+- (NSString *)stableString:(NSString *)string forField:(NSUInteger)index
+{
+    if (![string isKindOfClass:[NSString class]])
+        string = @"";
+    NSString *previous = [fieldStrings objectAtIndex:index];
+    if ([previous isEqualToString:string])
+        return previous;
+    string = [string copy];
+    [fieldStrings replaceObjectAtIndex:index withObject:string];
+    return string;
+}
+
+// body of the listener thread
+- (void)listen:(id)unused
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+    // sleeps in poll() until the bus has something; each signal goes through WOMPRISSignalFilter
+    while (dbus_connection_read_write_dispatch(signalConnection, -1))
+    {
+        [pool drain];
+        pool = [[NSAutoreleasePool alloc] init];
+    }
+    ELOG(@"Lost the D-Bus session bus; no more notifications from the player");
+    [pool drain];
+}
+
+// listener thread only
+- (void)listenerDidReceiveSignal:(DBusMessage *)message
+{
+    if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameOwnerChanged"))
+    {
+        // name, old owner, new owner (empty when the name is released)
+        NSArray *arguments = WOMPRISArguments(message);
+        if ([arguments count] != 3)
+            return;
+        NSString *name = [arguments objectAtIndex:0];
+        NSString *newOwner = [arguments objectAtIndex:2];
+        if (![name isKindOfClass:[NSString class]] || ![newOwner isKindOfClass:[NSString class]])
+            return;
+        BOOL changed = NO;
+        [stateLock lock];
+        signalCount++;
+        if (!busName && [newOwner length] > 0 && [name hasPrefix:@WO_MPRIS_NAME_PREFIX])
+            busName = [name copy];
+        if ([name isEqualToString:busName])
+        {
+            owner = ([newOwner length] > 0) ? [newOwner copy] : nil;
+            changed = YES;
+        }
+        [stateLock unlock];
+
+        // iTunes says "Stopped" as it quits
+        if (changed)
+            [self performSelectorOnMainThread:@selector(notifyDelegate:)
+                                   withObject:([newOwner length] ? nil :
+                                               [NSDictionary dictionaryWithObject:@"Stopped" forKey:@"Player State"])
+                                waitUntilDone:NO];
+        return;
+    }
+
+    if (!dbus_message_is_signal(message, WO_DBUS_PROPERTIES_INTERFACE, "PropertiesChanged"))
+        return;
+    const char *sender = dbus_message_get_sender(message);
+    [stateLock lock];
+    signalCount++;
+    BOOL fromPlayer = (owner && sender && strcmp([owner UTF8String], sender) == 0);
+    [stateLock unlock];
+    if (!fromPlayer)
+        return;
+
+    // interface, changed properties, invalidated properties
+    NSArray *arguments = WOMPRISArguments(message);
+    if ([arguments count] < 2 || ![[arguments objectAtIndex:1] isKindOfClass:[NSDictionary class]])
+        return;
+    NSDictionary *changedProperties = [arguments objectAtIndex:1];
+    NSDictionary *metadata = [changedProperties objectForKey:@"Metadata"];
+    NSString *status = [changedProperties objectForKey:@"PlaybackStatus"];
+
+    // volume, shuffle and the like are not announced by iTunes either
+    if (![metadata isKindOfClass:[NSDictionary class]])
+        metadata = nil;
+    if (![status isKindOfClass:[NSString class]])
+        status = nil;
+    if (!metadata && !status)
+        return;
+
+    // in the keys and units of iTunes' playerInfo notification
+    NSMutableDictionary *info = [NSMutableDictionary dictionary];
+    if (status)
+        [info setObject:status forKey:@"Player State"];
+    id value;
+    if ((value = [metadata objectForKey:@"xesam:title"]))
+        [info setObject:value forKey:@"Name"];
+    if ((value = WOMPRISJoinedString([metadata objectForKey:@"xesam:artist"])))
+        [info setObject:value forKey:@"Artist"];
+    if ((value = [metadata objectForKey:@"xesam:album"]))
+        [info setObject:value forKey:@"Album"];
+    if ((value = WOMPRISJoinedString([metadata objectForKey:@"xesam:composer"])))
+        [info setObject:value forKey:@"Composer"];
+    if ((value = WOMPRISYear([metadata objectForKey:@"xesam:contentCreated"])))
+        [info setObject:[NSNumber numberWithInt:[value intValue]] forKey:@"Year"];
+    if ((value = [metadata objectForKey:@"xesam:userRating"]) && [value isKindOfClass:[NSNumber class]])
+        [info setObject:[NSNumber numberWithInt:(int)lround([value doubleValue] * 100)] forKey:@"Rating"];
+    if ((value = [metadata objectForKey:@"mpris:length"]) && [value isKindOfClass:[NSNumber class]])
+        [info setObject:[NSNumber numberWithLongLong:[value longLongValue] / 1000] forKey:@"Total Time"];
+    if ((value = [metadata objectForKey:@"xesam:url"]))
+        [info setObject:value forKey:@"Location"];
+    [self performSelectorOnMainThread:@selector(notifyDelegate:) withObject:info waitUntilDone:NO];
+}
+
+// main thread only
+- (void)notifyDelegate:(NSDictionary *)info
+{
+    [delegate playerBackend:self didChangeWithInfo:info];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (NSString *)busName
+{
+    [stateLock lock];
+    NSString *name = busName;
+    [stateLock unlock];
+    return name;
+}
+
+@end
+
+// runs on the listener thread, inside dbus_connection_read_write_dispatch
+static DBusHandlerResult WOMPRISSignalFilter(DBusConnection *aConnection, DBusMessage *message, void *context)
+{
+    if (dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_SIGNAL)
+        [(WOMPRISPlayer *)context listenerDidReceiveSignal:message];
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
@@ -0,0 +1,174 @@
+//
+//  WOPlayerBackend.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class NSImage, WOPlayerSnapshot;
+
+//! What the player is doing, as far as a backend can tell
+typedef enum WOPlayerState {
+
+    WOPlayerNotRunning,
+    WOPlayerUnknown,            //!< Running but not answering (busy, or quitting)
+    WOPlayerError,              //!< Answered, but not with anything sensible (store previews, for example)
+    WOPlayerNotPlaying,         //!< No current track
+    WOPlayerPaused,             //!< Paused or stopped with a current track
+    WOPlayerPlaying
+
+} WOPlayerState;
+
+typedef enum WORepeatMode {
+
+    WORepeatOff = 0,
+    WORepeatOne = 1,
+    WORepeatAll = 2,
+    WORepeatUnknown = 3
+
+} WORepeatMode;
+
+typedef enum WOShuffleState {
+
+    WOShuffleOff = 0,
+    WOShuffleOn = 1,
+    WOShuffleUnknown = 2
+
+} WOShuffleState;
+
+@protocol WOPlayerBackendDelegate
+
+//! Sent on the main thread whenever the player announces a change of track or state. \p info uses the keys of iTunes'
+//! playerInfo notification ("Name", "Artist", "Album", "Composer", "Year", "Rating", "Total Time", "Location" and
+//! "Player State"), whatever the player, and is nil if the player said nothing more.
+- (void)playerBackend:(id)aBackend didChangeWithInfo:(NSDictionary *)info;
+
+@end
+
+//! Everything SynergyController needs from the music player: the state snapshot, transport commands, rating, volume,
+//! shuffle and repeat, playlists and artwork.
+//!
+//! Commands sent while the player is not running do nothing (and report failure where they return something), except
+//! for launch and, where the backend can manage it, activate. Volume is expressed as the number of lit segments (0 to 16)
+//! in the feedback window and ratings as 0 to 100.
+//!
+//! WOITunesPlayer drives iTunes through AppleScript. WOMPRISPlayer drives an MPRIS player on the D-Bus session bus; it
+//! returns YES from sendsNotifications and passes each change to the delegate, leaving the controller's poll as a
+//! once-a-month fallback (see WOPlayerPollScheduler). The protocol needs Foundation only, so that backends can be built
+//! without AppKit.
+@protocol WOPlayerBackend
+
+- (void)setDelegate:(id <WOPlayerBackendDelegate>)aDelegate;
+
+//! Sent once, before anything else, on the thread that will send all the commands and snapshot requests; a backend builds
+//! (compiles, looks up) its commands here so that none of them pays for that the first time it is used
+- (void)prepare;
+
+//! YES if the player announces changes to the delegate by itself, so that polling is only needed as a fallback
+- (BOOL)sendsNotifications;
+
+//! \name Process
+//! \startgroup
+
+- (BOOL)isRunning;
+
+//! YES if the player is running and is the frontmost application
+- (BOOL)isFrontmost;
+
+- (BOOL)launch;
+- (void)quit;
+- (void)activate;
+- (void)hide;
+
+//! \endgroup
+
+//! Asks the player what it is doing; never nil
+- (WOPlayerSnapshot *)snapshot;
+
+//! \name Transport
+//! \startgroup
+
+- (void)playPause;
+- (void)nextTrack;
+
+//! Restarts the current track if it is past its first few seconds, otherwise goes to the previous track
+- (void)backTrack;
+- (void)previousTrack;
+- (void)fastForward;
+- (void)rewind;
+
+//! Ends a fast forward or rewind
+- (void)resume;
+
+//! \p identifier is the trackIdentifier of an earlier snapshot
+- (BOOL)playTrack:(id)identifier;
+
+//! \endgroup
+
+//! \name Rating
+//! Each returns the new rating, or -1 if there is no current track
+//! \startgroup
+
+- (int)setRating:(int)rating;
+
+//! Moves to the next (or previous) whole star
+- (int)increaseRating;
+- (int)decreaseRating;
+
+//! \endgroup
+
+//! \name Volume
+//! Each returns the new number of lit segments, or -1 on failure
+//! \startgroup
+
+- (int)volumeUp;
+- (int)volumeDown;
+
+//! Returns 0 when the player has just been muted
+- (int)toggleMute;
+
+//! \endgroup
+
+//! \name Shuffle and repeat
+//! These apply to the playlist of the current track
+//! \startgroup
+
+- (BOOL)setShuffle:(BOOL)flag;
+
+//! Returns the new state, or WOShuffleUnknown on failure
+- (WOShuffleState)toggleShuffle;
+
+- (BOOL)setRepeatMode:(WORepeatMode)mode;
+
+//! Goes from off to all to one and back to off; returns the new mode, or WORepeatUnknown on failure
+- (WORepeatMode)cycleRepeatMode;
+
+//! \endgroup
+
+//! \name Playlists
+//! \startgroup
+
+//! Names of the playlists in the library, or nil if they could not be read
+- (NSArray *)playlistNames;
+
+//! Stops, shows the playlist called \p name and starts playing it, bringing the player to the front if \p flag is YES
+- (BOOL)playPlaylistNamed:(NSString *)name activate:(BOOL)flag;
+
+//! \endgroup
+
+//! \name Artwork
+//! \startgroup
+
+//! The artwork the player has for the current track, encoded as the player stores it, or nil
+- (NSData *)artworkOfCurrentTrack;
+
+- (BOOL)setArtworkOfCurrentTrack:(NSImage *)image;
+
+//! \endgroup
+
+//! Counters the backend keeps about its own work (compilations, for example), for the log; nil if it keeps none
+- (NSString *)statisticsDescription;
+
+@end
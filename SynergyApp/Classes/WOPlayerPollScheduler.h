@@ -0,0 +1,48 @@
+//
+//  WOPlayerPollScheduler.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+#import "WOPlayerSnapshot.h"
+
+//! Decides how long to wait before asking the player for the next snapshot.
+//!
+//! While a track is playing the only change that can be predicted is the end of the track, so polls are spread out in
+//! mid-track (up to WO_MID_TRACK_POLLING_FACTOR times the base interval) and closed in on the expected end, landing just
+//! after it. In every other state the interval doubles with each poll that finds nothing new, up to
+//! WO_MAX_IDLE_POLLING_INTERVAL, and drops back to the base interval as soon as anything changes. When the player sends
+//! notifications polling is only a fallback and the interval is a month.
+//!
+//! Holds no timer and reads no clock: the caller asks for an interval after each poll, whatever triggered it, and
+//! reschedules its own timer from that moment. A poll brought forward by a notification or a click therefore pushes the
+//! next scheduled one back rather than adding to it.
+//!
+//! \warn Not threadsafe
+@interface WOPlayerPollScheduler : NSObject {
+
+    //! The user's polling interval (WO_MIN_POLLING_INTERVAL to WO_MAX_POLLING_INTERVAL)
+    NSTimeInterval  baseInterval;
+
+    //! Current interval while not playing; doubles with each unchanged poll
+    NSTimeInterval  idleInterval;
+
+    BOOL            playerSendsNotifications;
+}
+
+- (id)initWithBaseInterval:(NSTimeInterval)anInterval;
+
+//! The interval to wait after a poll that returned \p snapshot, which differed from the one before it by \p changes
+- (NSTimeInterval)intervalAfterSnapshot:(WOPlayerSnapshot *)snapshot changes:(WOPlayerChanges)changes;
+
+#pragma mark -
+#pragma mark Properties
+
+//! Clamped to WO_MIN_POLLING_INTERVAL and WO_MAX_POLLING_INTERVAL; setting it also ends any back-off
+@property(assign) NSTimeInterval baseInterval;
+@property(assign) BOOL playerSendsNotifications;
+
+@end
@@ -0,0 +1,94 @@
+// WOPlayerPollScheduler.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOPlayerPollScheduler.h"
+
+// other headers
+#import "WOSynergyGlobal.h"
+
+//! Mid-track polls are at most this many base intervals apart
+#define WO_MID_TRACK_POLLING_FACTOR         4.0
+
+//! Mid-track polls aim to land this many seconds before the expected end of the track...
+#define WO_TRACK_END_LEAD                   2.0
+
+//! ...and the last poll of a track this many seconds after it, by which time the player has moved on
+#define WO_TRACK_END_SLACK                  0.5
+
+//! Ceiling for the back-off while paused, stopped or not running
+#define WO_MAX_IDLE_POLLING_INTERVAL        120.0
+
+//! With a player that sends notifications there is almost nothing left to poll for
+#define WO_NOTIFYING_PLAYER_POLLING_INTERVAL (60.0 * 60.0 * 24.0 * 30.0)
+
+@implementation WOPlayerPollScheduler
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)init
+{
+    return [self initWithBaseInterval:WO_MAX_POLLING_INTERVAL];
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (id)initWithBaseInterval:(NSTimeInterval)anInterval
+{
+    if ((self = [super init]))
+        [self setBaseInterval:anInterval];
+    return self;
+}
+
+- (NSTimeInterval)intervalAfterSnapshot:(WOPlayerSnapshot *)snapshot changes:(WOPlayerChanges)changes
+{
+    if (playerSendsNotifications)
+        return WO_NOTIFYING_PLAYER_POLLING_INTERVAL;
+
+    if ([snapshot state] != WOPlayerPlaying)
+    {
+        // the first poll after a change comes at the base interval, then back off
+        if ((changes & ~WOPlayerChangedPosition) != WOPlayerChangedNothing)
+            idleInterval = baseInterval;
+        else
+            idleInterval = MIN(idleInterval * 2.0, WO_MAX_IDLE_POLLING_INTERVAL);
+        return idleInterval;
+    }
+
+    idleInterval = baseInterval;
+
+    // Internet radio and the like: no end to aim for
+    int duration = [snapshot durationInSeconds];
+    if (duration <= 0)
+        return baseInterval;
+
+    NSTimeInterval remaining = (NSTimeInterval)(duration - [snapshot position]);
+
+    // close enough to the end that the next poll should be the one that sees the new track
+    if (remaining - WO_TRACK_END_LEAD < baseInterval)
+        return MAX(remaining + WO_TRACK_END_SLACK, WO_MIN_POLLING_INTERVAL);
+
+    return MAX(MIN(remaining - WO_TRACK_END_LEAD, baseInterval * WO_MID_TRACK_POLLING_FACTOR), baseInterval);
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (NSTimeInterval)baseInterval
+{
+    return baseInterval;
+}
+
+- (void)setBaseInterval:(NSTimeInterval)anInterval
+{
+    baseInterval = MIN(MAX(anInterval, WO_MIN_POLLING_INTERVAL), WO_MAX_POLLING_INTERVAL);
+    idleInterval = baseInterval;
+}
+
+@synthesize playerSendsNotifications;
+
+@end
@@ -0,0 +1,70 @@
+//
+//  WOPlayerQueue.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+#import "WOPlayerBackend.h"
+
+//! Talks to a WOPlayerBackend on a private worker thread so that the main thread never waits for the player (iTunes can
+//! take seconds to answer an Apple Event when it is busy).
+//!
+//! Requests are served one at a time, in order, except that every queued command goes ahead of a snapshot. Snapshot
+//! requests that arrive while one is already waiting are answered by the same snapshot, so there is never more than one
+//! state query in the queue however often the timer fires. Commands are bounded by WO_PLAYER_QUEUE_CAPACITY; beyond that
+//! new ones are dropped rather than let a stalled player build up a backlog.
+//!
+//! Results come back on the main thread: snapshots as immutable WOPlayerSnapshot objects, command results as NSNumber
+//! objects (for int and BOOL return values), the object returned, or nil (for void, and when the backend raised an
+//! exception).
+//!
+//! The cheap process checks (isRunning, isFrontmost, launch, sendsNotifications) do not send Apple Events and can still be
+//! made directly to the backend from the main thread.
+//!
+//! The worker sends the backend prepare before anything else, so that whatever the backend builds up front is built off
+//! the main thread. It also times every request it serves; see statisticsDescription.
+//!
+//! \warn Threadsafe
+@interface WOPlayerQueue : NSObject {
+
+    id <WOPlayerBackend>    player;
+
+    //! Guards commands, snapshotRequests and latencies
+    NSCondition             *condition;
+
+    //! Commands waiting for the worker, oldest first
+    NSMutableArray          *commands;
+
+    //! Everyone waiting for the next snapshot; at most one entry per target and selector
+    NSMutableArray          *snapshotRequests;
+
+    //! WOPlayerLatency objects by command name ("snapshot" for snapshots)
+    NSMutableDictionary     *latencies;
+}
+
+- (id)initWithPlayer:(id <WOPlayerBackend>)aPlayer;
+
+//! Sends \p aSelector to \p aTarget on the main thread with the next snapshot taken as its argument
+- (void)requestSnapshotForTarget:(id)aTarget selector:(SEL)aSelector;
+
+//! Sends the backend message \p aCommand with \p arguments and, if \p aTarget is not nil, sends \p aSelector to it on the
+//! main thread with the result as its argument. Arguments that the backend method takes as int or BOOL are passed as
+//! NSNumber objects. Returns NO if the queue is full.
+- (BOOL)sendCommand:(SEL)aCommand arguments:(NSArray *)arguments target:(id)aTarget selector:(SEL)aSelector;
+
+//! Shorthand for a command without arguments whose result is not needed
+- (BOOL)sendCommand:(SEL)aCommand;
+
+//! One line per kind of request served so far, with how many there were and how long the backend took over them on
+//! average and at worst, followed by the backend's own statisticsDescription
+- (NSString *)statisticsDescription;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(readonly) id <WOPlayerBackend> player;
+
+@end
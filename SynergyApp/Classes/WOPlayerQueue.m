@@ -0,0 +1,312 @@
+// WOPlayerQueue.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOPlayerQueue.h"
+
+// system headers
+#import <objc/runtime.h>
+
+// other headers
+#import "WODebug.h"
+#import "WOPlayerSnapshot.h"
+
+//! Most commands that can be waiting at once; a stalled player with a user hammering a hot key should not queue up a
+//! minute's worth of volume changes
+#define WO_PLAYER_QUEUE_CAPACITY    16
+
+//! A command or a snapshot request, with whoever wants the result
+@interface WOPlayerRequest : NSObject {
+
+@public
+    //! nil for a snapshot request
+    NSInvocation    *invocation;
+
+    //! Kept here as well because the invocation's argument buffer is not scanned by the collector
+    NSArray         *arguments;
+
+    id              target;
+    SEL             selector;
+    id              result;
+}
+
+@end
+
+@implementation WOPlayerRequest
+
+@end
+
+//! How long the backend has taken over one kind of request
+@interface WOPlayerLatency : NSObject {
+
+@public
+    unsigned        count;
+    NSTimeInterval  total;
+    NSTimeInterval  longest;
+}
+
+@end
+
+@implementation WOPlayerLatency
+
+@end
+
+@interface WOPlayerQueue ()
+
+- (void)workerThread:(id)ignored;
+- (void)performCommand:(WOPlayerRequest *)request;
+- (void)deliverRequests:(NSArray *)requests;
+- (void)recordLatency:(NSTimeInterval)latency forRequestNamed:(NSString *)name;
+
+@end
+
+// skips the method type qualifiers (const, in, out, oneway and so on)
+static const char *WOPlayerQueueSkipQualifiers(const char *type)
+{
+    while (*type && strchr("rnNoORV", *type))
+        type++;
+    return type;
+}
+
+@implementation WOPlayerQueue
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)initWithPlayer:(id <WOPlayerBackend>)aPlayer
+{
+    NSParameterAssert(aPlayer != nil);
+    if ((self = [super init]))
+    {
+        player              = aPlayer;
+        condition           = [[NSCondition alloc] init];
+        commands            = [[NSMutableArray alloc] initWithCapacity:WO_PLAYER_QUEUE_CAPACITY];
+        snapshotRequests    = [[NSMutableArray alloc] init];
+        latencies           = [[NSMutableDictionary alloc] init];
+        [NSThread detachNewThreadSelector:@selector(workerThread:) toTarget:self withObject:nil];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (void)requestSnapshotForTarget:(id)aTarget selector:(SEL)aSelector
+{
+    NSParameterAssert(aTarget != nil);
+    [condition lock];
+    for (WOPlayerRequest *request in snapshotRequests)
+    {
+        if (request->target == aTarget && request->selector == aSelector)
+        {
+            // already waiting: the snapshot that answers it will do for both
+            [condition unlock];
+            return;
+        }
+    }
+    WOPlayerRequest *request = [[WOPlayerRequest alloc] init];
+    request->target     = aTarget;
+    request->selector   = aSelector;
+    [snapshotRequests addObject:request];
+    [condition signal];
+    [condition unlock];
+}
+
+- (BOOL)sendCommand:(SEL)aCommand arguments:(NSArray *)arguments target:(id)aTarget selector:(SEL)aSelector
+{
+    NSMethodSignature *signature = [(NSObject *)player methodSignatureForSelector:aCommand];
+    NSParameterAssert(signature != nil);
+    NSParameterAssert([signature numberOfArguments] == [arguments count] + 2);
+
+    // build the invocation here so that a bad argument shows up in the caller, not on the worker thread
+    NSInvocation *invocation = [NSInvocation invocationWithMethodSignature:signature];
+    [invocation setTarget:player];
+    [invocation setSelector:aCommand];
+    for (NSUInteger i = 0; i < [arguments count]; i++)
+    {
+        id          argument    = [arguments objectAtIndex:i];
+        const char  *type       = WOPlayerQueueSkipQualifiers([signature getArgumentTypeAtIndex:i + 2]);
+        if (*type == _C_ID)
+            [invocation setArgument:&argument atIndex:i + 2];
+        else if (*type == _C_CHR || *type == _C_UCHR || *type == _C_BOOL)
+        {
+            BOOL value = [argument boolValue];
+            [invocation setArgument:&value atIndex:i + 2];
+        }
+        else if (*type == _C_INT || *type == _C_UINT)
+        {
+            int value = [argument intValue];
+            [invocation setArgument:&value atIndex:i + 2];
+        }
+        else
+            [NSException raise:NSInvalidArgumentException
+                        format:@"%@ cannot pass an argument of type %s to %@",
+                               NSStringFromClass([self class]), type, NSStringFromSelector(aCommand)];
+    }
+
+    WOPlayerRequest *request = [[WOPlayerRequest alloc] init];
+    request->invocation = invocation;
+    request->arguments  = arguments;
+    request->target     = aTarget;
+    request->selector   = aSelector;
+
+    [condition lock];
+    if ([commands count] >= WO_PLAYER_QUEUE_CAPACITY)
+    {
+        [condition unlock];
+        ELOG(@"Player queue full; dropping %@", NSStringFromSelector(aCommand));
+        return NO;
+    }
+    [commands addObject:request];
+    [condition signal];
+    [condition unlock];
+    return YES;
+}
+
+- (BOOL)sendCommand:(SEL)aCommand
+{
+    return [self sendCommand:aCommand arguments:nil target:nil selector:NULL];
+}
+
+- (NSString *)statisticsDescription
+{
+    NSMutableString *description = [NSMutableString string];
+    [condition lock];
+    for (NSString *name in [[latencies allKeys] sortedArrayUsingSelector:@selector(compare:)])
+    {
+        WOPlayerLatency *latency = [latencies objectForKey:name];
+        [description appendFormat:@"%@: %u, mean %.1f ms, longest %.1f ms\n", name, latency->count,
+         latency->total * 1000.0 / latency->count, latency->longest * 1000.0];
+    }
+    [condition unlock];
+    NSString *backendDescription = [player statisticsDescription];
+    if (backendDescription)
+        [description appendString:backendDescription];
+    return description;
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// commands first, then one snapshot for everyone waiting for it
+- (void)workerThread:(id)ignored
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    [player prepare];
+    [pool drain];
+
+    while (YES)
+    {
+        pool = [[NSAutoreleasePool alloc] init];
+        [condition lock];
+        while ([commands count] == 0 && [snapshotRequests count] == 0)
+            [condition wait];
+        WOPlayerRequest *command = nil;
+        NSArray         *waiting = nil;
+        if ([commands count] > 0)
+        {
+            command = [commands objectAtIndex:0];
+            [commands removeObjectAtIndex:0];
+        }
+        else
+        {
+            // requests arriving from now on need a snapshot taken after this one
+            waiting = snapshotRequests;
+            snapshotRequests = [[NSMutableArray alloc] init];
+        }
+        [condition unlock];
+
+        if (command)
+            [self performCommand:command];
+        else
+        {
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            WOPlayerSnapshot *snapshot = [player snapshot];
+            [self recordLatency:[NSDate timeIntervalSinceReferenceDate] - start forRequestNamed:@"snapshot"];
+            for (WOPlayerRequest *request in waiting)
+                request->result = snapshot;
+            [self performSelectorOnMainThread:@selector(deliverRequests:) withObject:waiting waitUntilDone:NO];
+        }
+        [pool drain];
+    }
+}
+
+- (void)performCommand:(WOPlayerRequest *)request
+{
+    NSInvocation    *invocation = request->invocation;
+    NSString        *name       = NSStringFromSelector([invocation selector]);
+    NSTimeInterval  start       = [NSDate timeIntervalSinceReferenceDate];
+    @try
+    {
+        [invocation invoke];
+    }
+    @catch (id e)
+    {
+        // the target still hears back, with a nil result, so that it does not wait forever
+        ELOG(@"Exception caught while sending %@ to the player: %@", name, e);
+        if (request->target)
+            [self performSelectorOnMainThread:@selector(deliverRequests:)
+                                   withObject:[NSArray arrayWithObject:request]
+                                waitUntilDone:NO];
+        return;
+    }
+    [self recordLatency:[NSDate timeIntervalSinceReferenceDate] - start forRequestNamed:name];
+
+    if (!request->target)
+        return;
+
+    const char *type = WOPlayerQueueSkipQualifiers([[invocation methodSignature] methodReturnType]);
+    if (*type == _C_ID)
+    {
+        id value;
+        [invocation getReturnValue:&value];
+        request->result = value;
+    }
+    else if (*type == _C_CHR || *type == _C_UCHR || *type == _C_BOOL)
+    {
+        BOOL value;
+        [invocation getReturnValue:&value];
+        request->result = [NSNumber numberWithBool:value];
+    }
+    else if (*type == _C_INT || *type == _C_UINT)
+    {
+        int value;
+        [invocation getReturnValue:&value];
+        request->result = [NSNumber numberWithInt:value];
+    }
+    [self performSelectorOnMainThread:@selector(deliverRequests:)
+                           withObject:[NSArray arrayWithObject:request]
+                        waitUntilDone:NO];
+}
+
+- (void)deliverRequests:(NSArray *)requests
+{
+    for (WOPlayerRequest *request in requests)
+        [request->target performSelector:request->selector withObject:request->result];
+}
+
+// time spent in the backend only, not waiting in the queue
+- (void)recordLatency:(NSTimeInterval)latency forRequestNamed:(NSString *)name
+{
+    [condition lock];
+    WOPlayerLatency *entry = [latencies objectForKey:name];
+    if (!entry)
+    {
+        entry = [[WOPlayerLatency alloc] init];
+        [latencies setObject:entry forKey:name];
+    }
+    entry->count++;
+    entry->total += latency;
+    if (latency > entry->longest)
+        entry->longest = latency;
+    [condition unlock];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize player;
+
+@end
@@ -0,0 +1,124 @@
+//
+//  WOPlayerSnapshot.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+#import "WOPlayerBackend.h"
+
+//! Fields that differ between two snapshots (see changesSince:)
+typedef NSUInteger WOPlayerChanges;
+
+enum {
+
+    WOPlayerChangedNothing      = 0,
+    WOPlayerChangedState        = 1 << 0,
+    WOPlayerChangedTrack        = 1 << 1,   //!< trackKey
+    WOPlayerChangedTitle        = 1 << 2,
+    WOPlayerChangedAlbum        = 1 << 3,
+    WOPlayerChangedArtist       = 1 << 4,
+    WOPlayerChangedComposer     = 1 << 5,
+    WOPlayerChangedDuration     = 1 << 6,
+    WOPlayerChangedYear         = 1 << 7,
+    WOPlayerChangedRating       = 1 << 8,
+    WOPlayerChangedRepeatMode   = 1 << 9,
+    WOPlayerChangedShuffle      = 1 << 10,
+    WOPlayerChangedPosition     = 1 << 11,
+
+    //! What the tooltip, song info, artwork and recent tracks menu are built from
+    WOPlayerChangedTrackInfo    = WOPlayerChangedTrack | WOPlayerChangedTitle | WOPlayerChangedAlbum |
+                                  WOPlayerChangedArtist,
+
+    //! What the floater's strings are built from
+    WOPlayerChangedFloaterText  = WOPlayerChangedTrackInfo | WOPlayerChangedComposer | WOPlayerChangedDuration |
+                                  WOPlayerChangedYear,
+
+    WOPlayerChangedEverything   = (1 << 12) - 1
+};
+
+//! What a WOPlayerBackend reported at one moment. Immutable.
+//!
+//! The track fields are only meaningful in the playing and paused states; in the others the strings are empty and the
+//! identifier is nil. Missing tags (Internet radio, for example) come through as empty strings, never nil.
+//!
+//! \warn Threadsafe
+@interface WOPlayerSnapshot : NSObject {
+
+    WOPlayerState   state;
+
+    //! Opaque to everyone but the backend, which can be asked to play it again
+    id              trackIdentifier;
+
+    //! Equal for the same track and different for different tracks
+    NSString        *trackKey;
+
+    NSString        *title;
+    NSString        *album;
+    NSString        *artist;
+    NSString        *composer;
+
+    //! As the player shows it ("3:45")
+    NSString        *duration;
+
+    //! Empty if not set
+    NSString        *year;
+
+    //! 0 to 100
+    int             rating;
+
+    WORepeatMode    repeatMode;
+    WOShuffleState  shuffleState;
+
+    //! Seconds into the track
+    int             position;
+}
+
+//! A snapshot with no track, for the states other than playing and paused
++ (WOPlayerSnapshot *)snapshotWithState:(WOPlayerState)aState;
+
+//! Designated initializer
+- (id)initWithState:(WOPlayerState)aState
+    trackIdentifier:(id)anIdentifier
+           trackKey:(NSString *)aKey
+              title:(NSString *)aTitle
+              album:(NSString *)anAlbum
+             artist:(NSString *)anArtist
+           composer:(NSString *)aComposer
+           duration:(NSString *)aDuration
+               year:(NSString *)aYear
+             rating:(int)aRating
+         repeatMode:(WORepeatMode)aRepeatMode
+       shuffleState:(WOShuffleState)aShuffleState
+           position:(int)aPosition;
+
+//! YES in the playing and paused states
+- (BOOL)hasTrack;
+
+//! The duration in seconds, or -1 if there is none (Internet radio) or it cannot be read
+- (int)durationInSeconds;
+
+//! The fields in which the receiver differs from \p previous; WOPlayerChangedEverything if \p previous is nil.
+//! Cheap when both snapshots came from the same backend, which hands out the same string objects for unchanged fields.
+- (WOPlayerChanges)changesSince:(WOPlayerSnapshot *)previous;
+
+#pragma mark -
+#pragma mark Properties
+
+@property(readonly) WOPlayerState state;
+@property(readonly) id trackIdentifier;
+@property(readonly) NSString *trackKey;
+@property(readonly) NSString *title;
+@property(readonly) NSString *album;
+@property(readonly) NSString *artist;
+@property(readonly) NSString *composer;
+@property(readonly) NSString *duration;
+@property(readonly) NSString *year;
+@property(readonly) int rating;
+@property(readonly) WORepeatMode repeatMode;
+@property(readonly) WOShuffleState shuffleState;
+@property(readonly) int position;
+
+@end
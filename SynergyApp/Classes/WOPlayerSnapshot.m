@@ -0,0 +1,167 @@
+// WOPlayerSnapshot.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOPlayerSnapshot.h"
+
+//! Pointer comparison first: a backend reuses the previous string when a field has not changed
+#define WO_STRING_CHANGED(a, b) ((a) != (b) && ![(a) isEqualToString:(b)])
+
+@implementation WOPlayerSnapshot
+
++ (WOPlayerSnapshot *)snapshotWithState:(WOPlayerState)aState
+{
+    return [[self alloc] initWithState:aState
+                       trackIdentifier:nil
+                              trackKey:@""
+                                 title:@""
+                                 album:@""
+                                artist:@""
+                              composer:@""
+                              duration:@""
+                                  year:@""
+                                rating:0
+                            repeatMode:WORepeatUnknown
+                          shuffleState:WOShuffleUnknown
+                              position:0];
+}
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)init
+{
+    return [self initWithState:WOPlayerUnknown
+               trackIdentifier:nil
+                      trackKey:@""
+                         title:@""
+                         album:@""
+                        artist:@""
+                      composer:@""
+                      duration:@""
+                          year:@""
+                        rating:0
+                    repeatMode:WORepeatUnknown
+                  shuffleState:WOShuffleUnknown
+                      position:0];
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %p state=%d title=\"%@\" album=\"%@\" artist=\"%@\" position=%d>",
+            NSStringFromClass([self class]), self, state, title, album, artist, position];
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (id)initWithState:(WOPlayerState)aState
+    trackIdentifier:(id)anIdentifier
+           trackKey:(NSString *)aKey
+              title:(NSString *)aTitle
+              album:(NSString *)anAlbum
+             artist:(NSString *)anArtist
+           composer:(NSString *)aComposer
+           duration:(NSString *)aDuration
+               year:(NSString *)aYear
+             rating:(int)aRating
+         repeatMode:(WORepeatMode)aRepeatMode
+       shuffleState:(WOShuffleState)aShuffleState
+           position:(int)aPosition
+{
+    if ((self = [super init]))
+    {
+        state           = aState;
+        trackIdentifier = anIdentifier;
+        trackKey        = aKey      ? [aKey copy]       : @"";
+        title           = aTitle    ? [aTitle copy]     : @"";
+        album           = anAlbum   ? [anAlbum copy]    : @"";
+        artist          = anArtist  ? [anArtist copy]   : @"";
+        composer        = aComposer ? [aComposer copy]  : @"";
+        duration        = aDuration ? [aDuration copy]  : @"";
+        year            = aYear     ? [aYear copy]      : @"";
+        rating          = aRating;
+        repeatMode      = aRepeatMode;
+        shuffleState    = aShuffleState;
+        position        = aPosition;
+    }
+    return self;
+}
+
+- (BOOL)hasTrack
+{
+    return (state == WOPlayerPlaying || state == WOPlayerPaused);
+}
+
+// the duration comes as "m:ss" or "h:mm:ss"
+- (int)durationInSeconds
+{
+    if ([duration length] == 0)
+        return -1;
+    int seconds = 0;
+    for (NSString *component in [duration componentsSeparatedByString:@":"])
+    {
+        NSScanner *scanner = [NSScanner scannerWithString:component];
+        int value;
+        if (![scanner scanInt:&value] || ![scanner isAtEnd] || value < 0)
+            return -1;
+        seconds = seconds * 60 + value;
+    }
+    return seconds;
+}
+
+- (WOPlayerChanges)changesSince:(WOPlayerSnapshot *)previous
+{
+    if (!previous)
+        return WOPlayerChangedEverything;
+    if (previous == self)
+        return WOPlayerChangedNothing;
+
+    WOPlayerChanges changes = WOPlayerChangedNothing;
+    if (state != previous->state)
+        changes |= WOPlayerChangedState;
+    if (WO_STRING_CHANGED(trackKey, previous->trackKey))
+        changes |= WOPlayerChangedTrack;
+    if (WO_STRING_CHANGED(title, previous->title))
+        changes |= WOPlayerChangedTitle;
+    if (WO_STRING_CHANGED(album, previous->album))
+        changes |= WOPlayerChangedAlbum;
+    if (WO_STRING_CHANGED(artist, previous->artist))
+        changes |= WOPlayerChangedArtist;
+    if (WO_STRING_CHANGED(composer, previous->composer))
+        changes |= WOPlayerChangedComposer;
+    if (WO_STRING_CHANGED(duration, previous->duration))
+        changes |= WOPlayerChangedDuration;
+    if (WO_STRING_CHANGED(year, previous->year))
+        changes |= WOPlayerChangedYear;
+    if (rating != previous->rating)
+        changes |= WOPlayerChangedRating;
+    if (repeatMode != previous->repeatMode)
+        changes |= WOPlayerChangedRepeatMode;
+    if (shuffleState != previous->shuffleState)
+        changes |= WOPlayerChangedShuffle;
+    if (position != previous->position)
+        changes |= WOPlayerChangedPosition;
+    return changes;
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize state;
+@synthesize trackIdentifier;
+@synthesize trackKey;
+@synthesize title;
+@synthesize album;
+@synthesize artist;
+@synthesize composer;
+@synthesize duration;
+@synthesize year;
+@synthesize rating;
+@synthesize repeatMode;
+@synthesize shuffleState;
+@synthesize position;
+
+@end
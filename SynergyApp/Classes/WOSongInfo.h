@@ -17,7 +17,9 @@
     NSString  *artist;
     NSString  *album;
     NSString  *song;
-    NSString  *filename;
+
+    // key of the album cover in WOCoverStore (0 until first computed)
+    uint64_t  coverKey;
 
     // simple state flag to indicate whether a download thread has been
     // spawned or not (YES = thread active, NO = no thread active)
@@ -53,8 +55,7 @@
 - (void)setAlbum:(NSString *)newAlbum;
 - (NSString *)song;
 - (void)setSong:(NSString *)newSong;
-- (NSString *)filename;
-- (void)setFilename:(NSString *)newFilename;
+- (uint64_t)coverKey;
 - (BOOL)downloadThreadSpawned;
 - (void)setDownloadThreadSpawned:(BOOL)newDownloadThreadSpawned;
 - (BOOL)attemptedDownload;
@@ -6,6 +6,7 @@
 //  Copyright 2003-present Greg Hurrell.
 
 #import "WOSongInfo.h"
+#import "WOCoverStore.h"
 #import "WODebug.h"
 
 @interface WOSongInfo (_private)
@@ -34,7 +35,6 @@
         [self setArtist:nil];
         [self setAlbum:nil];
         [self setSong:nil];
-        [self setFilename:nil];
         [self setDownloadThreadSpawned:NO];
         [self setAttemptedDownload:NO];
         [self setReadyToRetry:NO];
@@ -141,6 +141,7 @@
 - (void)setArtist:(NSString *)newArtist
 {
     artist = [newArtist copy];
+    coverKey = 0;
 }
 
 - (NSString *)album
@@ -151,6 +152,7 @@
 - (void)setAlbum:(NSString *)newAlbum
 {
     album = [newAlbum copy];
+    coverKey = 0;
 }
 
 - (NSString *)song
@@ -161,71 +163,18 @@
 - (void)setSong:(NSString *)newSong
 {
     song = [newSong copy];
+    coverKey = 0;
 }
 
-- (NSString *)filename
+- (uint64_t)coverKey
 {
-    // complex accessor: if filename not initialised, construct it from
-    // artist + album
-    if (!filename)
-    {
-        // but only do this if we have artist and/or album and/or song
-
-        NSString *artistString  = [self artist];
-        NSString *albumString   = [self album];
-        NSString *songString    = [self song];
-
-        NSString *generatedFilename;
-
-        // will mimic the "try" order of WOCoverDownloader's
-        // _searchForAlbumCover method
-
-        if (albumString && (![albumString isEqualToString:@""]) &&
-            artistString && (![artistString isEqualToString:@""]))
-            generatedFilename = [NSString stringWithFormat:@"Artist-%@,Album-%@", artistString, albumString];
-        else if (songString && (![songString isEqualToString:@""]) &&
-                 artistString && (![artistString isEqualToString:@""]))
-            generatedFilename = [NSString stringWithFormat:@"Artist-%@,Song-%@", artistString, songString];
-        else if (albumString && (![albumString isEqualToString:@""]))
-            generatedFilename = [NSString stringWithFormat:@"Album-%@", albumString];
-        else if (songString && (![songString isEqualToString:@""]))
-            generatedFilename = [NSString stringWithFormat:@"Song-%@", songString];
-        else
-            // not enough info to construct filename, return nil
-            generatedFilename = nil;
-
-        // if we have a filename, make strip out "unsafe" chars
-        if (generatedFilename)
-        {
-            NSMutableCharacterSet *unsafeChars = [[NSCharacterSet whitespaceAndNewlineCharacterSet] mutableCopy];
-            [unsafeChars addCharactersInString:@":/"];
-            NSMutableString *scratch = [NSMutableString string];
-            NSScanner *scanner = [NSScanner scannerWithString:generatedFilename];
-            NSString *result;
-            while (![scanner isAtEnd])
-            {
-                if ([scanner scanUpToCharactersFromSet:unsafeChars intoString:&result])
-                    // found a segment without any unsafe chars, append it
-                    [scratch appendString:result];
-
-                // now skip over unsafe chars
-                [scanner scanCharactersFromSet:unsafeChars intoString:nil];
-            }
-            // check to see if any characters left in string after stripping
-            if (![scratch isEqualToString:@""])
-                filename = [scratch stringByAppendingPathExtension:@"jpg"];
-            else
-                filename = nil;
-        }
-        else
-            filename = nil;
-    }
-    return filename;
-}
-
-- (void)setFilename:(NSString *)newFilename
-{
-    filename = [newFilename copy];
+    // complex accessor: computed from artist + album (or song) on first use;
+    // stays 0 if there is not enough information to identify a cover
+    if (!coverKey)
+        coverKey = [WOCoverStore keyForArtist:[self artist]
+                                        album:[self album]
+                                         song:[self song]];
+    return coverKey;
 }
 
 - (BOOL)downloadThreadSpawned
@@ -253,6 +253,10 @@ typedef enum WOScreenSegmentYCoordinate {
 
 // tell floater path to downloaded image
 - (void)setAlbumImagePath:(NSString *)path;
+
+// as above, along with pre-scaled copies of the image keyed by their longest side in pixels
+- (void)setAlbumImagePath:(NSString *)path variantPaths:(NSDictionary *)variantPaths;
+
 - (NSString *)albumImagePath;
 
 - (NSImage *)coverImage;
@@ -912,9 +912,14 @@
 
 // tell floater path to downloaded image
 - (void)setAlbumImagePath:(NSString *)path
+{
+    [self setAlbumImagePath:path variantPaths:nil];
+}
+
+- (void)setAlbumImagePath:(NSString *)path variantPaths:(NSDictionary *)variantPaths
 {
     // forward to floater
-    [floaterView setAlbumImagePath:path];
+    [floaterView setAlbumImagePath:path variantPaths:variantPaths];
 }
 
 - (NSString *)albumImagePath;
@@ -131,6 +131,9 @@ typedef enum WORatingCode {
     // private vars for album cover
     NSImage                 *albumImage;      // the actual image
     NSSize                  albumImageSize;   // size
+    NSDictionary            *albumImageVariantPaths;    // pre-scaled copies keyed by longest side
+    NSString                *albumImageLoadedPath;      // file albumImage was loaded from
+    float                   albumImageSide;             // side albumImage was chosen for
 }
 
 
@@ -182,6 +185,10 @@ typedef enum WORatingCode {
 // tell floater path to downloaded image
 @property(copy) NSString            *albumImagePath;
 
+// as above, along with pre-scaled copies of the image keyed by their longest side in pixels; the floater draws from the
+// smallest copy that is at least as large as the cover it displays
+- (void)setAlbumImagePath:(NSString *)path variantPaths:(NSDictionary *)variantPaths;
+
 // returns nil if there is no cover image in the floater
 @property(copy) NSImage             *albumImage;
 
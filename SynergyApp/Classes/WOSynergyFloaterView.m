@@ -4,10 +4,17 @@
 #import "WOSynergyFloaterView.h"
 
 #import "WOSynergyGlobal.h"
+#import "WOCoverImageCache.h"
 
 // Cocoa reports that text is higher than it really is
 #define WO_COCOA_TEXT_BUG_FACTOR  (1.15)
 
+@interface WOSynergyFloaterView ()
+
+- (void)loadAlbumImageFittingSize:(float)side;
+
+@end
+
 @implementation WOSynergyFloaterView
 
 NSSize originalSynergyImageSize;
@@ -26,6 +33,7 @@ NSSize originalSynergyImageSize;
             [bundle pathForResource:@"NoCoverArt" ofType:@"png"]];
 
         albumImage = nil;
+        albumImageSide = 128.0;
 
         // initialise this global for later use when drawing the icon (helps us
         // decide whether we need to resize or not)
@@ -179,14 +187,15 @@ NSSize originalSynergyImageSize;
 {
     if (albumImage)
     {
-        NSSize currentAlbumSize = [albumImage size];
-
         // desired height/width is related to corner radius
         // by the time this routine is called, [self bounds].size should already
         // return the correct size
         float desiredHeightWidth =
             floor([self bounds].size.height - (cornerRadius * 2));
 
+        [self loadAlbumImageFittingSize:desiredHeightWidth];
+        NSSize currentAlbumSize = [albumImage size];
+
         NSSize desiredSize;
 
         // handle non-square album art: longest side will be desiredHeightWidth
@@ -225,8 +234,6 @@ NSSize originalSynergyImageSize;
     // with albums we scale all the way up to 128 pixels
     if (albumImage && (floaterIconType == WOFloaterIconAlbumCover))
     {
-        NSSize currentAlbumSize = [albumImage size];
-
         // desired height/width is related to corner radius
         // by the time this routine is called, [self bounds].size should already
         // return the correct size
@@ -243,6 +250,9 @@ NSSize originalSynergyImageSize;
             floor([self bounds].size.height - (cornerRadius * 2));
         }
 
+        [self loadAlbumImageFittingSize:desiredHeightWidth];
+        NSSize currentAlbumSize = [albumImage size];
+
         NSSize desiredSize;
 
         // handle non-square album art: longest side will be desiredHeightWidth
@@ -1136,43 +1146,90 @@ NSSize originalSynergyImageSize;
 
 // tell floater path to downloaded image
 - (void)setAlbumImagePath:(NSString *)path
+{
+    [self setAlbumImagePath:path variantPaths:nil];
+}
+
+- (void)setAlbumImagePath:(NSString *)path variantPaths:(NSDictionary *)variantPaths
 {
     // quite possible that we'll be "re-setting" this value using the same
     // string, so do the equality check here to spare us unecessary cycles
-    if (albumImagePath != path)
+    if (albumImagePath == path &&
+        (albumImageVariantPaths == variantPaths || [albumImageVariantPaths isEqual:variantPaths]))
+        return;
+
+    // set new value
+    albumImagePath          = path;
+    albumImageVariantPaths  = [variantPaths copy];
+    albumImageLoadedPath    = nil;
+
+    // load the image into appropriate ivar
+    if (albumImagePath == nil)
     {
-        // set new value
-        albumImagePath = path;
+        albumImage  = nil;
+        return;
+    }
 
-        // load the image into appropriate ivar
-        if (albumImagePath == nil)
-            albumImage  = nil;
-        else
+    // paths that come with variants are straight from the cover store and known to exist; otherwise try with jpg
+    // (presumably) first
+    if (!variantPaths && ![[NSFileManager defaultManager] fileExistsAtPath:albumImagePath])
+    {
+        NSString *tiffString = [[albumImagePath stringByDeletingPathExtension] stringByAppendingPathExtension:@"tiff"];
+        if (![[NSFileManager defaultManager] fileExistsAtPath:tiffString])
         {
-            // try with jpg (presumably) first
-            if ([[NSFileManager defaultManager] fileExistsAtPath:albumImagePath])
-                albumImage = [[NSImage alloc] initByReferencingFile:albumImagePath];
-            else
-            {
-                NSString *tiffString = [[albumImagePath stringByDeletingPathExtension] stringByAppendingPathExtension:@"tiff"];
-                if ([[NSFileManager defaultManager] fileExistsAtPath:tiffString])
-                {
-                    albumImage = [[NSImage alloc] initByReferencingFile:tiffString];
-
-                    if ([albumImage isValid])
-                        albumImagePath = [tiffString copy];
-                }
-            }
+            albumImage = nil;
+            return;
+        }
+        albumImagePath = [tiffString copy];
+    }
 
-            if ([albumImage isValid])
-            {
-                albumImageSize = [albumImage size];
-                [albumImage setScalesWhenResized:YES];
-            }
-            else
-                albumImage = nil;
+    // until the next resize, assume the cover will be drawn at the size the last one was
+    [self loadAlbumImageFittingSize:albumImageSide];
+}
+
+// loads the smallest pre-scaled copy of the cover whose longest side is at least side pixels (or the full-size image if
+// there is none), so that drawing never decodes or scales down more pixels than it needs; does nothing if that file is
+// already loaded
+- (void)loadAlbumImageFittingSize:(float)side
+{
+    albumImageSide = side;
+    if (!albumImagePath)
+        return;
+
+    NSString *path = albumImagePath;
+    unsigned best = UINT_MAX;
+    for (NSNumber *size in albumImageVariantPaths)
+    {
+        unsigned variantSide = [size unsignedIntValue];
+        if (variantSide >= side && variantSide < best)
+        {
+            best = variantSide;
+            path = [albumImageVariantPaths objectForKey:size];
         }
     }
+
+    if ([path isEqualToString:albumImageLoadedPath])
+        return;
+
+    // shared with every other consumer of covers, so that going back to a recent cover doesn't touch the disk
+    WOCoverImageCache *cache = [WOCoverImageCache sharedCache];
+    NSImage *image = [cache imageWithContentsOfFile:path];
+    if (!image && path != albumImagePath)
+    {
+        // variant has gone missing: fall back to the original
+        path    = albumImagePath;
+        image   = [cache imageWithContentsOfFile:path];
+    }
+    albumImageLoadedPath = path;
+
+    if (image)
+    {
+        albumImageSize = [image size];
+        [image setScalesWhenResized:YES];
+        albumImage = image;
+    }
+    else
+        albumImage = nil;
 }
 
 @synthesize albumImagePath;
@@ -0,0 +1,13 @@
+//
+//  WOAudioscrobblerLog.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+//! Logs to the console if and only if the LogAudioscrobblerEvents user default (in org.wincent.Synergy) is true.
+//! Foundation-only, so that the engine and the play log can use it without pulling in AppKit; shared by the app and the
+//! pref pane.
+void WOAudioscrobblerLog(NSString *format, ...);
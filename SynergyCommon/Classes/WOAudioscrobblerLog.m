@@ -0,0 +1,21 @@
+// WOAudioscrobblerLog.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOAudioscrobblerLog.h"
+
+void WOAudioscrobblerLog(NSString *format, ...)
+{
+    if (!format) return;
+    Boolean valid;
+    // BUG: yes, hard-coding the bundle identifier here is evil, but necessary because this code can be called from the pref pane
+    if (CFPreferencesGetAppBooleanValue(CFSTR("LogAudioscrobblerEvents"), CFSTR("org.wincent.Synergy"), &valid) && valid)
+    {
+        va_list args;
+        va_start(args, format);
+        NSLog(@"Audioscrobbler: %@", [[NSString alloc] initWithFormat:format arguments:args]);
+        va_end(args);
+    }
+}
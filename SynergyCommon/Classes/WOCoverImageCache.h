@@ -0,0 +1,71 @@
+//
+//  WOCoverImageCache.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 17 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+
+@class NSImage, WOCoverImageCacheEntry;
+
+//! Process-wide cache of decoded album cover images, shared by the floater, the cover downloader and anything else that
+//! displays a cover.
+//!
+//! Entries are keyed by path. The cover store names every image after its cover key (and every pre-scaled variant after
+//! the key and its size), so a path stands for exactly one cover variant. Each entry holds a fully decoded bitmap and is
+//! charged against a byte budget at the size of its pixel buffer; whenever the cache goes over budget the least recently
+//! used entries are evicted. Flipping back and forth between covers that are already cached reads nothing from disk and
+//! decodes nothing.
+//!
+//! Every caller gets a new NSImage wrapping the shared (immutable) bitmap, so resizing it, as the floater does, is not
+//! seen by anybody else.
+//!
+//! \warn Threadsafe
+@interface WOCoverImageCache : NSObject {
+
+    //! WOCoverImageCacheEntry objects keyed by path
+    NSMutableDictionary     *entries;
+
+    //! Recency list, most recently used first
+    WOCoverImageCacheEntry  *newest;
+    WOCoverImageCacheEntry  *oldest;
+
+    NSUInteger              byteBudget;
+    NSUInteger              bytesUsed;
+    unsigned long long      hits;
+    unsigned long long      misses;
+
+    //! Guards everything above
+    NSLock                  *lock;
+}
+
+//! The cache used by every consumer in the process; its budget comes from the "CoverImageCacheBytes" default if set
++ (WOCoverImageCache *)sharedCache;
+
+- (id)initWithByteBudget:(NSUInteger)aBudget;
+
+//! Returns a new image backed by the cached bitmap for \p path, reading and decoding the file (and caching the result)
+//! only if it is not already cached; returns nil if the file can't be read
+- (NSImage *)imageWithContentsOfFile:(NSString *)path;
+
+//! Forgets \p path; must be called whenever the file is rewritten or deleted
+- (void)removeImageForPath:(NSString *)path;
+
+- (void)removeAllImages;
+
+#pragma mark -
+#pragma mark Properties
+
+//! Setting a smaller budget evicts immediately
+@property NSUInteger byteBudget;
+
+@property(readonly) NSUInteger bytesUsed;
+
+//! Lookups answered from memory
+@property(readonly) unsigned long long hits;
+
+//! Lookups that had to go to disk
+@property(readonly) unsigned long long misses;
+
+@end
@@ -0,0 +1,272 @@
+// WOCoverImageCache.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOCoverImageCache.h"
+
+// system headers
+#import <Cocoa/Cocoa.h>
+
+//! Budget used unless the "CoverImageCacheBytes" default says otherwise: a dozen or so full-size covers, or a couple of
+//! hundred 128-pixel variants
+#define WO_COVER_IMAGE_CACHE_BUDGET     ((NSUInteger)(8 * 1024 * 1024))
+
+@interface WOCoverImageCacheEntry : NSObject {
+
+@public
+    NSString                *path;
+    CGImageRef              image;      // fully decoded
+    NSUInteger              cost;       // bytes in image's pixel buffer
+    WOCoverImageCacheEntry  *newer;
+    WOCoverImageCacheEntry  *older;
+}
+
+@end
+
+@implementation WOCoverImageCacheEntry
+
+- (void)finalize
+{
+    CGImageRelease(image);
+    [super finalize];
+}
+
+@end
+
+// decodes the image at path into a bitmap owned by the returned image, so that nothing is left to decompress at draw time
+static CGImageRef WOCoverCreateDecodedImage(NSString *path)
+{
+    CGImageSourceRef source = CGImageSourceCreateWithURL((CFURLRef)[NSURL fileURLWithPath:path], NULL);
+    if (!source)
+        return NULL;
+    CGImageRef image = CGImageSourceCreateImageAtIndex(source, 0, NULL);
+    CFRelease(source);
+    if (!image)
+        return NULL;
+    size_t width = CGImageGetWidth(image);
+    size_t height = CGImageGetHeight(image);
+    CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, space,
+                                                 kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host);
+    CGColorSpaceRelease(space);
+    CGImageRef decoded = NULL;
+    if (context)
+    {
+        CGContextDrawImage(context, CGRectMake(0, 0, width, height), image);
+        decoded = CGBitmapContextCreateImage(context);
+        CGContextRelease(context);
+    }
+    CGImageRelease(image);
+    return decoded;
+}
+
+static WOCoverImageCache *WOSharedCoverImageCache = nil;
+
+@interface WOCoverImageCache ()
+
+- (void)unlinkEntry:(WOCoverImageCacheEntry *)entry;
+- (void)linkEntryAsNewest:(WOCoverImageCacheEntry *)entry;
+- (void)removeEntry:(WOCoverImageCacheEntry *)entry;
+- (void)evictToBudget;
+
+@end
+
+@implementation WOCoverImageCache
+
++ (WOCoverImageCache *)sharedCache
+{
+    @synchronized ([WOCoverImageCache class])
+    {
+        if (!WOSharedCoverImageCache)
+        {
+            NSUInteger budget = WO_COVER_IMAGE_CACHE_BUDGET;
+            NSNumber *bytes = NSMakeCollectable(CFPreferencesCopyAppValue(CFSTR("CoverImageCacheBytes"),
+                                                                          CFSTR("org.wincent.Synergy")));
+            if ([bytes isKindOfClass:[NSNumber class]] && [bytes integerValue] >= 0)
+                budget = [bytes unsignedIntegerValue];
+            WOSharedCoverImageCache = [[WOCoverImageCache alloc] initWithByteBudget:budget];
+        }
+    }
+    return WOSharedCoverImageCache;
+}
+
+#pragma mark -
+#pragma mark NSObject overrides
+
+- (id)init
+{
+    return [self initWithByteBudget:WO_COVER_IMAGE_CACHE_BUDGET];
+}
+
+- (id)initWithByteBudget:(NSUInteger)aBudget
+{
+    if ((self = [super init]))
+    {
+        entries     = [NSMutableDictionary dictionary];
+        byteBudget  = aBudget;
+        lock        = [[NSLock alloc] init];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (NSImage *)imageWithContentsOfFile:(NSString *)path
+{
+    if (!path)
+        return nil;
+    [lock lock];
+    WOCoverImageCacheEntry *entry = [entries objectForKey:path];
+    CGImageRef image = NULL;
+    if (entry)
+    {
+        hits++;
+        image = CGImageRetain(entry->image);
+        [self unlinkEntry:entry];
+        [self linkEntryAsNewest:entry];
+    }
+    else
+        misses++;
+    [lock unlock];
+
+    if (!image)
+    {
+        // decode outside the lock; if two threads miss on the same path at once both decode it and the later one wins
+        if (!(image = WOCoverCreateDecodedImage(path)))
+            return nil;
+        entry           = [[WOCoverImageCacheEntry alloc] init];
+        entry->path     = [path copy];
+        entry->image    = CGImageRetain(image);
+        entry->cost     = CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+        [lock lock];
+        WOCoverImageCacheEntry *existing = [entries objectForKey:path];
+        if (existing)
+            [self removeEntry:existing];
+        [entries setObject:entry forKey:entry->path];
+        [self linkEntryAsNewest:entry];
+        bytesUsed += entry->cost;
+        [self evictToBudget];
+        [lock unlock];
+    }
+
+    // a fresh rep per caller: NSImage may resize its reps, and the bitmap underneath is never copied
+    NSBitmapImageRep *rep = [[NSBitmapImageRep alloc] initWithCGImage:image];
+    CGImageRelease(image);
+    NSImage *result = [[NSImage alloc] initWithSize:[rep size]];
+    [result addRepresentation:rep];
+    return result;
+}
+
+- (void)removeImageForPath:(NSString *)path
+{
+    if (!path)
+        return;
+    [lock lock];
+    WOCoverImageCacheEntry *entry = [entries objectForKey:path];
+    if (entry)
+        [self removeEntry:entry];
+    [lock unlock];
+}
+
+- (void)removeAllImages
+{
+    [lock lock];
+    [entries removeAllObjects];
+    newest      = nil;
+    oldest      = nil;
+    bytesUsed   = 0;
+    [lock unlock];
+}
+
+#pragma mark -
+#pragma mark Private methods
+
+// caller holds lock
+- (void)unlinkEntry:(WOCoverImageCacheEntry *)entry
+{
+    if (entry->newer)
+        entry->newer->older = entry->older;
+    else
+        newest = entry->older;
+    if (entry->older)
+        entry->older->newer = entry->newer;
+    else
+        oldest = entry->newer;
+    entry->newer = nil;
+    entry->older = nil;
+}
+
+// caller holds lock
+- (void)linkEntryAsNewest:(WOCoverImageCacheEntry *)entry
+{
+    entry->older = newest;
+    entry->newer = nil;
+    if (newest)
+        newest->newer = entry;
+    newest = entry;
+    if (!oldest)
+        oldest = entry;
+}
+
+// caller holds lock
+- (void)removeEntry:(WOCoverImageCacheEntry *)entry
+{
+    [self unlinkEntry:entry];
+    bytesUsed -= entry->cost;
+    [entries removeObjectForKey:entry->path];
+}
+
+// caller holds lock
+- (void)evictToBudget
+{
+    while (bytesUsed > byteBudget && oldest)
+        [self removeEntry:oldest];
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (NSUInteger)byteBudget
+{
+    [lock lock];
+    NSUInteger budget = byteBudget;
+    [lock unlock];
+    return budget;
+}
+
+- (void)setByteBudget:(NSUInteger)aBudget
+{
+    [lock lock];
+    byteBudget = aBudget;
+    [self evictToBudget];
+    [lock unlock];
+}
+
+- (NSUInteger)bytesUsed
+{
+    [lock lock];
+    NSUInteger used = bytesUsed;
+    [lock unlock];
+    return used;
+}
+
+- (unsigned long long)hits
+{
+    [lock lock];
+    unsigned long long count = hits;
+    [lock unlock];
+    return count;
+}
+
+- (unsigned long long)misses
+{
+    [lock lock];
+    unsigned long long count = misses;
+    [lock unlock];
+    return count;
+}
+
+@end
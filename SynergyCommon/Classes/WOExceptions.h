@@ -11,6 +11,12 @@
 #define WO_DOWNLOAD_ALBUM_COVER_IMAGE_FAILURE_TEXT  \
 @"Error occurred while attempting to download album cover image"
 
+#define WO_STORE_ALBUM_COVER_IMAGE_FAILURE \
+@"StoreAlbumCoverImageFailure"
+
+#define WO_STORE_ALBUM_COVER_IMAGE_FAILURE_TEXT \
+@"Error occurred while attempting to save downloaded album cover image"
+
 #define WO_ALBUM_COVER_FOLDER \
 @"AlbumCoverCreationLocationError"
 
@@ -7,6 +7,8 @@
 
 #import <Cocoa/Cocoa.h>
 
+#import "WOAudioscrobblerLog.h"
+
 //! URL visited when user clicks help button
 #define WO_AUDIOSCROBBLER_HELP_URL  @"http://www.last.fm/"
 
@@ -18,6 +20,9 @@
 
 #define WO_STORE_AUDIOSCROBBLER_PASSWORD_IN_KEYCHAIN    @"StoreAudioscrobblerPasswordInKeychain"
 
+//! Hidden preference: array of handshake URLs of protocol-compatible servers that receive a copy of every play
+#define WO_AUDIOSCROBBLER_MIRRORS                       @"AudioscrobblerMirrors"
+
 //! \endgroup
 
 //! \name Sheet info keys
@@ -31,12 +36,6 @@
 
 //! \endgroup
 
-#pragma mark -
-#pragma mark Functions
-
-//! Logs to the console if and only if the LogAudioscrobblerEvents user default (in org.wincent.Synergy) is true
-void WOAudioscrobblerLog(NSString *format, ...);
-
 //! Simple controller class ("File's Owner") for audioscrobbler.nib
 @interface WOAudioscrobblerController : NSObject {
 
@@ -22,23 +22,6 @@
 
 #define WO_AUDIOSCROBBLER_SERVICE_NAME "Audioscrobbler"
 
-#pragma mark -
-#pragma mark Functions
-
-void WOAudioscrobblerLog(NSString *format, ...)
-{
-    if (!format) return;
-    Boolean valid;
-    // BUG: yes, hard-coding the bundle identifier here is evil, but necessary because this code can be called from the pref pane
-    if (CFPreferencesGetAppBooleanValue(CFSTR("LogAudioscrobblerEvents"), CFSTR("org.wincent.Synergy"), &valid) && valid)
-    {
-        va_list args;
-        va_start(args, format);
-        NSLog(@"Audioscrobbler: %@", [[NSString alloc] initWithFormat:format arguments:args]);
-        va_end(args);
-    }
-}
-
 @interface WOAudioscrobblerController (WOPrivate)
 
 - (void)handleKeychainEvent:(SecKeychainEvent)keychainEvent info:(SecKeychainCallbackInfo *)info;
@@ -0,0 +1,316 @@
+// WOAudioscrobblerEngineTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Drives WOAudioscrobblerEngine on a WOSimulatedClock with a scripted transport and checks when its requests go out:
+// that the latest INTERVAL is a floor under every delay, that consecutive failures back off from one minute to the
+// two-hour cap, and that after three catastrophic failures handshakes are at least 30 minutes apart. Hours of simulated
+// time run in milliseconds, and with a fixed jitter seed every run is the same.
+
+// system headers
+#import <Foundation/Foundation.h>
+
+// other headers
+#import "WOAudioscrobblerEngine.h"
+#import "WOAudioscrobblerScheduler.h"
+#import "WOSimulatedClock.h"
+#import "WOTestExpect.h"
+
+//! Arbitrary starting point for the simulated clock, on a whole second
+#define WO_TEST_START_TIME          800000000.0
+
+#define WO_TEST_JITTER_SEED         42
+
+#define WO_TEST_HANDSHAKE_REPLY     @"UPTODATE\nchallenge\nhttp://post.example.com/submit\nINTERVAL 1\n"
+
+//! Must match the engine's back-off constants
+#define WO_TEST_RETRY_BASE_DELAY    60.0
+#define WO_TEST_RETRY_MAX_DELAY     (60.0 * 120)
+
+//! Must match the engine's WO_HANDSHAKE_DELAY_ON_FAILURES
+#define WO_TEST_HANDSHAKE_FLOOR     (60.0 * 30)
+
+//! Slack for the scheduler rounding every deadline up to a whole second
+#define WO_TEST_ROUNDING            1.0
+
+//! Number of consecutive failed submissions in the back-off test; enough to sit at the cap for a while
+#define WO_TEST_FAILURE_COUNT       12
+
+//! Records each request the engine starts and answers it, on the same simulated clock, with the next scripted reply:
+//! an NSString is delivered as the response body and an NSError as a failure to connect.
+@interface WOScriptedTransport : NSObject <WOAudioscrobblerTransport> {
+
+@public
+    WOSimulatedClock        *clock;
+    WOAudioscrobblerEngine  *engine;
+
+    //! Replies still to be delivered, in order
+    NSMutableArray          *replies;
+
+    //! Delivered once replies has run out
+    id                      repeatingReply;
+
+    //! Start time of every request, in order
+    NSMutableArray          *requestTimes;
+
+    //! One NSNumber BOOL per request: YES for submissions (POST), NO for handshakes (GET)
+    NSMutableArray          *requestIsPost;
+}
+
+- (id)initWithClock:(WOSimulatedClock *)aClock;
+
+@end
+
+@implementation WOScriptedTransport
+
+- (id)initWithClock:(WOSimulatedClock *)aClock
+{
+    if ((self = [super init]))
+    {
+        self->clock         = aClock;
+        self->replies       = [NSMutableArray array];
+        self->requestTimes  = [NSMutableArray array];
+        self->requestIsPost = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)startRequestWithURL:(NSURL *)aURL body:(NSData *)aData isPost:(BOOL)post forEngine:(WOAudioscrobblerEngine *)anEngine
+{
+    [requestTimes addObject:[NSNumber numberWithDouble:clock.now]];
+    [requestIsPost addObject:[NSNumber numberWithBool:post]];
+
+    // the reply arrives after the engine has noted that it is waiting for one, as it would over a real connection
+    [clock scheduleSelector:@selector(deliverReply:) target:self afterDelay:0.0];
+    return YES;
+}
+
+- (void)cancelRequestForEngine:(WOAudioscrobblerEngine *)anEngine
+{
+    [clock cancelScheduledSelectorsForTarget:self];
+}
+
+- (void)deliverReply:(id)ignored
+{
+    id reply = repeatingReply;
+    if ([replies count] > 0)
+    {
+        reply = [replies objectAtIndex:0];
+        [replies removeObjectAtIndex:0];
+    }
+    if ([reply isKindOfClass:[NSError class]])
+        [engine transportDidFailWithError:reply];
+    else
+    {
+        [engine transportDidReceiveResponse];
+        [engine transportDidReceiveData:[reply dataUsingEncoding:NSUTF8StringEncoding]];
+        [engine transportDidFinishLoading];
+    }
+}
+
+- (unsigned)requestCount
+{
+    return [requestTimes count];
+}
+
+- (NSTimeInterval)timeOfRequest:(unsigned)index
+{
+    return [[requestTimes objectAtIndex:index] doubleValue];
+}
+
+- (BOOL)requestIsPost:(unsigned)index
+{
+    return [[requestIsPost objectAtIndex:index] boolValue];
+}
+
+@end
+
+static NSError *WOConnectionRefusedError(void)
+{
+    return [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotConnectToHost userInfo:nil];
+}
+
+static WOAudioscrobblerEngine *WONewEngine(WOSimulatedClock *clock, WOScriptedTransport *transport)
+{
+    WOAudioscrobblerEngine *engine = [[WOAudioscrobblerEngine alloc] init];
+    engine.clock        = clock;
+    engine.transport    = transport;
+    engine.user         = @"user";
+    engine.password     = @"password";
+    [engine setJitterSeed:WO_TEST_JITTER_SEED];
+    transport->engine   = engine;
+    return engine;
+}
+
+static void WOSubmitSong(WOAudioscrobblerEngine *engine)
+{
+    [engine submitSong:@"Song" artist:@"Artist" album:@"Album" length:180];
+}
+
+// runs the clock until the transport has seen count requests or nothing is left to run; returns NO in the latter case
+static BOOL WORunUntilRequestCount(WOSimulatedClock *clock, WOScriptedTransport *transport, unsigned count)
+{
+    while ([transport requestCount] < count)
+        if (![clock runNext])
+            return NO;
+    return YES;
+}
+
+// starts a session that the handshake reply (INTERVAL 1) opens at once, and lets it settle
+static void WOStartSession(WOSimulatedClock *clock, WOScriptedTransport *transport, WOAudioscrobblerEngine *engine)
+{
+    [transport->replies addObject:WO_TEST_HANDSHAKE_REPLY];
+    [engine startSession];
+    [clock runUntil:clock.now];
+}
+
+// "Always observe the latest INTERVAL you get": it holds back the next submission even when nothing has failed, and
+// it wins over a shorter back-off
+static void WOTestIntervalFloors(void)
+{
+    WOSimulatedClock    *clock      = [[WOSimulatedClock alloc] initWithTime:WO_TEST_START_TIME];
+    WOScriptedTransport *transport  = [[WOScriptedTransport alloc] initWithClock:clock];
+    WOAudioscrobblerEngine *engine  = WONewEngine(clock, transport);
+
+    [transport->replies addObject:@"UPTODATE\nchallenge\nhttp://post.example.com/submit\nINTERVAL 5\n"];
+    [engine startSession];
+    [clock runUntil:clock.now];
+    WO_EXPECT(engine.currentState == WOAudioscrobblerHandshakeSucceeded, "handshake succeeds");
+    WO_EXPECT(engine.lastKnownInterval == 5, "handshake INTERVAL is stored");
+
+    NSTimeInterval submitted = clock.now;
+    WOSubmitSong(engine);
+    NSTimeInterval delay = [engine.scheduler delayUntilSelector:@selector(nextOperation:) target:engine];
+    WO_EXPECT(delay >= 5.0 && delay <= 5.0 + WO_TEST_ROUNDING, "first submission waits for the handshake INTERVAL");
+
+    [transport->replies addObject:@"OK\nINTERVAL 30\n"];
+    WO_EXPECT(WORunUntilRequestCount(clock, transport, 2), "first submission is sent");
+    NSTimeInterval gap = [transport timeOfRequest:1] - submitted;
+    WO_EXPECT([transport requestIsPost:1], "first submission is a POST");
+    WO_EXPECT(gap >= 5.0 && gap <= 5.0 + WO_TEST_ROUNDING, "first submission is sent once the INTERVAL is up");
+    [clock runUntil:clock.now];
+    WO_EXPECT(engine.lastKnownInterval == 30, "submission INTERVAL replaces the handshake one");
+
+    // the next play waits for the newer, longer INTERVAL
+    submitted = clock.now;
+    WOSubmitSong(engine);
+    [transport->replies addObject:@"FAILED try later\nINTERVAL 600\n"];
+    WO_EXPECT(WORunUntilRequestCount(clock, transport, 3), "second submission is sent");
+    gap = [transport timeOfRequest:2] - submitted;
+    WO_EXPECT(gap >= 30.0 && gap <= 30.0 + WO_TEST_ROUNDING, "second submission waits for INTERVAL 30");
+    printf("INTERVAL 5 -> %.0f s, INTERVAL 30 -> %.0f s\n", [transport timeOfRequest:1] - WO_TEST_START_TIME, gap);
+
+    // a first failure backs off by at most a minute, but INTERVAL 600 holds the retry back further
+    [clock runUntil:clock.now];
+    WO_EXPECT(engine.currentState == WOAudioscrobblerWaitingToRetrySubmission, "FAILED waits to retry");
+    transport->repeatingReply = @"OK\nINTERVAL 1\n";
+    WO_EXPECT(WORunUntilRequestCount(clock, transport, 4), "retry is sent");
+    gap = [transport timeOfRequest:3] - [transport timeOfRequest:2];
+    WO_EXPECT(gap >= 600.0 && gap <= 600.0 + WO_TEST_ROUNDING, "INTERVAL outweighs a shorter back-off");
+    printf("INTERVAL 600 after one failure -> %.0f s\n", gap);
+    [clock runUntil:clock.now];
+    WO_EXPECT(engine.currentState == WOAudioscrobblerSubmissionSucceeded, "retry succeeds");
+}
+
+// runs WO_TEST_FAILURE_COUNT failed submissions and returns the gaps before each retry
+static NSArray *WOBackoffGaps(uint32_t seed)
+{
+    WOSimulatedClock    *clock      = [[WOSimulatedClock alloc] initWithTime:WO_TEST_START_TIME];
+    WOScriptedTransport *transport  = [[WOScriptedTransport alloc] initWithClock:clock];
+    WOAudioscrobblerEngine *engine  = WONewEngine(clock, transport);
+    [engine setJitterSeed:seed];
+    WOStartSession(clock, transport, engine);
+
+    transport->repeatingReply = @"FAILED busy\nINTERVAL 1\n";
+    WOSubmitSong(engine);
+    NSMutableArray *gaps = [NSMutableArray array];
+    WO_EXPECT(WORunUntilRequestCount(clock, transport, 2), "first submission is sent");
+    for (unsigned failures = 1; failures <= WO_TEST_FAILURE_COUNT; failures++)
+    {
+        WO_EXPECT(WORunUntilRequestCount(clock, transport, failures + 2), "retry is sent");
+        [gaps addObject:[NSNumber numberWithDouble:
+            [transport timeOfRequest:failures + 1] - [transport timeOfRequest:failures]]];
+    }
+
+    // the last retry has been sent but not yet answered; success clears the back-off, so the next play only waits for
+    // the INTERVAL
+    transport->repeatingReply = @"OK\nINTERVAL 1\n";
+    [clock runUntil:clock.now];
+    WO_EXPECT(engine.currentState == WOAudioscrobblerSubmissionSucceeded, "last retry succeeds");
+    NSTimeInterval submitted = clock.now;
+    WOSubmitSong(engine);
+    WO_EXPECT(WORunUntilRequestCount(clock, transport, WO_TEST_FAILURE_COUNT + 4), "submission after success is sent");
+    WO_EXPECT([transport timeOfRequest:WO_TEST_FAILURE_COUNT + 3] - submitted <= 1.0 + WO_TEST_ROUNDING,
+              "success resets the back-off");
+    return gaps;
+}
+
+// each consecutive failure doubles the ceiling from one minute up to two hours, with equal jitter in [ceiling/2, ceiling]
+static void WOTestBackoff(void)
+{
+    NSArray *gaps = WOBackoffGaps(WO_TEST_JITTER_SEED);
+    printf("back-off:");
+    for (unsigned i = 0; i < [gaps count]; i++)
+    {
+        NSTimeInterval gap = [[gaps objectAtIndex:i] doubleValue];
+        NSTimeInterval ceiling = MIN(WO_TEST_RETRY_BASE_DELAY * (1U << i), WO_TEST_RETRY_MAX_DELAY);
+        printf(" %.0f", gap);
+        if (gap < ceiling / 2.0 || gap > ceiling + WO_TEST_ROUNDING)
+        {
+            WOTestFailures++;
+            fprintf(stderr, "FAIL: retry %u after %.0f s, expected %.0f to %.0f s\n", i + 1, gap, ceiling / 2.0, ceiling);
+        }
+    }
+    printf(" s\n");
+    WO_EXPECT([[gaps lastObject] doubleValue] >= WO_TEST_RETRY_MAX_DELAY / 2.0, "back-off reaches the cap");
+    WO_EXPECT([gaps isEqualToArray:WOBackoffGaps(WO_TEST_JITTER_SEED)], "same seed, same delays");
+    WO_EXPECT(![gaps isEqualToArray:WOBackoffGaps(WO_TEST_JITTER_SEED + 1)], "jitter depends on the seed");
+}
+
+// "after the APP detects 3 catastrophic (i.e. DNS resolution or connection refused) failures in submitting [...] the APP
+// should not handshake more than once every 30 minutes"
+static void WOTestHandshakeFloor(void)
+{
+    WOSimulatedClock    *clock      = [[WOSimulatedClock alloc] initWithTime:WO_TEST_START_TIME];
+    WOScriptedTransport *transport  = [[WOScriptedTransport alloc] initWithClock:clock];
+    WOAudioscrobblerEngine *engine  = WONewEngine(clock, transport);
+    WOStartSession(clock, transport, engine);
+
+    // three refused submissions, then a refused handshake, then everything works again
+    for (unsigned i = 0; i < 4; i++)
+        [transport->replies addObject:WOConnectionRefusedError()];
+    [transport->replies addObject:WO_TEST_HANDSHAKE_REPLY];
+    transport->repeatingReply = @"OK\nINTERVAL 1\n";
+    WOSubmitSong(engine);
+
+    // requests: handshake, 3 submissions, handshake (refused), handshake, submission
+    WO_EXPECT(WORunUntilRequestCount(clock, transport, 7), "engine recovers");
+    WO_EXPECT(![transport requestIsPost:0] && [transport requestIsPost:1] && [transport requestIsPost:2] &&
+              [transport requestIsPost:3] && ![transport requestIsPost:4] && ![transport requestIsPost:5] &&
+              [transport requestIsPost:6], "third catastrophic failure leads to a new handshake");
+    WO_EXPECT([transport timeOfRequest:3] - [transport timeOfRequest:0] < WO_TEST_HANDSHAKE_FLOOR,
+              "submission retries are not held to the handshake floor");
+
+    NSTimeInterval first = [transport timeOfRequest:4] - [transport timeOfRequest:0];
+    NSTimeInterval second = [transport timeOfRequest:5] - [transport timeOfRequest:4];
+    WO_EXPECT(first >= WO_TEST_HANDSHAKE_FLOOR && first <= WO_TEST_HANDSHAKE_FLOOR + WO_TEST_ROUNDING,
+              "handshake after 3 catastrophic failures waits 30 minutes from the last one");
+    WO_EXPECT(second >= WO_TEST_HANDSHAKE_FLOOR && second <= WO_TEST_HANDSHAKE_FLOOR + WO_TEST_ROUNDING,
+              "refused handshake is retried 30 minutes later");
+    WO_EXPECT([transport timeOfRequest:6] - [transport timeOfRequest:5] <= 1.0 + WO_TEST_ROUNDING,
+              "successful handshake lifts the floor");
+    printf("handshakes after catastrophic failures: %.0f s, %.0f s apart\n", first, second);
+    [clock runUntil:clock.now];
+    WO_EXPECT(engine.currentState == WOAudioscrobblerSubmissionSucceeded, "submission succeeds after recovery");
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    WOTestIntervalFloors();
+    WOTestBackoff();
+    WOTestHandshakeFloor();
+    [pool drain];
+    return WO_TEST_RESULT();
+}
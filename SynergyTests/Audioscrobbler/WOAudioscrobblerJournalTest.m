@@ -0,0 +1,247 @@
+// WOAudioscrobblerJournalTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Writes a journal of plays, acknowledgements and a cursor, then replays copies of it cut short at every byte offset and
+// with every byte in turn corrupted. Each replay must recover exactly the records before the damage, truncate the file
+// back to them, and carry on appending from there. Also checks that the journal is compacted on the 512th
+// acknowledgement and not before.
+
+// system headers
+#import <Foundation/Foundation.h>
+#import <unistd.h>
+
+// other headers
+#import "WOAudioscrobblerEngine.h"
+#import "WOAudioscrobblerJournal.h"
+#import "WOTestExpect.h"
+
+//! Must match the journal's record layout: a 16-byte header whose third field is the payload length, then the payload
+//! padded to 8 bytes
+#define WO_TEST_HEADER_SIZE             16
+#define WO_TEST_LENGTH_OFFSET           8
+#define WO_TEST_PAD(length)             (((length) + 7) & ~7)
+
+//! Must match the journal's WO_JOURNAL_COMPACTION_THRESHOLD
+#define WO_TEST_COMPACTION_THRESHOLD    512
+
+//! Plays written for the compaction test; the ones past the threshold are still live when it compacts
+#define WO_TEST_COMPACTION_PLAYS        600
+
+#define WO_TEST_ENDPOINT                @"http://post.example.com/"
+
+#define WO_TEST_PLAY_COUNT              5
+
+//! One record as written by the first part of the test
+typedef struct WOTestRecord {
+    char                type;       //!< 'P' for a play, 'A' for an acknowledgement, 'C' for a cursor
+    unsigned long long  sequence;
+} WOTestRecord;
+
+//! The journal is written in exactly this order, one record per call
+static const WOTestRecord WOTestScript[] = {
+    { 'P', 1 }, { 'P', 2 }, { 'P', 3 }, { 'A', 1 }, { 'P', 4 }, { 'C', 3 }, { 'A', 2 }, { 'P', 5 }
+};
+
+#define WO_TEST_RECORD_COUNT            (sizeof(WOTestScript) / sizeof(WOTestScript[0]))
+
+static NSString *WOTestDirectory;
+
+static NSDictionary *WOTestPlay(unsigned index)
+{
+    // non-ASCII and empty fields exercise the variable-length encoding
+    NSString *tracks[WO_TEST_PLAY_COUNT] = { @"Hoppípolla", @"Glósóli", @"Svefn-g-englar", @"Olsen Olsen", @"Sæglópur" };
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+        tracks[index],                                          WO_TRACK_KEY,
+        @"Sigur Rós",                                           WO_ARTIST_KEY,
+        (index % 2 ? @"" : @"Takk..."),                         WO_ALBUM_KEY,
+        @"",                                                    WO_MBID_KEY,
+        [NSNumber numberWithUnsignedInt:240 + index],           WO_LENGTH_KEY,
+        [NSString stringWithFormat:@"2026-10-18 12:0%u:00", index], WO_DATE_KEY, nil];
+}
+
+static NSString *WOTestPath(NSString *name)
+{
+    return [WOTestDirectory stringByAppendingPathComponent:name];
+}
+
+static unsigned long long WOFileSize(NSString *path)
+{
+    return [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:NULL] fileSize];
+}
+
+// the offset at which each record in data ends
+static NSArray *WORecordEnds(NSData *data)
+{
+    NSMutableArray *ends = [NSMutableArray array];
+    const uint8_t *bytes = [data bytes];
+    NSUInteger offset = 0;
+    while (offset + WO_TEST_HEADER_SIZE <= [data length])
+    {
+        const uint8_t *field = bytes + offset + WO_TEST_LENGTH_OFFSET;
+        uint32_t length = field[0] | (field[1] << 8) | (field[2] << 16) | ((uint32_t)field[3] << 24);
+        offset += WO_TEST_HEADER_SIZE + WO_TEST_PAD(length);
+        [ends addObject:[NSNumber numberWithUnsignedInteger:offset]];
+    }
+    return ends;
+}
+
+// the number of whole records in the first offset bytes
+static unsigned WORecordsBefore(NSArray *ends, NSUInteger offset)
+{
+    unsigned count = 0;
+    while (count < [ends count] && [[ends objectAtIndex:count] unsignedIntegerValue] <= offset)
+        count++;
+    return count;
+}
+
+// replays the journal at path and checks that it holds what the first count records of WOTestScript describe; if
+// append is set, also appends a play and checks that it survives a second replay
+static void WOCheckReplay(NSString *path, unsigned count, NSUInteger intactSize, BOOL append, const char *description)
+{
+    unsigned long long acknowledged = 0, cursor = 0, highest = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (WOTestScript[i].type == 'A')
+            acknowledged = MAX(acknowledged, WOTestScript[i].sequence);
+        else if (WOTestScript[i].type == 'C')
+            cursor = WOTestScript[i].sequence;
+        highest = MAX(highest, WOTestScript[i].sequence);
+    }
+    NSMutableArray *expected = [NSMutableArray array];
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (WOTestScript[i].type != 'P' || WOTestScript[i].sequence <= acknowledged)
+            continue;
+        NSMutableDictionary *play = [WOTestPlay((unsigned)WOTestScript[i].sequence - 1) mutableCopy];
+        [play setObject:[NSNumber numberWithUnsignedLongLong:WOTestScript[i].sequence] forKey:WO_SEQUENCE_KEY];
+        [expected addObject:play];
+    }
+
+    WOAudioscrobblerJournal *journal = [[WOAudioscrobblerJournal alloc] initWithPath:path];
+    NSArray *plays = [journal replay];
+    BOOL ok = [plays isEqualToArray:expected] &&
+              WOFileSize(path) == intactSize &&
+              [journal acknowledgedSequence] == acknowledged &&
+              [journal cursorForEndpoint:WO_TEST_ENDPOINT] == MAX(cursor, acknowledged);
+    if (ok && append)
+    {
+        NSDictionary *added = [journal appendPlay:WOTestPlay(0)];
+        [journal synchronize];
+        ok = [[added objectForKey:WO_SEQUENCE_KEY] unsignedLongLongValue] == highest + 1 &&
+             [[[[WOAudioscrobblerJournal alloc] initWithPath:path] replay] isEqualToArray:
+                 [expected arrayByAddingObject:added]];
+    }
+    if (!ok)
+    {
+        WOTestFailures++;
+        fprintf(stderr, "FAIL: %s: expected %u records (%lu bytes), replayed %lu plays from a %llu-byte file\n",
+                description, count, (unsigned long)intactSize, (unsigned long)[plays count], WOFileSize(path));
+    }
+}
+
+// every replay leaves an idle writer thread behind; a thousand or so of them are harmless in a test
+static void WOTestTornAndCorruptTails(void)
+{
+    NSString *original = WOTestPath(@"original");
+    WOAudioscrobblerJournal *journal = [[WOAudioscrobblerJournal alloc] initWithPath:original];
+    WO_EXPECT([[journal replay] count] == 0, "a missing journal replays as empty");
+    NSMutableArray *tagged = [NSMutableArray array];
+    for (unsigned i = 0; i < WO_TEST_RECORD_COUNT; i++)
+    {
+        const WOTestRecord *record = &WOTestScript[i];
+        if (record->type == 'P')
+            [tagged addObject:[journal appendPlay:WOTestPlay([tagged count])]];
+        else if (record->type == 'A')
+            [journal acknowledgePlay:[tagged objectAtIndex:(NSUInteger)record->sequence - 1]];
+        else
+            [journal recordCursor:record->sequence forEndpoint:WO_TEST_ENDPOINT];
+    }
+    [journal synchronize];
+
+    NSData *data = [NSData dataWithContentsOfFile:original];
+    NSArray *ends = WORecordEnds(data);
+    WO_EXPECT([ends count] == WO_TEST_RECORD_COUNT && [[ends lastObject] unsignedIntegerValue] == [data length],
+              "one record per call");
+    printf("journal of %lu records, %lu bytes\n", (unsigned long)[ends count], (unsigned long)[data length]);
+    WOCheckReplay(original, WO_TEST_RECORD_COUNT, [data length], YES, "intact journal");
+
+    NSString *damaged = WOTestPath(@"damaged");
+    for (NSUInteger offset = 0; offset <= [data length]; offset++)
+    {
+        // cut short at offset
+        unsigned count = WORecordsBefore(ends, offset);
+        NSUInteger intactSize = count ? [[ends objectAtIndex:count - 1] unsignedIntegerValue] : 0;
+        [[data subdataWithRange:NSMakeRange(0, offset)] writeToFile:damaged atomically:NO];
+        BOOL append = (offset == intactSize + 1);  // once per record is plenty
+        WOCheckReplay(damaged, count, intactSize, append, [[NSString stringWithFormat:@"torn at %lu", (unsigned long)offset] UTF8String]);
+
+        // the byte at offset corrupted: its record and everything after it must go
+        if (offset == [data length])
+            break;
+        NSMutableData *corrupt = [data mutableCopy];
+        ((uint8_t *)[corrupt mutableBytes])[offset] ^= 0xff;
+        [corrupt writeToFile:damaged atomically:NO];
+        WOCheckReplay(damaged, count, intactSize, append,
+                      [[NSString stringWithFormat:@"corrupted at %lu", (unsigned long)offset] UTF8String]);
+    }
+}
+
+static void WOTestCompaction(void)
+{
+    NSString *path = WOTestPath(@"compaction");
+    WOAudioscrobblerJournal *journal = [[WOAudioscrobblerJournal alloc] initWithPath:path];
+    [journal replay];
+    NSMutableArray *queue = [NSMutableArray array];
+    for (unsigned i = 0; i < WO_TEST_COMPACTION_PLAYS; i++)
+        [queue addObject:[journal appendPlay:WOTestPlay(i % WO_TEST_PLAY_COUNT)]];
+
+    // acknowledged one at a time, compacting as the play log does
+    for (unsigned i = 1; i < WO_TEST_COMPACTION_THRESHOLD; i++)
+    {
+        [journal acknowledgePlay:[queue objectAtIndex:0]];
+        [queue removeObjectAtIndex:0];
+        [journal compactIfNeededWithQueue:queue];
+    }
+    [journal synchronize];
+    unsigned long long before = WOFileSize(path);
+    WO_EXPECT([WORecordEnds([NSData dataWithContentsOfFile:path]) count] ==
+              WO_TEST_COMPACTION_PLAYS + WO_TEST_COMPACTION_THRESHOLD - 1, "no compaction before the threshold");
+
+    [journal acknowledgePlay:[queue objectAtIndex:0]];
+    [queue removeObjectAtIndex:0];
+    [journal compactIfNeededWithQueue:queue];
+    [journal synchronize];
+    unsigned long long after = WOFileSize(path);
+    printf("compaction: %llu bytes before, %llu bytes after\n", before, after);
+
+    // the watermark, then only the live plays
+    WO_EXPECT([WORecordEnds([NSData dataWithContentsOfFile:path]) count] == 1 + [queue count],
+              "compaction on the threshold keeps only the watermark and the live plays");
+    WO_EXPECT(![[NSFileManager defaultManager] fileExistsAtPath:[path stringByAppendingPathExtension:@"new"]],
+              "compaction leaves no temporary file behind");
+
+    // appends after compaction go to the new file and sequence numbers carry on
+    [queue addObject:[journal appendPlay:WOTestPlay(0)]];
+    [journal synchronize];
+    WOAudioscrobblerJournal *replayed = [[WOAudioscrobblerJournal alloc] initWithPath:path];
+    WO_EXPECT([[replayed replay] isEqualToArray:queue], "compacted journal replays the live plays");
+    WO_EXPECT([replayed acknowledgedSequence] == WO_TEST_COMPACTION_THRESHOLD, "compacted journal keeps the watermark");
+    WO_EXPECT([[[replayed appendPlay:WOTestPlay(1)] objectForKey:WO_SEQUENCE_KEY] unsignedLongLongValue] ==
+              WO_TEST_COMPACTION_PLAYS + 2, "sequence numbers carry on after compaction");
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    WOTestDirectory = [NSTemporaryDirectory() stringByAppendingPathComponent:
+        [NSString stringWithFormat:@"synergy-journal-test-%d", getpid()]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:WOTestDirectory withIntermediateDirectories:YES
+                                               attributes:nil error:NULL];
+    WOTestTornAndCorruptTails();
+    WOTestCompaction();
+    [[NSFileManager defaultManager] removeItemAtPath:WOTestDirectory error:NULL];
+    [pool drain];
+    return WO_TEST_RESULT();
+}
@@ -0,0 +1,173 @@
+// WOAudioscrobblerResponseParserTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Feeds WOAudioscrobblerResponseParser handshake and submission replies (UPTODATE, UPDATE, FAILED, BADUSER, OK, BADAUTH
+// and unrecognized ones, with and without INTERVAL lines) one byte at a time, in chunks of various sizes that straddle the
+// line buffer, and whole, reusing one parser as the engine does. Every way of feeding a reply must give the same status,
+// argument, retained lines and interval. Also covers carriage returns, blank lines, a missing final terminator, invalid
+// and repeated INTERVAL lines, and lines longer than WO_REPLY_MAX_LINE, which must be cut short without spilling into the
+// lines after them.
+
+// system headers
+#import <Foundation/Foundation.h>
+
+// other headers
+#import "WOAudioscrobblerResponseParser.h"
+#import "WOTestExpect.h"
+
+//! Bytes passed to each parseBytes:length: call; 0 passes the whole reply at once
+static const NSUInteger WOTestChunkSizes[] = { 1, 2, 3, 7, 64, WO_REPLY_MAX_LINE - 1, WO_REPLY_MAX_LINE,
+    WO_REPLY_MAX_LINE + 1, 0 };
+
+#define WO_TEST_CHUNK_SIZE_COUNT    (sizeof(WOTestChunkSizes) / sizeof(WOTestChunkSizes[0]))
+
+static NSString *WORepeated(NSString *aString, NSUInteger count)
+{
+    return [@"" stringByPaddingToLength:count * [aString length] withString:aString startingAtIndex:0];
+}
+
+static BOOL WOEqualOrBothNil(NSString *a, NSString *b)
+{
+    return a == b || [a isEqualToString:b];
+}
+
+// parses reply in every chunk size and checks the parser's view of it each time; lines are the retained lines expected
+static void WOCheckReply(const char *description, NSString *reply, WOAudioscrobblerReplyStatus status,
+                         NSString *argument, NSArray *lines, unsigned lineCount, unsigned interval, BOOL invalid)
+{
+    // one parser for every reply, reset in between, as the engine uses it
+    static WOAudioscrobblerResponseParser *parser;
+    if (!parser)
+        parser = [[WOAudioscrobblerResponseParser alloc] init];
+
+    NSData          *data   = [reply dataUsingEncoding:NSUTF8StringEncoding];
+    const uint8_t   *bytes  = [data bytes];
+    NSUInteger      length  = [data length];
+    for (unsigned i = 0; i < WO_TEST_CHUNK_SIZE_COUNT; i++)
+    {
+        NSUInteger chunk = WOTestChunkSizes[i] ? WOTestChunkSizes[i] : MAX(length, 1);
+        [parser reset];
+        for (NSUInteger offset = 0; offset < length; offset += chunk)
+            [parser parseBytes:bytes + offset length:MIN(chunk, length - offset)];
+        [parser finish];
+
+        BOOL matches = (parser.status == status && parser.lineCount == lineCount && parser.interval == interval &&
+                        parser.sawInvalidInterval == invalid && WOEqualOrBothNil([parser argument], argument));
+        for (unsigned j = 0; j <= WO_REPLY_KEPT_LINES; j++)
+        {
+            NSString *line = (j < [lines count]) ? [lines objectAtIndex:j] : nil;
+            matches = matches && WOEqualOrBothNil([parser lineAtIndex:j], line);
+        }
+        if (!matches)
+        {
+            WOTestFailures++;
+            fprintf(stderr, "FAIL: %s, fed %lu bytes at a time: status %d, %u lines, interval %u%s, argument \"%s\"\n",
+                    description, (unsigned long)chunk, parser.status, parser.lineCount, parser.interval,
+                    parser.sawInvalidInterval ? " (invalid seen)" : "",
+                    [parser argument] ? [[parser argument] UTF8String] : "");
+        }
+    }
+}
+
+static void WOTestHandshakeReplies(void)
+{
+    WOCheckReply("UPTODATE", @"UPTODATE\nc0ffee\nhttp://post.example.com/protocol_1.2\nINTERVAL 1\n",
+                 WOAudioscrobblerReplyUpToDate, nil,
+                 [NSArray arrayWithObjects:@"UPTODATE", @"c0ffee", @"http://post.example.com/protocol_1.2", nil], 4, 1, NO);
+    WOCheckReply("UPDATE", @"UPDATE http://www.last.fm/download\r\nc0ffee\r\nhttp://post.example.com/\r\nINTERVAL 5\r\n",
+                 WOAudioscrobblerReplyUpdate, @" http://www.last.fm/download",
+                 [NSArray arrayWithObjects:@"UPDATE http://www.last.fm/download", @"c0ffee", @"http://post.example.com/",
+                  nil], 4, 5, NO);
+    WOCheckReply("FAILED", @"FAILED Plugin bug: Not all request variables are set\nINTERVAL 60\n",
+                 WOAudioscrobblerReplyFailed, @" Plugin bug: Not all request variables are set",
+                 [NSArray arrayWithObjects:@"FAILED Plugin bug: Not all request variables are set", @"INTERVAL 60", nil],
+                 2, 60, NO);
+    WOCheckReply("BADUSER", @"BADUSER\n", WOAudioscrobblerReplyBadUser, nil,
+                 [NSArray arrayWithObject:@"BADUSER"], 1, 0, NO);
+}
+
+static void WOTestSubmissionReplies(void)
+{
+    WOCheckReply("OK", @"OK\n", WOAudioscrobblerReplyOK, nil, [NSArray arrayWithObject:@"OK"], 1, 0, NO);
+    WOCheckReply("BADAUTH without a terminator", @"BADAUTH", WOAudioscrobblerReplyBadAuth, nil,
+                 [NSArray arrayWithObject:@"BADAUTH"], 1, 0, NO);
+    WOCheckReply("OK, INTERVAL without a terminator", @"OK\nINTERVAL 30", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL 30", nil], 2, 30, NO);
+    WOCheckReply("blank lines", @"\n\r\n\nOK\n\n\nINTERVAL 10\n\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL 10", nil], 2, 10, NO);
+    WOCheckReply("unrecognized", @"ERROR 42\n", WOAudioscrobblerReplyUnrecognized, @"ERROR 42",
+                 [NSArray arrayWithObject:@"ERROR 42"], 1, 0, NO);
+    WOCheckReply("empty", @"", WOAudioscrobblerReplyNone, nil, [NSArray array], 0, 0, NO);
+}
+
+static void WOTestIntervals(void)
+{
+    WOCheckReply("latest INTERVAL", @"OK\nINTERVAL 5\nINTERVAL 7\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL 5", @"INTERVAL 7", nil], 3, 7, NO);
+    WOCheckReply("INTERVAL after the retained lines", @"OK\na\nb\nc\nd\nINTERVAL 12\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"a", @"b", nil], 6, 12, NO);
+    WOCheckReply("spaced INTERVAL", @"OK\nINTERVAL   15\r\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL   15", nil], 2, 15, NO);
+    WOCheckReply("INTERVAL without a value", @"OK\nINTERVAL\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL", nil], 2, 0, YES);
+    WOCheckReply("INTERVAL 0", @"OK\nINTERVAL 0\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL 0", nil], 2, 0, YES);
+    WOCheckReply("negative INTERVAL", @"OK\nINTERVAL -5\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL -5", nil], 2, 0, YES);
+    WOCheckReply("overflowing INTERVAL", @"OK\nINTERVAL 99999999999\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL 99999999999", nil], 2, 0, YES);
+    WOCheckReply("invalid INTERVAL after a valid one", @"OK\nINTERVAL 5\nINTERVAL x\n", WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", @"INTERVAL 5", @"INTERVAL x", nil], 3, 5, YES);
+}
+
+static void WOTestLongLines(void)
+{
+    NSUInteger max = WO_REPLY_MAX_LINE;
+
+    // the status line and its argument are cut short; the next line is whole
+    NSString *reason = WORepeated(@"x", 1000);
+    NSString *status = [@"FAILED " stringByAppendingString:reason];
+    WOCheckReply("long FAILED", [status stringByAppendingString:@"\nINTERVAL 5\n"], WOAudioscrobblerReplyFailed,
+                 [[@" " stringByAppendingString:reason] substringToIndex:max - 6],
+                 [NSArray arrayWithObjects:[status substringToIndex:max], @"INTERVAL 5", nil], 2, 5, NO);
+
+    // likewise a retained line in the middle
+    NSString *challenge = WORepeated(@"c", 600);
+    WOCheckReply("long challenge",
+                 [NSString stringWithFormat:@"UPTODATE\n%@\nhttp://post.example.com/\nINTERVAL 1\n", challenge],
+                 WOAudioscrobblerReplyUpToDate, nil,
+                 [NSArray arrayWithObjects:@"UPTODATE", [challenge substringToIndex:max], @"http://post.example.com/", nil],
+                 4, 1, NO);
+
+    // a long line in the scratch buffer, which an INTERVAL line after it must not be mistaken for a part of
+    WOCheckReply("long line after the retained lines",
+                 [NSString stringWithFormat:@"OK\nINTERVAL 2\nx\n%@\nINTERVAL 9\n", WORepeated(@"A", 2000)],
+                 WOAudioscrobblerReplyOK, nil, [NSArray arrayWithObjects:@"OK", @"INTERVAL 2", @"x", nil], 5, 9, NO);
+
+    // a number cut short is not taken
+    NSString *interval = [@"INTERVAL 1" stringByAppendingString:WORepeated(@"0", 600)];
+    WOCheckReply("long INTERVAL", [NSString stringWithFormat:@"OK\n%@\n", interval], WOAudioscrobblerReplyOK, nil,
+                 [NSArray arrayWithObjects:@"OK", [interval substringToIndex:max], nil], 2, 0, YES);
+
+    // at the limit the carriage return is the byte discarded; one short of it, it is kept and then dropped
+    NSString *full = WORepeated(@"y", max);
+    NSString *almost = WORepeated(@"z", max - 1);
+    WOCheckReply("lines at the limit", [NSString stringWithFormat:@"OK\r\n%@\r\n%@\r\n", full, almost],
+                 WOAudioscrobblerReplyOK, nil, [NSArray arrayWithObjects:@"OK", full, almost, nil], 3, 0, NO);
+
+    // and a short reply after all that parses cleanly
+    WOCheckReply("OK after long lines", @"OK\n", WOAudioscrobblerReplyOK, nil, [NSArray arrayWithObject:@"OK"], 1, 0, NO);
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    WOTestHandshakeReplies();
+    WOTestSubmissionReplies();
+    WOTestIntervals();
+    WOTestLongLines();
+    [pool drain];
+    return WO_TEST_RESULT();
+}
@@ -0,0 +1,42 @@
+//
+//  WOSimulatedClock.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+
+#import <Foundation/Foundation.h>
+#import "WOAudioscrobblerEngine.h"
+
+//! A WOAudioscrobblerClock whose time only moves when a test moves it, so that hours of scheduling run in milliseconds
+//! and come out the same every time.
+//!
+//! Scheduled calls are made in deadline order (ties in the order they were scheduled), each with the clock set to its
+//! deadline.
+@interface WOSimulatedClock : NSObject <WOAudioscrobblerClock> {
+
+    //! Seconds since the reference date
+    NSTimeInterval      now;
+
+    //! Pending calls sorted by deadline, then by serial
+    NSMutableArray      *pending;
+
+    //! Tie-breaker giving calls with equal deadlines first-in, first-out order
+    unsigned long long  nextSerial;
+
+    //! Number of calls made so far
+    unsigned            callCount;
+}
+
+- (id)initWithTime:(NSTimeInterval)aTime;
+
+//! Moves the clock to the earliest pending call and makes it; returns NO if nothing is pending
+- (BOOL)runNext;
+
+//! Makes every call due at or before \p aTime, then leaves the clock at \p aTime
+- (void)runUntil:(NSTimeInterval)aTime;
+
+@property(readonly) NSTimeInterval  now;
+@property(readonly) unsigned        callCount;
+
+@end
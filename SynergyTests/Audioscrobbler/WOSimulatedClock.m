@@ -0,0 +1,103 @@
+// WOSimulatedClock.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+
+// class header
+#import "WOSimulatedClock.h"
+
+@interface WOSimulatedClockCall : NSObject {
+
+@public
+    id                  target;
+    SEL                 selector;
+    NSTimeInterval      deadline;
+    unsigned long long  serial;
+}
+
+@end
+
+@implementation WOSimulatedClockCall
+
+- (NSComparisonResult)compareDeadline:(WOSimulatedClockCall *)other
+{
+    if (deadline != other->deadline)
+        return deadline < other->deadline ? NSOrderedAscending : NSOrderedDescending;
+    if (serial != other->serial)
+        return serial < other->serial ? NSOrderedAscending : NSOrderedDescending;
+    return NSOrderedSame;
+}
+
+@end
+
+@implementation WOSimulatedClock
+
+- (id)initWithTime:(NSTimeInterval)aTime
+{
+    if ((self = [super init]))
+    {
+        self->now       = aTime;
+        self->pending   = [NSMutableArray array];
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark WOAudioscrobblerClock
+
+- (NSDate *)currentDate
+{
+    return [NSDate dateWithTimeIntervalSinceReferenceDate:now];
+}
+
+- (void)scheduleSelector:(SEL)aSelector target:(id)aTarget afterDelay:(NSTimeInterval)delay
+{
+    WOSimulatedClockCall *call = [[WOSimulatedClockCall alloc] init];
+    call->target    = aTarget;
+    call->selector  = aSelector;
+    call->deadline  = now + MAX(delay, 0.0);
+    call->serial    = nextSerial++;
+
+    // keep the array sorted; there are only ever a handful of calls pending
+    NSUInteger index = [pending count];
+    while (index > 0 && [[pending objectAtIndex:index - 1] compareDeadline:call] == NSOrderedDescending)
+        index--;
+    [pending insertObject:call atIndex:index];
+}
+
+- (void)cancelScheduledSelectorsForTarget:(id)aTarget
+{
+    for (NSInteger i = (NSInteger)[pending count] - 1; i >= 0; i--)
+        if (((WOSimulatedClockCall *)[pending objectAtIndex:i])->target == aTarget)
+            [pending removeObjectAtIndex:i];
+}
+
+#pragma mark -
+#pragma mark Custom methods
+
+- (BOOL)runNext
+{
+    if ([pending count] == 0)
+        return NO;
+    WOSimulatedClockCall *call = [pending objectAtIndex:0];
+    [pending removeObjectAtIndex:0];
+    now = MAX(now, call->deadline);
+    callCount++;
+    [call->target performSelector:call->selector withObject:nil];
+    return YES;
+}
+
+- (void)runUntil:(NSTimeInterval)aTime
+{
+    while ([pending count] > 0 && ((WOSimulatedClockCall *)[pending objectAtIndex:0])->deadline <= aTime)
+        [self runNext];
+    now = MAX(now, aTime);
+}
+
+#pragma mark -
+#pragma mark Properties
+
+@synthesize now;
+@synthesize callCount;
+
+@end
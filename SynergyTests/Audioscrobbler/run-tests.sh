@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# run-tests.sh
+# Synergy
+#
+# Copyright 2026-present Greg Hurrell. All rights reserved.
+#
+# Builds each Audioscrobbler test tool against Foundation and the engine classes it
+# exercises, then runs them all. Nothing touches the network or waits on a real
+# clock; the journal test writes only under $TMPDIR. Mac OS X only (the engine
+# uses CoreFoundation); needs the WOPublic submodule and the developer tools.
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$HERE/../.." && pwd)
+BUILD=${BUILD:-"${TMPDIR:-/tmp}/synergy-audioscrobbler-test"}
+APP="$ROOT/SynergyApp/Classes"
+COMMON="$ROOT/SynergyCommon/Classes"
+
+# everything the engine pulls in
+ENGINE="$APP/WOAudioscrobblerEncoder.m $APP/WOAudioscrobblerEngine.m $APP/WOAudioscrobblerJournal.m
+        $APP/WOAudioscrobblerPlayLog.m $APP/WOAudioscrobblerResponseParser.m $APP/WOAudioscrobblerScheduler.m
+        $APP/WONSFileManagerExtensions.m $COMMON/WOAudioscrobblerLog.m"
+
+build() {
+  name=$1
+  shift
+  # shellcheck disable=SC2086
+  ${CC:-cc} ${CFLAGS:-"-g -O0"} -x objective-c -DWO_AUDIOSCROBBLER_TEST_MODE \
+    -I"$ROOT" -I"$APP" -I"$COMMON" -I"$ROOT/SynergyTests" -I"$HERE" \
+    -o "$BUILD/$name" "$HERE/$name.m" "$@" \
+    -framework Cocoa -lcrypto
+}
+
+mkdir -p "$BUILD"
+# shellcheck disable=SC2086
+build WOAudioscrobblerEngineTest "$HERE/WOSimulatedClock.m" $ENGINE
+# shellcheck disable=SC2086
+build WOAudioscrobblerJournalTest $ENGINE
+build WOAudioscrobblerResponseParserTest "$APP/WOAudioscrobblerResponseParser.m"
+
+status=0
+for test in WOAudioscrobblerEngineTest WOAudioscrobblerJournalTest WOAudioscrobblerResponseParserTest; do
+  echo "== $test"
+  "$BUILD/$test" || status=1
+done
+exit $status
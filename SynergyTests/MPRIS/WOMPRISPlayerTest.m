@@ -0,0 +1,197 @@
+// WOMPRISPlayerTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Drives WOMPRISPlayer against stand-in-player.py on a private session bus (see run-tests.sh): checks the snapshot it
+// builds, that commands reach the player and that their PropertiesChanged signals come back to the delegate, and that
+// an idle backend uses no CPU. Prints the notification latencies and exits non-zero if anything fails.
+
+// system headers
+#import <Foundation/Foundation.h>
+#import <sys/resource.h>
+
+// other headers
+#import "WOMPRISPlayer.h"
+#import "WOPlayerSnapshot.h"
+#import "WOTestExpect.h"
+
+#define WO_STAND_IN_BUS_NAME            @"org.mpris.MediaPlayer2.standin"
+
+//! Seconds to wait for the stand-in to turn up, or for a notification to arrive
+#define WO_TEST_TIMEOUT                 5.0
+
+//! Seconds over which idle CPU is measured
+#define WO_TEST_IDLE_PERIOD             2.0
+
+//! CPU seconds the backend may use while idle (the run loop itself costs a little)
+#define WO_TEST_IDLE_ALLOWANCE          0.02
+
+static double WOCPUSeconds(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+@interface WOMPRISPlayerTestDelegate : NSObject <WOPlayerBackendDelegate> {
+
+@public
+    NSMutableArray  *notifications;
+    NSDate          *lastNotificationDate;
+}
+
+//! Runs the main run loop until a notification arrives (returning it, or NSNull for a nil one) or the timeout passes
+- (id)waitForNotification;
+
+@end
+
+@implementation WOMPRISPlayerTestDelegate
+
+- (id)init
+{
+    if ((self = [super init]))
+        notifications = [[NSMutableArray alloc] init];
+    return self;
+}
+
+- (void)playerBackend:(id)aBackend didChangeWithInfo:(NSDictionary *)info
+{
+    lastNotificationDate = [NSDate date];
+    [notifications addObject:(info ? (id)info : (id)[NSNull null])];
+}
+
+- (id)waitForNotification
+{
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:WO_TEST_TIMEOUT];
+    while ([notifications count] == 0 && [limit timeIntervalSinceNow] > 0)
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:limit];
+    if ([notifications count] == 0)
+        return nil;
+    id notification = [notifications objectAtIndex:0];
+    [notifications removeObjectAtIndex:0];
+    return notification;
+}
+
+@end
+
+// runs the main run loop long enough for signals already sent to be delivered, then forgets their notifications
+static void WODiscardNotifications(WOMPRISPlayerTestDelegate *delegate)
+{
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+    [delegate->notifications removeAllObjects];
+}
+
+// sends selector to player and waits for the notification it causes, printing how long that took
+static NSDictionary *WOExpectNotification(WOMPRISPlayer *player, WOMPRISPlayerTestDelegate *delegate, SEL selector)
+{
+    NSDate *start = [NSDate date];
+    [player performSelector:selector];
+    NSDate *returned = [NSDate date];
+    id notification = [delegate waitForNotification];
+    if (![notification isKindOfClass:[NSDictionary class]])
+    {
+        WOTestFailures++;
+        fprintf(stderr, "FAIL: no notification after %s\n", [NSStringFromSelector(selector) UTF8String]);
+        return nil;
+    }
+    printf("%-12s notified after %.3f ms (%.3f ms after the call returned)\n",
+           [NSStringFromSelector(selector) UTF8String],
+           [delegate->lastNotificationDate timeIntervalSinceDate:start] * 1000.0,
+           [delegate->lastNotificationDate timeIntervalSinceDate:returned] * 1000.0);
+    return notification;
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+    // without a source the run loop would return at once instead of waiting
+    [[NSRunLoop currentRunLoop] addPort:[NSPort port] forMode:NSDefaultRunLoopMode];
+
+    WOMPRISPlayerTestDelegate *delegate = [[WOMPRISPlayerTestDelegate alloc] init];
+    WOMPRISPlayer *player = [[WOMPRISPlayer alloc] initWithBusName:WO_STAND_IN_BUS_NAME];
+    WO_EXPECT(player != nil, "connects to the session bus");
+    if (!player)
+        return 1;
+    [player setDelegate:delegate];
+    [player prepare];
+    WO_EXPECT([player sendsNotifications], "sends notifications");
+
+    // the stand-in may still be starting
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:WO_TEST_TIMEOUT];
+    while (![player isRunning] && [limit timeIntervalSinceNow] > 0)
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    WO_EXPECT([player isRunning], "sees the stand-in player");
+    WODiscardNotifications(delegate);
+
+    // snapshot
+    WOPlayerSnapshot *first = [player snapshot];
+    WO_EXPECT(first.state == WOPlayerPaused, "snapshot state");
+    WO_EXPECT([first.trackKey isEqualToString:@"/org/mpris/MediaPlayer2/Track/1"], "snapshot track key");
+    WO_EXPECT([first.title isEqualToString:@"First Song"], "snapshot title");
+    WO_EXPECT([first.album isEqualToString:@"Stand-In Album"], "snapshot album");
+    WO_EXPECT([first.artist isEqualToString:@"Artist A, Artist B"], "snapshot artist");
+    WO_EXPECT([first.composer isEqualToString:@"Composer C"], "snapshot composer");
+    WO_EXPECT([first.duration isEqualToString:@"3:45"], "snapshot duration");
+    WO_EXPECT([first.year isEqualToString:@"2007"], "snapshot year");
+    WO_EXPECT(first.rating == 60, "snapshot rating");
+    WO_EXPECT(first.repeatMode == WORepeatOff, "snapshot repeat mode");
+    WO_EXPECT(first.shuffleState == WOShuffleOff, "snapshot shuffle");
+    WO_EXPECT(first.position == 30, "snapshot position");
+    WO_EXPECT([[player snapshot] changesSince:first] == WOPlayerChangedNothing, "an unchanged snapshot has no changes");
+
+    // notifications
+    NSDictionary *info = WOExpectNotification(player, delegate, @selector(playPause));
+    WO_EXPECT([[info objectForKey:@"Player State"] isEqualToString:@"Playing"], "play notification");
+    WO_EXPECT([player snapshot].state == WOPlayerPlaying, "playing after playPause");
+
+    info = WOExpectNotification(player, delegate, @selector(nextTrack));
+    WO_EXPECT([[info objectForKey:@"Name"] isEqualToString:@"Second Song"], "next track notification name");
+    WO_EXPECT([[info objectForKey:@"Artist"] isEqualToString:@"Artist A"], "next track notification artist");
+    WO_EXPECT([[info objectForKey:@"Total Time"] longLongValue] == 3723000, "next track notification total time");
+    WOPlayerSnapshot *second = [player snapshot];
+    WO_EXPECT([second.duration isEqualToString:@"1:02:03"], "long duration");
+    WO_EXPECT(([second changesSince:first] & WOPlayerChangedTrackInfo) != 0, "track change seen by changesSince:");
+
+    info = WOExpectNotification(player, delegate, @selector(previousTrack));
+    WO_EXPECT([[info objectForKey:@"Name"] isEqualToString:@"First Song"], "previous track notification");
+
+    WO_EXPECT([player playTrack:@"/org/mpris/MediaPlayer2/Track/3"], "playTrack:");
+    info = [delegate waitForNotification];
+    WO_EXPECT([[info objectForKey:@"Name"] isEqualToString:@"Third Song"], "playTrack: notification");
+    WO_EXPECT(![player playTrack:@"/org/mpris/MediaPlayer2/Track/9"], "playTrack: of an unknown track fails");
+
+    // commands without notifications
+    WO_EXPECT([player volumeUp] == 9, "volumeUp");
+    WO_EXPECT([player volumeDown] == 8, "volumeDown");
+    WO_EXPECT([player toggleMute] == 0, "mute");
+    WO_EXPECT([player toggleMute] == 8, "unmute");
+    WO_EXPECT([player toggleShuffle] == WOShuffleOn, "toggleShuffle");
+    WO_EXPECT([player cycleRepeatMode] == WORepeatAll, "cycleRepeatMode to all");
+    WO_EXPECT([player cycleRepeatMode] == WORepeatOne, "cycleRepeatMode to one");
+    WO_EXPECT([player setRating:80] == -1, "setRating: is unsupported");
+    WO_EXPECT([[player playlistNames] isEqualToArray:[NSArray arrayWithObjects:@"Morning", @"Evening", nil]],
+              "playlistNames");
+    WO_EXPECT([player playPlaylistNamed:@"Evening" activate:YES], "playPlaylistNamed:activate:");
+    WO_EXPECT(![player playPlaylistNamed:@"Nowhere" activate:NO], "playPlaylistNamed: of an unknown playlist fails");
+    WODiscardNotifications(delegate);
+
+    // idle: the listener thread should be asleep in poll()
+    double before = WOCPUSeconds();
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:WO_TEST_IDLE_PERIOD]];
+    double idle = WOCPUSeconds() - before;
+    printf("idle         %.3f CPU seconds over %.1f s\n", idle, WO_TEST_IDLE_PERIOD);
+    WO_EXPECT(idle < WO_TEST_IDLE_ALLOWANCE, "no CPU while idle");
+    WO_EXPECT([delegate->notifications count] == 0, "no notifications while idle");
+
+    // quitting
+    info = WOExpectNotification(player, delegate, @selector(quit));
+    WO_EXPECT([[info objectForKey:@"Player State"] isEqualToString:@"Stopped"], "quit notification");
+    WO_EXPECT(![player isRunning], "not running after quit");
+    WO_EXPECT([player snapshot].state == WOPlayerNotRunning, "snapshot after quit");
+
+    printf("%s\n", [[player statisticsDescription] UTF8String]);
+    [pool drain];
+    return WO_TEST_RESULT();
+}
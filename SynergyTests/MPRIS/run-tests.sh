@@ -0,0 +1,37 @@
+#!/bin/sh
+#
+# run-tests.sh
+# Synergy
+#
+# Copyright 2026-present Greg Hurrell. All rights reserved.
+#
+# Builds WOMPRISPlayerTest against GNUstep Foundation and libdbus-1, then runs it
+# on a private session bus (dbus-run-session) with stand-in-player.py as the
+# player. Linux only. Needs gnustep-config, pkg-config's dbus-1, dbus-run-session
+# and python3 with jeepney.
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$HERE/../.." && pwd)
+BUILD=${BUILD:-"${TMPDIR:-/tmp}/synergy-mpris-test"}
+
+if [ "$1" = "--on-bus" ]; then
+  python3 "$HERE/stand-in-player.py" &
+  PLAYER=$!
+  trap 'kill $PLAYER 2>/dev/null || true' EXIT
+  "$BUILD/WOMPRISPlayerTest"
+  exit $?
+fi
+
+mkdir -p "$BUILD"
+# shellcheck disable=SC2046
+${CC:-gcc} $(gnustep-config --objc-flags) $(pkg-config --cflags dbus-1) \
+  -I"$ROOT/SynergyApp/Classes" -I"$ROOT/SynergyCommon/Classes" -I"$ROOT/SynergyTests" \
+  -o "$BUILD/WOMPRISPlayerTest" \
+  "$HERE/WOMPRISPlayerTest.m" \
+  "$ROOT/SynergyApp/Classes/WOMPRISPlayer.m" \
+  "$ROOT/SynergyApp/Classes/WOPlayerSnapshot.m" \
+  $(gnustep-config --base-libs) $(pkg-config --libs dbus-1)
+
+exec dbus-run-session -- "$0" --on-bus
@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+#
+# stand-in-player.py
+# Synergy
+#
+# Copyright 2026-present Greg Hurrell. All rights reserved.
+#
+# A scripted MPRIS 2 player for the WOMPRISPlayer test: owns
+# org.mpris.MediaPlayer2.standin on the session bus, answers the MediaPlayer2,
+# Player, TrackList and Playlists interfaces from a fixed library of three
+# tracks, and emits PropertiesChanged for every change, as a real player would.
+# Nothing happens unless a command asks for it (the position does not advance),
+# so the test sees the same thing every time.
+#
+# Needs jeepney (pure Python; "pip install jeepney" or python3-jeepney).
+
+import sys
+
+from jeepney import DBusAddress, HeaderFields, MessageType, new_error, new_method_return, new_signal
+from jeepney.bus_messages import message_bus
+from jeepney.io.blocking import open_dbus_connection
+
+BUS_NAME = 'org.mpris.MediaPlayer2.standin'
+PATH = '/org/mpris/MediaPlayer2'
+ROOT = 'org.mpris.MediaPlayer2'
+PLAYER = 'org.mpris.MediaPlayer2.Player'
+TRACK_LIST = 'org.mpris.MediaPlayer2.TrackList'
+PLAYLISTS = 'org.mpris.MediaPlayer2.Playlists'
+PROPERTIES = 'org.freedesktop.DBus.Properties'
+
+TRACKS = [
+    {
+        'mpris:trackid': ('o', '/org/mpris/MediaPlayer2/Track/1'),
+        'mpris:length': ('x', 225000000),
+        'xesam:title': ('s', 'First Song'),
+        'xesam:album': ('s', 'Stand-In Album'),
+        'xesam:artist': ('as', ['Artist A', 'Artist B']),
+        'xesam:composer': ('as', ['Composer C']),
+        'xesam:contentCreated': ('s', '2007-03-01T00:00:00Z'),
+        'xesam:userRating': ('d', 0.6),
+        'xesam:url': ('s', 'file:///music/first.mp3'),
+    },
+    {
+        'mpris:trackid': ('o', '/org/mpris/MediaPlayer2/Track/2'),
+        'mpris:length': ('x', 3723000000),
+        'xesam:title': ('s', 'Second Song'),
+        'xesam:album': ('s', 'Stand-In Album'),
+        'xesam:artist': ('as', ['Artist A']),
+        'xesam:url': ('s', 'file:///music/second.mp3'),
+    },
+    {
+        'mpris:trackid': ('o', '/org/mpris/MediaPlayer2/Track/3'),
+        'mpris:length': ('x', 60000000),
+        'xesam:title': ('s', 'Third Song'),
+        'xesam:url': ('s', 'file:///music/third.mp3'),
+    },
+]
+
+PLAYLIST_NAMES = ['Morning', 'Evening']
+
+
+class StandInPlayer:
+
+    def __init__(self, connection):
+        self.connection = connection
+        self.emitter = DBusAddress(PATH, interface=PROPERTIES)
+        self.status = 'Paused'
+        self.index = 0
+        self.position = 30000000
+        self.volume = 0.5
+        self.shuffle = False
+        self.loop = 'None'
+        self.running = True
+
+    def player_properties(self):
+        return {
+            'PlaybackStatus': ('s', self.status),
+            'LoopStatus': ('s', self.loop),
+            'Rate': ('d', 1.0),
+            'Shuffle': ('b', self.shuffle),
+            'Metadata': ('a{sv}', TRACKS[self.index]),
+            'Volume': ('d', self.volume),
+            'Position': ('x', self.position),
+            'MinimumRate': ('d', 1.0),
+            'MaximumRate': ('d', 1.0),
+            'CanGoNext': ('b', True),
+            'CanGoPrevious': ('b', True),
+            'CanPlay': ('b', True),
+            'CanPause': ('b', True),
+            'CanSeek': ('b', True),
+            'CanControl': ('b', True),
+        }
+
+    def properties(self, interface):
+        if interface == ROOT:
+            return {
+                'CanQuit': ('b', True),
+                'CanRaise': ('b', True),
+                'HasTrackList': ('b', True),
+                'Identity': ('s', 'Stand-In Player'),
+                'SupportedUriSchemes': ('as', ['file']),
+                'SupportedMimeTypes': ('as', ['audio/mpeg']),
+            }
+        if interface == PLAYER:
+            return self.player_properties()
+        if interface == TRACK_LIST:
+            return {
+                'Tracks': ('ao', [track['mpris:trackid'][1] for track in TRACKS]),
+                'CanEditTracks': ('b', False),
+            }
+        if interface == PLAYLISTS:
+            return {
+                'PlaylistCount': ('u', len(PLAYLIST_NAMES)),
+                'Orderings': ('as', ['Alphabetical', 'UserDefined']),
+                'ActivePlaylist': ('(b(oss))', (False, ('/', '', ''))),
+            }
+        return None
+
+    def changed(self, *names):
+        properties = self.player_properties()
+        self.connection.send(new_signal(self.emitter, 'PropertiesChanged', 'sa{sv}as',
+                                        (PLAYER, {name: properties[name] for name in names}, [])))
+
+    def go_to(self, index):
+        self.index = index % len(TRACKS)
+        self.position = 0
+        self.changed('Metadata')
+
+    def set_status(self, status):
+        if status != self.status:
+            self.status = status
+            self.changed('PlaybackStatus')
+
+    def handle(self, message):
+        fields = message.header.fields
+        interface = fields.get(HeaderFields.interface)
+        member = fields.get(HeaderFields.member)
+        body = message.body
+
+        if interface == PROPERTIES and member == 'Get':
+            properties = self.properties(body[0])
+            if properties is None or body[1] not in properties:
+                return new_error(message, 'org.freedesktop.DBus.Error.UnknownProperty')
+            return new_method_return(message, 'v', (properties[body[1]],))
+        if interface == PROPERTIES and member == 'GetAll':
+            properties = self.properties(body[0])
+            if properties is None:
+                return new_error(message, 'org.freedesktop.DBus.Error.UnknownInterface')
+            return new_method_return(message, 'a{sv}', (properties,))
+        if interface == PROPERTIES and member == 'Set':
+            if body[0] != PLAYER:
+                return new_error(message, 'org.freedesktop.DBus.Error.PropertyReadOnly')
+            name, (signature, value) = body[1], body[2]
+            if name == 'Volume' and signature == 'd':
+                self.volume = max(value, 0.0)
+            elif name == 'Shuffle' and signature == 'b':
+                self.shuffle = bool(value)
+            elif name == 'LoopStatus' and signature == 's' and value in ('None', 'Track', 'Playlist'):
+                self.loop = value
+            else:
+                return new_error(message, 'org.freedesktop.DBus.Error.InvalidArgs')
+            self.changed(name)
+            return new_method_return(message)
+
+        if interface == ROOT and member == 'Raise':
+            return new_method_return(message)
+        if interface == ROOT and member == 'Quit':
+            self.running = False
+            return new_method_return(message)
+
+        if interface == PLAYER and member == 'PlayPause':
+            self.set_status('Paused' if self.status == 'Playing' else 'Playing')
+        elif interface == PLAYER and member == 'Play':
+            self.set_status('Playing')
+        elif interface == PLAYER and member == 'Pause':
+            self.set_status('Paused')
+        elif interface == PLAYER and member == 'Stop':
+            self.set_status('Stopped')
+        elif interface == PLAYER and member == 'Next':
+            self.go_to(self.index + 1)
+        elif interface == PLAYER and member == 'Previous':
+            self.go_to(self.index - 1)
+        elif interface == PLAYER and member == 'Seek':
+            self.position = max(self.position + body[0], 0)
+        elif interface == PLAYER and member == 'SetPosition':
+            if body[0] == TRACKS[self.index]['mpris:trackid'][1]:
+                self.position = body[1]
+        elif interface == TRACK_LIST and member == 'GoTo':
+            paths = [track['mpris:trackid'][1] for track in TRACKS]
+            if body[0] not in paths:
+                return new_error(message, 'org.freedesktop.DBus.Error.InvalidArgs')
+            self.go_to(paths.index(body[0]))
+        elif interface == PLAYLISTS and member == 'GetPlaylists':
+            index, count, ordering, reverse = body
+            names = sorted(PLAYLIST_NAMES) if ordering == 'Alphabetical' else list(PLAYLIST_NAMES)
+            if reverse:
+                names.reverse()
+            playlists = [('/org/mpris/MediaPlayer2/Playlist/%d' % PLAYLIST_NAMES.index(name), name, '')
+                         for name in names[index:index + count]]
+            return new_method_return(message, 'a(oss)', (playlists,))
+        elif interface == PLAYLISTS and member == 'ActivatePlaylist':
+            self.go_to(0)
+            self.set_status('Playing')
+        else:
+            return new_error(message, 'org.freedesktop.DBus.Error.UnknownMethod')
+        return new_method_return(message)
+
+    def run(self):
+        while self.running:
+            message = self.connection.receive()
+            if message.header.message_type != MessageType.method_call:
+                continue
+            if message.header.fields.get(HeaderFields.path) != PATH:
+                self.connection.send(new_error(message, 'org.freedesktop.DBus.Error.UnknownObject'))
+                continue
+            self.connection.send(self.handle(message))
+
+
+def main():
+    connection = open_dbus_connection(bus='SESSION')
+    reply = connection.send_and_get_reply(message_bus.RequestName(BUS_NAME))
+    if reply.body[0] != 1:
+        sys.exit('could not own %s' % BUS_NAME)
+    StandInPlayer(connection).run()
+    connection.close()
+
+
+if __name__ == '__main__':
+    main()
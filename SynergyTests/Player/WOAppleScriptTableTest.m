@@ -0,0 +1,170 @@
+// WOAppleScriptTableTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Fills a WOAppleScriptTable with scripts shaped like WOITunesPlayer's (plain scripts, and "on open args" handlers
+// taking numbers and strings) and runs them for 10,000 simulated hot key presses, checking every result and that
+// compilationCount does not move once compileAll has run. The scripts do their arithmetic in AppleScript instead of
+// telling iTunes, so that the test runs without it. Also checks that a script is compiled lazily exactly once, and that a
+// script that fails to compile is counted every time it is retried. Mac OS X only.
+
+// system headers
+#import <Cocoa/Cocoa.h>
+
+// other headers
+#import "WOAppleScriptTable.h"
+#import "WOTestExpect.h"
+
+//! Number of simulated hot key presses
+#define WO_TEST_PRESS_COUNT     10000
+
+// a hot key and the script it runs; parameter is -1 for a script without parameters, and is otherwise passed as a number
+// (or, for "playlist", as a string)
+typedef struct WOTestHotKey {
+    const char  *script;
+    int         parameter;
+} WOTestHotKey;
+
+static const WOTestHotKey WOTestHotKeys[] = {
+    { "playPause",      -1 },
+    { "changeVolume",   1 },
+    { "changeVolume",   -1 },
+    { "changeRating",   1 },
+    { "changeRating",   -1 },
+    { "setRating",      80 },
+    { "playlist",       3 },
+    { "hide",           -1 },
+};
+
+#define WO_TEST_HOT_KEY_COUNT   (sizeof(WOTestHotKeys) / sizeof(WOTestHotKeys[0]))
+
+//! Number of distinct scripts among WOTestHotKeys
+#define WO_TEST_SCRIPT_COUNT    6
+
+static void WOAddScripts(WOAppleScriptTable *table)
+{
+    [table addScriptNamed:@"playPause" source:@"return \"SUCCESS\""];
+    [table addScriptNamed:@"hide" source:
+        @"try\n"
+        @"  return \"SUCCESS\"\n"
+        @"on error\n"
+        @"  return \"ERROR\"\n"
+        @"end try"];
+
+    // args: segments to move by; answers the new volume out of 100 from a fixed starting point of 50
+    [table addScriptNamed:@"changeVolume" source:
+        @"on open args\n"
+        @"  set segments to item 1 of args\n"
+        @"  return 50 + segments * 100 div 16\n"
+        @"end open"];
+
+    // args: stars to move by, as in WOITunesPlayer, from a fixed rating of 50
+    [table addScriptNamed:@"changeRating" source:
+        @"on open args\n"
+        @"  set stars to item 1 of args\n"
+        @"  set oldRating to 50\n"
+        @"  if stars > 0 then\n"
+        @"    set newRating to ((oldRating div 20) + stars) * 20\n"
+        @"  else\n"
+        @"    set newRating to (((oldRating + 19) div 20) + stars) * 20\n"
+        @"  end if\n"
+        @"  return newRating\n"
+        @"end open"];
+
+    [table addScriptNamed:@"setRating" source:
+        @"on open args\n"
+        @"  return item 1 of args\n"
+        @"end open"];
+
+    [table addScriptNamed:@"playlist" source:
+        @"on open args\n"
+        @"  return \"Playlist \" & item 1 of args\n"
+        @"end open"];
+}
+
+// what the stand-in script for hotKey should answer
+static NSString *WOExpectedResult(const WOTestHotKey *hotKey)
+{
+    NSString *name = [NSString stringWithUTF8String:hotKey->script];
+    if ([name isEqualToString:@"changeVolume"])
+        return [NSString stringWithFormat:@"%d", 50 + hotKey->parameter * 100 / 16];
+    if ([name isEqualToString:@"changeRating"])
+        return hotKey->parameter > 0 ? @"60" : @"40";
+    if ([name isEqualToString:@"setRating"])
+        return [NSString stringWithFormat:@"%d", hotKey->parameter];
+    if ([name isEqualToString:@"playlist"])
+        return [NSString stringWithFormat:@"Playlist %d", hotKey->parameter];
+    return @"SUCCESS";
+}
+
+static NSString *WOPress(WOAppleScriptTable *table, const WOTestHotKey *hotKey)
+{
+    NSString *name = [NSString stringWithUTF8String:hotKey->script];
+    NSAppleEventDescriptor *result;
+    if (hotKey->parameter == -1)
+        result = [table runScriptNamed:name];
+    else if ([name isEqualToString:@"playlist"])
+        result = [table runScriptNamed:name parameters:
+            [NSArray arrayWithObject:[NSString stringWithFormat:@"%d", hotKey->parameter]]];
+    else
+        result = [table runScriptNamed:name parameters:
+            [NSArray arrayWithObject:[NSNumber numberWithInt:hotKey->parameter]]];
+
+    // numbers come back as integers and strings as text; stringValue coerces either
+    return [result stringValue];
+}
+
+static void WOTestNoRecompilation(void)
+{
+    WOAppleScriptTable *table = [[WOAppleScriptTable alloc] init];
+    WOAddScripts(table);
+    WO_EXPECT([table compilationCount] == 0, "nothing is compiled when scripts are added");
+    [table compileAll];
+    WO_EXPECT([table compilationCount] == WO_TEST_SCRIPT_COUNT, "compileAll compiles every script once");
+    [table compileAll];
+    WO_EXPECT([table compilationCount] == WO_TEST_SCRIPT_COUNT, "compileAll leaves compiled scripts alone");
+
+    unsigned wrong = 0;
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    for (unsigned i = 0; i < WO_TEST_PRESS_COUNT; i++)
+    {
+        const WOTestHotKey *hotKey = &WOTestHotKeys[i % WO_TEST_HOT_KEY_COUNT];
+        if (![WOPress(table, hotKey) isEqualToString:WOExpectedResult(hotKey)])
+            wrong++;
+    }
+    NSTimeInterval elapsed = [NSDate timeIntervalSinceReferenceDate] - start;
+    printf("%u presses in %.2f s (%.1f us each); %u compilations\n", WO_TEST_PRESS_COUNT, elapsed,
+           elapsed * 1e6 / WO_TEST_PRESS_COUNT, [table compilationCount]);
+    printf("%s\n", [[table statisticsDescription] UTF8String]);
+    WO_EXPECT(wrong == 0, "every press gets the right result");
+    WO_EXPECT([table compilationCount] == WO_TEST_SCRIPT_COUNT, "no recompilation across the presses");
+}
+
+static void WOTestLazyAndFailedCompilation(void)
+{
+    WOAppleScriptTable *table = [[WOAppleScriptTable alloc] init];
+    WOAddScripts(table);
+    [table addScriptNamed:@"broken" source:@"return ("];
+
+    // without compileAll, the first run compiles and later runs do not
+    for (unsigned i = 0; i < 100; i++)
+        WOPress(table, &WOTestHotKeys[0]);
+    WO_EXPECT([table compilationCount] == 1, "a script is compiled on first use, once");
+
+    // a script that does not compile is tried again, and counted, every time
+    for (unsigned i = 0; i < 3; i++)
+        WO_EXPECT([table runScriptNamed:@"broken"] == nil, "a script that does not compile returns nil");
+    WO_EXPECT([table compilationCount] == 4, "every attempt to compile a broken script is counted");
+    [table compileAll];
+    WO_EXPECT([table compilationCount] == 4 + WO_TEST_SCRIPT_COUNT, "compileAll compiles the rest and retries it");
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    WOTestNoRecompilation();
+    WOTestLazyAndFailedCompilation();
+    [pool drain];
+    return WO_TEST_RESULT();
+}
@@ -0,0 +1,198 @@
+// WOPlayerPollSchedulerTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Runs WOPlayerPollScheduler against simulated players for an hour of simulated time each, polling the way
+// SynergyController does (a snapshot, changesSince: the last one, then intervalAfterSnapshot:changes: until the next
+// poll), and prints the wakeups per hour next to those of a poll every base interval. Checks that playing an album takes
+// well under a third of the fixed-interval wakeups while seeing each new track within a second and a half of its start,
+// that idle players back off to the two-minute ceiling, and that a player that sends notifications is hardly polled.
+
+// system headers
+#import <Foundation/Foundation.h>
+
+// other headers
+#import "WOPlayerPollScheduler.h"
+#import "WOPlayerSnapshot.h"
+#import "WOTestExpect.h"
+
+#define WO_TEST_HOUR                3600.0
+
+//! Must match the scheduler's WO_MAX_IDLE_POLLING_INTERVAL
+#define WO_TEST_MAX_IDLE_INTERVAL   120.0
+
+//! The scheduler aims to land WO_TRACK_END_SLACK after the end of a track; positions are whole seconds, so it can be up
+//! to a second later than that
+#define WO_TEST_LATENCY_ALLOWANCE   1.5
+
+//! Track lengths in seconds for the simulated album, which repeats
+static const int WOTestTrackLengths[] = { 187, 243, 305, 412, 198, 276, 221, 354, 263, 199, 318, 240, 287, 230 };
+
+#define WO_TEST_TRACK_COUNT         (sizeof(WOTestTrackLengths) / sizeof(WOTestTrackLengths[0]))
+
+//! The album's strings, made once and handed out again for every snapshot of the same track, as a backend does
+static NSString *WOTestTrackKeys[WO_TEST_TRACK_COUNT];
+static NSString *WOTestTitles[WO_TEST_TRACK_COUNT];
+static NSString *WOTestDurations[WO_TEST_TRACK_COUNT];
+
+//! What a simulated player reports at a given second
+typedef WOPlayerSnapshot *(*WOPlayerModel)(NSTimeInterval time);
+
+static void WOMakeAlbum(void)
+{
+    for (unsigned i = 0; i < WO_TEST_TRACK_COUNT; i++)
+    {
+        WOTestTrackKeys[i]  = [[NSString alloc] initWithFormat:@"%u", i];
+        WOTestTitles[i]     = [[NSString alloc] initWithFormat:@"Track %u", i + 1];
+        WOTestDurations[i]  = [[NSString alloc] initWithFormat:@"%d:%02d", WOTestTrackLengths[i] / 60,
+                               WOTestTrackLengths[i] % 60];
+    }
+}
+
+// the track playing at time, and when it started
+static unsigned WOAlbumTrackAt(NSTimeInterval time, NSTimeInterval *start)
+{
+    NSTimeInterval trackStart = 0.0;
+    for (unsigned i = 0; ; i = (i + 1) % WO_TEST_TRACK_COUNT)
+    {
+        if (time < trackStart + WOTestTrackLengths[i])
+        {
+            if (start)
+                *start = trackStart;
+            return i;
+        }
+        trackStart += WOTestTrackLengths[i];
+    }
+}
+
+static WOPlayerSnapshot *WOTrackSnapshot(WOPlayerState state, unsigned track, NSString *duration, int position)
+{
+    return [[WOPlayerSnapshot alloc] initWithState:state
+                                   trackIdentifier:nil
+                                          trackKey:WOTestTrackKeys[track]
+                                             title:WOTestTitles[track]
+                                             album:@"Simulated Album"
+                                            artist:@"Simulated Artist"
+                                          composer:@""
+                                          duration:duration
+                                              year:@"2026"
+                                            rating:60
+                                        repeatMode:WORepeatAll
+                                      shuffleState:WOShuffleOff
+                                          position:position];
+}
+
+static WOPlayerSnapshot *WOPlayingAlbum(NSTimeInterval time)
+{
+    NSTimeInterval start;
+    unsigned track = WOAlbumTrackAt(time, &start);
+    return WOTrackSnapshot(WOPlayerPlaying, track, WOTestDurations[track], (int)(time - start));
+}
+
+static WOPlayerSnapshot *WOPausedAlbum(NSTimeInterval time)
+{
+    return WOTrackSnapshot(WOPlayerPaused, 0, WOTestDurations[0], 42);
+}
+
+// Internet radio: playing, but no duration to aim for
+static WOPlayerSnapshot *WOPlayingRadio(NSTimeInterval time)
+{
+    return WOTrackSnapshot(WOPlayerPlaying, 0, @"", (int)time);
+}
+
+static WOPlayerSnapshot *WONotRunning(NSTimeInterval time)
+{
+    return [WOPlayerSnapshot snapshotWithState:WOPlayerNotRunning];
+}
+
+// polls model for an hour of simulated time from a scheduler set up as the controller does, returning the number of
+// polls; for the album, also the longest a new track went unseen
+static unsigned WOWakeupsPerHour(WOPlayerModel model, NSTimeInterval base, BOOL notifying, NSTimeInterval *latency)
+{
+    WOPlayerPollScheduler *scheduler = [[WOPlayerPollScheduler alloc] initWithBaseInterval:base];
+    scheduler.playerSendsNotifications = notifying;
+    WOPlayerSnapshot *last = nil;
+    NSTimeInterval longest = 0.0;
+    unsigned wakeups = 0;
+    for (NSTimeInterval now = 0.0; now < WO_TEST_HOUR; )
+    {
+        WOPlayerSnapshot *snapshot = model(now);
+        WOPlayerChanges changes = [snapshot changesSince:last];
+        wakeups++;
+        if (last && (changes & WOPlayerChangedTrack) && model == WOPlayingAlbum)
+        {
+            NSTimeInterval start;
+            (void)WOAlbumTrackAt(now, &start);
+            longest = MAX(longest, now - start);
+        }
+        last = snapshot;
+        now += [scheduler intervalAfterSnapshot:snapshot changes:changes];
+    }
+    if (latency)
+        *latency = longest;
+    return wakeups;
+}
+
+static void WOTestPlaying(void)
+{
+    NSTimeInterval bases[] = { 1.0, 2.0, 5.0, 10.0 };
+    for (unsigned i = 0; i < sizeof(bases) / sizeof(bases[0]); i++)
+    {
+        NSTimeInterval latency;
+        unsigned wakeups = WOWakeupsPerHour(WOPlayingAlbum, bases[i], NO, &latency);
+        unsigned fixed = (unsigned)(WO_TEST_HOUR / bases[i]);
+        printf("album, base %4.1f s: %4u wakeups per hour (fixed interval: %4u), new track seen within %.1f s "
+               "(fixed interval: %.1f s)\n", bases[i], wakeups, fixed, latency, bases[i]);
+        WO_EXPECT(wakeups * 3 < fixed, "playing takes well under a third of the fixed-interval wakeups");
+        WO_EXPECT(latency <= WO_TEST_LATENCY_ALLOWANCE, "new tracks are seen just after they start");
+
+        unsigned radio = WOWakeupsPerHour(WOPlayingRadio, bases[i], NO, NULL);
+        printf("radio, base %4.1f s: %4u wakeups per hour\n", bases[i], radio);
+        WO_EXPECT(radio == fixed, "without a duration, polls come at the base interval");
+    }
+}
+
+static void WOTestIdle(void)
+{
+    // at most one doubling per poll from the base interval up to the ceiling, then the ceiling for the rest of the hour
+    unsigned ceiling = (unsigned)(WO_TEST_HOUR / WO_TEST_MAX_IDLE_INTERVAL) + 8;
+    unsigned paused = WOWakeupsPerHour(WOPausedAlbum, 1.0, NO, NULL);
+    unsigned stopped = WOWakeupsPerHour(WONotRunning, 1.0, NO, NULL);
+    printf("paused: %u wakeups per hour, not running: %u wakeups per hour (fixed interval: %u)\n", paused, stopped,
+           (unsigned)WO_TEST_HOUR);
+    WO_EXPECT(paused <= ceiling, "a paused player backs off to the ceiling");
+    WO_EXPECT(stopped <= ceiling, "a player that is not running backs off to the ceiling");
+
+    // a change drops the interval back to the base
+    WOPlayerPollScheduler *scheduler = [[WOPlayerPollScheduler alloc] initWithBaseInterval:2.0];
+    WOPlayerSnapshot *snapshot = WOPausedAlbum(0.0);
+    WO_EXPECT([scheduler intervalAfterSnapshot:snapshot changes:WOPlayerChangedEverything] == 2.0, "first poll");
+    WO_EXPECT([scheduler intervalAfterSnapshot:snapshot changes:WOPlayerChangedNothing] == 4.0, "doubles");
+    WO_EXPECT([scheduler intervalAfterSnapshot:snapshot changes:WOPlayerChangedNothing] == 8.0, "doubles again");
+    WO_EXPECT([scheduler intervalAfterSnapshot:snapshot changes:WOPlayerChangedPosition] == 16.0,
+              "a position change alone does not end the back-off");
+    WO_EXPECT([scheduler intervalAfterSnapshot:snapshot changes:WOPlayerChangedTitle] == 2.0, "a change ends it");
+    WO_EXPECT([scheduler intervalAfterSnapshot:snapshot changes:WOPlayerChangedNothing] == 4.0, "and it starts over");
+    scheduler.baseInterval = 3.0;
+    WO_EXPECT([scheduler intervalAfterSnapshot:snapshot changes:WOPlayerChangedNothing] == 6.0,
+              "a new base interval ends the back-off too");
+}
+
+static void WOTestNotifying(void)
+{
+    unsigned wakeups = WOWakeupsPerHour(WOPlayingAlbum, 1.0, YES, NULL);
+    printf("notifying player: %u wakeups per hour\n", wakeups);
+    WO_EXPECT(wakeups == 1, "a player that sends notifications is polled once, as a fallback");
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    WOMakeAlbum();
+    WOTestPlaying();
+    WOTestIdle();
+    WOTestNotifying();
+    [pool drain];
+    return WO_TEST_RESULT();
+}
@@ -0,0 +1,359 @@
+// WOPlayerQueueTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Puts WOPlayerQueue in front of a stand-in backend that is slow, or held still at a gate, and checks that the main thread
+// never waits for it, that snapshot requests made while one is already waiting are answered by a single snapshot, that
+// queued commands go ahead of a waiting snapshot, and that commands beyond the queue's capacity are dropped. Prints how
+// long the queue's methods took on the main thread and exits non-zero if anything fails.
+
+// system headers
+#import <Foundation/Foundation.h>
+
+// other headers
+#import "WOPlayerQueue.h"
+#import "WOPlayerSnapshot.h"
+#import "WOTestExpect.h"
+
+#define WO_GATE_CLOSED                  0
+#define WO_GATE_OPEN                    1
+
+//! Seconds to wait for the worker to get somewhere
+#define WO_TEST_TIMEOUT                 5.0
+
+//! Longest a call to the queue may take on the main thread
+#define WO_TEST_CALL_ALLOWANCE          0.01
+
+//! Must match the queue's WO_PLAYER_QUEUE_CAPACITY
+#define WO_TEST_QUEUE_CAPACITY          16
+
+//! How long each call takes the slow backend
+#define WO_TEST_SLOW_DELAY              0.2
+
+//! The main thread's own timer, standing in for the controller's
+#define WO_TEST_HEARTBEAT_INTERVAL      0.01
+
+//! Longest the heartbeat may go without firing while the slow backend is busy (the scheduler adds some jitter)
+#define WO_TEST_HEARTBEAT_ALLOWANCE     0.1
+
+//! Seconds over which the slow backend is polled
+#define WO_TEST_SLOW_PERIOD             1.0
+
+//! Poll interval in the slow test; well under the backend's delay, as when iTunes is busy
+#define WO_TEST_POLL_INTERVAL           0.05
+
+//! A backend that records every call it gets, takes delay seconds over each, and can be held at a gate
+@interface WOSlowPlayer : NSObject <WOPlayerBackend> {
+
+@public
+    //! Guards calls and mainThreadCalls
+    NSLock          *lock;
+
+    //! Name of every backend method called, in order
+    NSMutableArray  *calls;
+
+    //! Backend methods called on the main thread, which should be none
+    unsigned        mainThreadCalls;
+
+    //! Calls wait here while it is WO_GATE_CLOSED
+    NSConditionLock *gate;
+
+    NSTimeInterval  delay;
+
+    //! Only ever touched by the worker thread
+    int             volume;
+}
+
+- (id)initWithDelay:(NSTimeInterval)aDelay gate:(int)aCondition;
+
+- (void)closeGate;
+- (void)openGate;
+
+//! Copy of calls
+- (NSArray *)callNames;
+
+@end
+
+@implementation WOSlowPlayer
+
+- (id)initWithDelay:(NSTimeInterval)aDelay gate:(int)aCondition
+{
+    if ((self = [super init]))
+    {
+        lock    = [[NSLock alloc] init];
+        calls   = [[NSMutableArray alloc] init];
+        gate    = [[NSConditionLock alloc] initWithCondition:aCondition];
+        delay   = aDelay;
+    }
+    return self;
+}
+
+- (void)closeGate
+{
+    [gate lock];
+    [gate unlockWithCondition:WO_GATE_CLOSED];
+}
+
+- (void)openGate
+{
+    [gate lock];
+    [gate unlockWithCondition:WO_GATE_OPEN];
+}
+
+- (NSArray *)callNames
+{
+    [lock lock];
+    NSArray *names = [calls copy];
+    [lock unlock];
+    return names;
+}
+
+// recorded on arrival, so that the test can see what the worker is stuck in
+- (void)enter:(SEL)aSelector
+{
+    [lock lock];
+    [calls addObject:NSStringFromSelector(aSelector)];
+    if ([NSThread isMainThread])
+        mainThreadCalls++;
+    [lock unlock];
+    [gate lockWhenCondition:WO_GATE_OPEN];
+    [gate unlock];
+    if (delay > 0.0)
+        [NSThread sleepForTimeInterval:delay];
+}
+
+- (void)setDelegate:(id <WOPlayerBackendDelegate>)aDelegate {}
+- (void)prepare                 { [self enter:_cmd]; }
+- (BOOL)sendsNotifications      { return NO; }
+- (BOOL)isRunning               { return YES; }
+- (BOOL)isFrontmost             { return NO; }
+- (BOOL)launch                  { return YES; }
+- (void)quit                    { [self enter:_cmd]; }
+- (void)activate                { [self enter:_cmd]; }
+- (void)hide                    { [self enter:_cmd]; }
+
+// a new object every time, so that the test can tell snapshots apart
+- (WOPlayerSnapshot *)snapshot
+{
+    [self enter:_cmd];
+    return [WOPlayerSnapshot snapshotWithState:WOPlayerNotPlaying];
+}
+
+- (void)playPause               { [self enter:_cmd]; }
+- (void)nextTrack               { [self enter:_cmd]; }
+- (void)backTrack               { [self enter:_cmd]; }
+- (void)previousTrack           { [self enter:_cmd]; }
+- (void)fastForward             { [self enter:_cmd]; }
+- (void)rewind                  { [self enter:_cmd]; }
+- (void)resume                  { [self enter:_cmd]; }
+- (BOOL)playTrack:(id)anIdentifier  { [self enter:_cmd]; return NO; }
+- (int)setRating:(int)aRating   { [self enter:_cmd]; return aRating; }
+- (int)increaseRating           { [self enter:_cmd]; return -1; }
+- (int)decreaseRating           { [self enter:_cmd]; return -1; }
+- (int)volumeUp                 { [self enter:_cmd]; return ++volume; }
+- (int)volumeDown               { [self enter:_cmd]; return --volume; }
+- (int)toggleMute               { [self enter:_cmd]; return 0; }
+- (BOOL)setShuffle:(BOOL)flag   { [self enter:_cmd]; return YES; }
+- (WOShuffleState)toggleShuffle { [self enter:_cmd]; return WOShuffleUnknown; }
+- (BOOL)setRepeatMode:(WORepeatMode)aMode   { [self enter:_cmd]; return YES; }
+- (WORepeatMode)cycleRepeatMode { [self enter:_cmd]; return WORepeatUnknown; }
+- (NSArray *)playlistNames      { [self enter:_cmd]; return nil; }
+- (BOOL)playPlaylistNamed:(NSString *)aName activate:(BOOL)flag { [self enter:_cmd]; return NO; }
+- (NSData *)artworkOfCurrentTrack   { [self enter:_cmd]; return nil; }
+- (BOOL)setArtworkOfCurrentTrack:(NSImage *)anImage { [self enter:_cmd]; return NO; }
+- (NSString *)statisticsDescription { return nil; }
+
+@end
+
+//! Collects what the queue delivers, and keeps a heartbeat going on the main thread
+@interface WOQueueTestReceiver : NSObject {
+
+@public
+    NSMutableArray  *snapshots;
+    NSMutableArray  *results;
+
+    //! Deliveries that did not come on the main thread, which should be none
+    unsigned        offMainThread;
+
+    NSTimeInterval  lastBeat;
+    NSTimeInterval  longestGap;
+}
+
+@end
+
+@implementation WOQueueTestReceiver
+
+- (id)init
+{
+    if ((self = [super init]))
+    {
+        snapshots   = [[NSMutableArray alloc] init];
+        results     = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)snapshotArrived:(WOPlayerSnapshot *)aSnapshot
+{
+    if (![NSThread isMainThread])
+        offMainThread++;
+    [snapshots addObject:aSnapshot];
+}
+
+- (void)resultArrived:(id)aResult
+{
+    if (![NSThread isMainThread])
+        offMainThread++;
+    [results addObject:(aResult ? aResult : [NSNull null])];
+}
+
+- (void)beat:(NSTimer *)aTimer
+{
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (lastBeat > 0.0)
+        longestGap = MAX(longestGap, now - lastBeat);
+    lastBeat = now;
+}
+
+@end
+
+// runs the main run loop until the player has been called count times, or the timeout passes
+static BOOL WOWaitForCalls(WOSlowPlayer *player, NSUInteger count)
+{
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:WO_TEST_TIMEOUT];
+    while ([[player callNames] count] < count && [limit timeIntervalSinceNow] > 0)
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    return [[player callNames] count] >= count;
+}
+
+// lets results already on their way arrive
+static void WOSettle(void)
+{
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+}
+
+static NSArray *WOCallsAfter(WOSlowPlayer *player, NSUInteger index)
+{
+    NSArray *names = [player callNames];
+    return [names subarrayWithRange:NSMakeRange(index, [names count] - index)];
+}
+
+// with the worker held at the gate, the order in which it serves everything queued meanwhile
+static void WOTestOrderAndCollapsing(void)
+{
+    WOSlowPlayer        *player = [[WOSlowPlayer alloc] initWithDelay:0.0 gate:WO_GATE_CLOSED];
+    WOQueueTestReceiver *a      = [[WOQueueTestReceiver alloc] init];
+    WOQueueTestReceiver *b      = [[WOQueueTestReceiver alloc] init];
+    WOPlayerQueue       *queue  = [[WOPlayerQueue alloc] initWithPlayer:player];
+    WO_EXPECT(WOWaitForCalls(player, 1), "worker prepares the backend");
+
+    // the worker is stuck in prepare; none of this may wait for it
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    for (unsigned i = 0; i < 5; i++)
+        [queue requestSnapshotForTarget:a selector:@selector(snapshotArrived:)];
+    [queue requestSnapshotForTarget:b selector:@selector(snapshotArrived:)];
+    [queue sendCommand:@selector(volumeUp) arguments:nil target:a selector:@selector(resultArrived:)];
+    [queue sendCommand:@selector(playPause)];
+    [queue sendCommand:@selector(setRating:) arguments:[NSArray arrayWithObject:[NSNumber numberWithInt:80]]
+                target:a selector:@selector(resultArrived:)];
+    [queue sendCommand:@selector(volumeUp) arguments:nil target:a selector:@selector(resultArrived:)];
+    NSTimeInterval elapsed = [NSDate timeIntervalSinceReferenceDate] - start;
+    printf("10 requests to a stalled backend took %.3f ms on the main thread\n", elapsed * 1000.0);
+    WO_EXPECT(elapsed < WO_TEST_CALL_ALLOWANCE, "requests do not wait for a stalled backend");
+
+    [player openGate];
+    WO_EXPECT(WOWaitForCalls(player, 6), "worker serves the queue");
+    WOSettle();
+    NSArray *expected = [NSArray arrayWithObjects:@"prepare", @"volumeUp", @"playPause", @"setRating:", @"volumeUp",
+                         @"snapshot", nil];
+    WO_EXPECT([[player callNames] isEqualToArray:expected], "commands go ahead of the snapshot, which is taken once");
+    WO_EXPECT([a->snapshots count] == 1 && [b->snapshots count] == 1, "each target hears about the snapshot once");
+    WO_EXPECT([a->snapshots lastObject] == [b->snapshots lastObject], "both targets get the same snapshot");
+    expected = [NSArray arrayWithObjects:[NSNumber numberWithInt:1], [NSNumber numberWithInt:80],
+                [NSNumber numberWithInt:2], nil];
+    WO_EXPECT([a->results isEqualToArray:expected], "command results come back in order");
+
+    // requests made while a snapshot is being taken need a later one; a command still goes first
+    [player closeGate];
+    [queue requestSnapshotForTarget:a selector:@selector(snapshotArrived:)];
+    WO_EXPECT(WOWaitForCalls(player, 7), "worker starts a second snapshot");
+    for (unsigned i = 0; i < 3; i++)
+        [queue requestSnapshotForTarget:a selector:@selector(snapshotArrived:)];
+    [queue requestSnapshotForTarget:b selector:@selector(snapshotArrived:)];
+    [queue sendCommand:@selector(nextTrack)];
+    [player openGate];
+    WO_EXPECT(WOWaitForCalls(player, 9), "worker serves the second round");
+    WOSettle();
+    expected = [NSArray arrayWithObjects:@"snapshot", @"nextTrack", @"snapshot", nil];
+    WO_EXPECT([WOCallsAfter(player, 6) isEqualToArray:expected],
+              "requests made during a snapshot are answered by one more snapshot, after the command");
+    WO_EXPECT([a->snapshots count] == 3 && [b->snapshots count] == 2, "second round delivered to both targets");
+    WO_EXPECT([a->snapshots objectAtIndex:1] != [a->snapshots objectAtIndex:2], "the later snapshot is a new one");
+    WO_EXPECT([a->snapshots lastObject] == [b->snapshots lastObject], "the later snapshot answers both targets");
+
+    // capacity: with the worker stuck in a command, only WO_TEST_QUEUE_CAPACITY more fit
+    [player closeGate];
+    [queue sendCommand:@selector(playPause)];
+    WO_EXPECT(WOWaitForCalls(player, 10), "worker takes the blocking command");
+    unsigned accepted = 0;
+    for (unsigned i = 0; i < WO_TEST_QUEUE_CAPACITY + 4; i++)
+        if ([queue sendCommand:@selector(volumeDown)])
+            accepted++;
+    WO_EXPECT(accepted == WO_TEST_QUEUE_CAPACITY, "commands beyond the capacity are dropped");
+    [player openGate];
+    WO_EXPECT(WOWaitForCalls(player, 10 + WO_TEST_QUEUE_CAPACITY), "accepted commands are served");
+    WOSettle();
+    WO_EXPECT([[player callNames] count] == 10 + WO_TEST_QUEUE_CAPACITY, "dropped commands never reach the backend");
+    WO_EXPECT(player->mainThreadCalls == 0, "backend is never called on the main thread");
+    WO_EXPECT(a->offMainThread == 0 && b->offMainThread == 0, "results are delivered on the main thread");
+}
+
+// a backend that takes WO_TEST_SLOW_DELAY over everything, polled faster than it can answer
+static void WOTestSlowBackend(void)
+{
+    WOSlowPlayer        *player     = [[WOSlowPlayer alloc] initWithDelay:WO_TEST_SLOW_DELAY gate:WO_GATE_OPEN];
+    WOQueueTestReceiver *receiver   = [[WOQueueTestReceiver alloc] init];
+    WOPlayerQueue       *queue      = [[WOPlayerQueue alloc] initWithPlayer:player];
+    [NSTimer scheduledTimerWithTimeInterval:WO_TEST_HEARTBEAT_INTERVAL
+                                     target:receiver
+                                   selector:@selector(beat:)
+                                   userInfo:nil
+                                    repeats:YES];
+
+    NSTimeInterval longestCall = 0.0;
+    unsigned requests = 0;
+    NSDate *end = [NSDate dateWithTimeIntervalSinceNow:WO_TEST_SLOW_PERIOD];
+    while ([end timeIntervalSinceNow] > 0)
+    {
+        NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+        [queue requestSnapshotForTarget:receiver selector:@selector(snapshotArrived:)];
+        if (requests++ % 2)
+            [queue sendCommand:@selector(volumeUp) arguments:nil target:receiver selector:@selector(resultArrived:)];
+        longestCall = MAX(longestCall, [NSDate timeIntervalSinceReferenceDate] - start);
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:WO_TEST_POLL_INTERVAL]];
+    }
+    NSUInteger served = [[player callNames] count];
+    printf("slow backend: %u polls, %lu backend calls, %lu snapshots delivered; longest queue call %.3f ms, "
+           "longest heartbeat gap %.1f ms\n", requests, (unsigned long)served, (unsigned long)[receiver->snapshots count],
+           longestCall * 1000.0, receiver->longestGap * 1000.0);
+    WO_EXPECT(longestCall < WO_TEST_CALL_ALLOWANCE, "queue calls do not wait for a slow backend");
+    WO_EXPECT(receiver->longestGap < WO_TEST_HEARTBEAT_ALLOWANCE, "main thread keeps running while the backend is busy");
+    WO_EXPECT(served <= WO_TEST_SLOW_PERIOD / WO_TEST_SLOW_DELAY + 2, "backend works at its own pace");
+    WO_EXPECT([receiver->snapshots count] < requests / 2, "polls outrunning the backend are collapsed");
+    WO_EXPECT(player->mainThreadCalls == 0, "slow backend is never called on the main thread");
+    printf("%s", [[queue statisticsDescription] UTF8String]);
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+    // without a source the run loop would return at once instead of waiting
+    [[NSRunLoop currentRunLoop] addPort:[NSPort port] forMode:NSDefaultRunLoopMode];
+
+    WOTestOrderAndCollapsing();
+    WOTestSlowBackend();
+    [pool drain];
+    return WO_TEST_RESULT();
+}
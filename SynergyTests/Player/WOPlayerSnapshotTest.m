@@ -0,0 +1,254 @@
+// WOPlayerSnapshotTest.m
+// Synergy
+//
+// Copyright 2026-present Greg Hurrell. All rights reserved.
+//
+// Checks WOPlayerSnapshot's changesSince: field by field, and both ways of finding a string unchanged: the pointer
+// comparison taken when a backend hands out the same string object again, which must not fall back to comparing
+// characters, and the character comparison for equal strings that are different objects. Prints how long each takes.
+
+// system headers
+#import <Foundation/Foundation.h>
+
+// other headers
+#import "WOPlayerSnapshot.h"
+#import "WOTestExpect.h"
+
+//! Number of changesSince: calls timed for each path
+#define WO_TEST_TIMING_COUNT    1000000
+
+//! Number of fields compared by changesSince:, one change bit each
+#define WO_TEST_FIELD_COUNT     12
+
+//! An immutable string that counts the isEqualToString: messages it gets, so that the test can tell which path
+//! changesSince: took
+@interface WOCountingString : NSString {
+
+    NSString    *backing;
+
+@public
+    unsigned    comparisons;
+}
+
+- (id)initWithString:(NSString *)aString;
+
+@end
+
+@implementation WOCountingString
+
+- (id)initWithString:(NSString *)aString
+{
+    if ((self = [super init]))
+        backing = [aString copy];
+    return self;
+}
+
+- (NSUInteger)length
+{
+    return [backing length];
+}
+
+- (unichar)characterAtIndex:(NSUInteger)index
+{
+    return [backing characterAtIndex:index];
+}
+
+- (void)getCharacters:(unichar *)buffer range:(NSRange)aRange
+{
+    [backing getCharacters:buffer range:aRange];
+}
+
+// immutable, so a copy can be the same object, as it is for other immutable strings
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+- (BOOL)isEqualToString:(NSString *)aString
+{
+    comparisons++;
+    return [backing isEqualToString:aString];
+}
+
+@end
+
+//! Everything a snapshot is made from
+typedef struct WOTestFields {
+    WOPlayerState   state;
+    NSString        *trackKey;
+    NSString        *title;
+    NSString        *album;
+    NSString        *artist;
+    NSString        *composer;
+    NSString        *duration;
+    NSString        *year;
+    int             rating;
+    WORepeatMode    repeatMode;
+    WOShuffleState  shuffleState;
+    int             position;
+} WOTestFields;
+
+static WOPlayerSnapshot *WOSnapshotWithFields(WOTestFields fields)
+{
+    return [[WOPlayerSnapshot alloc] initWithState:fields.state
+                                   trackIdentifier:nil
+                                          trackKey:fields.trackKey
+                                             title:fields.title
+                                             album:fields.album
+                                            artist:fields.artist
+                                          composer:fields.composer
+                                          duration:fields.duration
+                                              year:fields.year
+                                            rating:fields.rating
+                                        repeatMode:fields.repeatMode
+                                      shuffleState:fields.shuffleState
+                                          position:fields.position];
+}
+
+static WOTestFields WOBaseFields(void)
+{
+    WOTestFields fields = {
+        WOPlayerPlaying, @"1234", @"Hoppípolla", @"Takk...", @"Sigur Rós", @"Jón Þór Birgisson", @"4:28", @"2005", 80,
+        WORepeatOff, WOShuffleOn, 30
+    };
+    return fields;
+}
+
+// equal strings that are different objects
+static NSString *WOFreshCopy(NSString *aString)
+{
+    return [NSString stringWithString:[NSMutableString stringWithString:aString]];
+}
+
+static NSString *WOChanged(NSString *aString)
+{
+    return [aString stringByAppendingString:@" (Live)"];
+}
+
+// fields with only field number index (in change bit order) different
+static WOTestFields WOFieldsChangedAt(WOTestFields fields, unsigned index)
+{
+    switch (index)
+    {
+        case 0:     fields.state        = WOPlayerPaused;               break;
+        case 1:     fields.trackKey     = WOChanged(fields.trackKey);   break;
+        case 2:     fields.title        = WOChanged(fields.title);      break;
+        case 3:     fields.album        = WOChanged(fields.album);      break;
+        case 4:     fields.artist       = WOChanged(fields.artist);     break;
+        case 5:     fields.composer     = WOChanged(fields.composer);   break;
+        case 6:     fields.duration     = @"4:29";                      break;
+        case 7:     fields.year         = @"2006";                      break;
+        case 8:     fields.rating       = 100;                          break;
+        case 9:     fields.repeatMode   = WORepeatAll;                  break;
+        case 10:    fields.shuffleState = WOShuffleOff;                 break;
+        case 11:    fields.position     = 31;                           break;
+    }
+    return fields;
+}
+
+static void WOTestFieldByField(void)
+{
+    WOTestFields        fields  = WOBaseFields();
+    WOPlayerSnapshot    *base   = WOSnapshotWithFields(fields);
+    WO_EXPECT([base changesSince:nil] == WOPlayerChangedEverything, "everything has changed since nothing");
+    WO_EXPECT([base changesSince:base] == WOPlayerChangedNothing, "nothing has changed since itself");
+
+    for (unsigned i = 0; i < WO_TEST_FIELD_COUNT; i++)
+    {
+        WOPlayerSnapshot *changed = WOSnapshotWithFields(WOFieldsChangedAt(fields, i));
+        if ([changed changesSince:base] != (WOPlayerChanges)(1 << i) || [base changesSince:changed] != (1 << i))
+        {
+            WOTestFailures++;
+            fprintf(stderr, "FAIL: changing field %u gives changes %lx and %lx, expected %x\n", i,
+                    (unsigned long)[changed changesSince:base], (unsigned long)[base changesSince:changed], 1 << i);
+        }
+    }
+
+    WOTestFields everything = fields;
+    for (unsigned i = 0; i < WO_TEST_FIELD_COUNT; i++)
+        everything = WOFieldsChangedAt(everything, i);
+    WO_EXPECT([WOSnapshotWithFields(everything) changesSince:base] == WOPlayerChangedEverything,
+              "changing every field changes everything");
+
+    // what the controller looks for
+    WOPlayerChanges changes = [WOSnapshotWithFields(WOFieldsChangedAt(fields, 2)) changesSince:base];
+    WO_EXPECT((changes & WOPlayerChangedTrackInfo) && (changes & WOPlayerChangedFloaterText), "title is track info");
+    changes = [WOSnapshotWithFields(WOFieldsChangedAt(fields, 5)) changesSince:base];
+    WO_EXPECT(!(changes & WOPlayerChangedTrackInfo) && (changes & WOPlayerChangedFloaterText),
+              "composer is floater text only");
+    changes = [WOSnapshotWithFields(WOFieldsChangedAt(fields, 11)) changesSince:base];
+    WO_EXPECT(!(changes & WOPlayerChangedFloaterText), "position is neither");
+
+    // a stopped player has no track fields
+    changes = [[WOPlayerSnapshot snapshotWithState:WOPlayerNotPlaying] changesSince:base];
+    WO_EXPECT((changes & WOPlayerChangedState) && (changes & WOPlayerChangedTrackInfo), "stopping clears the track");
+    WO_EXPECT([[WOPlayerSnapshot snapshotWithState:WOPlayerNotRunning] changesSince:
+        [WOPlayerSnapshot snapshotWithState:WOPlayerNotRunning]] == WOPlayerChangedNothing, "two empty snapshots match");
+}
+
+// the same string objects again, as a backend passes them for unchanged fields, against equal copies
+static void WOTestPointerReuse(void)
+{
+    WOTestFields fields = WOBaseFields();
+    WOCountingString *title = [[WOCountingString alloc] initWithString:fields.title];
+    fields.title = title;
+    WOPlayerSnapshot *previous = WOSnapshotWithFields(fields);
+    WO_EXPECT(previous.title == title, "snapshots keep immutable strings as they are");
+
+    WOPlayerSnapshot *reused = WOSnapshotWithFields(fields);
+    WO_EXPECT([reused changesSince:previous] == WOPlayerChangedNothing, "reused strings are unchanged");
+    WO_EXPECT(title->comparisons == 0, "reused strings are not compared character by character");
+
+    WOTestFields copied = fields;
+    copied.trackKey = WOFreshCopy(fields.trackKey);
+    copied.title    = [[WOCountingString alloc] initWithString:fields.title];
+    copied.album    = WOFreshCopy(fields.album);
+    copied.artist   = WOFreshCopy(fields.artist);
+    copied.composer = WOFreshCopy(fields.composer);
+    copied.duration = WOFreshCopy(fields.duration);
+    copied.year     = WOFreshCopy(fields.year);
+    WOPlayerSnapshot *equal = WOSnapshotWithFields(copied);
+    WO_EXPECT(equal.artist != previous.artist, "copies are different objects");
+    WO_EXPECT([equal changesSince:previous] == WOPlayerChangedNothing, "equal copies are unchanged");
+    WO_EXPECT(((WOCountingString *)copied.title)->comparisons == 1, "equal copies are compared character by character");
+
+    // a change is found either way
+    fields.album = WOChanged(fields.album);
+    WO_EXPECT([WOSnapshotWithFields(fields) changesSince:previous] == WOPlayerChangedAlbum,
+              "a new string among reused ones is seen");
+
+    // rough cost of each path
+    fields = WOBaseFields();
+    previous = WOSnapshotWithFields(fields);
+    reused = WOSnapshotWithFields(fields);
+    copied = fields;
+    copied.trackKey = WOFreshCopy(fields.trackKey);
+    copied.title    = WOFreshCopy(fields.title);
+    copied.album    = WOFreshCopy(fields.album);
+    copied.artist   = WOFreshCopy(fields.artist);
+    copied.composer = WOFreshCopy(fields.composer);
+    copied.duration = WOFreshCopy(fields.duration);
+    copied.year     = WOFreshCopy(fields.year);
+    equal = WOSnapshotWithFields(copied);
+    WOPlayerChanges seen = WOPlayerChangedNothing;
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    for (unsigned i = 0; i < WO_TEST_TIMING_COUNT; i++)
+        seen |= [reused changesSince:previous];
+    NSTimeInterval pointers = [NSDate timeIntervalSinceReferenceDate] - start;
+    start = [NSDate timeIntervalSinceReferenceDate];
+    for (unsigned i = 0; i < WO_TEST_TIMING_COUNT; i++)
+        seen |= [equal changesSince:previous];
+    NSTimeInterval characters = [NSDate timeIntervalSinceReferenceDate] - start;
+    WO_EXPECT(seen == WOPlayerChangedNothing, "no changes while timing");
+    printf("changesSince: %.0f ns with reused strings, %.0f ns with equal copies\n",
+           pointers * 1e9 / WO_TEST_TIMING_COUNT, characters * 1e9 / WO_TEST_TIMING_COUNT);
+}
+
+int main(int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    WOTestFieldByField();
+    WOTestPointerReuse();
+    [pool drain];
+    return WO_TEST_RESULT();
+}
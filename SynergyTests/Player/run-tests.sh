@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# run-tests.sh
+# Synergy
+#
+# Copyright 2026-present Greg Hurrell. All rights reserved.
+#
+# Builds each player test tool against Foundation and the classes it exercises,
+# then runs them all. Uses GNUstep (gnustep-config) where it is installed and the
+# Mac OS X developer tools otherwise; the AppleScript test needs Mac OS X.
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$HERE/../.." && pwd)
+BUILD=${BUILD:-"${TMPDIR:-/tmp}/synergy-player-test"}
+APP="$ROOT/SynergyApp/Classes"
+COMMON="$ROOT/SynergyCommon/Classes"
+
+if command -v gnustep-config >/dev/null 2>&1; then
+  OBJCFLAGS=$(gnustep-config --objc-flags)
+  LIBS=$(gnustep-config --base-libs)
+else
+  OBJCFLAGS="-x objective-c"
+  LIBS="-framework Foundation"
+fi
+
+build() {
+  name=$1
+  shift
+  # shellcheck disable=SC2086
+  ${CC:-cc} $OBJCFLAGS ${CFLAGS:-"-g -O0"} \
+    -I"$APP" -I"$COMMON" -I"$ROOT/SynergyTests" \
+    -o "$BUILD/$name" "$HERE/$name.m" "$@" \
+    $LIBS
+}
+
+mkdir -p "$BUILD"
+TESTS="WOPlayerQueueTest WOPlayerSnapshotTest WOPlayerPollSchedulerTest"
+build WOPlayerQueueTest "$APP/WOPlayerQueue.m" "$APP/WOPlayerSnapshot.m"
+build WOPlayerSnapshotTest "$APP/WOPlayerSnapshot.m"
+build WOPlayerPollSchedulerTest "$APP/WOPlayerPollScheduler.m" "$APP/WOPlayerSnapshot.m"
+if [ "$(uname)" = Darwin ]; then
+  TESTS="$TESTS WOAppleScriptTableTest"
+  build WOAppleScriptTableTest -I"$ROOT/SynergyApp/Categories" \
+    "$APP/WOAppleScriptTable.m" "$ROOT/SynergyApp/Categories/NSAppleScript+WOAdditions.m" \
+    -framework Cocoa
+fi
+
+status=0
+for test in $TESTS; do
+  echo "== $test"
+  "$BUILD/$test" || status=1
+done
+exit $status
@@ -0,0 +1,26 @@
+//
+//  WOTestExpect.h
+//  Synergy
+//
+//  Created by Greg Hurrell on 18 October 2026.
+//  Copyright 2026-present Greg Hurrell.
+//
+//  Checks shared by the test tools under SynergyTests. Each tool is a single main() that reports every failed
+//  expectation on stderr and exits non-zero if there were any.
+
+#import <stdio.h>
+
+//! Number of failed expectations so far
+static unsigned WOTestFailures;
+
+#define WO_EXPECT(condition, description)                                           \
+    do {                                                                            \
+        if (!(condition))                                                           \
+        {                                                                           \
+            WOTestFailures++;                                                       \
+            fprintf(stderr, "FAIL: %s (%s:%d)\n", description, __FILE__, __LINE__); \
+        }                                                                           \
+    } while (0)
+
+//! Prints the verdict and yields the exit status for main()
+#define WO_TEST_RESULT() (printf("%s\n", WOTestFailures ? "FAILED" : "PASSED"), WOTestFailures ? 1 : 0)